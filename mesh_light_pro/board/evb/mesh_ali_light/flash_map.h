@@ -89,6 +89,14 @@ example:
 #define BKP_DATA2_ADDR                  0x00000000
 #define BKP_DATA2_SIZE                  0x00000000  //0K Bytes
 
+/* ========== App Defined Section Flash Layout Configuration ========== */
+#define APP_DEFINED_SECTION_ADDR        0x0087A000
+#define APP_DEFINED_SECTION_SIZE        0x00006000  //24K Bytes
+#define APP_ALI_DATA_ADDR               0x0087A000  //product id and secret key of ali
+#define APP_ALI_DATA_SIZE               0x00001000  //4K Bytes
+#define APP_POWER_ON_COUNT_ADDR         0x0087B000  //power on counter of the light
+#define APP_POWER_ON_COUNT_SIZE         0x00001000  //4K Bytes
+
 /* ========== OTA Bank0 Flash Layout Configuration ========== */
 #define BANK0_OTA_HEADER_ADDR           0x00802000
 #define BANK0_OTA_HEADER_SIZE           0x00001000  //4K Bytes
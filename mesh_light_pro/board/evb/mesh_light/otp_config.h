@@ -40,7 +40,9 @@ void bt_stack_config_init(void);
 /*============================================================================*
  *                        flash configuration
  *============================================================================*/
-/** @brief support for puran flash*/
+/** @brief support for puran flash, ftl_app_cb.c replaces the rom ftl and shall be added to the
+  *        project. It can't read the data saved by the rom ftl, so only enable it on a product
+  *        whose ftl area is erased by the first download */
 #define FTL_APP_CALLBACK_ENABLE                    0
 /** @brief enable BP, set lock level depend on flash layout and selected flash id */
 #define FLASH_BLOCK_PROTECT_ENABLE                 0
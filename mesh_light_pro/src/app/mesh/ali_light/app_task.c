@@ -32,7 +32,11 @@
 #include "light_app.h"
 #include "mp_cmd.h"
 #include "board.h"
+#include "light_storage_app.h"
 #include "otp_config.h"
+#if (FTL_APP_CALLBACK_ENABLE == 1)
+#include "ftl_app_cb.h"
+#endif
 
 /*============================================================================*
  *                              Macros
@@ -43,6 +47,8 @@
 #define MAX_NUMBER_OF_GAP_MESSAGE     0x20      //!< GAP message queue size
 #define MAX_NUMBER_OF_IO_MESSAGE      0x20      //!< IO message queue size
 #define MAX_NUMBER_OF_EVENT_MESSAGE   (MAX_NUMBER_OF_GAP_MESSAGE + MAX_NUMBER_OF_IO_MESSAGE + MESH_INNER_MSG_NUM) //!< Event message queue size
+#define APP_FTL_GC_IDLE_TIME          10        //!< ms without event before an ftl gc slice
+#define APP_FTL_GC_CHECK_TIME         1000      //!< ms between checks whether ftl gc is needed
 
 /*============================================================================*
  *                              Variables
@@ -123,6 +129,14 @@ void app_main_task(void *p_param)
     mp_cmd_init(mp_cmd_table, mp_cmd_table_length());
     data_uart_init(DATA_UART_TX_PIN, DATA_UART_RX_PIN, app_send_uart_msg);
 
+    uint32_t boot_time_us[LIGHT_BOOT_PHASE_NUM];
+    light_boot_phase_mark(LIGHT_BOOT_PHASE_APP_TASK);
+    light_boot_time_get(boot_time_us);
+    APP_PRINT_INFO5("app_main_task: boot time us, main %d, light on %d, board init %d, mesh init %d, app task %d",
+                    boot_time_us[LIGHT_BOOT_PHASE_MAIN], boot_time_us[LIGHT_BOOT_PHASE_LIGHT_ON],
+                    boot_time_us[LIGHT_BOOT_PHASE_BOARD_INIT], boot_time_us[LIGHT_BOOT_PHASE_MESH_INIT],
+                    boot_time_us[LIGHT_BOOT_PHASE_APP_TASK]);
+
 #if (ROM_WATCH_DOG_ENABLE == 1)
     extern void reset_watch_dog_timer_enable(void);
     reset_watch_dog_timer_enable();
@@ -130,7 +144,13 @@ void app_main_task(void *p_param)
 
     while (true)
     {
-        if (os_msg_recv(evt_queue_handle, &event, 0xFFFFFFFF) == true)
+#if (FTL_APP_CALLBACK_ENABLE == 1)
+        /* flash is written by timers of other tasks too, so check the free pages periodically */
+        uint32_t wait_time = ftl_gc_pending_app() ? APP_FTL_GC_IDLE_TIME : APP_FTL_GC_CHECK_TIME;
+#else
+        uint32_t wait_time = 0xFFFFFFFF;
+#endif
+        if (os_msg_recv(evt_queue_handle, &event, wait_time) == true)
         {
             if (event == EVENT_IO_TO_APP)
             {
@@ -149,6 +169,13 @@ void app_main_task(void *p_param)
                 gap_handle_msg(event);
             }
         }
+#if (FTL_APP_CALLBACK_ENABLE == 1)
+        else
+        {
+            /* no event for a while, collect flash garbage a slice at a time */
+            ftl_gc_idle_app(FTL_GC_SLICE_ENTRY_NUM);
+        }
+#endif
     }
 }
 
@@ -37,6 +37,7 @@
 #include "otp_config.h"
 #include "mem_config.h"
 #include "light_swtimer.h"
+#include "light_storage_app.h"
 
 #if ALI_AIS_SUPPORT
 #include "ais.h"
@@ -77,6 +78,9 @@ void app_handle_io_msg(T_IO_MSG io_msg)
     case DFU_SERVER_TIMEOUT_MSG:
         dfu_server_adv_send();
         break;
+    case DFU_SERVER_PROGRAM_MSG:
+        dfu_server_program();
+        break;
     case AIS_SERVER_TIMEOUT_MSG:
         ais_server_adv();
         break;
@@ -98,6 +102,9 @@ void app_handle_io_msg(T_IO_MSG io_msg)
     case IO_MSG_TYPE_TIMER:
         light_handle_sw_timer_msg(&io_msg);
         break;
+    case LIGHT_POWER_FAIL_MSG:
+        light_state_flush();
+        break;
     default:
         break;
     }
@@ -763,6 +770,9 @@ T_APP_RESULT app_profile_callback(T_SERVER_ID service_id, void *p_data)
         case DFU_CB_END:
             light_dfu_server_end();
             break;
+        case DFU_CB_RESET:
+            light_dfu_server_reset();
+            break;
         default:
             break;
         }
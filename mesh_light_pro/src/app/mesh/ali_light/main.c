@@ -45,6 +45,11 @@
 #include "light_cwrgb_app.h"
 #include "light_storage_app.h"
 #include "light_config.h"
+#if LIGHT_POWER_FAIL_DETECT
+#include "rtl876x_lpc.h"
+#include "rtl876x_nvic.h"
+#include "app_msg.h"
+#endif
 #include "dfu_updater_app.h"
 
 #include "light_lightness_server_app.h"
@@ -52,6 +57,7 @@
 #include "light_hsl_server_app.h"
 #include "light_ctl_hsl_server_app.h"
 #include "light_cwrgb_server_app.h"
+#include "ali_server_app.h"
 
 #include "ota_server.h"
 #include "dfu_server.h"
@@ -85,6 +91,7 @@ void light_init(uint8_t light_type)
         break;
     }
     light_cwrgb_server_models_init();
+    ali_server_models_init(0);
 }
 
 /******************************************************************
@@ -284,11 +291,52 @@ void board_init(void)
 {
     light_driver_init();
     light_cwrgb_driver_init();
+#if LIGHT_EARLY_RESTORE
+    /* the mesh stack and models take much longer, light the last state first */
+    light_state_early_restore();
+#endif
+    light_boot_phase_mark(LIGHT_BOOT_PHASE_LIGHT_ON);
 #if (LIGHT_TYPE == LIGHT_LIGHTNESS) || (MESH_ALI_CERTIFICATION)
     light_controller_init();
 #endif
 }
 
+#if LIGHT_POWER_FAIL_DETECT
+/**
+ * @brief supply voltage drop handler, the light state is flushed in app task
+ */
+static void light_power_fail_handler(void)
+{
+    LPC_INTConfig(LPC_INT_VOLTAGE_COMP, DISABLE);
+    T_IO_MSG io_msg = {0};
+    io_msg.type = LIGHT_POWER_FAIL_MSG;
+    app_send_msg_to_apptask(&io_msg);
+}
+
+/**
+ * @brief detect supply voltage drop by the low power comparator
+ * @note the bulk capacitor shall hold the supply long enough for one flash write
+ */
+static void light_power_fail_detect_init(void)
+{
+    LPC_InitTypeDef LPC_InitStruct;
+    LPC_StructInit(&LPC_InitStruct);
+    LPC_InitStruct.LPC_Channel   = LIGHT_POWER_FAIL_CHANNEL;
+    LPC_InitStruct.LPC_Edge      = LPC_Vin_Below_Vth;
+    LPC_InitStruct.LPC_Threshold = LIGHT_POWER_FAIL_THRESHOLD;
+    LPC_Init(&LPC_InitStruct);
+    LPC_Cmd(ENABLE);
+    RamVectorTableUpdate(LPCOMP_VECTORn, light_power_fail_handler);
+
+    NVIC_InitTypeDef NVIC_InitStruct;
+    NVIC_InitStruct.NVIC_IRQChannel = LPCOMP_IRQn;
+    NVIC_InitStruct.NVIC_IRQChannelPriority = 3;
+    NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+    NVIC_Init(&NVIC_InitStruct);
+    LPC_INTConfig(LPC_INT_VOLTAGE_COMP, ENABLE);
+}
+#endif
+
 /**
  * @brief    Contains the initialization of peripherals
  * @note     Both new architecture driver and legacy driver initialization method can be used
@@ -296,7 +344,9 @@ void board_init(void)
  */
 void driver_init(void)
 {
-
+#if LIGHT_POWER_FAIL_DETECT
+    light_power_fail_detect_init();
+#endif
 }
 
 #if LIGHT_DLPS_EN
@@ -334,7 +384,9 @@ void app_exit_dlps_config(void)
 */
 bool app_dlps_check_cb(void)
 {
-    return light_check_dlps();
+    /* flash is not written in the dlps callbacks, stay awake until the store timer has written
+     * the pending light state */
+    return light_check_dlps() && !light_state_store_pending();
 }
 #endif
 
@@ -373,13 +425,16 @@ void task_init(void)
  */
 int main(void)
 {
+    light_boot_phase_mark(LIGHT_BOOT_PHASE_MAIN);
     board_init();
     driver_init();
+    light_boot_phase_mark(LIGHT_BOOT_PHASE_BOARD_INIT);
     le_gap_init(APP_MAX_LINKS);
     gap_lib_init();
     app_le_gap_init();
     app_le_profile_init();
     mesh_stack_init();
+    light_boot_phase_mark(LIGHT_BOOT_PHASE_MESH_INIT);
     pwr_mgr_init();
     task_init();
     os_sched_start();
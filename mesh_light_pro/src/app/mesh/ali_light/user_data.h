@@ -35,7 +35,7 @@ BEGIN_DECLS
  * @note this address must be equal or greater than OTA_TEMP + OTA_TEMP_SIZE address in flash map and
  *  must be 4k alignment
  */
-#define FLASH_ALI_DATA_ADDRESS    (((OTA_TMP_ADDR + OTA_TMP_SIZE + 4095)>>12)<<12)
+#define FLASH_ALI_DATA_ADDRESS    APP_ALI_DATA_ADDR
 /** @} */
 
 /**
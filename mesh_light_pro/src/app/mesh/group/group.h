@@ -251,6 +251,57 @@ bool group_transmitter_ctl_night_light(uint8_t group);
 bool group_transmitter_ctl_good_night(uint8_t group);
 
 /** @} */
+
+#if PLATFORM_HOST_SIM
+/**
+ * @defgroup Group_Sim_Exported_Functions Host Simulation Exported Functions
+ * @brief The host simulator (group_sim.c) runs many receivers and transmitters in one process,
+ *        it swaps their contexts in and out around each call.
+ * @{
+ */
+
+/**
+  * @brief get the size of the receiver context
+  * @return context size in bytes
+  */
+uint32_t group_receiver_sim_ctx_size(void);
+
+/**
+  * @brief copy out the receiver context
+  * @param[out] pctx: buffer of group_receiver_sim_ctx_size bytes
+  * @return none
+  */
+void group_receiver_sim_ctx_save(void *pctx);
+
+/**
+  * @brief replace the receiver context
+  * @param[in] pctx: context saved by group_receiver_sim_ctx_save
+  * @return none
+  */
+void group_receiver_sim_ctx_load(const void *pctx);
+
+/**
+  * @brief get the size of the transmitter context
+  * @return context size in bytes
+  */
+uint32_t group_transmitter_sim_ctx_size(void);
+
+/**
+  * @brief copy out the transmitter context
+  * @param[out] pctx: buffer of group_transmitter_sim_ctx_size bytes
+  * @return none
+  */
+void group_transmitter_sim_ctx_save(void *pctx);
+
+/**
+  * @brief replace the transmitter context
+  * @param[in] pctx: context saved by group_transmitter_sim_ctx_save
+  * @return none
+  */
+void group_transmitter_sim_ctx_load(const void *pctx);
+/** @} */
+#endif
+
 /** @} */
 
 END_DECLS
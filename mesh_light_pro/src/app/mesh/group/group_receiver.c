@@ -23,18 +23,34 @@
 
 #define GROUP_FLASH_PARAMS_EACH_TRANSMITTER_SIZE            (((1 + 1 + 6 + GROUP_RECEIVER_MAX_GROUP_NUM_EACH_TRANSMITTER + 4 + 3)/4)*4)
 
+/* open addressed index on bt address, kept sparse so unknown senders mostly hit an empty slot */
+#define GROUP_RECEIVER_HASH_BITS                            5
+#define GROUP_RECEIVER_HASH_SIZE                            (1 << GROUP_RECEIVER_HASH_BITS)
+#define GROUP_RECEIVER_HASH_MASK                            (GROUP_RECEIVER_HASH_SIZE - 1)
+#define GROUP_RECEIVER_INDEX_NULL                           0xff
+
+#if (GROUP_RECEIVER_HASH_SIZE < 2 * GROUP_RECEIVER_MAX_TRANSMITTER_NUM)
+#error "GROUP_RECEIVER_HASH_BITS is too small for GROUP_RECEIVER_MAX_TRANSMITTER_NUM"
+#endif
+
 typedef struct
 {
     bool valid;
     uint8_t bt_addr[6];
     uint8_t group[GROUP_RECEIVER_MAX_GROUP_NUM_EACH_TRANSMITTER];
-    uint32_t rank;
+    uint32_t rank; //!< bigger is more recently configured, restores lru order after reboot
     uint8_t tid;
+    uint8_t lru_prev;
+    uint8_t lru_next;
 } group_transmitter_info_t;
 
 typedef struct
 {
     group_transmitter_info_t gti[GROUP_RECEIVER_MAX_TRANSMITTER_NUM];
+    uint8_t hash[GROUP_RECEIVER_HASH_SIZE]; //!< transmitter index, GROUP_RECEIVER_INDEX_NULL if empty
+    uint8_t lru_head; //!< most recently used transmitter
+    uint8_t lru_tail; //!< least recently used transmitter
+    uint32_t rank;
     group_receiver_state_t state;
     pf_group_receiver_receive_cb_t cfg_cb;
     pf_group_receiver_receive_cb_t ctl_cb;
@@ -42,6 +58,97 @@ typedef struct
 
 static group_receiver_ctx_t grc;
 
+static uint8_t group_receiver_hash(const uint8_t bt_addr[])
+{
+    /* the low bytes of the address are the most random ones */
+    uint32_t key = LE_EXTRN2DWORD(bt_addr) ^ ((uint32_t)LE_EXTRN2WORD(bt_addr + 4) << 11);
+    return (key * 0x9e3779b1) >> (32 - GROUP_RECEIVER_HASH_BITS);
+}
+
+static void group_receiver_hash_insert(uint8_t index)
+{
+    uint8_t slot = group_receiver_hash(grc.gti[index].bt_addr);
+    while (GROUP_RECEIVER_INDEX_NULL != grc.hash[slot])
+    {
+        slot = (slot + 1) & GROUP_RECEIVER_HASH_MASK;
+    }
+    grc.hash[slot] = index;
+}
+
+static void group_receiver_hash_remove(uint8_t index)
+{
+    uint8_t slot = group_receiver_hash(grc.gti[index].bt_addr);
+    while (index != grc.hash[slot])
+    {
+        slot = (slot + 1) & GROUP_RECEIVER_HASH_MASK;
+    }
+
+    /* shift back the following entries of the probe sequence, no tombstone is left */
+    uint8_t next = slot;
+    for (;;)
+    {
+        grc.hash[slot] = GROUP_RECEIVER_INDEX_NULL;
+        uint8_t home;
+        do
+        {
+            next = (next + 1) & GROUP_RECEIVER_HASH_MASK;
+            if (GROUP_RECEIVER_INDEX_NULL == grc.hash[next])
+            {
+                return;
+            }
+            home = group_receiver_hash(grc.gti[grc.hash[next]].bt_addr);
+        }
+        while (((next - home) & GROUP_RECEIVER_HASH_MASK) < ((next - slot) & GROUP_RECEIVER_HASH_MASK));
+        grc.hash[slot] = grc.hash[next];
+        slot = next;
+    }
+}
+
+static void group_receiver_lru_unlink(uint8_t index)
+{
+    group_transmitter_info_t *pgti = &grc.gti[index];
+    if (GROUP_RECEIVER_INDEX_NULL != pgti->lru_prev)
+    {
+        grc.gti[pgti->lru_prev].lru_next = pgti->lru_next;
+    }
+    else
+    {
+        grc.lru_head = pgti->lru_next;
+    }
+    if (GROUP_RECEIVER_INDEX_NULL != pgti->lru_next)
+    {
+        grc.gti[pgti->lru_next].lru_prev = pgti->lru_prev;
+    }
+    else
+    {
+        grc.lru_tail = pgti->lru_prev;
+    }
+}
+
+static void group_receiver_lru_push(uint8_t index)
+{
+    grc.gti[index].lru_prev = GROUP_RECEIVER_INDEX_NULL;
+    grc.gti[index].lru_next = grc.lru_head;
+    if (GROUP_RECEIVER_INDEX_NULL != grc.lru_head)
+    {
+        grc.gti[grc.lru_head].lru_prev = index;
+    }
+    else
+    {
+        grc.lru_tail = index;
+    }
+    grc.lru_head = index;
+}
+
+static void group_receiver_lru_touch(uint8_t index)
+{
+    if (grc.lru_head != index)
+    {
+        group_receiver_lru_unlink(index);
+        group_receiver_lru_push(index);
+    }
+}
+
 static bool group_receiver_group_find(int index, uint8_t group)
 {
     int loop;
@@ -88,7 +195,7 @@ static bool group_receiver_group_add(int index, uint8_t group)
     return false;
 }
 
-static int group_receiver_allocate(uint8_t bt_addr[], uint8_t tid, uint32_t rank)
+static int group_receiver_allocate(uint8_t bt_addr[], uint8_t tid)
 {
     int loop;
     for (loop = 0; loop < GROUP_RECEIVER_MAX_TRANSMITTER_NUM; loop++)
@@ -98,8 +205,10 @@ static int group_receiver_allocate(uint8_t bt_addr[], uint8_t tid, uint32_t rank
             grc.gti[loop].valid = true;
             memcpy(grc.gti[loop].bt_addr, bt_addr, 6);
             memset(grc.gti[loop].group, GROUP_INVALID, GROUP_RECEIVER_MAX_GROUP_NUM_EACH_TRANSMITTER);
-            grc.gti[loop].rank = rank;
+            grc.gti[loop].rank = ++grc.rank;
             grc.gti[loop].tid = tid;
+            group_receiver_hash_insert(loop);
+            group_receiver_lru_push(loop);
             return loop;
         }
     }
@@ -112,73 +221,36 @@ static bool group_receiver_free(int index)
     {
         return false;
     }
+    group_receiver_hash_remove(index);
+    group_receiver_lru_unlink(index);
     grc.gti[index].valid = false;
     return true;
 }
 
 static int group_receiver_find(uint8_t bt_addr[], uint8_t tid)
 {
-    int loop;
-    for (loop = 0; loop < GROUP_RECEIVER_MAX_TRANSMITTER_NUM; loop++)
+    uint8_t slot = group_receiver_hash(bt_addr);
+    while (GROUP_RECEIVER_INDEX_NULL != grc.hash[slot])
     {
-        if (grc.gti[loop].valid)
+        int index = grc.hash[slot];
+        if (0 == memcmp(bt_addr, grc.gti[index].bt_addr, 6))
         {
-            if (0 == memcmp(bt_addr, grc.gti[loop].bt_addr, 6))
+            if (tid == grc.gti[index].tid)
             {
-                if (tid == grc.gti[loop].tid)
-                {
-                    return -2;
-                }
-                else
-                {
-                    grc.gti[loop].tid = tid;
-                }
-                return loop;
+                return -2;
             }
+            grc.gti[index].tid = tid;
+            group_receiver_lru_touch(index);
+            return index;
         }
+        slot = (slot + 1) & GROUP_RECEIVER_HASH_MASK;
     }
     return -1;
 }
 
 bool group_receiver_check(void)
 {
-    for (int loop = 0; loop < GROUP_RECEIVER_MAX_TRANSMITTER_NUM; loop++)
-    {
-        if (grc.gti[loop].valid)
-        {
-            return true;
-        }
-    }
-    return false;
-}
-
-static int group_receiver_rank(bool order)
-{
-    int ret = -1;
-    uint32_t rank = order ? 0x00000000 : 0xffffffff;
-    for (int loop = 0; loop < GROUP_RECEIVER_MAX_TRANSMITTER_NUM; loop++)
-    {
-        if (grc.gti[loop].valid)
-        {
-            if (order)
-            {
-                if (rank <= grc.gti[loop].rank)
-                {
-                    ret = loop;
-                    rank = grc.gti[loop].rank;
-                }
-            }
-            else
-            {
-                if (rank >= grc.gti[loop].rank)
-                {
-                    ret = loop;
-                    rank = grc.gti[loop].rank;
-                }
-            }
-        }
-    }
-    return ret;
+    return GROUP_RECEIVER_INDEX_NULL != grc.lru_head;
 }
 
 static bool group_receiver_nvm_save(int index)
@@ -209,6 +281,39 @@ static bool group_receiver_nvm_load(void)
             memcpy(grc.gti[loop].bt_addr, flash_data + 1, 6);
             memcpy(grc.gti[loop].group, flash_data + 7, GROUP_RECEIVER_MAX_GROUP_NUM_EACH_TRANSMITTER);
             memcpy(&grc.gti[loop].rank, flash_data + 7 + GROUP_RECEIVER_MAX_GROUP_NUM_EACH_TRANSMITTER, 4);
+            group_receiver_hash_insert(loop);
+            /* insert by rank, the most recently configured one is the head */
+            uint8_t next = grc.lru_head;
+            while ((GROUP_RECEIVER_INDEX_NULL != next) && (grc.gti[next].rank > grc.gti[loop].rank))
+            {
+                next = grc.gti[next].lru_next;
+            }
+            if (GROUP_RECEIVER_INDEX_NULL == next)
+            {
+                grc.gti[loop].lru_prev = grc.lru_tail;
+                grc.gti[loop].lru_next = GROUP_RECEIVER_INDEX_NULL;
+                if (GROUP_RECEIVER_INDEX_NULL != grc.lru_tail)
+                {
+                    grc.gti[grc.lru_tail].lru_next = loop;
+                }
+                else
+                {
+                    grc.lru_head = loop;
+                }
+                grc.lru_tail = loop;
+            }
+            else if (grc.lru_head == next)
+            {
+                group_receiver_lru_push(loop);
+            }
+            else
+            {
+                grc.gti[loop].lru_prev = grc.gti[next].lru_prev;
+                grc.gti[loop].lru_next = next;
+                grc.gti[grc.gti[next].lru_prev].lru_next = loop;
+                grc.gti[next].lru_prev = loop;
+            }
+            grc.rank = MAX(grc.rank, grc.gti[loop].rank);
         }
     }
     return true;
@@ -314,16 +419,14 @@ void group_receiver_receive(T_LE_SCAN_INFO *ple_scan_info)
             {
                 if (index == -1)
                 {
-                    index = group_receiver_rank(true);
-                    uint32_t rank = index >= 0 ? grc.gti[index].rank + 1 : 0x00000000;
-                    index = group_receiver_allocate(ple_scan_info->bd_addr, pmsg->tid, rank);
+                    index = group_receiver_allocate(ple_scan_info->bd_addr, pmsg->tid);
                     if (index < 0)
                     {
 #if GROUP_RECEIVER_PREEMPTIVE_MODE
-                        index = group_receiver_rank(false);
-                        printw("group_receiver_receive: space %d emptived by rank %d", index, rank);
+                        index = grc.lru_tail;
+                        printw("group_receiver_receive: space %d emptied by least recently used", index);
                         group_receiver_free(index);
-                        index = group_receiver_allocate(ple_scan_info->bd_addr, pmsg->tid, rank);
+                        index = group_receiver_allocate(ple_scan_info->bd_addr, pmsg->tid);
                         save_flash = true;
 #else
                         printw("group_receiver_receive: no space left for the new transmitter");
@@ -335,6 +438,12 @@ void group_receiver_receive(T_LE_SCAN_INFO *ple_scan_info)
                         save_flash = true;
                     }
                 }
+                else
+                {
+                    /* the new rank is kept in ram, flash is written only when the stored
+                     * transmitters or groups change and the rank goes along with them */
+                    grc.gti[index].rank = ++grc.rank;
+                }
 
                 if (pmsg->cfg.group != GROUP_ALL)
                 {
@@ -392,6 +501,9 @@ void group_receiver_receive(T_LE_SCAN_INFO *ple_scan_info)
 
 void group_receiver_init(void)
 {
+    memset(grc.hash, GROUP_RECEIVER_INDEX_NULL, GROUP_RECEIVER_HASH_SIZE);
+    grc.lru_head = GROUP_RECEIVER_INDEX_NULL;
+    grc.lru_tail = GROUP_RECEIVER_INDEX_NULL;
     group_receiver_nvm_load();
 }
 
@@ -416,3 +528,20 @@ void group_receiver_reg_cb(group_msg_type_t type, pf_group_receiver_receive_cb_t
         grc.cfg_cb = pf;
     }
 }
+
+#if PLATFORM_HOST_SIM
+uint32_t group_receiver_sim_ctx_size(void)
+{
+    return sizeof(group_receiver_ctx_t);
+}
+
+void group_receiver_sim_ctx_save(void *pctx)
+{
+    memcpy(pctx, &grc, sizeof(group_receiver_ctx_t));
+}
+
+void group_receiver_sim_ctx_load(const void *pctx)
+{
+    memcpy(&grc, pctx, sizeof(group_receiver_ctx_t));
+}
+#endif
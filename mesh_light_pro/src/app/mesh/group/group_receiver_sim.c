@@ -0,0 +1,382 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     group_receiver_sim.c
+  * @brief    Host benchmark of the group receiver in a dense room.
+  * @details  Three remotes are configured to one lamp and a fourth one evicts the least recently
+  *           used. A known remote is reconfigured, which shall not write flash but protect it from
+  *           the next eviction, and the kept remotes are checked again after a reboot. Then a
+  *           stream of scan reports is fed to group_receiver_receive at the given rate: the key
+  *           presses of many remotes, each press repeated over several advertising events, mixed
+  *           with the adverts of other devices. Every control callback is checked against the
+  *           configured remotes and groups, and the host cycles of one report are reported by kind.
+  *           Build it on a linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> group_receiver_sim.c
+  *           group_receiver.c platform_sim.c -o group_receiver_sim
+  *           and run it with the remotes, the adverts per second, the time in s and the percent
+  *           of foreign adverts, e.g. ./group_receiver_sim 64 4000 10 50
+  * @author   bill
+  * @date     2019-1-12
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "group.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define GROUP_RECEIVER_SIM_REMOTE_MAX       1024
+#define GROUP_RECEIVER_SIM_CFG_NUM          3 //!< transmitters kept by the receiver
+#define GROUP_RECEIVER_SIM_REPEAT           12 //!< adverts of one press seen by the lamp, mean
+#define GROUP_RECEIVER_SIM_TID_MASK         0x3f
+
+enum
+{
+    GROUP_RECEIVER_SIM_KIND_FOREIGN, //!< adverts of other devices
+    GROUP_RECEIVER_SIM_KIND_UNKNOWN, //!< remotes not configured to the lamp
+    GROUP_RECEIVER_SIM_KIND_REPEAT, //!< configured remote, tid already seen
+    GROUP_RECEIVER_SIM_KIND_NEW, //!< configured remote, new tid
+    GROUP_RECEIVER_SIM_KIND_NUM
+};
+
+typedef struct
+{
+    uint8_t bt_addr[6];
+    uint8_t tid;
+    uint8_t group; //!< group controlled by the remote
+    bool configured;
+    bool seen; //!< the current tid reached the receiver
+} group_receiver_sim_remote_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint64_t cycles;
+    uint64_t cycles_max;
+} group_receiver_sim_kind_t;
+
+static const char *const group_receiver_sim_kind_names[GROUP_RECEIVER_SIM_KIND_NUM] =
+{
+    "foreign", "unknown remote", "repeated tid", "new tid"
+};
+
+static group_receiver_sim_remote_t group_receiver_sim_remotes[GROUP_RECEIVER_SIM_REMOTE_MAX];
+static group_receiver_sim_kind_t group_receiver_sim_kinds[GROUP_RECEIVER_SIM_KIND_NUM];
+static uint64_t group_receiver_sim_rng = 1;
+static bool group_receiver_sim_expect;
+static uint32_t group_receiver_sim_ctl_count;
+static uint32_t group_receiver_sim_cfg_count;
+static uint32_t group_receiver_sim_errors;
+
+static uint64_t group_receiver_sim_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/* xorshift64*, the runs are reproducible */
+static uint32_t group_receiver_sim_below(uint32_t n)
+{
+    group_receiver_sim_rng ^= group_receiver_sim_rng >> 12;
+    group_receiver_sim_rng ^= group_receiver_sim_rng << 25;
+    group_receiver_sim_rng ^= group_receiver_sim_rng >> 27;
+    return (uint32_t)((group_receiver_sim_rng * 0x2545f4914f6cdd1dULL) >> 32) % n;
+}
+
+static void group_receiver_sim_ctl_cb(uint8_t *pdata, uint8_t len)
+{
+    UNUSED(pdata);
+    UNUSED(len);
+    group_receiver_sim_ctl_count ++;
+    if (!group_receiver_sim_expect)
+    {
+        group_receiver_sim_errors ++;
+    }
+    group_receiver_sim_expect = FALSE;
+}
+
+static void group_receiver_sim_cfg_cb(uint8_t *pdata, uint8_t len)
+{
+    UNUSED(pdata);
+    UNUSED(len);
+    group_receiver_sim_cfg_count ++;
+}
+
+static uint8_t group_receiver_sim_adv(T_LE_SCAN_INFO *pscan_info, const uint8_t bt_addr[],
+                                      uint8_t tid, group_msg_type_t type, uint8_t group)
+{
+    memset(pscan_info, 0, sizeof(*pscan_info));
+    memcpy(pscan_info->bd_addr, bt_addr, 6);
+    pscan_info->remote_addr_type = GAP_REMOTE_ADDR_LE_RANDOM;
+    pscan_info->adv_type = GAP_ADV_EVT_TYPE_UNDIRECTED;
+    pscan_info->rssi = -60;
+
+    uint8_t *pdata = pscan_info->data;
+    group_msg_t *pmsg = (group_msg_t *)(pdata + 5);
+    uint8_t msg_len;
+    pmsg->type = type;
+    pmsg->rfu = 0;
+    pmsg->tid = tid;
+    if (GROUP_MSG_TYPE_CFG == type)
+    {
+        pmsg->cfg.opcode = GROUP_CFG_OPCODE_GROUP;
+        pmsg->cfg.group = group;
+        msg_len = MEMBER_OFFSET(group_msg_t, cfg) + MEMBER_OFFSET(group_cfg_t, group) + 1;
+    }
+    else
+    {
+        pmsg->ctl.group = group;
+        pmsg->ctl.opcode = GROUP_CTL_OPCODE_ON_OFF;
+        pmsg->ctl.on_off = GROUP_CTL_ON;
+        msg_len = MEMBER_OFFSET(group_msg_t, ctl) + sizeof(group_ctl_t);
+    }
+    pdata[0] = 4 + msg_len;
+    pdata[1] = GAP_ADTYPE_MANUFACTURER_SPECIFIC;
+    LE_WORD2EXTRN(pdata + 2, MANUFACTURE_ADV_DATA_COMPANY_ID);
+    pdata[4] = MANUFACTURE_ADV_DATA_TYPE_GROUP;
+    pscan_info->data_len = 5 + msg_len;
+    return pscan_info->data_len;
+}
+
+/* the adverts of a phone or another lamp, some of them with the realtek company id */
+static void group_receiver_sim_foreign(T_LE_SCAN_INFO *pscan_info)
+{
+    memset(pscan_info, 0, sizeof(*pscan_info));
+    for (uint32_t i = 0; i < 6; ++i)
+    {
+        pscan_info->bd_addr[i] = group_receiver_sim_below(256);
+    }
+    pscan_info->adv_type = GAP_ADV_EVT_TYPE_UNDIRECTED;
+    uint8_t *pdata = pscan_info->data;
+    uint32_t kind = group_receiver_sim_below(3);
+    if (0 == kind)
+    {
+        pdata[0] = 2;
+        pdata[1] = GAP_ADTYPE_FLAGS;
+        pdata[2] = GAP_ADTYPE_FLAGS_GENERAL | GAP_ADTYPE_FLAGS_BREDR_NOT_SUPPORTED;
+        pdata[3] = 27;
+        pdata[4] = GAP_ADTYPE_MANUFACTURER_SPECIFIC;
+        LE_WORD2EXTRN(pdata + 5, 0x004c);
+        pscan_info->data_len = 31;
+    }
+    else
+    {
+        pdata[0] = 4 + 6;
+        pdata[1] = GAP_ADTYPE_MANUFACTURER_SPECIFIC;
+        LE_WORD2EXTRN(pdata + 2, MANUFACTURE_ADV_DATA_COMPANY_ID);
+        pdata[4] = MANUFACTURE_ADV_DATA_TYPE_BT_ADDR;
+        pscan_info->data_len = 11;
+    }
+}
+
+static void group_receiver_sim_receive(T_LE_SCAN_INFO *pscan_info, uint32_t kind)
+{
+    uint64_t begin = group_receiver_sim_cycles();
+    group_receiver_receive(pscan_info);
+    uint64_t cycles = group_receiver_sim_cycles() - begin;
+    group_receiver_sim_kind_t *pkind = &group_receiver_sim_kinds[kind];
+    pkind->count ++;
+    pkind->cycles += cycles;
+    if (cycles > pkind->cycles_max)
+    {
+        pkind->cycles_max = cycles;
+    }
+}
+
+static void group_receiver_sim_cfg(uint32_t remote)
+{
+    group_receiver_sim_remote_t *premote = &group_receiver_sim_remotes[remote];
+    T_LE_SCAN_INFO scan_info;
+    premote->tid = (premote->tid + 1) & GROUP_RECEIVER_SIM_TID_MASK;
+    group_receiver_sim_adv(&scan_info, premote->bt_addr, premote->tid, GROUP_MSG_TYPE_CFG,
+                           premote->group);
+    group_receiver_receive(&scan_info);
+}
+
+/* a ctl of the remote, the receiver shall run it if configured to the remote and group */
+static bool group_receiver_sim_ctl_check(uint32_t remote)
+{
+    group_receiver_sim_remote_t *premote = &group_receiver_sim_remotes[remote];
+    T_LE_SCAN_INFO scan_info;
+    premote->tid = (premote->tid + 1) & GROUP_RECEIVER_SIM_TID_MASK;
+    group_receiver_sim_adv(&scan_info, premote->bt_addr, premote->tid, GROUP_MSG_TYPE_CTL,
+                           premote->group);
+    uint32_t count = group_receiver_sim_ctl_count;
+    group_receiver_sim_expect = TRUE;
+    group_receiver_receive(&scan_info);
+    group_receiver_sim_expect = FALSE;
+    return count != group_receiver_sim_ctl_count;
+}
+
+/* run a ctl of remotes 0 ~ 4, only remotes 1, 3 and 4 shall be kept by the receiver */
+static bool group_receiver_sim_kept_check(const char *when)
+{
+    bool pass = TRUE;
+    for (uint32_t remote = 0; remote <= 4; ++remote)
+    {
+        bool expect = (0 != remote) && (2 != remote);
+        if (group_receiver_sim_ctl_check(remote) != expect)
+        {
+            printf("remote %u: ctl %s %s\n", remote, expect ? "lost" : "run", when);
+            pass = FALSE;
+        }
+        group_receiver_sim_remotes[remote].configured = expect;
+    }
+    return pass;
+}
+
+/* configure remotes 0 ~ 3 and reconfigure remote 1 without touching flash, then remote 2 is the
+ * least recently used one and shall be evicted by remote 4, and the kept ones survive a reboot */
+static bool group_receiver_sim_lru_check(void)
+{
+    plt_sim_stat_t stat;
+    group_receiver_state_set(GROUP_RECEIVER_STATE_CFG);
+    for (uint32_t remote = 0; remote <= GROUP_RECEIVER_SIM_CFG_NUM; ++remote)
+    {
+        group_receiver_sim_cfg(remote);
+    }
+    plt_sim_stat_get(&stat);
+    uint32_t save_count = stat.ftl_save_count;
+    group_receiver_sim_cfg(1);
+    plt_sim_stat_get(&stat);
+    bool pass = (save_count == stat.ftl_save_count);
+    if (!pass)
+    {
+        printf("reconfiguring a known remote writes flash %u times\n",
+               stat.ftl_save_count - save_count);
+    }
+    group_receiver_sim_cfg(4);
+    group_receiver_state_set(GROUP_RECEIVER_STATE_NORMAL);
+    pass = group_receiver_sim_kept_check("before the reboot") && pass;
+
+    /* reboot, the ram of the receiver is cleared */
+    uint32_t ctx_size = group_receiver_sim_ctx_size();
+    void *pctx = calloc(1, ctx_size);
+    group_receiver_sim_ctx_load(pctx);
+    free(pctx);
+    plt_sim_power_cycle();
+    group_receiver_init();
+    group_receiver_reg_cb(GROUP_MSG_TYPE_CTL, group_receiver_sim_ctl_cb);
+    group_receiver_reg_cb(GROUP_MSG_TYPE_CFG, group_receiver_sim_cfg_cb);
+    pass = group_receiver_sim_kept_check("after the reboot") && pass;
+    printf("lru eviction and reboot: %s, %u cfg callbacks\n", pass ? "kept" : "LOST",
+           group_receiver_sim_cfg_count);
+    return pass;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t remote_num = (argc > 1) ? strtoul(argv[1], NULL, 0) : 64;
+    uint32_t rate = (argc > 2) ? strtoul(argv[2], NULL, 0) : 4000;
+    uint32_t duration = (argc > 3) ? strtoul(argv[3], NULL, 0) : 10;
+    uint32_t foreign = (argc > 4) ? strtoul(argv[4], NULL, 0) : 50;
+    if ((remote_num <= 4) || (remote_num > GROUP_RECEIVER_SIM_REMOTE_MAX) || (0 == rate) ||
+        (foreign > 100))
+    {
+        printf("remotes shall be 5 ~ %u, foreign percent 0 ~ 100\n", GROUP_RECEIVER_SIM_REMOTE_MAX);
+        return 1;
+    }
+
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    for (uint32_t remote = 0; remote < remote_num; ++remote)
+    {
+        group_receiver_sim_remote_t *premote = &group_receiver_sim_remotes[remote];
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            premote->bt_addr[i] = group_receiver_sim_below(256);
+        }
+        premote->bt_addr[5] |= 0xc0;
+        premote->group = 1 + remote % 4;
+    }
+    group_receiver_init();
+    group_receiver_reg_cb(GROUP_MSG_TYPE_CTL, group_receiver_sim_ctl_cb);
+    group_receiver_reg_cb(GROUP_MSG_TYPE_CFG, group_receiver_sim_cfg_cb);
+    bool lru_pass = group_receiver_sim_lru_check();
+    uint32_t lru_errors = group_receiver_sim_errors;
+    for (uint32_t remote = 0; remote < remote_num; ++remote)
+    {
+        /* the last tids of the check reached the receiver */
+        group_receiver_sim_remotes[remote].seen = TRUE;
+    }
+
+    /* every ms of virtual time gets its share of the adverts */
+    uint32_t expected = 0, missed = 0, sent = 0;
+    T_LE_SCAN_INFO scan_info;
+    for (uint32_t ms = 0; ms < duration * 1000; ++ms)
+    {
+        uint32_t num = (uint32_t)((uint64_t)rate * (ms + 1) / 1000 - (uint64_t)rate * ms / 1000);
+        for (uint32_t i = 0; i < num; ++i, ++sent)
+        {
+            if (group_receiver_sim_below(100) < foreign)
+            {
+                group_receiver_sim_foreign(&scan_info);
+                group_receiver_sim_receive(&scan_info, GROUP_RECEIVER_SIM_KIND_FOREIGN);
+                continue;
+            }
+
+            uint32_t remote = group_receiver_sim_below(remote_num);
+            group_receiver_sim_remote_t *premote = &group_receiver_sim_remotes[remote];
+            if (0 == group_receiver_sim_below(GROUP_RECEIVER_SIM_REPEAT))
+            {
+                /* a new key press, mostly to the own group */
+                premote->tid = (premote->tid + 1) & GROUP_RECEIVER_SIM_TID_MASK;
+                premote->seen = FALSE;
+            }
+            uint32_t r = group_receiver_sim_below(20);
+            uint8_t group = (0 == r) ? GROUP_ALL : ((1 == r) ? (1 + (premote->group % 4)) :
+                                                    premote->group);
+            group_receiver_sim_adv(&scan_info, premote->bt_addr, premote->tid, GROUP_MSG_TYPE_CTL,
+                                   group);
+            uint32_t kind = !premote->configured ? GROUP_RECEIVER_SIM_KIND_UNKNOWN :
+                            (premote->seen ? GROUP_RECEIVER_SIM_KIND_REPEAT : GROUP_RECEIVER_SIM_KIND_NEW);
+            group_receiver_sim_expect = (GROUP_RECEIVER_SIM_KIND_NEW == kind) &&
+                                        (group == premote->group || GROUP_ALL == group);
+            expected += group_receiver_sim_expect;
+            premote->seen = TRUE;
+            group_receiver_sim_receive(&scan_info, kind);
+            if (group_receiver_sim_expect)
+            {
+                missed ++;
+                group_receiver_sim_expect = FALSE;
+            }
+        }
+        plt_sim_clock_advance(1);
+    }
+
+    printf("%u adverts in %u s from %u remotes, %u%% foreign\n", sent, duration, remote_num,
+           foreign);
+    uint64_t cycles = 0;
+    for (uint32_t kind = 0; kind < GROUP_RECEIVER_SIM_KIND_NUM; ++kind)
+    {
+        group_receiver_sim_kind_t *pkind = &group_receiver_sim_kinds[kind];
+        cycles += pkind->cycles;
+        printf("%-15s %8u reports, %6.1f cycles mean, %6llu max\n", group_receiver_sim_kind_names[kind],
+               pkind->count, pkind->count ? (double)pkind->cycles / pkind->count : 0.0,
+               (unsigned long long)pkind->cycles_max);
+    }
+    printf("%.1f host cycles per report, %.2f M cycles per second of scanning\n",
+           (double)cycles / sent, (double)cycles / duration / 1000000);
+    printf("ctl expected %u, missed %u, unexpected %u\n", expected, missed,
+           group_receiver_sim_errors - lru_errors);
+
+    bool fail = !lru_pass || missed || group_receiver_sim_errors;
+    printf("%s\n", fail ? "FAIL" : "PASS");
+    return fail ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -0,0 +1,772 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     group_sim.c
+  * @brief    Host radio simulator of the group advertising protocol.
+  * @details  The remotes press keys through the real group transmitter and the lamps receive
+  *           with the real group receiver, only the air in between is simulated: three adv
+  *           channels, the scan interval and window rotating over them, background advertising of
+  *           the lamps, collisions with optional capture, half duplex and random loss. The end to
+  *           end latency percentiles and the delivery ratio are reported.
+  *           Build it on a linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> group_sim.c
+  *           group_receiver.c group_transmitter.c platform_sim.c -lm -o group_sim
+  *           and run it with key=value overrides, e.g. ./group_sim remotes=100 lamps=500 rate=6,
+  *           "./group_sim help" lists the parameters.
+  * @note     Every remote controls its own group. GROUP_ALL to unconfigured receivers is not
+  *           simulated, the receiver keeps the tid of that path in one static variable.
+  * @author   bill
+  * @date     2019-1-10
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "group.h"
+#include "gap_scheduler.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define GROUP_SIM_REMOTES_EACH_LAMP_MAX     3 //!< transmitters kept by one receiver
+#define GROUP_SIM_ADV_CHANNEL_NUM           3
+#define GROUP_SIM_PDU_OVERHEAD              (1 + 4 + 2 + 6 + 3) //!< preamble, access address, header, AdvA, crc
+#define GROUP_SIM_US_PER_BYTE               8 //!< 1M phy
+#define GROUP_SIM_BG                        0xffffffff //!< pdu of the background advertising
+#define GROUP_SIM_OVERLAP_MAX               256
+#define GROUP_SIM_TAIL_MS                   1000 //!< background kept on air after the last press
+
+typedef struct
+{
+    uint32_t remote_num;
+    uint32_t lamp_num;
+    uint32_t remotes_each_lamp; //!< remotes configured to each lamp
+    uint32_t duration_s; //!< key presses happen within this time
+    double press_rate; //!< key presses per remote per minute, poisson
+    uint32_t sync_period_ms; //!< all remotes press once per period instead, 0 to disable
+    uint32_t sync_spread_ms; //!< spread of the synchronized presses
+    uint32_t tx_jitter_us; //!< random delay before each advertising event
+    uint32_t chan_gap_us; //!< idle time between the pdus of one advertising event
+    uint32_t scan_interval_us;
+    uint32_t scan_window_us;
+    double bg_rate; //!< background advertising events per lamp per second
+    uint32_t bg_len; //!< background advertising data length
+    double loss; //!< probability a pdu is lost at a receiver besides collisions
+    double capture; //!< probability a collided pdu is still received
+    uint32_t seed;
+    uint32_t log;
+} group_sim_cfg_t;
+
+typedef struct
+{
+    uint64_t start_us;
+    uint32_t press; //!< index of the press, GROUP_SIM_BG for the background
+    uint16_t src; //!< remote index, lamp index for the background
+    uint16_t dur_us;
+    uint8_t ch;
+} group_sim_pdu_t;
+
+typedef struct
+{
+    uint64_t time_us;
+    uint16_t remote;
+    uint8_t adv_len;
+    uint8_t adv_data[31];
+    uint32_t delivered; //!< target lamps which executed it
+} group_sim_press_t;
+
+typedef struct
+{
+    uint8_t bt_addr[6];
+    uint8_t group;
+    uint8_t on_off;
+    uint32_t target_num;
+    uint64_t busy_us; //!< end of the advertising queued, the next one waits for it
+    uint8_t *pctx;
+} group_sim_remote_t;
+
+typedef struct
+{
+    uint32_t phase_us; //!< scan timing offset
+    uint8_t remote_num;
+    uint16_t remote[GROUP_SIM_REMOTES_EACH_LAMP_MAX];
+    uint32_t last_press[GROUP_SIM_REMOTES_EACH_LAMP_MAX]; //!< latest press executed of each remote
+    uint8_t *pctx;
+} group_sim_lamp_t;
+
+typedef struct
+{
+    uint64_t receptions; //!< receptions tried by the target lamps
+    uint64_t miss_scan; //!< not scanning on the channel
+    uint64_t miss_tx; //!< transmitting itself
+    uint64_t miss_collision;
+    uint64_t miss_loss;
+    uint64_t expected; //!< press and target lamp pairs
+    uint64_t delivered;
+    uint64_t duplicated; //!< executed again by the same lamp, or after a later press
+    uint64_t misdelivered; //!< executed by a lamp not configured to the remote
+    uint32_t press_complete; //!< presses executed by all target lamps
+    uint64_t air_us[GROUP_SIM_ADV_CHANNEL_NUM];
+} group_sim_stat_t;
+
+typedef struct
+{
+    group_sim_cfg_t cfg;
+    uint64_t rng;
+    group_sim_remote_t *premotes;
+    group_sim_lamp_t *plamps;
+    group_sim_press_t *ppresses;
+    uint32_t press_num;
+    group_sim_pdu_t *ppdus;
+    uint32_t pdu_num;
+    uint32_t pdu_size;
+    uint32_t pdu_dur_max;
+    uint64_t end_us;
+    uint32_t *platency;
+    uint32_t lamp_loaded; //!< lamp whose context is in the receiver
+    uint32_t cur_lamp;
+    uint32_t cur_press;
+    uint64_t cur_time_us; //!< end of the pdu being received
+    gap_sched_task_t task;
+    bool task_ready;
+    group_sim_stat_t stat;
+} group_sim_t;
+
+static group_sim_t gs;
+
+static const struct
+{
+    const char *name;
+    bool is_double;
+    void *pvalue;
+    const char *help;
+} group_sim_params[] =
+{
+    {"remotes", FALSE, &gs.cfg.remote_num, "number of remotes, each one controls its own group"},
+    {"lamps", FALSE, &gs.cfg.lamp_num, "number of lamps"},
+    {"remotes_each_lamp", FALSE, &gs.cfg.remotes_each_lamp, "remotes configured to each lamp, 1 ~ 3"},
+    {"duration", FALSE, &gs.cfg.duration_s, "key press time, s"},
+    {"rate", TRUE, &gs.cfg.press_rate, "key presses per remote per minute, poisson"},
+    {"sync_period", FALSE, &gs.cfg.sync_period_ms, "all remotes press once per period, ms, 0 for poisson"},
+    {"sync_spread", FALSE, &gs.cfg.sync_spread_ms, "spread of the synchronized presses, ms"},
+    {"tx_jitter", FALSE, &gs.cfg.tx_jitter_us, "random delay before each advertising event, us"},
+    {"chan_gap", FALSE, &gs.cfg.chan_gap_us, "idle time between the channels of one event, us"},
+    {"scan_interval", FALSE, &gs.cfg.scan_interval_us, "lamp scan interval, us"},
+    {"scan_window", FALSE, &gs.cfg.scan_window_us, "lamp scan window, us"},
+    {"bg_rate", TRUE, &gs.cfg.bg_rate, "background advertising events per lamp per second"},
+    {"bg_len", FALSE, &gs.cfg.bg_len, "background advertising data length, bytes"},
+    {"loss", TRUE, &gs.cfg.loss, "random loss probability of each reception"},
+    {"capture", TRUE, &gs.cfg.capture, "probability a collided pdu is still received"},
+    {"seed", FALSE, &gs.cfg.seed, "random seed"},
+    {"log", FALSE, &gs.cfg.log, "print the module logs"},
+};
+
+static void group_sim_cfg_default(group_sim_cfg_t *pcfg)
+{
+    pcfg->remote_num = 100;
+    pcfg->lamp_num = 500;
+    pcfg->remotes_each_lamp = 1;
+    pcfg->duration_s = 300;
+    pcfg->press_rate = 2;
+    pcfg->sync_period_ms = 0;
+    pcfg->sync_spread_ms = 100;
+    pcfg->tx_jitter_us = 5000;
+    pcfg->chan_gap_us = 200;
+    pcfg->scan_interval_us = GAP_SCHED_SCAN_INTERVAL * 625;
+    pcfg->scan_window_us = GAP_SCHED_SCAN_WINDOW * 625;
+    pcfg->bg_rate = 1;
+    pcfg->bg_len = 31;
+    pcfg->loss = 0.02;
+    pcfg->capture = 0;
+    pcfg->seed = 1;
+    pcfg->log = 0;
+}
+
+/* xorshift64*, the runs are reproducible by seed */
+static uint64_t group_sim_rand(void)
+{
+    gs.rng ^= gs.rng >> 12;
+    gs.rng ^= gs.rng << 25;
+    gs.rng ^= gs.rng >> 27;
+    return gs.rng * 0x2545f4914f6cdd1dULL;
+}
+
+/* uniform in [0, 1) */
+static double group_sim_uniform(void)
+{
+    return (group_sim_rand() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint32_t group_sim_below(uint32_t n)
+{
+    return (n > 0) ? (uint32_t)(group_sim_rand() % n) : 0;
+}
+
+/* exponential interval of a poisson process, us */
+static uint64_t group_sim_exp_us(double rate_per_s)
+{
+    return (uint64_t)(-log(1 - group_sim_uniform()) / rate_per_s * 1000000);
+}
+
+static uint16_t group_sim_airtime(uint8_t adv_len)
+{
+    return (GROUP_SIM_PDU_OVERHEAD + adv_len) * GROUP_SIM_US_PER_BYTE;
+}
+
+/** gap scheduler: the transmitter hands its advertising over here */
+void *gap_sched_task_get(void)
+{
+    memset(&gs.task, 0, sizeof(gs.task));
+    return gs.task.adv_data;
+}
+
+void gap_sched_try(gap_sched_task_p ptask)
+{
+    UNUSED(ptask);
+    gs.task_ready = TRUE;
+}
+
+static void group_sim_pdu_add(uint64_t start_us, uint32_t press, uint16_t src, uint8_t adv_len)
+{
+    if (gs.pdu_num + GROUP_SIM_ADV_CHANNEL_NUM > gs.pdu_size)
+    {
+        gs.pdu_size = gs.pdu_size * 2 + 1024;
+        gs.ppdus = realloc(gs.ppdus, gs.pdu_size * sizeof(group_sim_pdu_t));
+        if (NULL == gs.ppdus)
+        {
+            printf("group_sim: out of memory\n");
+            exit(1);
+        }
+    }
+
+    /* one advertising event goes over the three channels back to back */
+    uint16_t dur = group_sim_airtime(adv_len);
+    for (uint8_t ch = 0; ch < GROUP_SIM_ADV_CHANNEL_NUM; ++ch)
+    {
+        group_sim_pdu_t *ppdu = &gs.ppdus[gs.pdu_num++];
+        ppdu->start_us = start_us + ch * (dur + gs.cfg.chan_gap_us);
+        ppdu->press = press;
+        ppdu->src = src;
+        ppdu->dur_us = dur;
+        ppdu->ch = ch;
+        gs.stat.air_us[ch] += dur;
+    }
+    gs.pdu_dur_max = MAX(gs.pdu_dur_max, dur);
+    gs.end_us = MAX(gs.end_us, start_us + GROUP_SIM_ADV_CHANNEL_NUM * (dur + gs.cfg.chan_gap_us));
+}
+
+static int group_sim_pdu_cmp(const void *pa, const void *pb)
+{
+    const group_sim_pdu_t *ppdu_a = pa;
+    const group_sim_pdu_t *ppdu_b = pb;
+    return (ppdu_a->start_us > ppdu_b->start_us) - (ppdu_a->start_us < ppdu_b->start_us);
+}
+
+static int group_sim_press_cmp(const void *pa, const void *pb)
+{
+    const group_sim_press_t *ppress_a = pa;
+    const group_sim_press_t *ppress_b = pb;
+    return (ppress_a->time_us > ppress_b->time_us) - (ppress_a->time_us < ppress_b->time_us);
+}
+
+static int group_sim_u32_cmp(const void *pa, const void *pb)
+{
+    uint32_t a = *(const uint32_t *)pa;
+    uint32_t b = *(const uint32_t *)pb;
+    return (a > b) - (a < b);
+}
+
+static void group_sim_lamp_load(uint32_t lamp)
+{
+    if (gs.lamp_loaded != lamp)
+    {
+        if (gs.lamp_loaded < gs.cfg.lamp_num)
+        {
+            group_receiver_sim_ctx_save(gs.plamps[gs.lamp_loaded].pctx);
+        }
+        group_receiver_sim_ctx_load(gs.plamps[lamp].pctx);
+        gs.lamp_loaded = lamp;
+    }
+}
+
+static int group_sim_lamp_remote_find(const group_sim_lamp_t *plamp, uint16_t remote)
+{
+    for (int index = 0; index < plamp->remote_num; ++index)
+    {
+        if (plamp->remote[index] == remote)
+        {
+            return index;
+        }
+    }
+    return -1;
+}
+
+/* hand the advertising of a remote to the receiver of a lamp */
+static void group_sim_lamp_receive(uint32_t lamp, uint16_t remote, const uint8_t *padv_data,
+                                   uint8_t adv_len)
+{
+    T_LE_SCAN_INFO scan_info;
+    memset(&scan_info, 0, sizeof(scan_info));
+    memcpy(scan_info.bd_addr, gs.premotes[remote].bt_addr, 6);
+    scan_info.remote_addr_type = GAP_REMOTE_ADDR_LE_RANDOM;
+    scan_info.adv_type = GAP_ADV_EVT_TYPE_UNDIRECTED;
+    scan_info.rssi = -60;
+    scan_info.data_len = adv_len;
+    memcpy(scan_info.data, padv_data, adv_len);
+
+    group_sim_lamp_load(lamp);
+    gs.cur_lamp = lamp;
+    group_receiver_receive(&scan_info);
+}
+
+static void group_sim_ctl_cb(uint8_t *pdata, uint8_t len)
+{
+    UNUSED(pdata);
+    UNUSED(len);
+    if (GROUP_SIM_BG == gs.cur_press)
+    {
+        return;
+    }
+
+    group_sim_lamp_t *plamp = &gs.plamps[gs.cur_lamp];
+    group_sim_press_t *ppress = &gs.ppresses[gs.cur_press];
+    int index = group_sim_lamp_remote_find(plamp, ppress->remote);
+    if (index < 0)
+    {
+        gs.stat.misdelivered ++;
+    }
+    else if ((GROUP_SIM_BG != plamp->last_press[index]) && (gs.cur_press <= plamp->last_press[index]))
+    {
+        /* the receiver only remembers the last tid, a late copy of an older press runs again */
+        gs.stat.duplicated ++;
+    }
+    else
+    {
+        plamp->last_press[index] = gs.cur_press;
+        gs.platency[gs.stat.delivered++] = (uint32_t)(gs.cur_time_us - ppress->time_us);
+        ppress->delivered ++;
+    }
+}
+
+static bool group_sim_setup(void)
+{
+    group_sim_cfg_t *pcfg = &gs.cfg;
+    pcfg->remotes_each_lamp = CLAMP(pcfg->remotes_each_lamp, 1, GROUP_SIM_REMOTES_EACH_LAMP_MAX);
+    pcfg->remotes_each_lamp = MIN(pcfg->remotes_each_lamp, pcfg->remote_num);
+    if ((0 == pcfg->remote_num) || (pcfg->remote_num > 0xffff) || (0 == pcfg->lamp_num) ||
+        (pcfg->lamp_num > 0xffff) || (0 == pcfg->scan_interval_us) ||
+        (pcfg->scan_window_us > pcfg->scan_interval_us) || (pcfg->bg_len > 31))
+    {
+        printf("group_sim: invalid parameters\n");
+        return FALSE;
+    }
+
+    gs.rng = ((uint64_t)pcfg->seed + 1) * 0x9e3779b97f4a7c15ULL;
+    plt_sim_reset();
+    plt_sim_log_enable(pcfg->log);
+
+    uint32_t rx_ctx_size = group_receiver_sim_ctx_size();
+    uint32_t tx_ctx_size = group_transmitter_sim_ctx_size();
+    gs.premotes = calloc(pcfg->remote_num, sizeof(group_sim_remote_t) + tx_ctx_size);
+    gs.plamps = calloc(pcfg->lamp_num, sizeof(group_sim_lamp_t) + rx_ctx_size);
+    if ((NULL == gs.premotes) || (NULL == gs.plamps))
+    {
+        printf("group_sim: out of memory\n");
+        return FALSE;
+    }
+
+    /* the contexts follow the arrays */
+    uint8_t *pctx = (uint8_t *)(gs.premotes + pcfg->remote_num);
+    for (uint32_t remote = 0; remote < pcfg->remote_num; ++remote)
+    {
+        group_sim_remote_t *premote = &gs.premotes[remote];
+        bool unique;
+        do
+        {
+            for (uint8_t i = 0; i < 6; ++i)
+            {
+                premote->bt_addr[i] = (uint8_t)group_sim_rand();
+            }
+            premote->bt_addr[5] |= 0xc0; /* static random address */
+            unique = TRUE;
+            for (uint32_t other = 0; other < remote; ++other)
+            {
+                if (0 == memcmp(gs.premotes[other].bt_addr, premote->bt_addr, 6))
+                {
+                    unique = FALSE;
+                }
+            }
+        }
+        while (!unique);
+        premote->group = 1 + remote % (GROUP_ALL - 1);
+        premote->pctx = pctx + remote * tx_ctx_size;
+        group_transmitter_init();
+        group_transmitter_sim_ctx_save(premote->pctx);
+    }
+
+    /* a fresh receiver, nothing is stored yet after the reset */
+    group_receiver_init();
+    group_receiver_reg_cb(GROUP_MSG_TYPE_CTL, group_sim_ctl_cb);
+    pctx = (uint8_t *)(gs.plamps + pcfg->lamp_num);
+    for (uint32_t lamp = 0; lamp < pcfg->lamp_num; ++lamp)
+    {
+        group_sim_lamp_t *plamp = &gs.plamps[lamp];
+        plamp->phase_us = group_sim_below(GROUP_SIM_ADV_CHANNEL_NUM * pcfg->scan_interval_us);
+        plamp->remote_num = pcfg->remotes_each_lamp;
+        for (uint8_t index = 0; index < plamp->remote_num; ++index)
+        {
+            plamp->remote[index] = (lamp + index) % pcfg->remote_num;
+            plamp->last_press[index] = GROUP_SIM_BG;
+            gs.premotes[plamp->remote[index]].target_num ++;
+        }
+        plamp->pctx = pctx + lamp * rx_ctx_size;
+        group_receiver_sim_ctx_save(plamp->pctx);
+    }
+    gs.lamp_loaded = pcfg->lamp_num;
+
+    /* pairing over a perfect air: each remote sends its group once to its lamps in cfg state */
+    gs.cur_press = GROUP_SIM_BG;
+    for (uint16_t remote = 0; remote < pcfg->remote_num; ++remote)
+    {
+        group_sim_remote_t *premote = &gs.premotes[remote];
+        group_transmitter_sim_ctx_load(premote->pctx);
+        gs.task_ready = FALSE;
+        group_transmitter_cfg_group(premote->group);
+        group_transmitter_sim_ctx_save(premote->pctx);
+        if (!gs.task_ready)
+        {
+            printf("group_sim: remote %d sent nothing\n", remote);
+            return FALSE;
+        }
+        for (uint32_t lamp = 0; lamp < pcfg->lamp_num; ++lamp)
+        {
+            if (group_sim_lamp_remote_find(&gs.plamps[lamp], remote) >= 0)
+            {
+                group_sim_lamp_load(lamp);
+                group_receiver_state_set(GROUP_RECEIVER_STATE_CFG);
+                group_sim_lamp_receive(lamp, remote, gs.task.adv_data, gs.task.adv_len);
+                group_receiver_state_set(GROUP_RECEIVER_STATE_NORMAL);
+            }
+        }
+    }
+    for (uint32_t lamp = 0; lamp < pcfg->lamp_num; ++lamp)
+    {
+        group_sim_lamp_load(lamp);
+        if (!group_receiver_check())
+        {
+            printf("group_sim: lamp %d is not configured\n", lamp);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+static bool group_sim_traffic(void)
+{
+    group_sim_cfg_t *pcfg = &gs.cfg;
+    uint64_t duration_us = (uint64_t)pcfg->duration_s * 1000000;
+
+    /* key press times */
+    uint32_t press_size = 0;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        uint64_t rng = gs.rng;
+        gs.press_num = 0;
+        for (uint16_t remote = 0; remote < pcfg->remote_num; ++remote)
+        {
+            if (0 != pcfg->sync_period_ms)
+            {
+                for (uint64_t t = 0; t < duration_us; t += (uint64_t)pcfg->sync_period_ms * 1000)
+                {
+                    uint64_t time_us = t + group_sim_below(pcfg->sync_spread_ms * 1000 + 1);
+                    if (pass)
+                    {
+                        gs.ppresses[gs.press_num].time_us = time_us;
+                        gs.ppresses[gs.press_num].remote = remote;
+                    }
+                    gs.press_num ++;
+                }
+            }
+            else if (pcfg->press_rate > 0)
+            {
+                for (uint64_t t = group_sim_exp_us(pcfg->press_rate / 60); t < duration_us;
+                     t += group_sim_exp_us(pcfg->press_rate / 60))
+                {
+                    if (pass)
+                    {
+                        gs.ppresses[gs.press_num].time_us = t;
+                        gs.ppresses[gs.press_num].remote = remote;
+                    }
+                    gs.press_num ++;
+                }
+            }
+        }
+        if (0 == pass)
+        {
+            /* count first, then fill with the same random sequence */
+            press_size = gs.press_num;
+            gs.ppresses = calloc(press_size + 1, sizeof(group_sim_press_t));
+            if (NULL == gs.ppresses)
+            {
+                printf("group_sim: out of memory\n");
+                return FALSE;
+            }
+            gs.rng = rng;
+        }
+    }
+    qsort(gs.ppresses, gs.press_num, sizeof(group_sim_press_t), group_sim_press_cmp);
+
+    /* the remotes send by the real transmitter, its retransmission settings are taken as is */
+    for (uint32_t press = 0; press < gs.press_num; ++press)
+    {
+        group_sim_press_t *ppress = &gs.ppresses[press];
+        group_sim_remote_t *premote = &gs.premotes[ppress->remote];
+        premote->on_off = !premote->on_off;
+        group_transmitter_sim_ctx_load(premote->pctx);
+        gs.task_ready = FALSE;
+        group_transmitter_ctl_on_off(premote->group, premote->on_off ? GROUP_CTL_ON : GROUP_CTL_OFF);
+        group_transmitter_sim_ctx_save(premote->pctx);
+        if (!gs.task_ready)
+        {
+            continue;
+        }
+        ppress->adv_len = gs.task.adv_len;
+        memcpy(ppress->adv_data, gs.task.adv_data, gs.task.adv_len);
+        /* the gap scheduler sends the queued advertising one after another */
+        uint64_t time_us = MAX(ppress->time_us, premote->busy_us);
+        for (uint32_t count = 0; count <= gs.task.retrans_count; ++count)
+        {
+            uint64_t start_us = time_us + group_sim_below(pcfg->tx_jitter_us + 1);
+            group_sim_pdu_add(start_us, press, ppress->remote, ppress->adv_len);
+            premote->busy_us = start_us + GROUP_SIM_ADV_CHANNEL_NUM * (group_sim_airtime(ppress->adv_len) +
+                                                                      pcfg->chan_gap_us);
+            time_us += (uint64_t)gs.task.retrans_interval * 1000;
+        }
+        gs.stat.expected += premote->target_num;
+    }
+
+    /* background advertising of the lamps: relays, beacons and their own messages */
+    if (pcfg->bg_rate > 0)
+    {
+        uint64_t bg_end_us = MAX(gs.end_us, duration_us) + GROUP_SIM_TAIL_MS * 1000;
+        for (uint32_t lamp = 0; lamp < pcfg->lamp_num; ++lamp)
+        {
+            for (uint64_t t = group_sim_exp_us(pcfg->bg_rate); t < bg_end_us;
+                 t += group_sim_exp_us(pcfg->bg_rate))
+            {
+                group_sim_pdu_add(t, GROUP_SIM_BG, lamp, pcfg->bg_len);
+            }
+        }
+    }
+    qsort(gs.ppdus, gs.pdu_num, sizeof(group_sim_pdu_t), group_sim_pdu_cmp);
+
+    gs.platency = malloc((gs.stat.expected + 1) * sizeof(uint32_t));
+    if (NULL == gs.platency)
+    {
+        printf("group_sim: out of memory\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/* whether the lamp scans the channel of the pdu for the whole pdu */
+static bool group_sim_scanning(const group_sim_lamp_t *plamp, const group_sim_pdu_t *ppdu)
+{
+    uint64_t t = ppdu->start_us + plamp->phase_us;
+    uint64_t interval = t / gs.cfg.scan_interval_us;
+    uint32_t offset = t % gs.cfg.scan_interval_us;
+    return ((interval % GROUP_SIM_ADV_CHANNEL_NUM) == ppdu->ch) &&
+           (offset + ppdu->dur_us <= gs.cfg.scan_window_us);
+}
+
+static void group_sim_run(void)
+{
+    uint32_t overlap[GROUP_SIM_OVERLAP_MAX];
+    for (uint32_t i = 0; i < gs.pdu_num; ++i)
+    {
+        const group_sim_pdu_t *ppdu = &gs.ppdus[i];
+        if (GROUP_SIM_BG == ppdu->press)
+        {
+            continue;
+        }
+
+        /* everything on air at the same time, on any channel */
+        uint64_t end_us = ppdu->start_us + ppdu->dur_us;
+        uint32_t overlap_num = 0;
+        for (uint32_t j = i; (j-- > 0) &&
+             (gs.ppdus[j].start_us + gs.pdu_dur_max > ppdu->start_us);)
+        {
+            if ((gs.ppdus[j].start_us + gs.ppdus[j].dur_us > ppdu->start_us) &&
+                (overlap_num < GROUP_SIM_OVERLAP_MAX))
+            {
+                overlap[overlap_num++] = j;
+            }
+        }
+        for (uint32_t j = i + 1; (j < gs.pdu_num) && (gs.ppdus[j].start_us < end_us); ++j)
+        {
+            if (overlap_num < GROUP_SIM_OVERLAP_MAX)
+            {
+                overlap[overlap_num++] = j;
+            }
+        }
+
+        const group_sim_press_t *ppress = &gs.ppresses[ppdu->press];
+        for (uint32_t lamp = 0; lamp < gs.cfg.lamp_num; ++lamp)
+        {
+            const group_sim_lamp_t *plamp = &gs.plamps[lamp];
+            bool target = (group_sim_lamp_remote_find(plamp, ppdu->src) >= 0);
+            gs.stat.receptions += target;
+            if (!group_sim_scanning(plamp, ppdu))
+            {
+                gs.stat.miss_scan += target;
+                continue;
+            }
+
+            bool transmitting = FALSE;
+            bool collided = FALSE;
+            for (uint32_t k = 0; k < overlap_num; ++k)
+            {
+                const group_sim_pdu_t *pother = &gs.ppdus[overlap[k]];
+                if ((GROUP_SIM_BG == pother->press) && (pother->src == lamp))
+                {
+                    transmitting = TRUE;
+                    break;
+                }
+                if (pother->ch == ppdu->ch)
+                {
+                    collided = TRUE;
+                }
+            }
+            if (transmitting)
+            {
+                gs.stat.miss_tx += target;
+                continue;
+            }
+            if (collided && (group_sim_uniform() >= gs.cfg.capture))
+            {
+                gs.stat.miss_collision += target;
+                continue;
+            }
+            if (group_sim_uniform() < gs.cfg.loss)
+            {
+                gs.stat.miss_loss += target;
+                continue;
+            }
+
+            gs.cur_press = ppdu->press;
+            gs.cur_time_us = end_us;
+            group_sim_lamp_receive(lamp, ppdu->src, ppress->adv_data, ppress->adv_len);
+        }
+    }
+}
+
+static double group_sim_percentile(double p)
+{
+    if (0 == gs.stat.delivered)
+    {
+        return 0;
+    }
+    return gs.platency[(uint64_t)(p * (gs.stat.delivered - 1) + 0.5)] / 1000.0;
+}
+
+static void group_sim_report(void)
+{
+    group_sim_cfg_t *pcfg = &gs.cfg;
+    group_sim_stat_t *pstat = &gs.stat;
+    for (uint32_t press = 0; press < gs.press_num; ++press)
+    {
+        if (gs.ppresses[press].delivered == gs.premotes[gs.ppresses[press].remote].target_num)
+        {
+            pstat->press_complete ++;
+        }
+    }
+    qsort(gs.platency, pstat->delivered, sizeof(uint32_t), group_sim_u32_cmp);
+
+    printf("config: %u remotes, %u lamps, %u remotes each lamp, %u s, ", pcfg->remote_num,
+           pcfg->lamp_num, pcfg->remotes_each_lamp, pcfg->duration_s);
+    if (0 != pcfg->sync_period_ms)
+    {
+        printf("presses every %u ms within %u ms\n", pcfg->sync_period_ms, pcfg->sync_spread_ms);
+    }
+    else
+    {
+        printf("%.2f presses per remote per minute\n", pcfg->press_rate);
+    }
+    printf("        tx %u times every %u ms, jitter %u us, scan %u/%u us, bg %.2f/s %u bytes, "
+           "loss %.3f, capture %.2f, seed %u\n", gs.task.retrans_count + 1, gs.task.retrans_interval,
+           pcfg->tx_jitter_us, pcfg->scan_window_us, pcfg->scan_interval_us, pcfg->bg_rate,
+           pcfg->bg_len, pcfg->loss, pcfg->capture, pcfg->seed);
+    printf("air:    %u pdus, load %.2f%% %.2f%% %.2f%% on channel 37 38 39\n", gs.pdu_num,
+           100.0 * pstat->air_us[0] / gs.end_us, 100.0 * pstat->air_us[1] / gs.end_us,
+           100.0 * pstat->air_us[2] / gs.end_us);
+    double receptions = MAX(pstat->receptions, 1);
+    printf("rx:     %llu pdus to target lamps, missed %.2f%% scan, %.2f%% own tx, "
+           "%.2f%% collision, %.2f%% loss\n", (unsigned long long)pstat->receptions,
+           100 * pstat->miss_scan / receptions, 100 * pstat->miss_tx / receptions,
+           100 * pstat->miss_collision / receptions, 100 * pstat->miss_loss / receptions);
+    printf("result: %u presses, delivery %.4f (%llu/%llu), presses to every target %.4f, "
+           "duplicated %llu, misdelivered %llu\n", gs.press_num,
+           (double)pstat->delivered / MAX(pstat->expected, 1), (unsigned long long)pstat->delivered,
+           (unsigned long long)pstat->expected, (double)pstat->press_complete / MAX(gs.press_num, 1),
+           (unsigned long long)pstat->duplicated, (unsigned long long)pstat->misdelivered);
+    printf("latency ms: p50 %.2f, p90 %.2f, p99 %.2f, p99.9 %.2f, max %.2f\n",
+           group_sim_percentile(0.5), group_sim_percentile(0.9), group_sim_percentile(0.99),
+           group_sim_percentile(0.999), group_sim_percentile(1));
+}
+
+static bool group_sim_args(int argc, char **argv)
+{
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        const char *peq = strchr(argv[arg], '=');
+        uint32_t index;
+        for (index = 0; index < sizeof(group_sim_params) / sizeof(group_sim_params[0]); ++index)
+        {
+            if ((NULL != peq) && (strlen(group_sim_params[index].name) == (size_t)(peq - argv[arg])) &&
+                (0 == strncmp(argv[arg], group_sim_params[index].name, peq - argv[arg])))
+            {
+                break;
+            }
+        }
+        if (index == sizeof(group_sim_params) / sizeof(group_sim_params[0]))
+        {
+            printf("usage: group_sim [name=value]...\n");
+            for (index = 0; index < sizeof(group_sim_params) / sizeof(group_sim_params[0]); ++index)
+            {
+                printf("  %-18s %s\n", group_sim_params[index].name, group_sim_params[index].help);
+            }
+            return FALSE;
+        }
+
+        if (group_sim_params[index].is_double)
+        {
+            *(double *)group_sim_params[index].pvalue = strtod(peq + 1, NULL);
+        }
+        else
+        {
+            *(uint32_t *)group_sim_params[index].pvalue = strtoul(peq + 1, NULL, 0);
+        }
+    }
+    return TRUE;
+}
+
+int main(int argc, char **argv)
+{
+    group_sim_cfg_default(&gs.cfg);
+    if (!group_sim_args(argc, argv) || !group_sim_setup() || !group_sim_traffic())
+    {
+        return 1;
+    }
+    group_sim_run();
+    group_sim_report();
+    return 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -17,7 +17,12 @@
 #include "gap_scheduler.h"
 #include "platform_diagnose.h"
 
+#ifndef GROUP_TRANSMITTER_TX_TIMES
 #define GROUP_TRANSMITTER_TX_TIMES          3 //!< bigger than or equal to 1
+#endif
+#ifndef GROUP_TRANSMITTER_TX_INTERVAL
+#define GROUP_TRANSMITTER_TX_INTERVAL       10 //!< ms
+#endif
 
 typedef struct
 {
@@ -47,7 +52,7 @@ static bool group_transmitter_transmit(group_msg_type_t type, uint8_t *pdata, ui
     ptask->adv_type = GAP_SCHED_ADV_TYPE_IND;
     ptask->adv_len = pbuffer[0] + 1;
     ptask->retrans_count = GROUP_TRANSMITTER_TX_TIMES - 1;
-    ptask->retrans_interval = 10;
+    ptask->retrans_interval = GROUP_TRANSMITTER_TX_INTERVAL;
     printi("group_transmitter_transmit: tid %d, type %d, len %d", pmsg->tid,
            pmsg->type, len + MEMBER_OFFSET(group_msg_t, cfg));
     dprinti((uint8_t *)pmsg, len + MEMBER_OFFSET(group_msg_t, cfg));
@@ -117,3 +122,19 @@ void group_transmitter_init(void)
     plt_rand(&gtc.tid, 1);
 }
 
+#if PLATFORM_HOST_SIM
+uint32_t group_transmitter_sim_ctx_size(void)
+{
+    return sizeof(group_transmitter_ctx_t);
+}
+
+void group_transmitter_sim_ctx_save(void *pctx)
+{
+    memcpy(pctx, &gtc, sizeof(group_transmitter_ctx_t));
+}
+
+void group_transmitter_sim_ctx_load(const void *pctx)
+{
+    memcpy(&gtc, pctx, sizeof(group_transmitter_ctx_t));
+}
+#endif
@@ -0,0 +1,395 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+* @file     ali_server_app.c
+* @brief    Source file for ali vendor server application.
+* @details  Applies the attributes of one vendor set as one light update and coalesces the
+*           attribute indications to the gateway.
+* @author   bill
+* @date     2019-1-8
+* @version  v1.0
+* *************************************************************************************
+*/
+
+#include <string.h>
+#include "mesh_api.h"
+#include "ali_server_app.h"
+#include "light_ctl.h"
+#include "light_cwrgb_app.h"
+#include "light_storage_app.h"
+#include "light_config.h"
+#if LIGHT_TYPE == LIGHT_CWRGB
+#include "light_ctl_hsl_server_app.h"
+#endif
+
+#define ALI_INDICATE_TIMER_ID               0
+
+/* fields changed by a set */
+#define ALI_FIELD_LIGHTNESS                 0x01
+#define ALI_FIELD_TEMPERATURE               0x02
+#define ALI_FIELD_HSL                       0x04
+#define ALI_FIELD_SCENE_MODE                0x08
+
+#define ALI_ON_OFF_UNCHANGED                0xff
+
+/* ali vendor model */
+static mesh_model_info_t ali_server;
+
+#if (LIGHT_TYPE == LIGHT_CW) || (LIGHT_TYPE == LIGHT_CWRGB)
+static uint16_t ali_scene_mode; //!< last scene mode recalled, 0 if none
+#endif
+
+/* attributes waiting for the indication */
+static ali_msg_type_t ali_indicate_types[ALI_ATTR_MAX_NUM];
+static uint8_t ali_indicate_num;
+static plt_timer_t ali_indicate_timer;
+
+static bool ali_light_is_on(void)
+{
+    return (0 != light_get_cold()->lightness) || (0 != light_get_warm()->lightness) ||
+           (0 != light_get_red()->lightness) || (0 != light_get_green()->lightness) ||
+           (0 != light_get_blue()->lightness);
+}
+
+static uint16_t ali_light_lightness(void)
+{
+#if LIGHT_TYPE == LIGHT_LIGHTNESS
+    return light_get_cold()->lightness;
+#elif LIGHT_TYPE == LIGHT_RGB
+    return light_get_hsl().lightness;
+#else
+    return light_get_ctl().lightness;
+#endif
+}
+
+static void ali_attr_get(ali_server_get_t *pdata)
+{
+    switch (pdata->type)
+    {
+    case ALI_ATTR_TYPE_ON_OFF:
+        pdata->value[0] = ali_light_is_on() ? 1 : 0;
+        pdata->len = 1;
+        break;
+    case ALI_ATTR_TYPE_LIGHTNESS:
+        LE_WORD2EXTRN(pdata->value, ali_light_lightness());
+        pdata->len = 2;
+        break;
+#if (LIGHT_TYPE == LIGHT_CW) || (LIGHT_TYPE == LIGHT_CWRGB)
+    case ALI_ATTR_TYPE_TEMPERATURE:
+        LE_WORD2EXTRN(pdata->value, light_get_ctl().temperature);
+        pdata->len = 2;
+        break;
+    case ALI_ATTR_TYPE_SCENE_MODE:
+        if (0 != ali_scene_mode)
+        {
+            LE_WORD2EXTRN(pdata->value, ali_scene_mode);
+            pdata->len = 2;
+        }
+        break;
+#endif
+#if (LIGHT_TYPE == LIGHT_RGB) || (LIGHT_TYPE == LIGHT_CWRGB)
+    case ALI_ATTR_TYPE_HSL:
+        {
+            light_hsl_t hsl = light_get_hsl();
+            LE_WORD2EXTRN(pdata->value, hsl.lightness);
+            LE_WORD2EXTRN(pdata->value + 2, hsl.hue);
+            LE_WORD2EXTRN(pdata->value + 4, hsl.saturation);
+            pdata->len = 6;
+        }
+        break;
+#endif
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief apply the attributes of one set
+ * @param[in] pattrs: attributes
+ * @param[in] num: number of attributes
+ * @retval 0: applied
+ * @retval -1: an attribute is invalid, the light is not changed
+ * @note every attribute is checked before the light is changed, the channels are written once
+ *       with the combined state. Turning off ignores the other attributes, types not supported by
+ *       the light type are ignored.
+ */
+static int32_t ali_attrs_apply(const ali_attr_t *pattrs, uint8_t num)
+{
+    uint8_t on_off = ALI_ON_OFF_UNCHANGED;
+    uint8_t fields = 0;
+    uint16_t lightness = 0;
+#if (LIGHT_TYPE == LIGHT_CW) || (LIGHT_TYPE == LIGHT_CWRGB)
+    uint16_t temperature = 0;
+    uint16_t scene_mode = 0;
+    const void *pscene = NULL;
+#endif
+#if (LIGHT_TYPE == LIGHT_RGB) || (LIGHT_TYPE == LIGHT_CWRGB)
+    light_hsl_t hsl_set = {0, 0, 0};
+#endif
+
+    for (uint8_t index = 0; index < num; ++index)
+    {
+        const uint8_t *pvalue = pattrs[index].pvalue;
+        uint16_t len = pattrs[index].len;
+        switch (pattrs[index].type)
+        {
+        case ALI_ATTR_TYPE_ON_OFF:
+            if ((1 != len) || (pvalue[0] > 1))
+            {
+                return -1;
+            }
+            on_off = pvalue[0];
+            break;
+        case ALI_ATTR_TYPE_LIGHTNESS:
+            if (2 != len)
+            {
+                return -1;
+            }
+            lightness = LE_EXTRN2WORD(pvalue);
+            fields |= ALI_FIELD_LIGHTNESS;
+            break;
+#if (LIGHT_TYPE == LIGHT_CW) || (LIGHT_TYPE == LIGHT_CWRGB)
+        case ALI_ATTR_TYPE_TEMPERATURE:
+            if (2 != len)
+            {
+                return -1;
+            }
+            temperature = LE_EXTRN2WORD(pvalue);
+            if (!IS_LIGHT_CTL_TEMPERATURE_VALID(temperature))
+            {
+                return -1;
+            }
+            fields |= ALI_FIELD_TEMPERATURE;
+            break;
+        case ALI_ATTR_TYPE_SCENE_MODE:
+            if (2 != len)
+            {
+                return -1;
+            }
+            scene_mode = LE_EXTRN2WORD(pvalue);
+            pscene = light_scene_state_get(scene_mode);
+            if (NULL == pscene)
+            {
+                return -1;
+            }
+            fields |= ALI_FIELD_SCENE_MODE;
+            break;
+#endif
+#if (LIGHT_TYPE == LIGHT_RGB) || (LIGHT_TYPE == LIGHT_CWRGB)
+        case ALI_ATTR_TYPE_HSL:
+            if (6 != len)
+            {
+                return -1;
+            }
+            hsl_set.lightness = LE_EXTRN2WORD(pvalue);
+            hsl_set.hue = LE_EXTRN2WORD(pvalue + 2);
+            hsl_set.saturation = LE_EXTRN2WORD(pvalue + 4);
+            fields |= ALI_FIELD_HSL;
+            break;
+#endif
+        default:
+            printw("ali_attrs_apply: ignore attribute 0x%04x", pattrs[index].type);
+            break;
+        }
+    }
+
+    if (0 == on_off)
+    {
+#if LIGHT_TYPE == LIGHT_LIGHTNESS
+        light_lighten_cold(0);
+#else
+        light_cwrgb_turn_off();
+#endif
+        return 0;
+    }
+
+    if (0 == fields)
+    {
+        if (1 == on_off)
+        {
+#if LIGHT_TYPE == LIGHT_LIGHTNESS
+            uint16_t last = light_get_cold()->lightness_last;
+            light_set_cold_lightness((0 == last) ? 65535 : last);
+#elif LIGHT_TYPE == LIGHT_CW
+            light_cw_turn_on();
+#elif LIGHT_TYPE == LIGHT_RGB
+            light_rgb_turn_on();
+#else
+            light_cwrgb_turn_on();
+#endif
+        }
+        return 0;
+    }
+
+#if LIGHT_TYPE == LIGHT_LIGHTNESS
+    if (fields & ALI_FIELD_LIGHTNESS)
+    {
+        light_set_cold_lightness(lightness);
+    }
+#else
+#if (LIGHT_TYPE == LIGHT_CW) || (LIGHT_TYPE == LIGHT_CWRGB)
+    bool ctl_changed = FALSE;
+    light_ctl_t ctl = light_get_ctl();
+#endif
+#if (LIGHT_TYPE == LIGHT_RGB) || (LIGHT_TYPE == LIGHT_CWRGB)
+    bool hsl_changed = FALSE;
+    light_hsl_t hsl = light_get_hsl();
+#endif
+
+    /* the scene is the base state, the other attributes of the set override it */
+    if (fields & ALI_FIELD_SCENE_MODE)
+    {
+#if LIGHT_TYPE == LIGHT_CW
+        ctl = *(const light_ctl_t *)pscene;
+        ctl_changed = TRUE;
+#elif LIGHT_TYPE == LIGHT_CWRGB
+        const light_ctl_hsl_scene_t *pstate = pscene;
+        ctl = pstate->ctl;
+        hsl = pstate->hsl;
+        ctl_changed = TRUE;
+        hsl_changed = TRUE;
+#endif
+    }
+#if (LIGHT_TYPE == LIGHT_CW) || (LIGHT_TYPE == LIGHT_CWRGB)
+    if (fields & ALI_FIELD_LIGHTNESS)
+    {
+        ctl.lightness = lightness;
+        ctl_changed = TRUE;
+    }
+    if (fields & ALI_FIELD_TEMPERATURE)
+    {
+        ctl.temperature = temperature;
+        ctl.delta_uv = 0;
+        ctl_changed = TRUE;
+    }
+#endif
+#if (LIGHT_TYPE == LIGHT_RGB) || (LIGHT_TYPE == LIGHT_CWRGB)
+    if (fields & ALI_FIELD_HSL)
+    {
+        hsl = hsl_set;
+        hsl_changed = TRUE;
+    }
+#if LIGHT_TYPE == LIGHT_RGB
+    if (fields & ALI_FIELD_LIGHTNESS)
+    {
+        hsl.lightness = lightness;
+        hsl_changed = TRUE;
+    }
+#else
+    if ((fields & ALI_FIELD_LIGHTNESS) && !(fields & ALI_FIELD_HSL) &&
+        ((0 != light_get_red()->lightness) || (0 != light_get_green()->lightness) ||
+         (0 != light_get_blue()->lightness)))
+    {
+        /* dim the colour as well if it is on */
+        hsl.lightness = lightness;
+        hsl_changed = TRUE;
+    }
+#endif
+#endif
+
+#if (LIGHT_TYPE == LIGHT_CW) || (LIGHT_TYPE == LIGHT_CWRGB)
+    if (ctl_changed)
+    {
+        light_set_ctl(ctl);
+    }
+#endif
+#if (LIGHT_TYPE == LIGHT_RGB) || (LIGHT_TYPE == LIGHT_CWRGB)
+    if (hsl_changed)
+    {
+        light_set_hsl(hsl);
+    }
+#endif
+#endif
+
+#if (LIGHT_TYPE == LIGHT_CW) || (LIGHT_TYPE == LIGHT_CWRGB)
+    ali_scene_mode = (fields & ALI_FIELD_SCENE_MODE) ? scene_mode : 0;
+#endif
+
+    return 0;
+}
+
+static void ali_indicate_timeout_cb(void *ptimer)
+{
+    UNUSED(ptimer);
+    if (0 != ali_indicate_num)
+    {
+        ali_publish(&ali_server, ali_indicate_types, ali_indicate_num);
+        ali_indicate_num = 0;
+    }
+}
+
+void ali_server_indicate(ali_msg_type_t type)
+{
+    uint8_t index;
+    for (index = 0; index < ali_indicate_num; ++index)
+    {
+        if (ali_indicate_types[index] == type)
+        {
+            break;
+        }
+    }
+    if ((index == ali_indicate_num) && (ali_indicate_num < ALI_ATTR_MAX_NUM))
+    {
+        ali_indicate_types[ali_indicate_num ++] = type;
+    }
+
+    if (NULL == ali_indicate_timer)
+    {
+        ali_indicate_timer = plt_timer_create("ali", ALI_INDICATE_DELAY, FALSE, ALI_INDICATE_TIMER_ID,
+                                              ali_indicate_timeout_cb);
+        if (NULL == ali_indicate_timer)
+        {
+            printe("ali_server_indicate: create timer failed, indicate now");
+            ali_indicate_timeout_cb(NULL);
+            return;
+        }
+    }
+    /* the window is not extended by later changes, the gateway hears within ALI_INDICATE_DELAY */
+    if (!plt_timer_is_active(ali_indicate_timer))
+    {
+        plt_timer_change_period(ali_indicate_timer, ALI_INDICATE_DELAY, 0);
+    }
+}
+
+static int32_t ali_server_data(const mesh_model_info_p pmodel_info, uint32_t type, void *pargs)
+{
+    int32_t ret = 0;
+    switch (type)
+    {
+    case ALI_SERVER_GET:
+        ali_attr_get(pargs);
+        break;
+    case ALI_SERVER_SET:
+        {
+            ali_server_set_t *pdata = pargs;
+            ret = ali_attrs_apply(pdata->pattrs, pdata->num);
+            if (ret < 0)
+            {
+                printw("ali_server_data: invalid set, tid %d", pdata->tid);
+                break;
+            }
+
+            light_state_store();
+            if (!pdata->ack)
+            {
+                /* nothing is sent back to the source, let the gateway know */
+                for (uint8_t index = 0; index < pdata->num; ++index)
+                {
+                    ali_server_indicate(pdata->pattrs[index].type);
+                }
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    return ret;
+}
+
+void ali_server_models_init(uint8_t element_index)
+{
+    ali_server.model_data_cb = ali_server_data;
+    ali_server_reg(element_index, &ali_server);
+}
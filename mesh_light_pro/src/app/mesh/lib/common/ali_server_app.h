@@ -0,0 +1,52 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+* @file     ali_server_app.h
+* @brief    Head file for ali vendor server application.
+* @details  Data structs and external functions declaration.
+* @author   bill
+* @date     2019-1-8
+* @version  v1.0
+* *************************************************************************************
+*/
+
+#ifndef _ALI_SERVER_APP_H_
+#define _ALI_SERVER_APP_H_
+
+#include "platform_types.h"
+#include "ali.h"
+
+BEGIN_DECLS
+
+/**
+ * @addtogroup ALI_SERVER_APP
+ * @{
+ */
+
+/**
+ * @defgroup Ali_Server_App_Exported_Functions Ali Server App Exported Functions
+ * @brief
+ * @{
+ */
+/**
+ * @brief initialize ali vendor server model
+ * @param[in] element_index: model element index
+ * @note register the light server models first, scene modes are recalled from their scene
+ *       register
+ */
+void ali_server_models_init(uint8_t element_index);
+
+/**
+ * @brief indicate an attribute change to the gateway
+ * @param[in] type: attribute type
+ * @note the changes within ALI_INDICATE_DELAY after the first one are published in one stat
+ *       carrying the values at publish time
+ */
+void ali_server_indicate(ali_msg_type_t type);
+/** @} */
+/** @} */
+
+END_DECLS
+
+#endif /* _ALI_SERVER_APP_H_ */
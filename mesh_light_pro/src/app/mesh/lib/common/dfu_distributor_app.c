@@ -13,12 +13,20 @@
 
 #define MM_ID MM_MODEL
 
+#include "app_msg.h"
 #include "dfu_distributor_app.h"
 #include "patch_header_check.h"
+#include "crc32.h"
 
-#define DFU_DIST_NODE_NUM_MAX   5
-#define DFU_DIST_RETRY_TIMES    3
+#define DFU_DIST_RETRY_TIMES    8 //!< passes over the silent nodes before they are dropped
+#define DFU_DIST_POLL_RETRY_TIMES   1 //!< retries of the block status poll, silent nodes stay in the next round
 #define DFU_DIST_RETRY_PERIOD   7000
+#define DFU_DIST_RESPONSE_PERIOD    2000 //!< wait for the responses of the requests in flight
+#define DFU_DIST_REQUEST_WINDOW     16 //!< requests in flight to different nodes
+#define DFU_DIST_RESEND_ROUND_MAX   8 //!< resend rounds without progress before the incomplete nodes are dropped
+
+extern void *evt_queue_handle;
+extern void *io_queue_handle;
 
 typedef enum
 {
@@ -37,6 +45,11 @@ typedef struct
 {
     uint16_t addr;
     fw_update_phase_t phase;
+    bool failed; //!< no response after retries, left out of the rest of the distribution
+    bool requested; //!< the request of the current phase is in flight
+    bool responded; //!< the request of the current phase is answered
+    bool block_received; //!< the current block has been received by the node
+    uint16_t missing_num; //!< fewest chunks of the current block the node has reported missing
 } dfu_dist_node_info_t;
 
 struct
@@ -44,9 +57,12 @@ struct
     plt_timer_t timer;
     dfu_dist_fsm_t fsm;
     uint16_t dst; //!< usually group addr
-    dfu_dist_node_info_t node_info[DFU_DIST_NODE_NUM_MAX];
+    uint16_t chunk_dst; //!< dst, or the last node missing chunks of the block
+    dfu_dist_node_info_t *node_info;
     uint16_t node_num;
-    uint16_t node_loop;
+    uint16_t node_loop; //!< next node to request in the pass
+    uint16_t request_num; //!< requests in flight
+    uint8_t retry_count; //!< passes over the nodes of the phase, or chunk send retries
     uint16_t company_id;
     uint8_t firmware_id[FW_UPDATE_FW_ID_LEN];
     uint8_t count;
@@ -58,23 +74,52 @@ struct
     uint32_t block_size;
     uint16_t block_num;
     uint16_t block_loop;
+    uint8_t block_round; //!< resend rounds of the current block without progress
+    uint32_t missing_total; //!< chunks missing in all the nodes reports of the round
+    bool block_progress; //!< a node has received the block or reported fewer missing chunks
     uint16_t chunk_size;
     uint16_t chunk_num;
     uint16_t chunk_loop;
-    uint16_t *chunk_list;
-    uint16_t chunk_list_num;
-    uint16_t chunk_list_loop;
+    uint8_t *chunk_missing; //!< bit pool of the chunks to send to dst, union of the nodes reports
     fw_update_policy_t policy;
 } dfu_dist_ctx;
 
+static void dfu_dist_phase_start(dfu_dist_fsm_t fsm);
+static void dfu_dist_phase_done(void);
+static void dfu_dist_request_fill(void);
+
 void dfu_dist_timeout_cb(void *timer)
 {
+    uint8_t event = EVENT_IO_TO_APP;
+    T_IO_MSG msg;
+    msg.type = DFU_DIST_TIMEOUT_MSG;
+    if (os_msg_send(io_queue_handle, &msg, 0) == false)
+    {
+    }
+    else if (os_msg_send(evt_queue_handle, &event, 0) == false)
+    {
+    }
+}
 
+static void dfu_dist_stop(void)
+{
+    dfu_dist_ctx.fsm = DFU_DIST_IDLE;
+    plt_timer_stop(dfu_dist_ctx.timer, 0);
+    if (dfu_dist_ctx.node_info)
+    {
+        plt_free(dfu_dist_ctx.node_info, RAM_TYPE_DATA_ON);
+        dfu_dist_ctx.node_info = NULL;
+    }
+    if (dfu_dist_ctx.chunk_missing)
+    {
+        plt_free(dfu_dist_ctx.chunk_missing, RAM_TYPE_DATA_ON);
+        dfu_dist_ctx.chunk_missing = NULL;
+    }
 }
 
-void dfu_dist_block_start(void)
+static uint32_t dfu_dist_current_block_size(void)
 {
-    uint32_t block_size;
+    uint32_t block_size = dfu_dist_ctx.block_size;
     if (dfu_dist_ctx.block_loop == dfu_dist_ctx.block_num - 1)
     {
         block_size = dfu_dist_ctx.object_size % dfu_dist_ctx.block_size;
@@ -83,38 +128,79 @@ void dfu_dist_block_start(void)
             block_size = dfu_dist_ctx.block_size;
         }
     }
-    else
-    {
-        block_size = dfu_dist_ctx.block_size;
-    }
-    dfu_dist_ctx.chunk_size = (block_size + dfu_dist_ctx.max_chunk_num - 1) /
-                              dfu_dist_ctx.max_chunk_num;
-    dfu_dist_ctx.chunk_num = (block_size + dfu_dist_ctx.chunk_size - 1) / dfu_dist_ctx.chunk_size;
-    if (dfu_dist_ctx.chunk_size > (ACCESS_PAYLOAD_MAX_SIZE - MEMBER_OFFSET(obj_chunk_transfer_t, data)))
+    return block_size;
+}
+
+/**
+ * @brief check whether the node still has to answer the request of the current phase
+ */
+static bool dfu_dist_node_pending(const dfu_dist_node_info_t *pnode)
+{
+    if (pnode->failed || pnode->responded)
     {
-        // TODO:
+        return FALSE;
     }
-    obj_block_transfer_start(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr,
-                             dfu_dist_ctx.object_id, dfu_dist_ctx.block_loop,
-                             dfu_dist_ctx.chunk_size, OBJ_BLOCK_CHECK_ALGO_CRC32, NULL, 0);
+    return !((dfu_dist_ctx.fsm == DFU_DIST_OBJ_CHUNK_TRANSFERED) && pnode->block_received);
 }
 
-void dfu_dist_chunk_start(void)
+/**
+ * @brief move node_loop to the first pending node from the start index
+ * @param[in] start: node index to start from
+ * @retval TRUE: node found
+ * @retval FALSE: no more node to request in this pass
+ */
+static bool dfu_dist_node_next(uint16_t start)
 {
-    uint16_t chunk_size;
-    uint32_t block_size;
-    if (dfu_dist_ctx.block_loop == dfu_dist_ctx.block_num - 1)
+    for (dfu_dist_ctx.node_loop = start; dfu_dist_ctx.node_loop < dfu_dist_ctx.node_num;
+         dfu_dist_ctx.node_loop++)
     {
-        block_size = dfu_dist_ctx.object_size % dfu_dist_ctx.block_size;
-        if (!block_size)
+        dfu_dist_node_info_t *pnode = &dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop];
+        if (dfu_dist_node_pending(pnode) && !pnode->requested)
         {
-            block_size = dfu_dist_ctx.block_size;
+            return TRUE;
         }
     }
-    else
+    return FALSE;
+}
+
+/**
+ * @brief find the node which still has to answer the request of the current phase
+ * @param[in] addr: source address of the response
+ * @return the node, NULL if not found or already answered
+ */
+static dfu_dist_node_info_t *dfu_dist_node_find(uint16_t addr)
+{
+    if (dfu_dist_ctx.fsm == DFU_DIST_IDLE)
     {
-        block_size = dfu_dist_ctx.block_size;
+        return NULL;
     }
+    for (uint16_t loop = 0; loop < dfu_dist_ctx.node_num; loop++)
+    {
+        dfu_dist_node_info_t *pnode = &dfu_dist_ctx.node_info[loop];
+        if (pnode->addr == addr)
+        {
+            return dfu_dist_node_pending(pnode) ? pnode : NULL;
+        }
+    }
+    return NULL;
+}
+
+void dfu_dist_block_start(uint16_t dst)
+{
+    /* the nodes check the block against it before writing it */
+    uint8_t *pheader = (uint8_t *)get_header_addr_by_img_id(AppPatch);
+    uint32_t crc = crc32_update(0, pheader + dfu_dist_ctx.block_loop * dfu_dist_ctx.block_size,
+                                dfu_dist_current_block_size());
+    uint8_t checksum[4];
+    LE_DWORD2EXTRN(checksum, crc);
+    obj_block_transfer_start(dst, dfu_dist_ctx.object_id, dfu_dist_ctx.block_loop,
+                             dfu_dist_ctx.chunk_size, OBJ_BLOCK_CHECK_ALGO_CRC32, checksum, sizeof(checksum));
+}
+
+void dfu_dist_chunk_start(void)
+{
+    uint16_t chunk_size;
+    uint32_t block_size = dfu_dist_current_block_size();
     if (dfu_dist_ctx.chunk_loop == dfu_dist_ctx.chunk_num - 1)
     {
         chunk_size = block_size % dfu_dist_ctx.chunk_size;
@@ -127,56 +213,372 @@ void dfu_dist_chunk_start(void)
     {
         chunk_size = dfu_dist_ctx.chunk_size;
     }
-    uint8_t *chunk_data = plt_malloc(chunk_size, RAM_TYPE_DATA_OFF);
-    if (NULL == chunk_data)
-    {
-        printe("dfu: dfu_dist_chunk_start malloc fail!");
-        return;
-    }
+    /* the image is memory mapped, send the chunk from flash directly */
     uint8_t *pheader = (uint8_t *)get_header_addr_by_img_id(AppPatch);
-    memcpy(chunk_data, pheader + dfu_dist_ctx.block_loop * dfu_dist_ctx.block_size +
-           dfu_dist_ctx.chunk_loop * dfu_dist_ctx.chunk_size, chunk_size);
-    printi("dfu: obj size %d, block num %d/%d size %d, chunk num %d/%d size %d",
+    printi("dfu: obj size %d, block num %d/%d size %d, chunk num %d/%d size %d, round %d",
            dfu_dist_ctx.object_size,
            dfu_dist_ctx.block_loop, dfu_dist_ctx.block_num, block_size,
-           dfu_dist_ctx.chunk_loop, dfu_dist_ctx.chunk_num, chunk_size);
-    obj_chunk_transfer(dfu_dist_ctx.dst, dfu_dist_ctx.chunk_loop, chunk_data, chunk_size);
-    plt_free(chunk_data, RAM_TYPE_DATA_OFF);
+           dfu_dist_ctx.chunk_loop, dfu_dist_ctx.chunk_num, chunk_size, dfu_dist_ctx.block_round);
+    plt_timer_change_period(dfu_dist_ctx.timer, DFU_DIST_RETRY_PERIOD, 0);
+    obj_chunk_transfer(dfu_dist_ctx.chunk_dst, dfu_dist_ctx.chunk_loop,
+                       pheader + dfu_dist_ctx.block_loop * dfu_dist_ctx.block_size +
+                       dfu_dist_ctx.chunk_loop * dfu_dist_ctx.chunk_size, chunk_size);
 }
 
-void obj_transfer_client_send_cb(mesh_model_info_p pmodel_info, mesh_msg_send_stat_t stat,
-                                 uint32_t access_opcode)
+/**
+ * @brief send the next missing chunk to dst, check the nodes when all of them have been sent
+ */
+static void dfu_dist_chunk_next(void)
 {
-    if (access_opcode == MESH_MSG_OBJ_CHUNCK_TRANSFER)
+    while (dfu_dist_ctx.chunk_loop < dfu_dist_ctx.chunk_num)
     {
-        if (dfu_dist_ctx.fsm == DFU_DIST_OBJ_BLOCK_STARTED)
+        if (plt_bit_pool_get(dfu_dist_ctx.chunk_missing, dfu_dist_ctx.chunk_loop))
         {
-            dfu_dist_ctx.chunk_loop++;
-            if (dfu_dist_ctx.chunk_loop < dfu_dist_ctx.chunk_num)
-            {
-                dfu_dist_chunk_start();
-            }
-            else
+            dfu_dist_chunk_start();
+            return;
+        }
+        dfu_dist_ctx.chunk_loop++;
+    }
+
+    /* collect the missing chunks of this round from the nodes */
+    memset(dfu_dist_ctx.chunk_missing, 0, plt_bit_pool_size(dfu_dist_ctx.max_chunk_num));
+    dfu_dist_ctx.missing_total = 0;
+    dfu_dist_ctx.block_progress = FALSE;
+    dfu_dist_phase_start(DFU_DIST_OBJ_CHUNK_TRANSFERED);
+}
+
+/**
+ * @brief send the request of the current phase to the node
+ */
+static void dfu_dist_request(uint16_t addr)
+{
+    plt_timer_change_period(dfu_dist_ctx.timer, DFU_DIST_RESPONSE_PERIOD, 0);
+    switch (dfu_dist_ctx.fsm)
+    {
+    case DFU_DIST_STARTED:
+        obj_info_get(addr);
+        break;
+    case DFU_DIST_OBJ_INFO_GETTED:
+        fw_update_prepare(addr, dfu_dist_ctx.company_id, dfu_dist_ctx.firmware_id,
+                          dfu_dist_ctx.object_id, NULL, 0);
+        break;
+    case DFU_DIST_FW_PREPARED:
+        fw_update_start(addr, dfu_dist_ctx.policy, dfu_dist_ctx.company_id, dfu_dist_ctx.firmware_id);
+        break;
+    case DFU_DIST_FW_STARTED:
+        obj_transfer_start(addr, dfu_dist_ctx.object_id, dfu_dist_ctx.object_size,
+                           plt_log2(dfu_dist_ctx.block_size));
+        break;
+    case DFU_DIST_OBJ_STARTED:
+        dfu_dist_block_start(addr);
+        break;
+    case DFU_DIST_OBJ_CHUNK_TRANSFERED:
+        obj_block_get(addr, dfu_dist_ctx.object_id, dfu_dist_ctx.block_loop);
+        break;
+    case DFU_DIST_OBJ_TRANSFERED:
+        fw_update_apply(addr, dfu_dist_ctx.company_id, dfu_dist_ctx.firmware_id);
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief every pending node has been requested once in this pass, request the silent ones again
+ *        or finish the phase without them
+ */
+static void dfu_dist_pass_done(void)
+{
+    bool pending = FALSE;
+    for (uint16_t loop = 0; loop < dfu_dist_ctx.node_num; loop++)
+    {
+        if (dfu_dist_node_pending(&dfu_dist_ctx.node_info[loop]))
+        {
+            pending = TRUE;
+            break;
+        }
+    }
+    uint8_t retry_times = (dfu_dist_ctx.fsm == DFU_DIST_OBJ_CHUNK_TRANSFERED) ?
+                          DFU_DIST_POLL_RETRY_TIMES : DFU_DIST_RETRY_TIMES;
+    if (pending && (dfu_dist_ctx.retry_count < retry_times))
+    {
+        dfu_dist_ctx.retry_count++;
+        printw("dfu_dist_pass_done: retry %d, fsm = %d", dfu_dist_ctx.retry_count, dfu_dist_ctx.fsm);
+        dfu_dist_ctx.node_loop = 0;
+        dfu_dist_request_fill();
+        return;
+    }
+
+    plt_timer_stop(dfu_dist_ctx.timer, 0);
+    for (uint16_t loop = 0; loop < dfu_dist_ctx.node_num; loop++)
+    {
+        dfu_dist_node_info_t *pnode = &dfu_dist_ctx.node_info[loop];
+        if (!dfu_dist_node_pending(pnode))
+        {
+            continue;
+        }
+        if (dfu_dist_ctx.fsm == DFU_DIST_OBJ_CHUNK_TRANSFERED)
+        {
+            /* a silent node stays in the next round as missing every chunk, it is dropped only
+             * when the rounds make no progress */
+            printw("dfu_dist_pass_done: node 0x%04x no block status", pnode->addr);
+            dfu_dist_ctx.missing_total += dfu_dist_ctx.chunk_num;
+            for (uint16_t chunk = 0; chunk < dfu_dist_ctx.chunk_num; chunk++)
             {
-                dfu_dist_ctx.fsm = DFU_DIST_OBJ_CHUNK_TRANSFERED;
-                dfu_dist_ctx.node_loop = 0;
-                obj_block_get(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.object_id,
-                              dfu_dist_ctx.block_num);
+                plt_bit_pool_set(dfu_dist_ctx.chunk_missing, chunk, TRUE);
             }
         }
-        else if (dfu_dist_ctx.fsm == DFU_DIST_OBJ_CHUNK_TRANSFERED)
+        else
         {
-            dfu_dist_ctx.chunk_list_loop++;
-            if (dfu_dist_ctx.chunk_list_loop < dfu_dist_ctx.chunk_list_num)
+            printe("dfu_dist_pass_done: node 0x%04x no response, drop it!", pnode->addr);
+            pnode->failed = TRUE;
+        }
+    }
+    dfu_dist_phase_done();
+}
+
+/**
+ * @brief send the request of the current phase to the next pending nodes, up to
+ *        DFU_DIST_REQUEST_WINDOW of them in flight
+ */
+static void dfu_dist_request_fill(void)
+{
+    while ((dfu_dist_ctx.request_num < DFU_DIST_REQUEST_WINDOW) &&
+           dfu_dist_node_next(dfu_dist_ctx.node_loop))
+    {
+        dfu_dist_node_info_t *pnode = &dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop];
+        pnode->requested = TRUE;
+        dfu_dist_ctx.request_num++;
+        dfu_dist_ctx.node_loop++;
+        dfu_dist_request(pnode->addr);
+    }
+    if (0 == dfu_dist_ctx.request_num)
+    {
+        dfu_dist_pass_done();
+    }
+}
+
+/**
+ * @brief the current phase is finished by all the nodes, go to the next one
+ */
+static void dfu_dist_phase_done(void)
+{
+    switch (dfu_dist_ctx.fsm)
+    {
+    case DFU_DIST_STARTED:
+        if (dfu_dist_ctx.min_block_size > dfu_dist_ctx.max_block_size)
+        {
+            // TODO:
+        }
+        else
+        {
+            /* chunks to a group addr are not acked and lost with any of their segments, the
+             * smallest block keeps every chunk in a few segments */
+            dfu_dist_ctx.block_size = MESH_IS_GROUP_ADDR(dfu_dist_ctx.dst) ? dfu_dist_ctx.min_block_size :
+                                      dfu_dist_ctx.max_block_size;
+            dfu_dist_ctx.block_num = (dfu_dist_ctx.object_size + dfu_dist_ctx.block_size - 1) /
+                                     dfu_dist_ctx.block_size;
+        }
+        dfu_dist_ctx.chunk_missing = plt_malloc(plt_bit_pool_size(dfu_dist_ctx.max_chunk_num),
+                                                RAM_TYPE_DATA_ON);
+        if (NULL == dfu_dist_ctx.chunk_missing)
+        {
+            printe("dfu_dist_phase_done: malloc chunk bit pool fail!");
+            dfu_dist_stop();
+            return;
+        }
+        dfu_dist_phase_start(DFU_DIST_OBJ_INFO_GETTED);
+        break;
+    case DFU_DIST_OBJ_INFO_GETTED:
+        dfu_dist_phase_start(DFU_DIST_FW_PREPARED);
+        break;
+    case DFU_DIST_FW_PREPARED:
+        dfu_dist_phase_start(DFU_DIST_FW_STARTED);
+        break;
+    case DFU_DIST_FW_STARTED:
+        dfu_dist_ctx.block_loop = 0;
+        dfu_dist_phase_start(DFU_DIST_OBJ_STARTED);
+        break;
+    case DFU_DIST_OBJ_STARTED:
+        /* every node is waiting for the chunks, send all of them to dst once */
+        dfu_dist_ctx.fsm = DFU_DIST_OBJ_BLOCK_STARTED;
+        dfu_dist_ctx.retry_count = 0;
+        dfu_dist_ctx.chunk_dst = dfu_dist_ctx.dst;
+        dfu_dist_ctx.block_round = 0;
+        dfu_dist_ctx.chunk_loop = 0;
+        for (uint16_t loop = 0; loop < dfu_dist_ctx.chunk_num; loop++)
+        {
+            plt_bit_pool_set(dfu_dist_ctx.chunk_missing, loop, TRUE);
+        }
+        dfu_dist_chunk_next();
+        break;
+    case DFU_DIST_OBJ_CHUNK_TRANSFERED:
+        {
+            uint16_t incomplete_num = 0;
+            dfu_dist_node_info_t *pnearest = NULL;
+            for (uint16_t loop = 0; loop < dfu_dist_ctx.node_num; loop++)
             {
-                dfu_dist_ctx.chunk_loop = dfu_dist_ctx.chunk_list[dfu_dist_ctx.chunk_list_loop];
-                dfu_dist_chunk_start();
+                dfu_dist_node_info_t *pnode = &dfu_dist_ctx.node_info[loop];
+                if (!pnode->failed && !pnode->block_received)
+                {
+                    incomplete_num++;
+                    dfu_dist_ctx.chunk_dst = pnode->addr;
+                    if (pnode->responded &&
+                        ((NULL == pnearest) || (pnode->missing_num < pnearest->missing_num)))
+                    {
+                        pnearest = pnode;
+                    }
+                }
             }
-            else
+            /* a silent node counts as missing every chunk, so the progress is judged by the
+             * nodes which have answered */
+            if (dfu_dist_ctx.block_progress)
             {
-                obj_block_get(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.object_id,
-                              dfu_dist_ctx.block_num);
+                dfu_dist_ctx.block_round = 0;
             }
+            if (dfu_dist_ctx.missing_total && (dfu_dist_ctx.block_round < DFU_DIST_RESEND_ROUND_MAX))
+            {
+                /* resend the union of the missing chunks to dst, a single node left gets them
+                 * by unicast which is acked segment by segment. A group round may keep losing a
+                 * long chunk, so after a round without progress the answered node missing the
+                 * fewest chunks gets them by unicast instead. */
+                if (incomplete_num > 1)
+                {
+                    dfu_dist_ctx.chunk_dst = dfu_dist_ctx.dst;
+                    if (dfu_dist_ctx.block_round && (NULL != pnearest))
+                    {
+                        dfu_dist_ctx.chunk_dst = pnearest->addr;
+                    }
+                }
+                dfu_dist_ctx.fsm = DFU_DIST_OBJ_BLOCK_STARTED;
+                dfu_dist_ctx.retry_count = 0;
+                dfu_dist_ctx.block_round++;
+                dfu_dist_ctx.chunk_loop = 0;
+                dfu_dist_chunk_next();
+                break;
+            }
+            for (uint16_t loop = 0; loop < dfu_dist_ctx.node_num; loop++)
+            {
+                if (!dfu_dist_ctx.node_info[loop].failed && !dfu_dist_ctx.node_info[loop].block_received)
+                {
+                    printe("dfu_dist_phase_done: node 0x%04x misses block %d, drop it!",
+                           dfu_dist_ctx.node_info[loop].addr, dfu_dist_ctx.block_loop);
+                    dfu_dist_ctx.node_info[loop].failed = TRUE;
+                }
+            }
+            dfu_dist_ctx.block_loop++;
+            dfu_dist_phase_start(dfu_dist_ctx.block_loop < dfu_dist_ctx.block_num ? DFU_DIST_OBJ_STARTED :
+                                 DFU_DIST_OBJ_TRANSFERED);
+        }
+        break;
+    case DFU_DIST_OBJ_TRANSFERED:
+        /* Oh my god, finally it is all over! */
+        dfu_dist_stop();
+        // TODO: inform the upper layer
+        break;
+    default:
+        break;
+    }
+}
+
+static void dfu_dist_phase_start(dfu_dist_fsm_t fsm)
+{
+    dfu_dist_ctx.fsm = fsm;
+    dfu_dist_ctx.retry_count = 0;
+    dfu_dist_ctx.request_num = 0;
+    for (uint16_t loop = 0; loop < dfu_dist_ctx.node_num; loop++)
+    {
+        dfu_dist_ctx.node_info[loop].requested = FALSE;
+        dfu_dist_ctx.node_info[loop].responded = FALSE;
+    }
+    if (fsm == DFU_DIST_OBJ_STARTED)
+    {
+        uint32_t block_size = dfu_dist_current_block_size();
+        dfu_dist_ctx.chunk_size = (block_size + dfu_dist_ctx.max_chunk_num - 1) /
+                                  dfu_dist_ctx.max_chunk_num;
+        dfu_dist_ctx.chunk_num = (block_size + dfu_dist_ctx.chunk_size - 1) / dfu_dist_ctx.chunk_size;
+        if (dfu_dist_ctx.chunk_size > (ACCESS_PAYLOAD_MAX_SIZE - MEMBER_OFFSET(obj_chunk_transfer_t, data)))
+        {
+            // TODO:
+        }
+        for (uint16_t loop = 0; loop < dfu_dist_ctx.node_num; loop++)
+        {
+            dfu_dist_ctx.node_info[loop].block_received = FALSE;
+            dfu_dist_ctx.node_info[loop].missing_num = 0xffff;
+        }
+    }
+
+    if (!dfu_dist_node_next(0) && (fsm != DFU_DIST_OBJ_CHUNK_TRANSFERED))
+    {
+        printe("dfu_dist_phase_start: no node left, fsm = %d", fsm);
+        dfu_dist_stop();
+        return;
+    }
+    /* all the nodes may have received the block already, then the phase is done at once */
+    dfu_dist_ctx.node_loop = 0;
+    dfu_dist_request_fill();
+}
+
+/**
+ * @brief the node has answered the request of the current phase, request the next nodes or
+ *        finish the pass
+ */
+static void dfu_dist_node_done(dfu_dist_node_info_t *pnode)
+{
+    pnode->responded = TRUE;
+    if (pnode->requested)
+    {
+        pnode->requested = FALSE;
+        dfu_dist_ctx.request_num--;
+    }
+    dfu_dist_request_fill();
+}
+
+void dfu_dist_handle_timeout(void)
+{
+    if (dfu_dist_ctx.fsm == DFU_DIST_IDLE)
+    {
+        return;
+    }
+
+    if (dfu_dist_ctx.fsm == DFU_DIST_OBJ_BLOCK_STARTED)
+    {
+        if (dfu_dist_ctx.retry_count < DFU_DIST_RETRY_TIMES)
+        {
+            dfu_dist_ctx.retry_count++;
+            printw("dfu_dist_handle_timeout: retry chunk %d, %d", dfu_dist_ctx.chunk_loop,
+                   dfu_dist_ctx.retry_count);
+            dfu_dist_chunk_start();
+        }
+        else
+        {
+            printe("dfu_dist_handle_timeout: fail to send chunk %d, stop!", dfu_dist_ctx.chunk_loop);
+            dfu_dist_stop();
+        }
+        return;
+    }
+
+    /* the requests in flight are not answered, go on with the rest of the pass */
+    printw("dfu_dist_handle_timeout: %d requests not answered, fsm = %d", dfu_dist_ctx.request_num,
+           dfu_dist_ctx.fsm);
+    for (uint16_t loop = 0; loop < dfu_dist_ctx.node_num; loop++)
+    {
+        dfu_dist_ctx.node_info[loop].requested = FALSE;
+    }
+    dfu_dist_ctx.request_num = 0;
+    dfu_dist_request_fill();
+}
+
+void obj_transfer_client_send_cb(mesh_model_info_p pmodel_info, mesh_msg_send_stat_t stat,
+                                 uint32_t access_opcode)
+{
+    if (access_opcode == MESH_MSG_OBJ_CHUNCK_TRANSFER)
+    {
+        if (dfu_dist_ctx.fsm == DFU_DIST_OBJ_BLOCK_STARTED)
+        {
+            dfu_dist_ctx.retry_count = 0;
+            dfu_dist_ctx.chunk_loop++;
+            dfu_dist_chunk_next();
         }
     }
 }
@@ -185,157 +587,86 @@ bool obj_transfer_client_receive(mesh_msg_p pmesh_msg)
 {
     bool ret = TRUE;
     uint8_t *pbuffer = pmesh_msg->pbuffer + pmesh_msg->msg_offset;
+    dfu_dist_node_info_t *pnode = dfu_dist_node_find(pmesh_msg->src);
     switch (pmesh_msg->access_opcode)
     {
     case MESH_MSG_OBJ_INFO_STAT:
         if (pmesh_msg->msg_len == sizeof(obj_info_stat_t))
         {
             obj_info_stat_t *pmsg = (obj_info_stat_t *)pbuffer;
-            if (pmesh_msg->src == dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr)
+            if ((NULL != pnode) && (dfu_dist_ctx.fsm == DFU_DIST_STARTED))
             {
-                if (!dfu_dist_ctx.node_loop)
+                if (dfu_dist_ctx.min_block_size < plt_exp2(pmsg->min_block_size_log))
                 {
                     dfu_dist_ctx.min_block_size = plt_exp2(pmsg->min_block_size_log);
-                    dfu_dist_ctx.max_block_size = plt_exp2(pmsg->max_block_size_log);
-                    dfu_dist_ctx.max_chunk_num = pmsg->max_chunk_num;
                 }
-                else
+                if (dfu_dist_ctx.max_block_size > plt_exp2(pmsg->max_block_size_log))
                 {
-                    if (dfu_dist_ctx.min_block_size < plt_exp2(pmsg->min_block_size_log))
-                    {
-                        dfu_dist_ctx.min_block_size = plt_exp2(pmsg->min_block_size_log);
-                    }
-                    if (dfu_dist_ctx.max_block_size > plt_exp2(pmsg->max_block_size_log))
-                    {
-                        dfu_dist_ctx.max_block_size = plt_exp2(pmsg->max_block_size_log);
-                    }
-                    if (dfu_dist_ctx.max_chunk_num > pmsg->max_chunk_num)
-                    {
-                        dfu_dist_ctx.max_chunk_num = pmsg->max_chunk_num;
-                    }
-                }
-
-                plt_timer_reset(dfu_dist_ctx.timer, 0);
-                dfu_dist_ctx.node_loop++;
-                if (dfu_dist_ctx.node_loop < dfu_dist_ctx.node_num)
-                {
-                    obj_info_get(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr);
+                    dfu_dist_ctx.max_block_size = plt_exp2(pmsg->max_block_size_log);
                 }
-                else
+                if (dfu_dist_ctx.max_chunk_num > pmsg->max_chunk_num)
                 {
-                    if (dfu_dist_ctx.min_block_size > dfu_dist_ctx.max_block_size)
-                    {
-                        // TODO:
-                    }
-                    else
-                    {
-                        dfu_dist_ctx.block_size = dfu_dist_ctx.max_block_size;
-                        dfu_dist_ctx.block_num = (dfu_dist_ctx.object_size + dfu_dist_ctx.block_size - 1) /
-                                                 dfu_dist_ctx.block_size;
-                    }
-                    dfu_dist_ctx.fsm = DFU_DIST_OBJ_INFO_GETTED;
-                    dfu_dist_ctx.node_loop = 0;
-                    fw_update_prepare(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.company_id,
-                                      dfu_dist_ctx.firmware_id,
-                                      dfu_dist_ctx.object_id, NULL, 0);
+                    dfu_dist_ctx.max_chunk_num = pmsg->max_chunk_num;
                 }
+                dfu_dist_node_done(pnode);
             }
         }
         break;
     case MESH_MSG_OBJ_TRANSFER_STAT:
         if (pmesh_msg->msg_len == sizeof(obj_transfer_stat_t))
         {
-            if (pmesh_msg->src == dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr)
+            if ((NULL != pnode) && (dfu_dist_ctx.fsm == DFU_DIST_FW_STARTED))
             {
-                plt_timer_reset(dfu_dist_ctx.timer, 0);
-                dfu_dist_ctx.node_loop++;
-                if (dfu_dist_ctx.node_loop < dfu_dist_ctx.node_num)
-                {
-                    obj_transfer_start(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.object_id,
-                                       dfu_dist_ctx.object_size, plt_log2(dfu_dist_ctx.block_size));
-                }
-                else
-                {
-                    dfu_dist_ctx.fsm = DFU_DIST_OBJ_STARTED;
-                    dfu_dist_ctx.node_loop = 0;
-                    dfu_dist_ctx.block_loop = 0;
-                    dfu_dist_block_start();
-                }
+                dfu_dist_node_done(pnode);
             }
         }
         break;
     case MESH_MSG_OBJ_BLOCK_TRANSFER_STAT:
         if (pmesh_msg->msg_len == sizeof(obj_block_transfer_stat_t))
         {
-            if (pmesh_msg->src == dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr)
+            if ((NULL != pnode) && (dfu_dist_ctx.fsm == DFU_DIST_OBJ_STARTED))
             {
-                plt_timer_reset(dfu_dist_ctx.timer, 0);
-                dfu_dist_ctx.node_loop++;
-                if (dfu_dist_ctx.node_loop < dfu_dist_ctx.node_num)
-                {
-                    dfu_dist_block_start();
-                }
-                else
-                {
-                    dfu_dist_ctx.fsm = DFU_DIST_OBJ_BLOCK_STARTED;
-                    dfu_dist_ctx.node_loop = 0;
-                    dfu_dist_ctx.chunk_loop = 0;
-                    dfu_dist_chunk_start();
-                }
+                dfu_dist_node_done(pnode);
             }
         }
         break;
     case MESH_MSG_OBJ_BLOCK_STAT:
-        if (pmesh_msg->src == dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr)
+        if (pmesh_msg->msg_len >= MEMBER_OFFSET(obj_block_stat_t, chunk_list))
         {
             obj_block_stat_t *pmsg = (obj_block_stat_t *)pbuffer;
-            if (pmsg->stat == OBJ_BLOCK_TRANSFER_STAT_NOT_ALL_CHUNCK_RECEIVED)
+            if ((NULL != pnode) && (dfu_dist_ctx.fsm == DFU_DIST_OBJ_CHUNK_TRANSFERED))
             {
-                if (dfu_dist_ctx.chunk_list_num || dfu_dist_ctx.chunk_list)
+                uint16_t chunk_list_num = (pmesh_msg->msg_len - MEMBER_OFFSET(obj_block_stat_t,
+                                                                              chunk_list)) >> 1;
+                if (pmsg->stat == OBJ_BLOCK_TRANSFER_STAT_ACCEPTED)
                 {
-                    dfu_dist_ctx.chunk_list_num = 0;
-                    plt_free(dfu_dist_ctx.chunk_list, RAM_TYPE_DATA_ON);
-                    dfu_dist_ctx.chunk_list = NULL;
+                    pnode->block_received = TRUE;
+                    dfu_dist_ctx.block_progress = TRUE;
                 }
-                uint16_t chunk_list_len = (pmesh_msg->msg_len - MEMBER_OFFSET(obj_block_stat_t, chunk_list));
-                if (chunk_list_len)
+                else if (chunk_list_num)
                 {
-                    dfu_dist_ctx.chunk_list = plt_malloc(chunk_list_len, RAM_TYPE_DATA_ON);
-                    memcpy(dfu_dist_ctx.chunk_list, pmsg->chunk_list, chunk_list_len);
-                    dfu_dist_ctx.chunk_list_num = chunk_list_len >> 1;
-                    dfu_dist_ctx.chunk_list_loop = 0;
-                    dfu_dist_ctx.chunk_loop = dfu_dist_ctx.chunk_list[0];
-                    dfu_dist_chunk_start();
-                }
-                else
-                {
-                    // wrong case
-                }
-            }
-            else
-            {
-                dfu_dist_ctx.node_loop++;
-                if (dfu_dist_ctx.node_loop < dfu_dist_ctx.node_num)
-                {
-                    obj_block_get(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.object_id,
-                                  dfu_dist_ctx.block_num);
-                }
-                else
-                {
-                    dfu_dist_ctx.node_loop = 0;
-                    dfu_dist_ctx.block_loop++;
-                    if (dfu_dist_ctx.block_loop < dfu_dist_ctx.block_num)
+                    if (chunk_list_num < pnode->missing_num)
                     {
-                        dfu_dist_ctx.fsm = DFU_DIST_OBJ_STARTED;
-                        dfu_dist_block_start();
+                        pnode->missing_num = chunk_list_num;
+                        dfu_dist_ctx.block_progress = TRUE;
                     }
-                    else
+                    /* merge the missing chunks of the node, a node missing all of them reports
+                     * invalid block num with the full list */
+                    dfu_dist_ctx.missing_total += chunk_list_num;
+                    for (uint16_t loop = 0; loop < chunk_list_num; loop++)
                     {
-                        dfu_dist_ctx.fsm = DFU_DIST_OBJ_TRANSFERED;
-                        fw_update_apply(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.company_id,
-                                        dfu_dist_ctx.firmware_id);
+                        uint16_t chunk_num = pmsg->chunk_list[loop];
+                        if (chunk_num < dfu_dist_ctx.chunk_num)
+                        {
+                            plt_bit_pool_set(dfu_dist_ctx.chunk_missing, chunk_num, TRUE);
+                        }
                     }
                 }
+                else
+                {
+                    printw("obj_transfer_client_receive: node 0x%04x block stat %d", pmesh_msg->src, pmsg->stat);
+                }
+                dfu_dist_node_done(pnode);
             }
         }
         break;
@@ -355,6 +686,7 @@ bool fw_update_client_receive(mesh_msg_p pmesh_msg)
 {
     bool ret = TRUE;
     uint8_t *pbuffer = pmesh_msg->pbuffer + pmesh_msg->msg_offset;
+    dfu_dist_node_info_t *pnode = dfu_dist_node_find(pmesh_msg->src);
     switch (pmesh_msg->access_opcode)
     {
     case MESH_MSG_FW_INFO_STAT:
@@ -363,53 +695,11 @@ bool fw_update_client_receive(mesh_msg_p pmesh_msg)
         if (pmesh_msg->msg_len == sizeof(fw_update_stat_t))
         {
             fw_update_stat_t *pmsg = (fw_update_stat_t *)pbuffer;
-            if (pmesh_msg->src == dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr)
+            if ((dfu_dist_ctx.fsm == DFU_DIST_OBJ_INFO_GETTED || dfu_dist_ctx.fsm == DFU_DIST_FW_PREPARED ||
+                 dfu_dist_ctx.fsm == DFU_DIST_OBJ_TRANSFERED) && (NULL != pnode))
             {
-                dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].phase = (fw_update_phase_t)pmsg->phase;
-                plt_timer_reset(dfu_dist_ctx.timer, 0);
-                dfu_dist_ctx.node_loop++;
-                if (dfu_dist_ctx.node_loop < dfu_dist_ctx.node_num)
-                {
-                    if (dfu_dist_ctx.fsm == DFU_DIST_OBJ_INFO_GETTED)
-                    {
-                        fw_update_prepare(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.company_id,
-                                          dfu_dist_ctx.firmware_id,
-                                          dfu_dist_ctx.object_id, NULL, 0);
-                    }
-                    else if (dfu_dist_ctx.fsm == DFU_DIST_FW_PREPARED)
-                    {
-                        fw_update_start(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.policy,
-                                        dfu_dist_ctx.company_id, dfu_dist_ctx.firmware_id);
-                    }
-                    else if (dfu_dist_ctx.fsm == DFU_DIST_OBJ_TRANSFERED)
-                    {
-                        fw_update_apply(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.company_id,
-                                        dfu_dist_ctx.firmware_id);
-                    }
-                }
-                else
-                {
-                    dfu_dist_ctx.node_loop = 0;
-                    if (dfu_dist_ctx.fsm == DFU_DIST_OBJ_INFO_GETTED)
-                    {
-                        dfu_dist_ctx.fsm = DFU_DIST_FW_PREPARED;
-                        fw_update_start(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.policy,
-                                        dfu_dist_ctx.company_id, dfu_dist_ctx.firmware_id);
-                    }
-                    else if (dfu_dist_ctx.fsm == DFU_DIST_FW_PREPARED)
-                    {
-                        dfu_dist_ctx.fsm = DFU_DIST_FW_STARTED;
-                        obj_transfer_start(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr, dfu_dist_ctx.object_id,
-                                           dfu_dist_ctx.object_size, plt_log2(dfu_dist_ctx.block_size));
-                    }
-                    else if (dfu_dist_ctx.fsm == DFU_DIST_OBJ_TRANSFERED)
-                    {
-                        /* Oh my god, finally it is all over! */
-                        dfu_dist_ctx.fsm = DFU_DIST_IDLE;
-                        plt_timer_stop(dfu_dist_ctx.timer, 0);
-                        // TODO: inform the upper layer
-                    }
-                }
+                pnode->phase = (fw_update_phase_t)pmsg->phase;
+                dfu_dist_node_done(pnode);
             }
         }
         break;
@@ -428,24 +718,21 @@ bool fw_update_client_receive(mesh_msg_p pmesh_msg)
 bool dfu_dist_start(uint16_t company_id, fw_update_fw_id_t firmware_id, uint8_t object_id[8],
                     uint16_t dst, uint16_t node_list[], uint16_t node_num)
 {
-    dfu_dist_ctx.dst = dst;
+    if (dfu_dist_ctx.fsm != DFU_DIST_IDLE)
+    {
+        printe("dfu_dist_start: fail, distribution in progress!");
+        return false;
+    }
+    if (0 == node_num)
+    {
+        return false;
+    }
     T_IMG_HEADER_FORMAT *p_header = (T_IMG_HEADER_FORMAT *)get_header_addr_by_img_id(AppPatch);
     if (0 == p_header->ctrl_header.payload_len)
     {
         printe("dfu_dist_start: fail, wrong downloaded image!");
         return false;
     }
-    dfu_dist_ctx.object_size = p_header->ctrl_header.payload_len + 1024;
-    dfu_dist_ctx.company_id = company_id;
-    FW_UPDATE_FW_ID(dfu_dist_ctx.firmware_id, firmware_id);
-    dfu_dist_ctx.node_num = MIN(DFU_DIST_NODE_NUM_MAX, node_num);
-    for (dfu_dist_ctx.node_loop = 0; dfu_dist_ctx.node_loop < dfu_dist_ctx.node_num;
-         dfu_dist_ctx.node_loop++)
-    {
-        dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr = node_list[dfu_dist_ctx.node_loop];
-    }
-    //plt_rand(dfu_dist_ctx.object_id, sizeof(dfu_dist_ctx.object_id));
-    memcpy(dfu_dist_ctx.object_id, object_id, sizeof(dfu_dist_ctx.object_id));
     if (!dfu_dist_ctx.timer)
     {
         dfu_dist_ctx.timer = plt_timer_create("dfu", DFU_DIST_RETRY_PERIOD, false, 0, dfu_dist_timeout_cb);
@@ -454,10 +741,29 @@ bool dfu_dist_start(uint16_t company_id, fw_update_fw_id_t firmware_id, uint8_t
             return false;
         }
     }
-    plt_timer_start(dfu_dist_ctx.timer, 0);
-    dfu_dist_ctx.fsm = DFU_DIST_STARTED;
-    dfu_dist_ctx.node_loop = 0;
-    obj_info_get(dfu_dist_ctx.node_info[dfu_dist_ctx.node_loop].addr);
+    dfu_dist_ctx.node_info = plt_malloc(node_num * sizeof(dfu_dist_node_info_t), RAM_TYPE_DATA_ON);
+    if (NULL == dfu_dist_ctx.node_info)
+    {
+        printe("dfu_dist_start: fail, malloc %d nodes!", node_num);
+        return false;
+    }
+    memset(dfu_dist_ctx.node_info, 0, node_num * sizeof(dfu_dist_node_info_t));
+    dfu_dist_ctx.node_num = node_num;
+    for (uint16_t loop = 0; loop < node_num; loop++)
+    {
+        dfu_dist_ctx.node_info[loop].addr = node_list[loop];
+    }
+    dfu_dist_ctx.dst = dst;
+    dfu_dist_ctx.object_size = p_header->ctrl_header.payload_len + 1024;
+    dfu_dist_ctx.company_id = company_id;
+    FW_UPDATE_FW_ID(dfu_dist_ctx.firmware_id, firmware_id);
+    //plt_rand(dfu_dist_ctx.object_id, sizeof(dfu_dist_ctx.object_id));
+    memcpy(dfu_dist_ctx.object_id, object_id, sizeof(dfu_dist_ctx.object_id));
+    /* narrowed down by the object info of every node */
+    dfu_dist_ctx.min_block_size = 0;
+    dfu_dist_ctx.max_block_size = 0xffffffff;
+    dfu_dist_ctx.max_chunk_num = 0xffff;
+    dfu_dist_phase_start(DFU_DIST_STARTED);
     return true;
 }
 
@@ -28,14 +28,43 @@ extern "C" {
  * @{
  */
 
+/**
+ * @defgroup Dfu_Distributor_Exported_Macros Dfu Distributor Exported Macros
+ * @brief
+ * @{
+ */
+#define DFU_DIST_TIMEOUT_MSG            112 //!< io message to retry the pending request
+/** @} */
+
 /**
  * @defgroup Dfu_Distributor_Exported_Functions Dfu Distributor Exported Functions
  * @brief
  * @{
  */
 void dfu_dist_models_init(void);
+
+/**
+ * @brief start to distribute the downloaded image to the nodes
+ * @param[in] company_id: company id of the firmware
+ * @param[in] firmware_id: firmware id
+ * @param[in] object_id: object id
+ * @param[in] dst: address the chunks are sent to, usually a group address all the nodes subscribe
+ * @param[in] node_list: unicast addresses of the nodes
+ * @param[in] node_num: number of the nodes
+ * @retval true: started
+ * @retval false: start fail
+ * @note every block is sent to dst once, then the missing chunks reported by the nodes are
+ *       merged and only their union is sent again
+ */
 bool dfu_dist_start(uint16_t company_id, fw_update_fw_id_t firmware_id, uint8_t object_id[8],
                     uint16_t dst, uint16_t node_list[], uint16_t node_num);
+
+/**
+ * @brief handle the request timeout
+ * @note call it when DFU_DIST_TIMEOUT_MSG is received, the request is retried
+ *       DFU_DIST_RETRY_TIMES before the node is dropped
+ */
+void dfu_dist_handle_timeout(void);
 /** @} */
 /** @} */
 
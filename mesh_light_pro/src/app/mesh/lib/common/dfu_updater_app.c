@@ -20,6 +20,7 @@
 #include "flash_adv_cfg.h"
 #include "user_flash.h"
 #include "ftl.h"
+#include "light_storage_app.h"
 
 #if DFU_UPDATER_SUPPORT_POWER_OFF_GO_ON
 typedef struct
@@ -123,6 +124,8 @@ int32_t fw_update_server_data_cb(const mesh_model_info_p pmodel_info, uint32_t t
             }
             else
             {
+                /* the deferred light state is lost by the reboot otherwise */
+                light_state_flush();
                 DBG_DIRECT("dfu success, reboot!");
                 unlock_flash_all();
                 mesh_reboot(MESH_OTA, 1000);
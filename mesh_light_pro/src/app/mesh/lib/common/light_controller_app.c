@@ -16,15 +16,15 @@
 #include "platform_os.h"
 
 #define MAX_ACTION_NUM              5
-/* timer interval, minimum value is 10ms */
-#define LIGHT_MONITOR_INTERVAL      50
+/* minimum one shot timer period, deadlines closer than it are handled at once */
+#define LIGHT_TIMER_MIN_INTERVAL    10
 static plt_timer_t light_ctl_timer = NULL;
 
 typedef struct
 {
     uint16_t current_lightness;
     uint16_t target_lightness;
-    uint8_t steps;
+    uint32_t steps;
     int32_t step_delta;
 } light_lightness_action_t;
 
@@ -33,10 +33,8 @@ typedef struct
     uint16_t lightness_begin;
     uint16_t lightness_end;
     bool in_begin_phase;
-    uint32_t begin_count;
-    uint32_t begin_cur_count;
-    uint32_t end_count;
-    uint32_t end_cur_count;
+    uint32_t begin_time;
+    uint32_t end_time;
     uint32_t times;
 } light_blink_action_t;
 
@@ -46,21 +44,28 @@ typedef struct
     uint16_t lightness_end;
     uint16_t current_lightness;
     bool in_forward_phase;
-    uint8_t current_forward_steps;
-    uint8_t forward_steps;
+    uint32_t current_forward_steps;
+    uint32_t forward_steps;
     int32_t forward_step_delta;
-    uint8_t current_reverse_steps;
-    uint8_t reverse_steps;
+    uint32_t current_reverse_steps;
+    uint32_t reverse_steps;
     int32_t reverse_step_delta;
     uint32_t times;
     bool half_breath_end;
 } light_breath_action_t;
 
+typedef struct
+{
+    uint32_t steps;
+    light_step_cb step;
+} light_steps_action_t;
+
 typedef enum
 {
     LIGHT_ACTION_LIGHTNESS_LINEAR,
     LIGHT_ACTION_BLINK,
     LIGHT_ACTION_BREATH,
+    LIGHT_ACTION_STEPS,
     LIGHT_ACTION_UNKNOWN,
 } light_action_type_t;
 
@@ -69,6 +74,7 @@ typedef union
     light_lightness_action_t lightness;
     light_blink_action_t blink;
     light_breath_action_t breath;
+    light_steps_action_t steps;
 } light_action_value_t;
 
 typedef struct
@@ -78,6 +84,7 @@ typedef struct
     light_t *light;
     light_change_done_cb change_done;
     light_action_type_t type;
+    uint32_t next_time; //!< deadline of the next change, in system time ms
     light_action_value_t value;
 } light_action_t;
 
@@ -109,6 +116,7 @@ static light_action_t *request_action(light_t *light)
 
 static void release_action(light_action_t *action)
 {
+    action->need_change = FALSE;
     action->busy = FALSE;
     if (NULL != action->change_done)
     {
@@ -116,189 +124,227 @@ static void release_action(light_action_t *action)
     }
 }
 
-static bool is_all_light_idle(void)
+static bool is_action_due(const light_action_t *action, uint32_t now)
+{
+    return ((int32_t)(action->next_time - now) < LIGHT_TIMER_MIN_INTERVAL);
+}
+
+/**
+ * @brief arm the one shot timer to the earliest deadline of all running actions
+ */
+static void light_controller_schedule(void)
 {
+    if (NULL == light_ctl_timer)
+    {
+        return;
+    }
+
+    uint32_t now = plt_time_read_ms();
+    int32_t wait_time = 0;
+    bool running = FALSE;
     for (uint8_t channel = 0; channel < MAX_ACTION_NUM; ++channel)
     {
         if (light_actions[channel].busy && light_actions[channel].need_change)
+        {
+            int32_t remain = (int32_t)(light_actions[channel].next_time - now);
+            if (!running || (remain < wait_time))
+            {
+                wait_time = remain;
+            }
+            running = TRUE;
+        }
+    }
+
+    if (!running)
+    {
+        if (plt_timer_is_active(light_ctl_timer))
+        {
+            plt_timer_stop(light_ctl_timer, 0);
+        }
+        return;
+    }
+
+    if (wait_time < LIGHT_TIMER_MIN_INTERVAL)
+    {
+        wait_time = LIGHT_TIMER_MIN_INTERVAL;
+    }
+    plt_timer_change_period(light_ctl_timer, wait_time, 0);
+}
+
+/**
+ * @brief run one linear step
+ * @return TRUE: action continues, FALSE: action finished
+ */
+static bool light_action_linear_step(light_action_t *action)
+{
+    light_lightness_action_t *plinear = &action->value.lightness;
+    if (plinear->steps > 1)
+    {
+        plinear->current_lightness += plinear->step_delta;
+        plinear->steps --;
+        light_lighten(action->light, plinear->current_lightness);
+        action->next_time += LIGHT_MONITOR_INTERVAL;
+        return TRUE;
+    }
+
+    light_lighten(action->light, plinear->target_lightness);
+    if (plinear->target_lightness > 0)
+    {
+        action->light->lightness_last = plinear->target_lightness;
+    }
+    return FALSE;
+}
+
+/**
+ * @brief switch blink phase, the light only changes on phase boundaries
+ * @return TRUE: action continues, FALSE: action finished
+ */
+static bool light_action_blink_step(light_action_t *action)
+{
+    light_blink_action_t *pblink = &action->value.blink;
+    if (pblink->in_begin_phase)
+    {
+        if (0 == pblink->times)
         {
             return FALSE;
         }
+
+        if (pblink->begin_time > 0)
+        {
+            light_lighten(action->light, pblink->lightness_begin);
+        }
+        pblink->in_begin_phase = FALSE;
+        action->next_time += pblink->begin_time;
+    }
+    else
+    {
+        if (pblink->end_time > 0)
+        {
+            light_lighten(action->light, pblink->lightness_end);
+        }
+        pblink->in_begin_phase = TRUE;
+        action->next_time += pblink->end_time;
+        if (TIME_INFINITE != pblink->times)
+        {
+            pblink->times --;
+        }
     }
+
     return TRUE;
 }
 
-static void light_controller_timer_start(void)
+/**
+ * @brief run one breath step
+ * @return TRUE: action continues, FALSE: action finished
+ */
+static bool light_action_breath_step(light_action_t *action)
 {
-    if (NULL != light_ctl_timer)
+    light_breath_action_t *pbreath = &action->value.breath;
+    if (0 == pbreath->times)
+    {
+        return FALSE;
+    }
+
+    if (pbreath->in_forward_phase)
     {
-        if (!plt_timer_is_active(light_ctl_timer))
+        if (pbreath->current_forward_steps >= pbreath->forward_steps)
         {
-            plt_timer_start(light_ctl_timer, 0);
+            light_lighten(action->light, pbreath->lightness_end);
+            pbreath->current_lightness = pbreath->lightness_end;
+            pbreath->current_reverse_steps = 0;
+            pbreath->in_forward_phase = FALSE;
+            if ((1 == pbreath->times) && pbreath->half_breath_end)
+            {
+                pbreath->times = 0;
+                return FALSE;
+            }
+        }
+        else
+        {
+            light_lighten(action->light, pbreath->current_lightness);
+            pbreath->current_lightness += pbreath->forward_step_delta;
+            pbreath->current_forward_steps ++;
         }
     }
+    else
+    {
+        if (pbreath->current_reverse_steps >= pbreath->reverse_steps)
+        {
+            light_lighten(action->light, pbreath->lightness_begin);
+            pbreath->current_lightness = pbreath->lightness_begin;
+            pbreath->current_forward_steps = 0;
+            pbreath->in_forward_phase = TRUE;
+
+            if (TIME_INFINITE != pbreath->times)
+            {
+                pbreath->times --;
+            }
+        }
+        else
+        {
+            light_lighten(action->light, pbreath->current_lightness);
+            pbreath->current_lightness += pbreath->reverse_step_delta;
+            pbreath->current_reverse_steps ++;
+        }
+    }
+
+    action->next_time += LIGHT_MONITOR_INTERVAL;
+    return TRUE;
+}
+
+/**
+ * @brief run one step of the caller
+ * @return TRUE: action continues, FALSE: action finished
+ */
+static bool light_action_steps_step(light_action_t *action)
+{
+    light_steps_action_t *psteps = &action->value.steps;
+    psteps->steps --;
+    psteps->step(action->light, psteps->steps);
+    action->next_time += LIGHT_MONITOR_INTERVAL;
+    return (psteps->steps > 0);
 }
 
 static void light_ctl_timeout_handle(void *pargs)
 {
     UNUSED(pargs);
 
+    uint32_t now = plt_time_read_ms();
     for (uint8_t channel = 0; channel < MAX_ACTION_NUM; ++channel)
     {
-        if (light_actions[channel].busy && light_actions[channel].need_change)
+        light_action_t *paction = &light_actions[channel];
+        while (paction->busy && paction->need_change && is_action_due(paction, now))
         {
-            switch (light_actions[channel].type)
+            bool running;
+            switch (paction->type)
             {
             case LIGHT_ACTION_LIGHTNESS_LINEAR:
-                if (light_actions[channel].value.lightness.steps > 1)
-                {
-                    light_lighten(light_actions[channel].light,
-                                  light_actions[channel].value.lightness.current_lightness);
-                    light_actions[channel].value.lightness.current_lightness +=
-                        light_actions[channel].value.lightness.step_delta;
-                    light_actions[channel].value.lightness.steps --;
-                }
-                else
-                {
-                    light_lighten(light_actions[channel].light,
-                                  light_actions[channel].value.lightness.target_lightness);
-                    if (light_actions[channel].value.lightness.target_lightness > 0)
-                    {
-                        light_actions[channel].light->lightness_last =
-                            light_actions[channel].value.lightness.target_lightness;
-                    }
-
-                    light_actions[channel].need_change = FALSE;
-                    release_action(&light_actions[channel]);
-                }
+                running = light_action_linear_step(paction);
                 break;
             case LIGHT_ACTION_BLINK:
-                if (light_actions[channel].value.blink.times > 0)
-                {
-                    if (light_actions[channel].value.blink.in_begin_phase)
-                    {
-                        if (light_actions[channel].value.blink.begin_cur_count >=
-                            light_actions[channel].value.blink.begin_count)
-                        {
-                            light_actions[channel].value.blink.in_begin_phase = FALSE;
-                            light_actions[channel].value.blink.begin_cur_count = 0;
-                        }
-                        else
-                        {
-                            if (0 == light_actions[channel].value.blink.begin_cur_count)
-                            {
-                                light_lighten(light_actions[channel].light,
-                                              light_actions[channel].value.blink.lightness_begin);
-                            }
-                            light_actions[channel].value.blink.begin_cur_count ++;
-                        }
-                    }
-                    else
-                    {
-                        if (light_actions[channel].value.blink.end_cur_count >=
-                            light_actions[channel].value.blink.end_count)
-                        {
-                            light_actions[channel].value.blink.in_begin_phase = TRUE;
-                            light_actions[channel].value.blink.end_cur_count = 0;
-
-                            if (TIME_INFINITE != light_actions[channel].value.blink.times)
-                            {
-                                light_actions[channel].value.blink.times --;
-                            }
-                        }
-                        else
-                        {
-                            if (0 == light_actions[channel].value.blink.end_cur_count)
-                            {
-                                light_lighten(light_actions[channel].light, light_actions[channel].value.blink.lightness_end);
-                            }
-                            light_actions[channel].value.blink.end_cur_count ++;
-                        }
-                    }
-                }
-                else
-                {
-                    light_actions[channel].need_change = FALSE;
-                    release_action(&light_actions[channel]);
-                }
+                running = light_action_blink_step(paction);
                 break;
             case LIGHT_ACTION_BREATH:
-                if (light_actions[channel].value.breath.times > 0)
-                {
-                    if (light_actions[channel].value.breath.in_forward_phase)
-                    {
-                        if (light_actions[channel].value.breath.current_forward_steps >=
-                            light_actions[channel].value.breath.forward_steps)
-                        {
-                            light_lighten(light_actions[channel].light,
-                                          light_actions[channel].value.breath.lightness_end);
-                            light_actions[channel].value.breath.current_lightness =
-                                light_actions[channel].value.breath.lightness_end;
-                            light_actions[channel].value.breath.current_reverse_steps = 0;
-                            light_actions[channel].value.breath.in_forward_phase = FALSE;
-                            if (1 == light_actions[channel].value.breath.times)
-                            {
-                                if (light_actions[channel].value.breath.half_breath_end)
-                                {
-                                    light_actions[channel].value.breath.times = 0;
-                                    light_actions[channel].need_change = FALSE;
-                                    release_action(&light_actions[channel]);
-                                }
-                            }
-                        }
-                        else
-                        {
-                            light_lighten(light_actions[channel].light,
-                                          light_actions[channel].value.breath.current_lightness);
-                            light_actions[channel].value.breath.current_lightness +=
-                                light_actions[channel].value.breath.forward_step_delta;
-                            light_actions[channel].value.breath.current_forward_steps ++;
-                        }
-                    }
-                    else
-                    {
-                        if (light_actions[channel].value.breath.current_reverse_steps >=
-                            light_actions[channel].value.breath.reverse_steps)
-                        {
-                            light_lighten(light_actions[channel].light,
-                                          light_actions[channel].value.breath.lightness_begin);
-                            light_actions[channel].value.breath.current_lightness =
-                                light_actions[channel].value.breath.lightness_begin;
-                            light_actions[channel].value.breath.current_forward_steps = 0;
-                            light_actions[channel].value.breath.in_forward_phase = TRUE;
-
-                            if (TIME_INFINITE != light_actions[channel].value.breath.times)
-                            {
-                                light_actions[channel].value.breath.times --;
-                            }
-                        }
-                        else
-                        {
-                            light_lighten(light_actions[channel].light,
-                                          light_actions[channel].value.breath.current_lightness);
-                            light_actions[channel].value.breath.current_lightness +=
-                                light_actions[channel].value.breath.reverse_step_delta;
-                            light_actions[channel].value.breath.current_reverse_steps ++;
-                        }
-                    }
-                }
-                else
-                {
-                    light_actions[channel].need_change = FALSE;
-                    release_action(&light_actions[channel]);
-                }
+                running = light_action_breath_step(paction);
+                break;
+            case LIGHT_ACTION_STEPS:
+                running = light_action_steps_step(paction);
                 break;
             default:
+                running = FALSE;
+                break;
+            }
+
+            if (!running)
+            {
+                /* change done callback may start a new action on this channel */
+                release_action(paction);
                 break;
             }
         }
     }
 
-    /* Check light controler status */
-    if (is_all_light_idle())
-    {
-        plt_timer_stop(light_ctl_timer, 0);
-    }
+    light_controller_schedule();
 }
 
 void light_stop(light_t *light)
@@ -307,6 +353,7 @@ void light_stop(light_t *light)
     {
         if (light_actions[i].light == light)
         {
+            light_ramp_stop(light);
             light_actions[i].type = LIGHT_ACTION_UNKNOWN;
             light_actions[i].need_change = FALSE;
             light_actions[i].busy = FALSE;
@@ -317,6 +364,8 @@ void light_stop(light_t *light)
             break;
         }
     }
+
+    light_controller_schedule();
 }
 
 void light_set_lightness_linear(light_t *light, uint16_t lightness, uint32_t time,
@@ -331,20 +380,52 @@ void light_set_lightness_linear(light_t *light, uint16_t lightness, uint32_t tim
         paction->change_done = pcb;
         paction->value.lightness.current_lightness = light->lightness;
         paction->value.lightness.target_lightness = lightness;
-        paction->value.lightness.steps = time / LIGHT_MONITOR_INTERVAL;
-        if (0 == paction->value.lightness.steps)
+        if (light_ramp_start(light, lightness, time))
         {
+            /* hardware paces the fade, only wake up to finish it */
             paction->value.lightness.steps = 1;
+            paction->value.lightness.step_delta = 0;
+            paction->next_time = plt_time_read_ms() + time;
+        }
+        else
+        {
+            paction->value.lightness.steps = time / LIGHT_MONITOR_INTERVAL;
+            if (0 == paction->value.lightness.steps)
+            {
+                paction->value.lightness.steps = 1;
+            }
+            paction->value.lightness.step_delta = (int32_t)(
+                                                      paction->value.lightness.target_lightness -
+                                                      paction->value.lightness.current_lightness) / (int32_t)paction->value.lightness.steps;
+            paction->next_time = plt_time_read_ms() + LIGHT_MONITOR_INTERVAL;
         }
-        paction->value.lightness.step_delta = (int32_t)(
-                                                  paction->value.lightness.target_lightness -
-                                                  paction->value.lightness.current_lightness) / paction->value.lightness.steps;
         paction->need_change = TRUE;
 
-        light_controller_timer_start();
+        light_controller_schedule();
     }
 }
 
+bool light_set_steps(light_t *light, uint32_t steps, light_step_cb step_cb,
+                     light_change_done_cb pcb)
+{
+    light_action_t *paction = request_action(light);
+    if (NULL == paction)
+    {
+        return FALSE;
+    }
+
+    paction->light = light;
+    paction->type = LIGHT_ACTION_STEPS;
+    paction->change_done = pcb;
+    paction->value.steps.steps = (0 == steps) ? 1 : steps;
+    paction->value.steps.step = step_cb;
+    paction->next_time = plt_time_read_ms() + LIGHT_MONITOR_INTERVAL;
+    paction->need_change = TRUE;
+
+    light_controller_schedule();
+    return TRUE;
+}
+
 void light_blink(light_t *light, uint16_t lightness_begin, uint16_t lightness_end,
                  uint32_t interval, uint8_t begin_duty, uint32_t times, light_change_done_cb pcb)
 {
@@ -353,24 +434,27 @@ void light_blink(light_t *light, uint16_t lightness_begin, uint16_t lightness_en
         begin_duty = 100;
     }
 
+    if (interval < LIGHT_TIMER_MIN_INTERVAL)
+    {
+        interval = LIGHT_TIMER_MIN_INTERVAL;
+    }
+
     light_action_t *paction = request_action(light);
     if (NULL != paction)
     {
-        uint32_t total_count = interval / LIGHT_MONITOR_INTERVAL + 1;
         paction->light = light;
         paction->type = LIGHT_ACTION_BLINK;
         paction->change_done = pcb;
         paction->value.blink.lightness_begin = lightness_begin;
         paction->value.blink.lightness_end = lightness_end;
         paction->value.blink.in_begin_phase = TRUE;
-        paction->value.blink.begin_count = total_count * begin_duty / 100;
-        paction->value.blink.begin_cur_count = 0;
-        paction->value.blink.end_count = total_count - paction->value.blink.begin_count;
-        paction->value.blink.end_cur_count = 0;
+        paction->value.blink.begin_time = interval * begin_duty / 100;
+        paction->value.blink.end_time = interval - paction->value.blink.begin_time;
         paction->value.blink.times = times;
+        paction->next_time = plt_time_read_ms();
         paction->need_change = TRUE;
 
-        light_controller_timer_start();
+        light_controller_schedule();
     }
 }
 
@@ -400,18 +484,21 @@ void light_breath(light_t *light, uint16_t lightness_begin, uint16_t lightness_e
         paction->value.breath.in_forward_phase = TRUE;
         paction->value.breath.current_forward_steps = 0;
         paction->value.breath.forward_steps = total_steps * forward_duty / 100;
-        paction->value.breath.forward_step_delta = (int32_t)(lightness_end - lightness_begin) /
-                                                   paction->value.breath.forward_steps;
+        paction->value.breath.forward_step_delta = (0 == paction->value.breath.forward_steps) ? 0 :
+                                                   (int32_t)(lightness_end - lightness_begin) /
+                                                   (int32_t)paction->value.breath.forward_steps;
         paction->value.breath.current_reverse_steps = 0;
         paction->value.breath.reverse_steps = total_steps -
                                               paction->value.breath.forward_steps;
-        paction->value.breath.reverse_step_delta = (int32_t)(lightness_begin - lightness_end) /
-                                                   paction->value.breath.reverse_steps;
+        paction->value.breath.reverse_step_delta = (0 == paction->value.breath.reverse_steps) ? 0 :
+                                                   (int32_t)(lightness_begin - lightness_end) /
+                                                   (int32_t)paction->value.breath.reverse_steps;
         paction->value.breath.times = times;
         paction->value.breath.half_breath_end = half_breath_end;
+        paction->next_time = plt_time_read_ms() + LIGHT_MONITOR_INTERVAL;
         paction->need_change = TRUE;
 
-        light_controller_timer_start();
+        light_controller_schedule();
     }
 }
 
@@ -452,7 +539,8 @@ bool light_controller_init(void)
     }
     else
     {
-        light_ctl_timer = plt_timer_create("lightctl", LIGHT_MONITOR_INTERVAL, TRUE, 0,
+        /* one shot timer, armed to the earliest action deadline on demand */
+        light_ctl_timer = plt_timer_create("lightctl", LIGHT_MONITOR_INTERVAL, FALSE, 0,
                                            light_ctl_timeout_handle);
         if (NULL == light_ctl_timer)
         {
@@ -460,7 +548,7 @@ bool light_controller_init(void)
             return FALSE;
         }
 
-        plt_timer_start(light_ctl_timer, 0);
+        light_controller_schedule();
     }
 
     return TRUE;
@@ -478,6 +566,7 @@ void light_controller_deinit(void)
     {
         if (light_actions[i].busy)
         {
+            light_ramp_stop(light_actions[i].light);
             light_actions[i].busy = FALSE;
             light_actions[i].type = LIGHT_ACTION_UNKNOWN;
             light_actions[i].need_change = FALSE;
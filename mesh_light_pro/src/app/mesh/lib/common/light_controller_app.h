@@ -29,6 +29,8 @@ BEGIN_DECLS
  * @{
  */
 #define TIME_INFINITE    0xFFFFFFFF
+/* step interval of the gradual actions, minimum value is 10ms */
+#define LIGHT_MONITOR_INTERVAL      50
 /** @} */
 
 /**
@@ -37,6 +39,8 @@ BEGIN_DECLS
  * @{
  */
 typedef void (*light_change_done_cb)(light_t *light);
+/** step of a stepped action, remaining_steps is 0 at the last step */
+typedef void (*light_step_cb)(light_t *light, uint32_t remaining_steps);
 /** @} */
 
 /**
@@ -67,6 +71,20 @@ void light_controller_deinit(void);
 void light_set_lightness_linear(light_t *light, uint16_t lightness, uint32_t time,
                                 light_change_done_cb cb);
 
+/**
+ * @brief run a change stepped by the caller
+ * @param[in] light: light channel the action is bound to
+ * @param[in] steps: number of steps, one every LIGHT_MONITOR_INTERVAL
+ * @param[in] step_cb: step callback function, it changes the lights
+ * @param[in] cb: light change done callback function
+ * @retval TRUE: action started
+ * @retval FALSE: no free action
+ * @note an action started later on the same light replaces it, step_cb shall not start or stop
+ *       the actions of the light
+ */
+bool light_set_steps(light_t *light, uint32_t steps, light_step_cb step_cb,
+                     light_change_done_cb cb);
+
 /**
  * @brief blink light
  * @param[in] light: light channel
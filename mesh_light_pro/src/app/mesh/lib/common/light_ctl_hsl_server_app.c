@@ -19,7 +19,13 @@
 #include "light_hsl.h"
 #include "light_cwrgb_app.h"
 #include "light_storage_app.h"
+#include "scene.h"
 
+static uint16_t current_scene;
+
+/* ctl when the transitions of the ctl and ctl temperature servers start */
+static light_ctl_t ctl_trans_start;
+static light_ctl_t temperature_trans_start;
 
 /* ctl & hsl light models */
 static mesh_model_info_t generic_on_off_server;
@@ -32,6 +38,8 @@ static mesh_model_info_t light_hsl_server;
 static mesh_model_info_t light_hsl_setup_server;
 static mesh_model_info_t light_hsl_hue_server;
 static mesh_model_info_t light_hsl_saturation_server;
+static mesh_model_info_t light_scene_server;
+static mesh_model_info_t light_scene_setup_server;
 
 
 static int32_t generic_on_off_server_data(const mesh_model_info_p pmodel_info, uint32_t type,
@@ -198,13 +206,11 @@ static int32_t light_ctl_server_data(const mesh_model_info_p pmodel_info, uint32
     case LIGHT_CTL_SERVER_SET:
         {
             light_ctl_server_set_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_ctl_t target = {pdata->lightness, pdata->temperature, pdata->delta_uv};
+            if (light_ctl_transition_step(&ctl_trans_start, target, LIGHT_CTL_FIELD_TEMPERATURE,
+                                          pdata->total_time.num_steps, pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_ctl_t ctl = light_get_ctl();
-                //ctl.lightness = pdata->lightness;
-                ctl.temperature = pdata->temperature;
-                ctl.delta_uv = pdata->delta_uv;
-                light_set_ctl(ctl);
                 light_state_store();
             }
         }
@@ -212,12 +218,11 @@ static int32_t light_ctl_server_data(const mesh_model_info_p pmodel_info, uint32
     case LIGHT_CTL_SERVER_SET_TEMPERATURE:
         {
             light_ctl_server_set_temperature_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_ctl_t target = {0, pdata->temperature, pdata->delta_uv};
+            if (light_ctl_transition_step(&temperature_trans_start, target, LIGHT_CTL_FIELD_TEMPERATURE,
+                                          pdata->total_time.num_steps, pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_ctl_t ctl = light_get_ctl();
-                ctl.temperature = pdata->temperature;
-                ctl.delta_uv = pdata->delta_uv;
-                light_set_ctl(ctl);
                 light_state_store();
             }
         }
@@ -280,13 +285,14 @@ static int32_t light_hsl_server_data(const mesh_model_info_p pmodel_info, uint32
     case LIGHT_HSL_SERVER_SET:
         {
             light_hsl_server_set_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_hsl_t hsl;
+            hsl.lightness = pdata->lightness;
+            hsl.hue = pdata->hue;
+            hsl.saturation = pdata->saturation;
+            if (light_hsl_transition_step(hsl, pdata->total_time.num_steps,
+                                          pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_hsl_t hsl;
-                hsl.lightness = pdata->lightness;
-                hsl.hue = pdata->hue;
-                hsl.saturation = pdata->saturation;
-                light_set_hsl(hsl);
                 light_state_store();
             }
         }
@@ -294,11 +300,12 @@ static int32_t light_hsl_server_data(const mesh_model_info_p pmodel_info, uint32
     case LIGHT_HSL_SERVER_SET_HUE:
         {
             light_hsl_server_set_hue_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_hsl_t hsl = light_get_hsl();
+            hsl.hue = pdata->hue;
+            if (light_hsl_transition_step(hsl, pdata->total_time.num_steps,
+                                          pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_hsl_t hsl = light_get_hsl();
-                hsl.hue = pdata->hue;
-                light_set_hsl(hsl);
                 light_state_store();
             }
         }
@@ -306,11 +313,12 @@ static int32_t light_hsl_server_data(const mesh_model_info_p pmodel_info, uint32
     case LIGHT_HSL_SERVER_SET_SATURATION:
         {
             light_hsl_server_set_saturation_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_hsl_t hsl = light_get_hsl();
+            hsl.saturation = pdata->saturation;
+            if (light_hsl_transition_step(hsl, pdata->total_time.num_steps,
+                                          pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_hsl_t hsl = light_get_hsl();
-                hsl.saturation = pdata->saturation;
-                light_set_hsl(hsl);
                 light_state_store();
             }
         }
@@ -330,6 +338,61 @@ static int32_t light_hsl_server_data(const mesh_model_info_p pmodel_info, uint32
     return 0;
 }
 
+static int32_t scene_server_data(const mesh_model_info_p pmodel_info, uint32_t type,
+                                 void *pargs)
+{
+    switch (type)
+    {
+    case SCENE_SERVER_GET:
+        {
+            scene_server_get_t *pdata = pargs;
+            pdata->current_scene = current_scene;
+        }
+        break;
+    case SCENE_SERVER_STORE:
+        {
+            scene_server_store_t *pdata = pargs;
+            if ((SCENE_STATUS_SUCCESS == pdata->status) && (NULL != pdata->pmemory))
+            {
+                light_ctl_hsl_scene_t *pstate = pdata->pmemory;
+                pstate->ctl = light_get_ctl();
+                pstate->hsl = light_get_hsl();
+                light_scene_store(pdata->pmemory);
+            }
+        }
+        break;
+    case SCENE_SERVER_RECALL:
+        {
+            scene_server_recall_t *pdata = pargs;
+            if (pdata->remaining_time.num_steps == pdata->total_time.num_steps)
+            {
+                if (NULL != pdata->pmemory)
+                {
+                    const light_ctl_hsl_scene_t *pstate = pdata->pmemory;
+                    light_set_ctl(pstate->ctl);
+                    light_set_hsl(pstate->hsl);
+                    light_state_store();
+
+                    light_ctl_publish(&light_ctl_server, pstate->ctl.lightness, pstate->ctl.temperature);
+                    light_hsl_publish(&light_hsl_server, pstate->hsl.lightness, pstate->hsl.hue,
+                                      pstate->hsl.saturation);
+                }
+                current_scene = pdata->scene_number;
+            }
+        }
+        break;
+    case SCENE_SERVER_DELETE:
+        {
+            light_scene_delete();
+        }
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
 void light_ctl_hsl_server_models_init(uint8_t element_index)
 {
     /* binding models */
@@ -342,6 +405,8 @@ void light_ctl_hsl_server_models_init(uint8_t element_index)
     light_hsl_setup_server.pmodel_bound = &light_hsl_server;
     light_hsl_hue_server.pmodel_bound = &light_hsl_setup_server;
     light_hsl_saturation_server.pmodel_bound = &light_hsl_hue_server;
+    light_scene_server.pmodel_bound = &light_hsl_saturation_server;
+    light_scene_setup_server.pmodel_bound = &light_scene_server;
 
     /* register light ctl & hsl models */
     generic_on_off_server.model_data_cb = generic_on_off_server_data;
@@ -367,4 +432,14 @@ void light_ctl_hsl_server_models_init(uint8_t element_index)
     light_hsl_hue_server_reg(element_index, &light_hsl_hue_server);
     light_hsl_saturation_server.model_data_cb = light_hsl_server_data;
     light_hsl_saturation_server_reg(element_index, &light_hsl_saturation_server);
+
+    light_scene_server.model_data_cb = scene_server_data;
+    scene_server_reg(element_index, &light_scene_server);
+    light_scene_setup_server.model_data_cb = scene_server_data;
+    scene_setup_server_reg(element_index, &light_scene_setup_server);
+    scene_storage_memory_t *scene_storage_memory = light_scene_restore(NULL, 0);
+    scene_server_set_storage_memory(&light_scene_server, scene_storage_memory,
+                                    LIGHT_FLASH_SCENE_NUM);
+    scene_setup_server_set_storage_memory(&light_scene_setup_server, scene_storage_memory,
+                                          LIGHT_FLASH_SCENE_NUM);
 }
@@ -15,6 +15,7 @@
 #define _LIGHT_CTL_HSL_SERVER_APP_H
 
 #include "platform_types.h"
+#include "light_cwrgb_app.h"
 
 BEGIN_DECLS
 
@@ -23,6 +24,19 @@ BEGIN_DECLS
  * @{
  */
 
+/**
+ * @defgroup Light_Ctl_Hsl_Server_Exported_Types Light CTL HSL Server Exported Types
+ * @brief
+ * @{
+ */
+/** scene state kept in light_flash_scene_t */
+typedef struct
+{
+    light_ctl_t ctl;
+    light_hsl_t hsl;
+} light_ctl_hsl_scene_t;
+/** @} */
+
 /**
  * @defgroup Light_Ctl_Hsl_Server_Exported_Functions Light CTL HSL Server Exported Functions
  * @brief
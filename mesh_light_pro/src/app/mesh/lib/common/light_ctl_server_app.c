@@ -19,23 +19,26 @@
 #include "light_cwrgb_app.h"
 #include "light_storage_app.h"
 #include "scene.h"
+#include "time_server_app.h"
+#include "scheduler_server_app.h"
 
 
-static light_ctl_t scene_read = {65535, 65535, 0};
-static light_ctl_t scene_cinema = {65535, 0, 0};
-static light_ctl_t scene_warm = {0, 65535, 0};
-static light_ctl_t scene_night = {0, 6553, 0};
-
-static scene_storage_memory_t scene_storage_memory[] =
+/* default scenes, the state is light_ctl_t */
+static const light_flash_scene_t scene_defaults[] =
 {
-    {3, &scene_read},
-    {4, &scene_cinema},
-    {5, &scene_warm},
-    {6, &scene_night}
+    {3, {65535, 4000, 0}}, /* read */
+    {4, {65535, 6500, 0}}, /* cinema */
+    {5, {65535, 2700, 0}}, /* warm */
+    {6, {6553, 2700, 0}} /* night */
 };
 
 static uint16_t current_scene;
 
+/* ctl when the transitions of the lightness, ctl and ctl temperature servers start */
+static light_ctl_t lightness_trans_start;
+static light_ctl_t ctl_trans_start;
+static light_ctl_t temperature_trans_start;
+
 /* ctl light models */
 static mesh_model_info_t generic_on_off_server;
 static mesh_model_info_t light_lightness_server;
@@ -132,25 +135,18 @@ static int32_t light_lightness_server_data(const mesh_model_info_p pmodel_info,
         }
         break;
     case LIGHT_LIGHTNESS_SERVER_SET:
+    case LIGHT_LIGHTNESS_SERVER_SET_LINEAR:
         {
             light_lightness_server_set_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_ctl_t target = {pdata->lightness, 0, 0};
+            if (LIGHT_LIGHTNESS_SERVER_SET_LINEAR == type)
             {
-                light_ctl_t ctl = light_get_ctl();
-                ctl.lightness = pdata->lightness;
-                light_set_ctl(ctl);
-                light_state_store();
+                target.lightness = light_lightness_linear_to_actual(pdata->lightness);
             }
-        }
-        break;
-    case LIGHT_LIGHTNESS_SERVER_SET_LINEAR:
-        {
-            light_lightness_server_set_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            if (light_ctl_transition_step(&lightness_trans_start, target, LIGHT_CTL_FIELD_LIGHTNESS,
+                                          pdata->total_time.num_steps, pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_ctl_t ctl = light_get_ctl();
-                ctl.lightness = light_lightness_linear_to_actual(pdata->lightness);
-                light_set_ctl(ctl);
                 light_state_store();
             }
         }
@@ -210,13 +206,12 @@ static int32_t light_ctl_server_data(const mesh_model_info_p pmodel_info, uint32
     case LIGHT_CTL_SERVER_SET:
         {
             light_ctl_server_set_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_ctl_t target = {pdata->lightness, pdata->temperature, pdata->delta_uv};
+            if (light_ctl_transition_step(&ctl_trans_start, target,
+                                          LIGHT_CTL_FIELD_LIGHTNESS | LIGHT_CTL_FIELD_TEMPERATURE,
+                                          pdata->total_time.num_steps, pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_ctl_t ctl = light_get_ctl();
-                ctl.lightness = pdata->lightness;
-                ctl.temperature = pdata->temperature;
-                ctl.delta_uv = pdata->delta_uv;
-                light_set_ctl(ctl);
                 light_state_store();
             }
         }
@@ -224,12 +219,11 @@ static int32_t light_ctl_server_data(const mesh_model_info_p pmodel_info, uint32
     case LIGHT_CTL_SERVER_SET_TEMPERATURE:
         {
             light_ctl_server_set_temperature_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_ctl_t target = {0, pdata->temperature, pdata->delta_uv};
+            if (light_ctl_transition_step(&temperature_trans_start, target, LIGHT_CTL_FIELD_TEMPERATURE,
+                                          pdata->total_time.num_steps, pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_ctl_t ctl = light_get_ctl();
-                ctl.temperature = pdata->temperature;
-                ctl.delta_uv = pdata->delta_uv;
-                light_set_ctl(ctl);
                 light_state_store();
             }
         }
@@ -270,6 +264,13 @@ static int32_t scene_server_data(const mesh_model_info_p pmodel_info, uint32_t t
         break;
     case SCENE_SERVER_STORE:
         {
+            scene_server_store_t *pdata = pargs;
+            if ((SCENE_STATUS_SUCCESS == pdata->status) && (NULL != pdata->pmemory))
+            {
+                light_ctl_t *pstate = pdata->pmemory;
+                *pstate = light_get_ctl();
+                light_scene_store(pdata->pmemory);
+            }
         }
         break;
     case SCENE_SERVER_RECALL:
@@ -292,6 +293,7 @@ static int32_t scene_server_data(const mesh_model_info_p pmodel_info, uint32_t t
         break;
     case SCENE_SERVER_DELETE:
         {
+            light_scene_delete();
         }
         break;
     default:
@@ -334,8 +336,14 @@ void light_ctl_server_models_init(uint8_t element_index)
     scene_server_reg(element_index, &light_scene_server);
     light_scene_setup_server.model_data_cb = scene_server_data;
     scene_setup_server_reg(element_index, &light_scene_setup_server);
+    scene_storage_memory_t *scene_storage_memory =
+        light_scene_restore(scene_defaults, sizeof(scene_defaults) / sizeof(light_flash_scene_t));
     scene_server_set_storage_memory(&light_scene_server, scene_storage_memory,
-                                    sizeof(scene_storage_memory) / sizeof(scene_storage_memory_t));
-    scene_setup_server_set_storage_memory(&light_scene_server, scene_storage_memory,
-                                          sizeof(scene_storage_memory) / sizeof(scene_storage_memory_t));
+                                    LIGHT_FLASH_SCENE_NUM);
+    scene_setup_server_set_storage_memory(&light_scene_setup_server, scene_storage_memory,
+                                          LIGHT_FLASH_SCENE_NUM);
+
+    /* register time and scheduler models, the scheduler extends the scene server */
+    time_server_models_init(element_index);
+    scheduler_server_models_init(element_index, &generic_on_off_server, &light_scene_server);
 }
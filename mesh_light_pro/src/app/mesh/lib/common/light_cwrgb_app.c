@@ -10,11 +10,12 @@
 * @version  v1.0
 *********************************************************************************************************
 */
-#include <math.h>
 #include "light_cwrgb_app.h"
 #include "rtl876x_pinmux.h"
 #include "rtl876x_tim.h"
 #include "light_config.h"
+#include "light_ctl.h"
+#include "light_controller_app.h"
 
 static light_t light_cwrgb[] =
 {
@@ -36,33 +37,115 @@ static light_t light_cwrgb[] =
 };
 
 static light_hsl_t light_hsl;
+/* light_hsl is derived from the rgb channels on demand */
+static bool light_hsl_dirty;
+static light_hsl_cache_stat_t light_hsl_stat;
+
+/* hsl fade, the states move by fixed deltas every step, the hue by the shorter arc */
+typedef struct
+{
+    uint32_t hue; //!< Q16, wraps around the circle
+    uint32_t saturation; //!< Q15
+    uint32_t lightness; //!< Q15
+    int32_t hue_delta;
+    int32_t saturation_delta;
+    int32_t lightness_delta;
+    light_hsl_t hsl; //!< state of the last step
+    uint32_t v1; //!< bounds of the last step, kept while saturation and lightness hold
+    uint32_t v2;
+    light_hsl_t target;
+} light_hsl_fade_t;
+
+static light_hsl_fade_t light_hsl_fade;
+static bool light_hsl_fading;
 static light_ctl_t light_ctl;
+/* light_ctl is derived from the cold and warm channels on demand */
+static bool light_ctl_dirty = TRUE;
 
-static float hue_2_rgb(float v1, float v2, float h)
-{
-    if (h < 0)
-    {
-        h += 1;
-    }
-    else if (h > 1)
-    {
-        h -= 1;
-    }
-    if (6 * h < 1)
+/* hue in sixths of a turn, a turn is 6 * 65536 */
+#define HUE_Q16_ONE             0x10000
+#define HUE_Q16_TURN            (6 * HUE_Q16_ONE)
+
+/**
+ * @brief calculate the bounds of hsl to rgb conversion
+ * @param[in] l: lightness
+ * @param[in] s: saturation
+ * @param[out] pv1: lower bound in Q16, channel value 65535 is 65535 << 16
+ * @param[out] pv2: upper bound in Q16
+ */
+static void hsl_2_bounds(uint32_t l, uint32_t s, uint32_t *pv1, uint32_t *pv2)
+{
+    /* l * s / 65535 in Q16, x * 65536 / 65535 = x + x / 65535 */
+    uint32_t ls = l * s;
+    ls += ls / 65535;
+    if (l <= 32767)
     {
-        return v1 + (v2 - v1) * 6 * h;
+        /* l * (1 + s) */
+        *pv2 = (l << 16) + ls;
     }
-    else if (2 * h < 1)
+    else
     {
-        return v2;
+        /* l + s - s * l */
+        *pv2 = (l << 16) + ((s << 16) - ls);
     }
-    else if (3 * h < 2)
+    /* 2 * l - v2 */
+    *pv1 = (l << 16) - (*pv2 - (l << 16));
+}
+
+/**
+ * @brief calculate rgb from the bounds and hue
+ * @param[in] v1: lower bound in Q16
+ * @param[in] v2: upper bound in Q16
+ * @param[in] h6: hue multiplied by 6, in Q16, range [0, HUE_Q16_TURN)
+ * @param[out] prgb: rgb value
+ */
+static void hue_2_rgb(uint32_t v1, uint32_t v2, uint32_t h6, light_rgb_t *prgb)
+{
+    /* one channel holds the upper bound and one the lower bound in each sixth of the circle, the
+     * third one ramps up in the even sixths and down in the odd ones */
+    uint32_t sextant = h6 >> 16;
+    uint32_t frac = h6 & (HUE_Q16_ONE - 1);
+    if (sextant & 1)
     {
-        return v1 + (v2 - v1) * (4 - 6 * h);
+        frac = HUE_Q16_ONE - frac;
     }
-    else
+    /* round up to be consistent with the former floating point version */
+    uint16_t max = (v2 + 0xffff) >> 16;
+    uint16_t min = (v1 + 0xffff) >> 16;
+    uint16_t mid = (v1 + (uint32_t)(((uint64_t)(v2 - v1) * frac) >> 16) + 0xffff) >> 16;
+
+    switch (sextant)
     {
-        return v1;
+    case 0:
+        prgb->red = max;
+        prgb->green = mid;
+        prgb->blue = min;
+        break;
+    case 1:
+        prgb->red = mid;
+        prgb->green = max;
+        prgb->blue = min;
+        break;
+    case 2:
+        prgb->red = min;
+        prgb->green = max;
+        prgb->blue = mid;
+        break;
+    case 3:
+        prgb->red = min;
+        prgb->green = mid;
+        prgb->blue = max;
+        break;
+    case 4:
+        prgb->red = mid;
+        prgb->green = min;
+        prgb->blue = max;
+        break;
+    default:
+        prgb->red = max;
+        prgb->green = min;
+        prgb->blue = mid;
+        break;
     }
 }
 
@@ -75,22 +158,9 @@ light_rgb_t hsl_2_rgb(light_hsl_t hsl)
     }
     else
     {
-        float h, s, l, v1, v2;
-        h = (float)hsl.hue / 65536;
-        s = (float)hsl.saturation / 65535;
-        l = (float)hsl.lightness / 65535;
-        if (l < 0.5f)
-        {
-            v2 = l * (1 + s);
-        }
-        else
-        {
-            v2 = (l + s) - (s * l);
-        }
-        v1 = 2 * l - v2;
-        rgb.red = ceil(65535 * hue_2_rgb(v1, v2, h + 1.0 / 3));
-        rgb.green = ceil(65535 * hue_2_rgb(v1, v2, h));
-        rgb.blue = ceil(65535 * hue_2_rgb(v1, v2, h - 1.0 / 3));
+        uint32_t v1, v2;
+        hsl_2_bounds(hsl.lightness, hsl.saturation, &v1, &v2);
+        hue_2_rgb(v1, v2, 6 * (uint32_t)hsl.hue, &rgb);
     }
 
     return rgb;
@@ -140,16 +210,276 @@ light_hsl_t rgb_2_hsl(light_rgb_t rgb)
     {
         hsl.saturation = 0;
     }
-    else if (hsl.lightness <= 32767)
+    else
+    {
+        /* round up, denominator is never 0 here */
+        uint32_t den = (hsl.lightness <= 32767) ? ((uint32_t)max + min) : (2 * 65535 - (uint32_t)max - min);
+        hsl.saturation = (65535 * (uint32_t)(max - min) + den - 1) / den;
+    }
+
+    return hsl;
+}
+
+/* planckian locus by the krystek approximation, one point every CTL_MIRED_STEP mired from
+ * CTL_MIRED_MIN, which covers the ctl temperature range 800K ~ 20000K. f(u, v, nu, nv) gets the
+ * point and its unit normal towards positive delta uv, in cie 1960 uv scaled by 1e6 */
+#define CTL_MIRED_MIN           50
+#define CTL_MIRED_STEP          25
+#define CTL_LOCUS_POINTS        49
+#define CTL_LOCUS(f)            f(183985, 276638, -966639, 256143), \
+    f(186676, 285035, -936322, 351142), \
+    f(190250, 293371, -900445, 434970), \
+    f(194609, 301469, -859175, 511682), \
+    f(199662, 309180, -812202, 583376), \
+    f(205320, 316386, -759372, 650656), \
+    f(211503, 323009, -701048, 713114), \
+    f(218136, 328999, -638266, 769816), \
+    f(225150, 334340, -572677, 819781), \
+    f(232482, 339040, -506302, 862356), \
+    f(240074, 343125, -441201, 897408), \
+    f(247876, 346631, -379153, 925334), \
+    f(255841, 349607, -321468, 946920), \
+    f(263927, 352102, -268934, 963158), \
+    f(272097, 354166, -221867, 975077), \
+    f(280318, 355850, -180220, 983626), \
+    f(288562, 357200, -143710, 989620), \
+    f(296803, 358259, -111911, 993718), \
+    f(305019, 359066, -84340, 996437), \
+    f(313191, 359657, -60500, 998168), \
+    f(321302, 360063, -39921, 999203), \
+    f(329338, 360311, -22168, 999754), \
+    f(337287, 360425, -6853, 999977), \
+    f(345139, 360426, 6365, 999980), \
+    f(352885, 360331, 17782, 999842), \
+    f(360518, 360157, 27653, 999618), \
+    f(368032, 359916, 36199, 999345), \
+    f(375423, 359621, 43606, 999049), \
+    f(382687, 359280, 50034, 998748), \
+    f(389821, 358902, 55621, 998452), \
+    f(396824, 358494, 60481, 998169), \
+    f(403695, 358063, 64715, 997904), \
+    f(410433, 357613, 68408, 997657), \
+    f(417037, 357150, 71631, 997431), \
+    f(423509, 356676, 74448, 997225), \
+    f(429849, 356194, 76910, 997038), \
+    f(436057, 355708, 79066, 996869), \
+    f(442137, 355220, 80952, 996718), \
+    f(448088, 354732, 82605, 996582), \
+    f(453913, 354245, 84052, 996461), \
+    f(459614, 353760, 85321, 996354), \
+    f(465193, 353279, 86431, 996258), \
+    f(470652, 352803, 87403, 996173), \
+    f(475993, 352332, 88254, 996098), \
+    f(481219, 351867, 88997, 996032), \
+    f(486333, 351408, 89647, 995974), \
+    f(491335, 350957, 90212, 995923), \
+    f(496230, 350512, 90704, 995878), \
+    f(501019, 350075, 91131, 995839)
+
+/* the mix of the two leds lies on the chord from the warm led to the cold led, a target point is
+ * projected on the chord, the position is 0 at the warm led and 65536 at the cold led */
+#define CTL_CHORD_U             ((int64_t)LIGHT_CTL_COLD_U - LIGHT_CTL_WARM_U)
+#define CTL_CHORD_V             ((int64_t)LIGHT_CTL_COLD_V - LIGHT_CTL_WARM_V)
+#define CTL_CHORD_LEN2          (CTL_CHORD_U * CTL_CHORD_U + CTL_CHORD_V * CTL_CHORD_V)
+#define CTL_MIX_POINT(u, v, nu, nv) \
+    {(int32_t)((((u) - LIGHT_CTL_WARM_U) * CTL_CHORD_U + ((v) - LIGHT_CTL_WARM_V) * CTL_CHORD_V) * \
+               65536 / CTL_CHORD_LEN2), \
+     (int32_t)(((nu) * CTL_CHORD_U + (nv) * CTL_CHORD_V) * 65536 / CTL_CHORD_LEN2)}
+
+typedef struct
+{
+    int32_t position; //!< locus point on the chord in Q16
+    int32_t duv_gain; //!< position moved by delta uv 1.0, in Q16
+} ctl_mix_point_t;
+
+/* mixing table of the leds in light_config.h, computed by the compiler */
+static const ctl_mix_point_t ctl_mix_table[CTL_LOCUS_POINTS] = {CTL_LOCUS(CTL_MIX_POINT)};
+
+/**
+ * @brief get the chord position of a ctl temperature
+ * @param[in] temperature: temperature in kelvin
+ * @param[in] delta_uv: delta uv, 32768 is 1.0
+ * @return chord position in Q16, range [0, 65536]
+ */
+static uint32_t ctl_mix_position(uint16_t temperature, int16_t delta_uv)
+{
+    temperature = MAX(temperature, LIGHT_CTL_TEMPERATURE_LOWER_LIMIT);
+    temperature = MIN(temperature, LIGHT_CTL_TEMPERATURE_UPPER_LIMIT);
+    /* interpolate in mired, Q8 */
+    uint32_t mired = ((1000000UL << 8) + temperature / 2) / temperature;
+    uint32_t index = (mired - (CTL_MIRED_MIN << 8)) / (CTL_MIRED_STEP << 8);
+    uint32_t frac = (mired - (CTL_MIRED_MIN << 8)) % (CTL_MIRED_STEP << 8);
+    if (index >= CTL_LOCUS_POINTS - 1)
+    {
+        index = CTL_LOCUS_POINTS - 2;
+        frac = CTL_MIRED_STEP << 8;
+    }
+
+    const ctl_mix_point_t *ppoint = &ctl_mix_table[index];
+    int32_t position = ppoint[0].position + (ppoint[1].position - ppoint[0].position) * (int32_t)frac /
+                       (CTL_MIRED_STEP << 8);
+    int32_t duv_gain = ppoint[0].duv_gain + (ppoint[1].duv_gain - ppoint[0].duv_gain) * (int32_t)frac /
+                       (CTL_MIRED_STEP << 8);
+    position += (int32_t)((int64_t)duv_gain * delta_uv / 32768);
+
+    /* out of the leds gamut, the nearest led alone */
+    position = MAX(position, 0);
+    position = MIN(position, 65536);
+    return position;
+}
+
+light_cw_t ctl_2_cw(light_ctl_t ctl)
+{
+    /* luminance share of the cold led, a led weighs Y / v on the uv chord */
+    uint32_t position = ctl_mix_position(ctl.temperature, ctl.delta_uv);
+    uint64_t cold = (uint64_t)position * LIGHT_CTL_COLD_V;
+    uint64_t warm = (uint64_t)(65536 - position) * LIGHT_CTL_WARM_V;
+    uint32_t share = (cold << 16) / (cold + warm);
+
+    light_cw_t cw;
+    cw.cold = ((uint32_t)ctl.lightness * share + 0x8000) >> 16;
+    cw.warm = ctl.lightness - cw.cold;
+    return cw;
+}
+
+light_ctl_t cw_2_ctl(light_cw_t cw)
+{
+    light_ctl_t ctl = {0, 0, 0};
+    uint32_t sum = (uint32_t)cw.cold + cw.warm;
+    ctl.lightness = MIN(sum, 65535);
+
+    /* cold share back to the chord position */
+    uint32_t share = (0 == sum) ? 0x8000 : ((((uint32_t)cw.cold << 16) + sum / 2) / sum);
+    uint64_t cold = (uint64_t)share * LIGHT_CTL_WARM_V;
+    uint64_t warm = (uint64_t)(65536 - share) * LIGHT_CTL_COLD_V;
+    int32_t position = (cold << 16) / (cold + warm);
+
+    /* the position falls along the table */
+    uint32_t mired;
+    if (position >= ctl_mix_table[0].position)
+    {
+        mired = CTL_MIRED_MIN << 8;
+    }
+    else if (position <= ctl_mix_table[CTL_LOCUS_POINTS - 1].position)
     {
-        hsl.saturation = ceil(65535 * (double)(max - min) / (max + min));
+        mired = (CTL_MIRED_MIN + (CTL_LOCUS_POINTS - 1) * CTL_MIRED_STEP) << 8;
     }
     else
     {
-        hsl.saturation = ceil(65535 * (double)(max - min) / (2 * 65535 - max - min));
+        uint32_t low = 0;
+        uint32_t high = CTL_LOCUS_POINTS - 1;
+        while (high - low > 1)
+        {
+            uint32_t mid = (low + high) / 2;
+            if (ctl_mix_table[mid].position >= position)
+            {
+                low = mid;
+            }
+            else
+            {
+                high = mid;
+            }
+        }
+        mired = ((CTL_MIRED_MIN + low * CTL_MIRED_STEP) << 8) +
+                (uint32_t)(ctl_mix_table[low].position - position) * (CTL_MIRED_STEP << 8) /
+                (uint32_t)(ctl_mix_table[low].position - ctl_mix_table[high].position);
     }
+    ctl.temperature = ((1000000UL << 8) + mired / 2) / mired;
 
-    return hsl;
+    return ctl;
+}
+
+static void light_ctl_invalidate(void)
+{
+    light_ctl_dirty = TRUE;
+}
+
+/**
+ * @brief start the hsl fade
+ * @param[out] pfade: hsl fade
+ * @param[in] begin: hsl value of the fade start
+ * @param[in] end: target hsl value
+ * @param[in] steps: number of steps, larger than 0
+ */
+static void light_hsl_fade_init(light_hsl_fade_t *pfade, light_hsl_t begin, light_hsl_t end,
+                                uint32_t steps)
+{
+    pfade->hue = (uint32_t)begin.hue << 16;
+    pfade->saturation = (uint32_t)begin.saturation << 15;
+    pfade->lightness = (uint32_t)begin.lightness << 15;
+    /* the 16 bit difference is the shorter arc */
+    pfade->hue_delta = (int32_t)(int16_t)(end.hue - begin.hue) * 65536 / (int32_t)steps;
+    pfade->saturation_delta = ((int32_t)end.saturation - begin.saturation) * 32768 / (int32_t)steps;
+    pfade->lightness_delta = ((int32_t)end.lightness - begin.lightness) * 32768 / (int32_t)steps;
+    pfade->hsl = begin;
+    hsl_2_bounds(begin.lightness, begin.saturation, &pfade->v1, &pfade->v2);
+    pfade->target = end;
+}
+
+/**
+ * @brief move the hsl fade by one step
+ * @param[in,out] pfade: hsl fade
+ * @return rgb value of the step, same as hsl_2_rgb of the step state
+ */
+static light_rgb_t light_hsl_fade_step(light_hsl_fade_t *pfade)
+{
+    pfade->hue += pfade->hue_delta;
+    pfade->saturation += pfade->saturation_delta;
+    pfade->lightness += pfade->lightness_delta;
+
+    light_hsl_t hsl;
+    hsl.lightness = (pfade->lightness + 0x4000) >> 15;
+    hsl.hue = (pfade->hue + 0x8000) >> 16;
+    hsl.saturation = (pfade->saturation + 0x4000) >> 15;
+    if ((hsl.lightness != pfade->hsl.lightness) || (hsl.saturation != pfade->hsl.saturation))
+    {
+        hsl_2_bounds(hsl.lightness, hsl.saturation, &pfade->v1, &pfade->v2);
+    }
+    pfade->hsl = hsl;
+
+    light_rgb_t rgb;
+    hue_2_rgb(pfade->v1, pfade->v2, 6 * (uint32_t)hsl.hue, &rgb);
+    return rgb;
+}
+
+static void light_hsl_fade_step_cb(light_t *light, uint32_t remaining_steps)
+{
+    UNUSED(light);
+    if (0 == remaining_steps)
+    {
+        light_hsl_fading = FALSE;
+        light_set_hsl(light_hsl_fade.target);
+        return;
+    }
+
+    light_rgb_t rgb = light_hsl_fade_step(&light_hsl_fade);
+    light_lighten(&light_cwrgb[2], rgb.red);
+    light_lighten(&light_cwrgb[3], rgb.green);
+    light_lighten(&light_cwrgb[4], rgb.blue);
+    light_hsl = light_hsl_fade.hsl;
+    light_hsl_dirty = FALSE;
+}
+
+static void light_hsl_fade_done(light_t *light)
+{
+    UNUSED(light);
+    light_hsl_fading = FALSE;
+}
+
+static void light_hsl_fade_stop(void)
+{
+    if (light_hsl_fading)
+    {
+        light_stop(&light_cwrgb[2]);
+        light_hsl_fading = FALSE;
+    }
+}
+
+static void light_hsl_invalidate(void)
+{
+    light_hsl_fade_stop();
+    light_hsl_dirty = TRUE;
+    light_hsl_stat.invalidate_count ++;
 }
 
 void light_cwrgb_driver_init(void)
@@ -171,41 +501,39 @@ void light_cwrgb_enter_dlps(void)
 void light_set_cold_lightness(uint16_t lightness)
 {
     light_set_lightness(&light_cwrgb[0], lightness);
-    light_ctl.lightness = lightness;
+    light_ctl_invalidate();
 }
 
 void light_lighten_cold(uint16_t lightness)
 {
     light_lighten(&light_cwrgb[0], lightness);
-    light_ctl.lightness = lightness;
+    light_ctl_invalidate();
 }
 
 void light_set_warm_lightness(uint16_t lightness)
 {
     light_set_lightness(&light_cwrgb[1], lightness);
-    light_ctl.temperature = lightness;
+    light_ctl_invalidate();
 }
 
 void light_lighten_warm(uint16_t lightness)
 {
     light_lighten(&light_cwrgb[1], lightness);
-    light_ctl.temperature = lightness;
+    light_ctl_invalidate();
 }
 
 void light_set_cw_lightness(light_cw_t lightness)
 {
     light_set_lightness(&light_cwrgb[0], lightness.cold);
     light_set_lightness(&light_cwrgb[1], lightness.warm);
-    light_ctl.lightness = lightness.cold;
-    light_ctl.temperature = lightness.warm;
+    light_ctl_invalidate();
 }
 
 void light_lighten_cw(light_cw_t lightness)
 {
     light_lighten(&light_cwrgb[0], lightness.cold);
     light_lighten(&light_cwrgb[1], lightness.warm);
-    light_ctl.lightness = lightness.cold;
-    light_ctl.temperature = lightness.warm;
+    light_ctl_invalidate();
 }
 
 light_cw_t light_get_cw_lightness(void)
@@ -217,43 +545,37 @@ light_cw_t light_get_cw_lightness(void)
 void light_set_red_lightness(uint16_t lightness)
 {
     light_set_lightness(&light_cwrgb[2], lightness);
-    light_rgb_t rgb = {light_cwrgb[2].lightness, light_cwrgb[3].lightness, light_cwrgb[4].lightness};
-    light_hsl = rgb_2_hsl(rgb);
+    light_hsl_invalidate();
 }
 
 void light_lighten_red(uint16_t lightness)
 {
     light_lighten(&light_cwrgb[2], lightness);
-    light_rgb_t rgb = {light_cwrgb[2].lightness, light_cwrgb[3].lightness, light_cwrgb[4].lightness};
-    light_hsl = rgb_2_hsl(rgb);
+    light_hsl_invalidate();
 }
 
 void light_set_green_lightness(uint16_t lightness)
 {
     light_set_lightness(&light_cwrgb[3], lightness);
-    light_rgb_t rgb = {light_cwrgb[2].lightness, light_cwrgb[3].lightness, light_cwrgb[4].lightness};
-    light_hsl = rgb_2_hsl(rgb);
+    light_hsl_invalidate();
 }
 
 void light_lighten_green(uint16_t lightness)
 {
     light_lighten(&light_cwrgb[3], lightness);
-    light_rgb_t rgb = {light_cwrgb[2].lightness, light_cwrgb[3].lightness, light_cwrgb[4].lightness};
-    light_hsl = rgb_2_hsl(rgb);
+    light_hsl_invalidate();
 }
 
 void light_set_blue_lightness(uint16_t lightness)
 {
     light_set_lightness(&light_cwrgb[4], lightness);
-    light_rgb_t rgb = {light_cwrgb[2].lightness, light_cwrgb[3].lightness, light_cwrgb[4].lightness};
-    light_hsl = rgb_2_hsl(rgb);
+    light_hsl_invalidate();
 }
 
 void light_lighten_blue(uint16_t lightness)
 {
     light_lighten(&light_cwrgb[4], lightness);
-    light_rgb_t rgb = {light_cwrgb[2].lightness, light_cwrgb[3].lightness, light_cwrgb[4].lightness};
-    light_hsl = rgb_2_hsl(rgb);
+    light_hsl_invalidate();
 }
 
 void light_set_rgb_lightness(light_rgb_t lightness)
@@ -261,8 +583,7 @@ void light_set_rgb_lightness(light_rgb_t lightness)
     light_set_lightness(&light_cwrgb[2], lightness.red);
     light_set_lightness(&light_cwrgb[3], lightness.green);
     light_set_lightness(&light_cwrgb[4], lightness.blue);
-    light_rgb_t rgb = {light_cwrgb[2].lightness, light_cwrgb[3].lightness, light_cwrgb[4].lightness};
-    light_hsl = rgb_2_hsl(rgb);
+    light_hsl_invalidate();
 }
 
 void light_lighten_rgb(light_rgb_t lightness)
@@ -270,8 +591,7 @@ void light_lighten_rgb(light_rgb_t lightness)
     light_lighten(&light_cwrgb[2], lightness.red);
     light_lighten(&light_cwrgb[3], lightness.green);
     light_lighten(&light_cwrgb[4], lightness.blue);
-    light_rgb_t rgb = {light_cwrgb[2].lightness, light_cwrgb[3].lightness, light_cwrgb[4].lightness};
-    light_hsl = rgb_2_hsl(rgb);
+    light_hsl_invalidate();
 }
 
 light_rgb_t light_get_rgb_lightness(void)
@@ -284,6 +604,7 @@ void light_cw_turn_off(void)
 {
     light_lighten(&light_cwrgb[0], 0);
     light_lighten(&light_cwrgb[1], 0);
+    light_ctl_invalidate();
 }
 
 void light_cw_turn_on(void)
@@ -300,6 +621,7 @@ void light_cw_turn_on(void)
         light_lighten(&light_cwrgb[0], light_cwrgb[0].lightness_last);
         light_lighten(&light_cwrgb[1], light_cwrgb[1].lightness_last);
     }
+    light_ctl_invalidate();
 }
 
 void light_rgb_turn_off(void)
@@ -388,30 +710,152 @@ void light_blink_blue(uint32_t hz_numerator, uint32_t hz_denominator, uint8_t du
 
 void light_set_ctl(light_ctl_t ctl)
 {
-    light_set_lightness(&light_cwrgb[0], ctl.lightness);
-    light_set_lightness(&light_cwrgb[1], ctl.temperature);
+    light_cw_t cw = ctl_2_cw(ctl);
+    light_set_lightness(&light_cwrgb[0], cw.cold);
+    light_set_lightness(&light_cwrgb[1], cw.warm);
     light_ctl = ctl;
+    light_ctl_dirty = FALSE;
+}
+
+void light_fade_ctl(light_ctl_t ctl, uint32_t time)
+{
+    light_cw_t cw = ctl_2_cw(ctl);
+    if (!light_ramp_start(&light_cwrgb[0], cw.cold, time) ||
+        !light_ramp_start(&light_cwrgb[1], cw.warm, time))
+    {
+        light_lighten(&light_cwrgb[0], cw.cold);
+        light_lighten(&light_cwrgb[1], cw.warm);
+    }
+    light_ctl = ctl;
+    light_ctl_dirty = FALSE;
+}
+
+bool light_ctl_transition_step(light_ctl_t *pstart, light_ctl_t target, uint8_t fields,
+                               uint8_t total_steps, uint8_t remaining_steps, uint32_t step_time)
+{
+    light_ctl_t ctl = light_get_ctl();
+    if (remaining_steps >= total_steps)
+    {
+        *pstart = ctl;
+    }
+
+    if (0 == remaining_steps)
+    {
+        if (fields & LIGHT_CTL_FIELD_LIGHTNESS)
+        {
+            ctl.lightness = target.lightness;
+        }
+        if (fields & LIGHT_CTL_FIELD_TEMPERATURE)
+        {
+            ctl.temperature = target.temperature;
+            ctl.delta_uv = target.delta_uv;
+        }
+        light_set_ctl(ctl);
+        return TRUE;
+    }
+
+    /* head for the state at the end of this step, the hardware fade fills the step in */
+    int32_t steps = total_steps - remaining_steps + 1;
+    if (fields & LIGHT_CTL_FIELD_LIGHTNESS)
+    {
+        ctl.lightness = pstart->lightness + ((int32_t)target.lightness - pstart->lightness) * steps /
+                        total_steps;
+    }
+    if (fields & LIGHT_CTL_FIELD_TEMPERATURE)
+    {
+        ctl.temperature = pstart->temperature + ((int32_t)target.temperature - pstart->temperature) *
+                          steps / total_steps;
+        ctl.delta_uv = pstart->delta_uv + ((int32_t)target.delta_uv - pstart->delta_uv) * steps /
+                       total_steps;
+    }
+    light_fade_ctl(ctl, step_time);
+    return FALSE;
 }
 
 light_ctl_t light_get_ctl(void)
 {
+    if (light_ctl_dirty)
+    {
+        light_cw_t cw = {light_cwrgb[0].lightness, light_cwrgb[1].lightness};
+        light_ctl_t ctl = light_ctl;
+        ctl.lightness = MIN((uint32_t)cw.cold + cw.warm, 65535);
+        light_cw_t mix = ctl_2_cw(ctl);
+        if ((mix.cold != cw.cold) || (mix.warm != cw.warm))
+        {
+            /* mixed by other means, the delta uv can not be told from the channels */
+            ctl = cw_2_ctl(cw);
+        }
+        light_ctl = ctl;
+        light_ctl_dirty = FALSE;
+    }
+
     return light_ctl;
 }
 
 void light_set_hsl(light_hsl_t hsl)
 {
+    light_hsl_fade_stop();
     light_rgb_t rgb = hsl_2_rgb(hsl);
-    light_hsl = hsl;
     light_set_lightness(&light_cwrgb[2], rgb.red);
     light_set_lightness(&light_cwrgb[3], rgb.green);
     light_set_lightness(&light_cwrgb[4], rgb.blue);
+    /* keep the requested value, converting back would lose hue precision */
+    light_hsl = hsl;
+    light_hsl_dirty = FALSE;
+}
+
+bool light_fade_hsl(light_hsl_t hsl, uint32_t time)
+{
+    light_hsl_t begin = light_get_hsl();
+    uint32_t steps = time / LIGHT_MONITOR_INTERVAL;
+    light_hsl_fade_stop();
+    if ((steps > 1) &&
+        light_set_steps(&light_cwrgb[2], steps, light_hsl_fade_step_cb, light_hsl_fade_done))
+    {
+        light_hsl_fade_init(&light_hsl_fade, begin, hsl, steps);
+        light_hsl_fading = TRUE;
+        return TRUE;
+    }
+
+    light_set_hsl(hsl);
+    return FALSE;
+}
+
+bool light_hsl_transition_step(light_hsl_t target, uint8_t total_steps, uint8_t remaining_steps,
+                               uint32_t step_time)
+{
+    if (0 == remaining_steps)
+    {
+        light_set_hsl(target);
+        return TRUE;
+    }
+
+    if (remaining_steps >= total_steps)
+    {
+        /* the light controller paces the whole transition */
+        light_fade_hsl(target, total_steps * step_time);
+    }
+    return FALSE;
 }
 
 light_hsl_t light_get_hsl(void)
 {
+    if (light_hsl_dirty)
+    {
+        light_rgb_t rgb = {light_cwrgb[2].lightness, light_cwrgb[3].lightness, light_cwrgb[4].lightness};
+        light_hsl = rgb_2_hsl(rgb);
+        light_hsl_dirty = FALSE;
+        light_hsl_stat.convert_count ++;
+    }
+
     return light_hsl;
 }
 
+void light_get_hsl_cache_stat(light_hsl_cache_stat_t *pstat)
+{
+    *pstat = light_hsl_stat;
+}
+
 light_t *light_get_cold(void)
 {
     return &light_cwrgb[0];
@@ -458,11 +902,11 @@ void light_set_cwrgb(const uint16_t *cwrgb)
 
 void light_get_cwrgb(uint8_t *cwrgb)
 {
-    cwrgb[0] = light_get_cold()->lightness / 65535.0 * 255;
-    cwrgb[1] = light_get_warm()->lightness / 65535.0 * 255;
-    cwrgb[2] = light_get_red()->lightness / 65535.0 * 255;
-    cwrgb[3] = light_get_green()->lightness / 65535.0 * 255;
-    cwrgb[4] = light_get_blue()->lightness / 65535.0 * 255;
+    cwrgb[0] = light_get_cold()->lightness * 255UL / 65535;
+    cwrgb[1] = light_get_warm()->lightness * 255UL / 65535;
+    cwrgb[2] = light_get_red()->lightness * 255UL / 65535;
+    cwrgb[3] = light_get_green()->lightness * 255UL / 65535;
+    cwrgb[4] = light_get_blue()->lightness * 255UL / 65535;
 }
 
 
@@ -34,11 +34,15 @@ typedef struct
     uint16_t warm;
 } light_cw_t;
 
+/** light ctl fields moved by a transition */
+#define LIGHT_CTL_FIELD_LIGHTNESS           0x01
+#define LIGHT_CTL_FIELD_TEMPERATURE         0x02 //!< temperature and delta uv
+
 typedef struct
 {
     uint16_t lightness;
-    uint16_t temperature;
-    int16_t delta_uv;
+    uint16_t temperature; //!< kelvin
+    int16_t delta_uv; //!< 32768 is 1.0
 } light_ctl_t;
 
 typedef struct
@@ -54,6 +58,12 @@ typedef struct
     uint16_t hue;
     uint16_t saturation;
 } light_hsl_t;
+
+typedef struct
+{
+    uint32_t invalidate_count; //!< rgb writes, each one used to convert rgb to hsl
+    uint32_t convert_count; //!< rgb to hsl conversions done by light_get_hsl
+} light_hsl_cache_stat_t;
 /** @} */
 
 /**
@@ -294,15 +304,59 @@ light_t *light_get_blue(void);
 /**
  * @brief set ctl value
  * @param[in] ctl: light ctl value
+ * @note the cold and warm channels are mixed by ctl_2_cw
  */
 void light_set_ctl(light_ctl_t ctl);
 
+/**
+ * @brief fade to ctl value by hardware timer
+ * @param[in] ctl: target light ctl value
+ * @param[in] time: fade time, the unit is ms
+ * @note the channels are set at once if the fade can not start, the lightness_last field is not
+ *       updated
+ */
+void light_fade_ctl(light_ctl_t ctl, uint32_t time);
+
+/**
+ * @brief move ctl value by one step of a transition
+ * @param[in,out] pstart: ctl value when the transition starts, saved by the first step
+ * @param[in] target: target ctl value
+ * @param[in] fields: LIGHT_CTL_FIELD_LIGHTNESS and LIGHT_CTL_FIELD_TEMPERATURE, fields in transition
+ * @param[in] total_steps: transition steps
+ * @param[in] remaining_steps: steps to go, equals total_steps at the first step
+ * @param[in] step_time: step time, the unit is ms
+ * @retval TRUE: transition done, target set
+ * @retval FALSE: in transition, the channels fade to the state at the end of the step
+ * @note the fields are interpolated linearly by the steps done
+ */
+bool light_ctl_transition_step(light_ctl_t *pstart, light_ctl_t target, uint8_t fields,
+                               uint8_t total_steps, uint8_t remaining_steps, uint32_t step_time);
+
 /**
  * @brief get ctl value
  * @return light ctl value
+ * @note converted from the cold and warm channels on the first call after they change, unless
+ *       they still hold the mix of the last ctl value
  */
 light_ctl_t light_get_ctl(void);
 
+/**
+ * @brief convert ctl to cold and warm
+ * @param[in] ctl: ctl value
+ * @return cold and warm lightness, they add up to the ctl lightness
+ * @note the temperature and delta uv are projected on the chord between the led chromaticities in
+ *       light_config.h, the channels are taken as equally bright at full duty, the shares are
+ *       exact with DIMMING_CURVE_LINEAR
+ */
+light_cw_t ctl_2_cw(light_ctl_t ctl);
+
+/**
+ * @brief convert cold and warm to ctl
+ * @param[in] cw: cold and warm lightness
+ * @return ctl value, delta uv is 0
+ */
+light_ctl_t cw_2_ctl(light_cw_t cw);
+
 /**
  * @brief convert rgb to hsl
  * @param[in] rgb: rgb value
@@ -314,6 +368,7 @@ light_hsl_t rgb_2_hsl(light_rgb_t rgb);
  * @brief convert hsl to rgb
  * @param[in] hsl: hsl value
  * @return rgb value
+ * @note Q16 fixed point, channels are rounded up and may exceed the exact value by 1
  */
 light_rgb_t hsl_2_rgb(light_hsl_t hsl);
 
@@ -323,12 +378,45 @@ light_rgb_t hsl_2_rgb(light_hsl_t hsl);
  */
 void light_set_hsl(light_hsl_t hsl);
 
+/**
+ * @brief fade light to the hsl value
+ * @param[in] hsl: target hsl value
+ * @param[in] time: fade time in ms
+ * @retval TRUE: fade started, the light reaches the target after time
+ * @retval FALSE: time shorter than two controller steps or no controller action free, the
+ *                target is set now
+ * @note the hue turns by the shorter arc, the states move by fixed deltas every
+ *       LIGHT_MONITOR_INTERVAL, setting the rgb channels or the hsl stops the fade
+ */
+bool light_fade_hsl(light_hsl_t hsl, uint32_t time);
+
+/**
+ * @brief handle one step of a generic transition towards the hsl value
+ * @param[in] target: target hsl value
+ * @param[in] total_steps: total steps of the transition
+ * @param[in] remaining_steps: remaining steps of the transition
+ * @param[in] step_time: step time in ms
+ * @retval TRUE: target set, the transition is done
+ * @retval FALSE: transition in progress
+ * @note the first step starts light_fade_hsl over the whole transition, the last step sets
+ *       the target
+ */
+bool light_hsl_transition_step(light_hsl_t target, uint8_t total_steps, uint8_t remaining_steps,
+                               uint32_t step_time);
+
 /**
  * @brief get hsl value
  * @return hsl value
+ * @note converted from the rgb channels on the first call after they change
  */
 light_hsl_t light_get_hsl(void);
 
+/**
+ * @brief get hsl cache statistics
+ * @param[out] pstat: statistics, conversions avoided = invalidate_count - convert_count
+ */
+void light_get_hsl_cache_stat(light_hsl_cache_stat_t *pstat);
+
 
 /**
  * @brief light cwrgb model set cwrgb value
@@ -163,6 +163,8 @@ void light_dfu_server_end(void)
     light_rgb_t rgb = {light_get_red()->lightness_last, light_get_green()->lightness_last, light_get_blue()->lightness_last};
     light_set_cw_lightness(cw);
     light_set_rgb_lightness(rgb);
+    /* dfu server reboots into the new image, write the deferred light state first */
+    light_state_flush();
 }
 
 void light_dfu_server_fail(void)
@@ -170,4 +172,10 @@ void light_dfu_server_fail(void)
     light_blink_green(1, 2, 50);
 }
 
+void light_dfu_server_reset(void)
+{
+    /* dfu server resets the node at once, write the deferred light state first */
+    light_state_flush();
+}
+
 
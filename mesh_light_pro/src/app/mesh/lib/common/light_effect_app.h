@@ -87,6 +87,7 @@ void light_dfu_server_start(void);
 
 /**
  * @brief dfu server end light effect
+ * @note the pending light state is written, the node reboots after it
  */
 void light_dfu_server_end(void);
 
@@ -95,6 +96,12 @@ void light_dfu_server_end(void);
  */
 void light_dfu_server_fail(void);
 
+/**
+ * @brief dfu server is resetting the node
+ * @note the pending light state is written, the node reboots after it
+ */
+void light_dfu_server_reset(void);
+
 #if MESH_ALI_CERTIFICATION
 void light_set_unprov_effect(bool flag);
 #endif
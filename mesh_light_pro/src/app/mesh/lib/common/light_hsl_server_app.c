@@ -120,11 +120,12 @@ static int32_t light_lightness_server_data(const mesh_model_info_p pmodel_info,
     case LIGHT_LIGHTNESS_SERVER_SET:
         {
             light_lightness_server_set_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_hsl_t hsl = light_get_hsl();
+            hsl.lightness = pdata->lightness;
+            if (light_hsl_transition_step(hsl, pdata->total_time.num_steps,
+                                          pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_hsl_t hsl = light_get_hsl();
-                hsl.lightness = pdata->lightness;
-                light_set_hsl(hsl);
                 light_state_store();
             }
         }
@@ -132,11 +133,12 @@ static int32_t light_lightness_server_data(const mesh_model_info_p pmodel_info,
     case LIGHT_LIGHTNESS_SERVER_SET_LINEAR:
         {
             light_lightness_server_set_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_hsl_t hsl = light_get_hsl();
+            hsl.lightness = light_lightness_linear_to_actual(pdata->lightness);
+            if (light_hsl_transition_step(hsl, pdata->total_time.num_steps,
+                                          pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_hsl_t hsl = light_get_hsl();
-                hsl.lightness = light_lightness_linear_to_actual(pdata->lightness);
-                light_set_hsl(hsl);
                 light_state_store();
             }
         }
@@ -203,13 +205,14 @@ static int32_t light_hsl_server_data(const mesh_model_info_p pmodel_info, uint32
     case LIGHT_HSL_SERVER_SET:
         {
             light_hsl_server_set_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_hsl_t hsl;
+            hsl.lightness = pdata->lightness;
+            hsl.hue = pdata->hue;
+            hsl.saturation = pdata->saturation;
+            if (light_hsl_transition_step(hsl, pdata->total_time.num_steps,
+                                          pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_hsl_t hsl;
-                hsl.lightness = pdata->lightness;
-                hsl.hue = pdata->hue;
-                hsl.saturation = pdata->saturation;
-                light_set_hsl(hsl);
                 light_state_store();
             }
         }
@@ -217,11 +220,12 @@ static int32_t light_hsl_server_data(const mesh_model_info_p pmodel_info, uint32
     case LIGHT_HSL_SERVER_SET_HUE:
         {
             light_hsl_server_set_hue_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_hsl_t hsl = light_get_hsl();
+            hsl.hue = pdata->hue;
+            if (light_hsl_transition_step(hsl, pdata->total_time.num_steps,
+                                          pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_hsl_t hsl = light_get_hsl();
-                hsl.hue = pdata->hue;
-                light_set_hsl(hsl);
                 light_state_store();
             }
         }
@@ -229,11 +233,12 @@ static int32_t light_hsl_server_data(const mesh_model_info_p pmodel_info, uint32
     case LIGHT_HSL_SERVER_SET_SATURATION:
         {
             light_hsl_server_set_saturation_t *pdata = pargs;
-            if (pdata->total_time.num_steps == pdata->remaining_time.num_steps)
+            light_hsl_t hsl = light_get_hsl();
+            hsl.saturation = pdata->saturation;
+            if (light_hsl_transition_step(hsl, pdata->total_time.num_steps,
+                                          pdata->remaining_time.num_steps,
+                                          generic_transition_step_time(pdata->total_time)))
             {
-                light_hsl_t hsl = light_get_hsl();
-                hsl.saturation = pdata->saturation;
-                light_set_hsl(hsl);
                 light_state_store();
             }
         }
@@ -11,10 +11,34 @@
 * *************************************************************************************
 */
 
+#include <string.h>
 #include "light_storage_app.h"
 #include "light_cwrgb_app.h"
 #include "mesh_api.h"
 #include "light_config.h"
+#include "scene.h"
+
+#define LIGHT_STATE_STORE_TIMER_ID         0
+
+/* light state persisted in flash and the state waiting for the quiet period */
+static light_flash_light_state_t light_state_flash;
+static light_flash_light_state_t light_state_pending;
+static bool light_state_flash_valid;
+static bool light_state_dirty;
+static uint32_t light_state_dirty_time; //!< time of the first change not written
+static uint32_t light_state_change_time; //!< time of the last change
+static plt_timer_t light_state_store_timer;
+static light_state_store_stat_t light_state_store_stat;
+
+/* scene records, a scene state is edited in place and written with the light state, the
+ * scene number is copied to its record when written */
+static light_flash_scene_t light_scene_records[LIGHT_FLASH_SCENE_NUM];
+static scene_storage_memory_t light_scene_memory[LIGHT_FLASH_SCENE_NUM];
+static uint32_t light_scene_dirty; //!< bit mask of records not written
+static bool light_scene_flash_valid; //!< all records in flash are valid
+
+static bool light_state_early; //!< last state driven before the node state is known
+static uint32_t light_boot_time_us[LIGHT_BOOT_PHASE_NUM];
 
 static bool light_state_restore(void)
 {
@@ -22,9 +46,14 @@ static bool light_state_restore(void)
     mesh_node_state_t node_state = mesh_node_state_restore();
     if (node_state == PROV_NODE)
     {
-        light_flash_light_state_t light_state = {65535, 65535, 65535, 65535, 65535};
+        light_flash_light_state_t light_state = {{65535, 65535, 65535, 65535, 65535}, 0, 0};
         ret = light_flash_read(LIGHT_FLASH_PARAM_TYPE_LIGHT_STATE, sizeof(light_flash_light_state_t),
                                &light_state);
+        if (ret)
+        {
+            light_state_flash = light_state;
+            light_state_flash_valid = TRUE;
+        }
 #if LIGHT_TYPE == LIGHT_LIGHTNESS
         light_set_cold_lightness(light_state.state[0]);
 #elif LIGHT_TYPE == LIGHT_CW
@@ -42,27 +71,301 @@ static bool light_state_restore(void)
         light_set_blue_lightness(light_state.state[4]);
 #endif
     }
+    else if (light_state_early)
+    {
+        /* node reset after the state was written, back to the default output and do not light
+         * the state at the next boot */
+        light_flash_light_state_t light_state = {{65535, 65535, 65535, 65535, 65535}, 0, 0};
+        light_set_cwrgb(light_state.state);
+        ret = light_flash_write(LIGHT_FLASH_PARAM_TYPE_LIGHT_STATE, sizeof(light_flash_light_state_t),
+                                &light_state);
+    }
+    light_state_early = FALSE;
 
     return ret;
 }
 
+bool light_state_early_restore(void)
+{
+    if (light_power_on_count_get() >= LIGHT_POWER_ON_COUNT)
+    {
+        /* this power on resets the node */
+        return FALSE;
+    }
+
+    light_flash_light_state_t light_state;
+    if (!light_flash_read(LIGHT_FLASH_PARAM_TYPE_LIGHT_STATE, sizeof(light_flash_light_state_t),
+                          &light_state) || (0 == (light_state.flags & LIGHT_FLASH_LIGHT_STATE_FLAG_BOOT)))
+    {
+        return FALSE;
+    }
+
+    light_set_cwrgb(light_state.state);
+    light_state_early = TRUE;
+    return TRUE;
+}
+
+void light_boot_phase_mark(light_boot_phase_t phase)
+{
+    if (phase < LIGHT_BOOT_PHASE_NUM)
+    {
+        light_boot_time_us[phase] = plt_time_read_us();
+    }
+}
+
+void light_boot_time_get(uint32_t *ptime_us)
+{
+    memcpy(ptime_us, light_boot_time_us, sizeof(light_boot_time_us));
+}
+
 static bool light_user_data_restore(void)
 {
     /** restore user data from flash */
     return TRUE;
 }
 
+static void light_state_store_timeout_cb(void *ptimer)
+{
+    UNUSED(ptimer);
+    if (light_state_store_pending())
+    {
+        uint32_t now = plt_time_read_ms();
+        uint32_t idle_time = now - light_state_change_time;
+        uint32_t dirty_time = now - light_state_dirty_time;
+        if ((idle_time < LIGHT_STATE_STORE_QUIET_TIME) && (dirty_time < LIGHT_STATE_STORE_DELAY_MAX))
+        {
+            /* state changed again, wait for the rest of the quiet period */
+            plt_timer_change_period(light_state_store_timer,
+                                    MIN(LIGHT_STATE_STORE_QUIET_TIME - idle_time,
+                                        LIGHT_STATE_STORE_DELAY_MAX - dirty_time), 0);
+            return;
+        }
+    }
+    light_state_flush();
+}
+
+/**
+ * @brief start the quiet period of a new change, call it before marking the change
+ * @retval TRUE: the change will be written when the quiet period ends
+ * @retval FALSE: no timer, write the change now
+ */
+static bool light_storage_defer(void)
+{
+    uint32_t now = plt_time_read_ms();
+    if (!light_state_store_pending())
+    {
+        light_state_dirty_time = now;
+    }
+    light_state_change_time = now;
+
+    if (NULL == light_state_store_timer)
+    {
+        light_state_store_timer = plt_timer_create("store", LIGHT_STATE_STORE_QUIET_TIME, FALSE,
+                                                   LIGHT_STATE_STORE_TIMER_ID, light_state_store_timeout_cb);
+        if (NULL == light_state_store_timer)
+        {
+            return FALSE;
+        }
+    }
+    /* the timer is not restarted by every change, the callback checks the quiet period */
+    if (!plt_timer_is_active(light_state_store_timer))
+    {
+        plt_timer_change_period(light_state_store_timer, LIGHT_STATE_STORE_QUIET_TIME, 0);
+    }
+
+    return TRUE;
+}
+
 bool light_state_store(void)
 {
-    bool ret = TRUE;
     light_cw_t cw = light_get_cw_lightness();
     light_rgb_t rgb = light_get_rgb_lightness();
-    light_flash_light_state_t light_state = {cw.cold, cw.warm, rgb.red, rgb.green, rgb.blue};
-    ret = light_flash_write(LIGHT_FLASH_PARAM_TYPE_LIGHT_STATE, sizeof(light_flash_light_state_t),
-                            &light_state);
+    light_flash_light_state_t light_state = {{cw.cold, cw.warm, rgb.red, rgb.green, rgb.blue}, 0, 0};
+    light_state.flags = (PROV_NODE == mesh_node.node_state) ? LIGHT_FLASH_LIGHT_STATE_FLAG_BOOT : 0;
+
+    light_state_store_stat.request_count ++;
+    if (light_state_flash_valid && (light_state.flags == light_state_flash.flags) &&
+        (0 == memcmp(light_state.state, light_state_flash.state, sizeof(light_state.state))))
+    {
+        /* back to the persisted state, nothing to write */
+        light_state_store_stat.unchanged_count ++;
+        light_state_dirty = FALSE;
+        return TRUE;
+    }
+
+    if (light_state_dirty)
+    {
+        light_state_store_stat.coalesced_count ++;
+    }
+    bool deferred = light_storage_defer();
+    light_state_pending = light_state;
+    light_state_dirty = TRUE;
+    if (!deferred)
+    {
+        printe("light_state_store: create timer failed, store now");
+        return light_state_flush();
+    }
+
+    return TRUE;
+}
+
+bool light_state_flush(void)
+{
+    bool ret = TRUE;
+    if (light_state_dirty)
+    {
+        ret = light_flash_write(LIGHT_FLASH_PARAM_TYPE_LIGHT_STATE, sizeof(light_flash_light_state_t),
+                                &light_state_pending);
+        if (ret)
+        {
+            light_state_flash = light_state_pending;
+            light_state_flash_valid = TRUE;
+            light_state_dirty = FALSE;
+            light_state_store_stat.write_count ++;
+            light_state_store_stat.write_bytes += sizeof(light_flash_light_state_t);
+        }
+    }
+
+    if (0 != light_scene_dirty)
+    {
+        if (!light_scene_flash_valid)
+        {
+            /* records never written hold no valid scene, write the whole register once */
+            light_scene_dirty = (1 << LIGHT_FLASH_SCENE_NUM) - 1;
+        }
+        for (uint8_t index = 0; index < LIGHT_FLASH_SCENE_NUM; ++index)
+        {
+            if (0 == (light_scene_dirty & (1 << index)))
+            {
+                continue;
+            }
+            light_scene_records[index].scene_number = light_scene_memory[index].scene_number;
+            if (light_flash_scene_write(index, &light_scene_records[index]))
+            {
+                light_scene_dirty &= ~(1 << index);
+                light_state_store_stat.scene_write_count ++;
+                light_state_store_stat.write_bytes += sizeof(light_flash_scene_t);
+            }
+            else
+            {
+                ret = FALSE;
+            }
+        }
+        light_scene_flash_valid = (0 == light_scene_dirty);
+    }
+
+    if (NULL != light_state_store_timer)
+    {
+        if (light_state_store_pending())
+        {
+            /* write failed, retry after another quiet period */
+            plt_timer_change_period(light_state_store_timer, LIGHT_STATE_STORE_QUIET_TIME, 0);
+        }
+        else if (plt_timer_is_active(light_state_store_timer))
+        {
+            plt_timer_stop(light_state_store_timer, 0);
+        }
+    }
+
     return ret;
 }
 
+bool light_state_store_pending(void)
+{
+    return light_state_dirty || (0 != light_scene_dirty);
+}
+
+void light_state_store_stat_get(light_state_store_stat_t *pstat)
+{
+    *pstat = light_state_store_stat;
+}
+
+scene_storage_memory_t *light_scene_restore(const light_flash_scene_t *pdefaults,
+                                            uint8_t num_defaults)
+{
+    memset(light_scene_records, 0, sizeof(light_scene_records));
+    light_scene_dirty = 0;
+    light_scene_flash_valid = (PROV_NODE == mesh_node_state_restore()) &&
+                              light_flash_read(LIGHT_FLASH_PARAM_TYPE_SCENE, sizeof(light_scene_records),
+                                               light_scene_records);
+    if (!light_scene_flash_valid)
+    {
+        memset(light_scene_records, 0, sizeof(light_scene_records));
+        if (NULL != pdefaults)
+        {
+            memcpy(light_scene_records, pdefaults,
+                   MIN(num_defaults, LIGHT_FLASH_SCENE_NUM) * sizeof(light_flash_scene_t));
+        }
+    }
+
+    for (uint8_t index = 0; index < LIGHT_FLASH_SCENE_NUM; ++index)
+    {
+        light_scene_memory[index].scene_number = light_scene_records[index].scene_number;
+        light_scene_memory[index].pmemory = light_scene_records[index].state;
+    }
+
+    return light_scene_memory;
+}
+
+const void *light_scene_state_get(uint16_t scene_number)
+{
+    if (0 == scene_number)
+    {
+        return NULL;
+    }
+
+    for (uint8_t index = 0; index < LIGHT_FLASH_SCENE_NUM; ++index)
+    {
+        if (light_scene_memory[index].scene_number == scene_number)
+        {
+            return light_scene_memory[index].pmemory;
+        }
+    }
+
+    return NULL;
+}
+
+bool light_scene_store(const void *pmemory)
+{
+    uint32_t offset = (const uint8_t *)pmemory - (const uint8_t *)light_scene_records[0].state;
+    uint8_t index = offset / sizeof(light_flash_scene_t);
+    if ((index >= LIGHT_FLASH_SCENE_NUM) || (0 != offset % sizeof(light_flash_scene_t)))
+    {
+        printe("light_scene_store: invalid scene memory");
+        return FALSE;
+    }
+
+    if (0 != (light_scene_dirty & (1 << index)))
+    {
+        light_state_store_stat.coalesced_count ++;
+    }
+    bool deferred = light_storage_defer();
+    light_scene_dirty |= (1 << index);
+
+    return deferred ? TRUE : light_state_flush();
+}
+
+bool light_scene_delete(void)
+{
+    uint32_t deleted = 0;
+    for (uint8_t index = 0; index < LIGHT_FLASH_SCENE_NUM; ++index)
+    {
+        if (light_scene_memory[index].scene_number != light_scene_records[index].scene_number)
+        {
+            deleted |= (1 << index);
+        }
+    }
+
+    if (0 == (deleted & ~light_scene_dirty))
+    {
+        return TRUE;
+    }
+    bool deferred = light_storage_defer();
+    light_scene_dirty |= deleted;
+
+    return deferred ? TRUE : light_state_flush();
+}
+
 bool light_user_data_store(void)
 {
     return TRUE;
@@ -70,10 +373,7 @@ bool light_user_data_store(void)
 
 bool light_flash_restore(void)
 {
-    light_flash_power_on_count_t power_on_count = {.count = 0};
-    light_flash_read(LIGHT_FLASH_PARAM_TYPE_POWER_ON_COUNT, sizeof(light_flash_power_on_count_t),
-                     &power_on_count);
-    if (!light_power_on_count_check(power_on_count.count))
+    if (!light_power_on_count_check())
     {
         light_state_restore();
         light_user_data_restore();
@@ -15,6 +15,8 @@
 #define _LIGHT_STORAGE_APP_H_
 
 #include "platform_types.h"
+#include "scene.h"
+#include "dimmable_light.h"
 
 BEGIN_DECLS
 
@@ -23,6 +25,40 @@ BEGIN_DECLS
  * @{
  */
 
+/**
+ * @defgroup Light_Storage_Exported_Macros Light Storage Exported Macros
+ * @brief
+ * @{
+ */
+#define LIGHT_POWER_FAIL_MSG               120 //!< io message to flush light state on power fail
+/** @} */
+
+/**
+ * @defgroup Light_Storage_Exported_Types Light Storage Exported Types
+ * @brief
+ * @{
+ */
+typedef struct
+{
+    uint32_t request_count; //!< light_state_store invoke times
+    uint32_t unchanged_count; //!< requests equal to the state in flash
+    uint32_t coalesced_count; //!< requests merged into a pending write
+    uint32_t write_count; //!< light state writes to flash
+    uint32_t write_bytes; //!< bytes written to flash
+    uint32_t scene_write_count; //!< scene records written to flash
+} light_state_store_stat_t;
+
+typedef enum
+{
+    LIGHT_BOOT_PHASE_MAIN, //!< main entered
+    LIGHT_BOOT_PHASE_LIGHT_ON, //!< pwm channels driven, by the last state if restored early
+    LIGHT_BOOT_PHASE_BOARD_INIT, //!< board and drivers initialized
+    LIGHT_BOOT_PHASE_MESH_INIT, //!< mesh stack and models initialized, light state handed over
+    LIGHT_BOOT_PHASE_APP_TASK, //!< app task running
+    LIGHT_BOOT_PHASE_NUM,
+} light_boot_phase_t;
+/** @} */
+
 /**
  * @defgroup Light_Storage_Exported_Functions Light Storage Exported Functions
  * @brief
@@ -40,9 +76,93 @@ bool light_flash_restore(void);
  * @brief store light data to flash
  * @retval TRUE: store success
  * @retval FALSE: store fail
+ * @note the write is deferred until the state has been quiet for LIGHT_STATE_STORE_QUIET_TIME,
+ *       at most LIGHT_STATE_STORE_DELAY_MAX after the first change, a state equal to the one
+ *       in flash is not written
  */
 bool light_state_store(void);
 
+/**
+ * @brief write the pending light state and scenes to flash now
+ * @retval TRUE: store success or nothing pending
+ * @retval FALSE: store fail
+ * @note call it before power off, reboot or dlps
+ */
+bool light_state_flush(void);
+
+/**
+ * @brief check whether light state or scenes are waiting to be written
+ * @retval TRUE: state pending
+ * @retval FALSE: flash is up to date
+ */
+bool light_state_store_pending(void);
+
+/**
+ * @brief get light state store statistics
+ * @param[out] pstat: statistics
+ */
+void light_state_store_stat_get(light_state_store_stat_t *pstat);
+
+/**
+ * @brief drive the last light state before the mesh stack is initialized
+ * @retval TRUE: last state restored
+ * @retval FALSE: no state written by a provisioned node, or the power on count resets the node,
+ *                the light keeps the default output
+ * @note call it right after the light drivers are initialized, it reads the light state record
+ *       and the power on count only. light_flash_restore hands over later, it turns the light
+ *       back to the default output if the node turns out to be unprovisioned.
+ */
+bool light_state_early_restore(void);
+
+/**
+ * @brief record the time of a boot phase
+ * @param[in] phase: boot phase
+ */
+void light_boot_phase_mark(light_boot_phase_t phase);
+
+/**
+ * @brief get the boot phase timestamps
+ * @param[out] ptime_us: LIGHT_BOOT_PHASE_NUM timestamps of plt_time_read_us, 0 if the phase is not
+ *                       reached, the time to light is ptime_us[LIGHT_BOOT_PHASE_LIGHT_ON]
+ * @note the timestamps count from reset, they are valid if boot takes less than
+ *       PLT_TIME_READ_US_MAX_VALUE
+ */
+void light_boot_time_get(uint32_t *ptime_us);
+
+/**
+ * @brief restore scene register from flash
+ * @param[in] pdefaults: scenes used when flash holds no scene register
+ * @param[in] num_defaults: number of default scenes
+ * @return LIGHT_FLASH_SCENE_NUM scene storage memories, a memory is the state field of its
+ *         flash record, set them to scene server and scene setup server
+ */
+scene_storage_memory_t *light_scene_restore(const light_flash_scene_t *pdefaults,
+                                            uint8_t num_defaults);
+
+/**
+ * @brief get the state of a scene in the scene register
+ * @param[in] scene_number: scene number
+ * @return scene state, its layout is defined by the light type, NULL if the scene is not stored
+ */
+const void *light_scene_state_get(uint16_t scene_number);
+
+/**
+ * @brief store scene to flash after its state memory has been updated
+ * @param[in] pmemory: scene state memory
+ * @retval TRUE: store success
+ * @retval FALSE: store fail
+ * @note the write is deferred as light_state_store does
+ */
+bool light_scene_store(const void *pmemory);
+
+/**
+ * @brief store scene deletion to flash
+ * @retval TRUE: store success
+ * @retval FALSE: store fail
+ * @note the write is deferred as light_state_store does
+ */
+bool light_scene_delete(void);
+
 /**
  * @brief store user data to flash
  * @retval TRUE: store success
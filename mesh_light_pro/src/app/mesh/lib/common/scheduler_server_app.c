@@ -0,0 +1,561 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+* @file     scheduler_server_app.c
+* @brief    Source file for scheduler server application.
+* @details  Fires the scheduler register entries against the tai clock of time_server_app.
+* @author   bill
+* @date     2018-12-20
+* @version  v1.0
+* *************************************************************************************
+*/
+
+#include <string.h>
+#include "platform_diagnose.h"
+#include "platform_misc.h"
+#include "platform_os.h"
+#include "scheduler_server_app.h"
+#include "time_server_app.h"
+#include "scheduler.h"
+#include "generic_on_off.h"
+#include "scene.h"
+
+#define SCHEDULER_NUM                   16
+#define SCHEDULER_INDEX_NULL            0xff
+#define SCHEDULER_TIMER_ID              101
+/* longest wake-up period, keeps the tai clock rebased and the timer period in range */
+#define SCHEDULER_MAX_INTERVAL          3600000
+/* every year entries are searched this far ahead, 29 february on a given weekday may take 40 years */
+#define SCHEDULER_SEARCH_YEARS          40
+#define SCHEDULER_SECONDS_PER_DAY       86400
+#define SCHEDULER_ROLL_DAY_NONE         0xffffffff
+
+typedef struct
+{
+    scheduler_register_t reg;
+    uint8_t hour; //!< register hour with the random hour resolved
+    uint8_t minute; //!< register minute with the random minute resolved
+    uint8_t second; //!< register second with the random second resolved
+    uint32_t roll_day; //!< local day the random fields are resolved for
+    uint64_t fire_tai; //!< next fire time in tai seconds, 0 if the entry never fires
+} scheduler_entry_t;
+
+/* scheduler models */
+static mesh_model_info_t scheduler_server;
+static mesh_model_info_t scheduler_setup_server;
+static mesh_model_info_p scheduler_onoff_server;
+static mesh_model_info_p scheduler_scene_server;
+
+static scheduler_entry_t scheduler_entries[SCHEDULER_NUM];
+/* next-fire queue, binary min heap of entry indexes, one timer armed to the top */
+static uint8_t scheduler_heap[SCHEDULER_NUM];
+static uint8_t scheduler_heap_pos[SCHEDULER_NUM];
+static uint8_t scheduler_heap_size;
+static uint64_t scheduler_next_change; //!< tai seconds of the time change the timer waits for
+static plt_timer_t scheduler_timer;
+
+static bool scheduler_is_leap_year(uint32_t year)
+{
+    return ((0 == year % 4) && (0 != year % 100)) || (0 == year % 400);
+}
+
+static uint8_t scheduler_days_in_month(uint32_t year, uint8_t month)
+{
+    static const uint8_t days[12] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    return ((2 == month) && scheduler_is_leap_year(year)) ? 29 : days[month - 1];
+}
+
+/**
+ * @brief convert date to days since 2000-01-01
+ */
+static uint32_t scheduler_days_from_date(uint32_t year, uint8_t month, uint8_t day)
+{
+    /* years start at march, so the leap day is the last day of the year */
+    year -= (month <= 2);
+    uint32_t era = year / 400;
+    uint32_t year_of_era = year - era * 400;
+    uint32_t day_of_year = (153 * ((month > 2) ? (month - 3) : (month + 9)) + 2) / 5 + day - 1;
+    uint32_t day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 730425;
+}
+
+/**
+ * @brief convert days since 2000-01-01 to date
+ */
+static void scheduler_date_from_days(uint32_t days, uint32_t *pyear, uint8_t *pmonth,
+                                     uint8_t *pday)
+{
+    days += 730425;
+    uint32_t era = days / 146097;
+    uint32_t day_of_era = days - era * 146097;
+    uint32_t year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) /
+                           365;
+    uint32_t day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    uint32_t month_index = (5 * day_of_year + 2) / 153;
+    *pday = day_of_year - (153 * month_index + 2) / 5 + 1;
+    *pmonth = (month_index < 10) ? (month_index + 3) : (month_index - 9);
+    *pyear = year_of_era + era * 400 + (*pmonth <= 2);
+}
+
+/**
+ * @brief find the smallest value not less than from matching the register field
+ * @param[in] field: register value, limit means every, limit + 1 every 15, limit + 2 every 20
+ * @param[in] from: lower bound
+ * @param[in] limit: number of values
+ * @return matched value, -1 if none below limit
+ */
+static int32_t scheduler_field_next(uint8_t field, uint32_t from, uint32_t limit)
+{
+    uint32_t value;
+    if (field < limit)
+    {
+        value = (field >= from) ? field : limit;
+    }
+    else if (field == limit)
+    {
+        value = from;
+    }
+    else
+    {
+        uint32_t step = (field == limit + 1) ? 15 : 20;
+        value = (from + step - 1) / step * step;
+    }
+
+    return (value < limit) ? (int32_t)value : -1;
+}
+
+/**
+ * @brief find the first matching time of day not earlier than from
+ * @return seconds of the day, -1 if none left in the day
+ */
+static int32_t scheduler_time_of_day_next(const scheduler_entry_t *pentry, uint32_t from)
+{
+    int32_t hour = from / 3600;
+    int32_t minute = from / 60 % 60;
+    int32_t second = from % 60;
+    for (int32_t h = scheduler_field_next(pentry->hour, hour, 24); h >= 0;
+         h = scheduler_field_next(pentry->hour, h + 1, 24))
+    {
+        for (int32_t m = scheduler_field_next(pentry->minute, (h == hour) ? minute : 0, 60); m >= 0;
+             m = scheduler_field_next(pentry->minute, m + 1, 60))
+        {
+            int32_t s = scheduler_field_next(pentry->second,
+                                             ((h == hour) && (m == minute)) ? second : 0, 60);
+            if (s >= 0)
+            {
+                return h * 3600 + m * 60 + s;
+            }
+        }
+    }
+
+    return -1;
+}
+
+/**
+ * @brief find the first local time not earlier than from matching the entry
+ * @param[in] pentry: scheduler entry
+ * @param[in] from: local seconds since 2000-01-01
+ * @param[out] pnext: matched local seconds since 2000-01-01
+ * @retval TRUE: matched
+ * @retval FALSE: the entry never fires again
+ */
+static bool scheduler_next_local(const scheduler_entry_t *pentry, uint64_t from, uint64_t *pnext)
+{
+    const scheduler_register_t *preg = &pentry->reg;
+    if ((0 == preg->month) || (0 == preg->day_of_week))
+    {
+        return FALSE;
+    }
+
+    uint32_t from_days = from / SCHEDULER_SECONDS_PER_DAY;
+    uint32_t year;
+    uint8_t month;
+    uint8_t day;
+    scheduler_date_from_days(from_days, &year, &month, &day);
+    uint32_t last_year = (SCHEDULER_EVERY_YEAR == preg->year) ? (year + SCHEDULER_SEARCH_YEARS) :
+                         (uint32_t)(2000 + preg->year);
+    for (; year <= last_year; ++year, month = 1, day = 1)
+    {
+        if ((SCHEDULER_EVERY_YEAR != preg->year) && (year != last_year))
+        {
+            continue;
+        }
+
+        for (; month <= 12; ++month, day = 1)
+        {
+            if (0 == (preg->month & (1 << (month - 1))))
+            {
+                continue;
+            }
+
+            uint8_t first = day;
+            uint8_t last = scheduler_days_in_month(year, month);
+            if (SCHEDULER_EVERY_DAY != preg->day)
+            {
+                if ((preg->day < first) || (preg->day > last))
+                {
+                    continue;
+                }
+                first = last = preg->day;
+            }
+
+            for (uint8_t d = first; d <= last; ++d)
+            {
+                uint32_t days = scheduler_days_from_date(year, month, d);
+                /* 2000-01-01 is a saturday, bit 0 is monday */
+                if (0 == (preg->day_of_week & (1 << ((days + 5) % 7))))
+                {
+                    continue;
+                }
+
+                int32_t time_of_day = scheduler_time_of_day_next(pentry, (days == from_days) ?
+                                                                 (from % SCHEDULER_SECONDS_PER_DAY) : 0);
+                if (time_of_day >= 0)
+                {
+                    *pnext = (uint64_t)days * SCHEDULER_SECONDS_PER_DAY + time_of_day;
+                    return TRUE;
+                }
+            }
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief resolve the random fields, they stay the same for the whole day
+ */
+static void scheduler_roll(scheduler_entry_t *pentry, uint32_t day)
+{
+    const scheduler_register_t *preg = &pentry->reg;
+    uint8_t rand[3];
+    plt_rand(rand, sizeof(rand));
+    pentry->hour = (SCHEDULER_RANDOM_HOUR == preg->hour) ? (rand[0] % 24) : preg->hour;
+    pentry->minute = (SCHEDULER_RADOM_MINUTE == preg->minute) ? (rand[1] % 60) : preg->minute;
+    pentry->second = (SCHEDULER_RANDOM_SECOND == preg->second) ? (rand[2] % 60) : preg->second;
+    pentry->roll_day = day;
+}
+
+/**
+ * @brief compute the first fire time after now
+ * @return tai seconds, 0 if the entry never fires
+ */
+static uint64_t scheduler_fire_next(scheduler_entry_t *pentry, uint64_t now)
+{
+    const scheduler_register_t *preg = &pentry->reg;
+    if ((SCHEDULER_NO_ACTION == preg->action) ||
+        ((SCHEDULER_SCENE_RECALL == preg->action) && (SCHEDULER_NO_SCENE == preg->scene_number)))
+    {
+        return 0;
+    }
+
+    int32_t offset = time_server_app_local_offset(now);
+    int64_t from = (int64_t)now + offset + 1;
+    uint64_t next;
+    if (from < 0)
+    {
+        return 0;
+    }
+    if (from / SCHEDULER_SECONDS_PER_DAY != pentry->roll_day)
+    {
+        scheduler_roll(pentry, from / SCHEDULER_SECONDS_PER_DAY);
+    }
+    if (!scheduler_next_local(pentry, from, &next))
+    {
+        return 0;
+    }
+    if (next / SCHEDULER_SECONDS_PER_DAY != pentry->roll_day)
+    {
+        /* the day matches whatever the random fields are, roll them for that day */
+        scheduler_roll(pentry, next / SCHEDULER_SECONDS_PER_DAY);
+        scheduler_next_local(pentry, (uint64_t)pentry->roll_day * SCHEDULER_SECONDS_PER_DAY, &next);
+    }
+
+    /* a scheduled time zone or tai-utc delta change may take effect before the fire time */
+    uint64_t fire = next - time_server_app_local_offset(next - offset);
+    return MAX(fire, now + 1);
+}
+
+static bool scheduler_heap_less(uint8_t pos_a, uint8_t pos_b)
+{
+    return scheduler_entries[scheduler_heap[pos_a]].fire_tai <
+           scheduler_entries[scheduler_heap[pos_b]].fire_tai;
+}
+
+static void scheduler_heap_swap(uint8_t pos_a, uint8_t pos_b)
+{
+    uint8_t index = scheduler_heap[pos_a];
+    scheduler_heap[pos_a] = scheduler_heap[pos_b];
+    scheduler_heap[pos_b] = index;
+    scheduler_heap_pos[scheduler_heap[pos_a]] = pos_a;
+    scheduler_heap_pos[scheduler_heap[pos_b]] = pos_b;
+}
+
+static void scheduler_heap_sift_up(uint8_t pos)
+{
+    while ((pos > 0) && scheduler_heap_less(pos, (pos - 1) / 2))
+    {
+        scheduler_heap_swap(pos, (pos - 1) / 2);
+        pos = (pos - 1) / 2;
+    }
+}
+
+static void scheduler_heap_sift_down(uint8_t pos)
+{
+    for (;;)
+    {
+        uint8_t min = pos;
+        uint8_t child = 2 * pos + 1;
+        if ((child < scheduler_heap_size) && scheduler_heap_less(child, min))
+        {
+            min = child;
+        }
+        if ((child + 1 < scheduler_heap_size) && scheduler_heap_less(child + 1, min))
+        {
+            min = child + 1;
+        }
+        if (min == pos)
+        {
+            break;
+        }
+        scheduler_heap_swap(pos, min);
+        pos = min;
+    }
+}
+
+/**
+ * @brief move the entry to its place after its fire time has changed
+ */
+static void scheduler_heap_update(uint8_t index)
+{
+    uint8_t pos = scheduler_heap_pos[index];
+    if (0 == scheduler_entries[index].fire_tai)
+    {
+        if (SCHEDULER_INDEX_NULL != pos)
+        {
+            scheduler_heap_size --;
+            scheduler_heap_swap(pos, scheduler_heap_size);
+            scheduler_heap_pos[index] = SCHEDULER_INDEX_NULL;
+            if (pos < scheduler_heap_size)
+            {
+                uint8_t moved = scheduler_heap[pos];
+                scheduler_heap_sift_up(pos);
+                scheduler_heap_sift_down(scheduler_heap_pos[moved]);
+            }
+        }
+        return;
+    }
+
+    if (SCHEDULER_INDEX_NULL == pos)
+    {
+        pos = scheduler_heap_size ++;
+        scheduler_heap[pos] = index;
+        scheduler_heap_pos[index] = pos;
+    }
+    scheduler_heap_sift_up(pos);
+    scheduler_heap_sift_down(scheduler_heap_pos[index]);
+}
+
+/**
+ * @brief recompute all the fire times, used when the local time has moved
+ * @param[in] now: tai seconds, 0 if the time is unknown
+ */
+static void scheduler_queue_build(uint64_t now)
+{
+    scheduler_heap_size = 0;
+    for (uint8_t index = 0; index < SCHEDULER_NUM; ++index)
+    {
+        scheduler_entries[index].fire_tai = (0 == now) ? 0 : scheduler_fire_next(
+                                                &scheduler_entries[index], now);
+        scheduler_heap_pos[index] = SCHEDULER_INDEX_NULL;
+        if (0 != scheduler_entries[index].fire_tai)
+        {
+            scheduler_heap[scheduler_heap_size] = index;
+            scheduler_heap_pos[index] = scheduler_heap_size;
+            scheduler_heap_size ++;
+        }
+    }
+
+    for (uint8_t pos = scheduler_heap_size / 2; pos > 0; --pos)
+    {
+        scheduler_heap_sift_down(pos - 1);
+    }
+}
+
+/**
+ * @brief arm the timer to the first fire time or time change, whichever comes first
+ */
+static void scheduler_arm(uint64_t now_ms)
+{
+    if (NULL == scheduler_timer)
+    {
+        return;
+    }
+
+    scheduler_next_change = time_server_app_next_change();
+    if ((0 == scheduler_heap_size) && (0 == scheduler_next_change))
+    {
+        if (plt_timer_is_active(scheduler_timer))
+        {
+            plt_timer_stop(scheduler_timer, 0);
+        }
+        return;
+    }
+
+    uint64_t wake_ms = (0 == scheduler_heap_size) ? (scheduler_next_change * 1000) :
+                       (scheduler_entries[scheduler_heap[0]].fire_tai * 1000);
+    if (0 != scheduler_next_change)
+    {
+        wake_ms = MIN(wake_ms, scheduler_next_change * 1000);
+    }
+    uint64_t period = (wake_ms > now_ms) ? (wake_ms - now_ms) : 1;
+    plt_timer_change_period(scheduler_timer, (uint32_t)MIN(period, SCHEDULER_MAX_INTERVAL), 0);
+}
+
+static void scheduler_execute(const scheduler_entry_t *pentry)
+{
+    const scheduler_register_t *preg = &pentry->reg;
+    generic_transition_time_t trans_time = {preg->num_steps, preg->step_resolution};
+    printi("scheduler_execute: index %d, action %d, scene %d", preg->index, preg->action,
+           preg->scene_number);
+    switch (preg->action)
+    {
+    case SCHEDULER_TURN_OFF:
+    case SCHEDULER_TURN_ON:
+        if (NULL != scheduler_onoff_server)
+        {
+            generic_on_off_server_execute(scheduler_onoff_server,
+                                          (SCHEDULER_TURN_ON == preg->action) ? GENERIC_ON : GENERIC_OFF,
+                                          trans_time);
+        }
+        break;
+    case SCHEDULER_SCENE_RECALL:
+        if ((NULL == scheduler_scene_server) ||
+            !scene_server_execute(scheduler_scene_server, preg->scene_number, trans_time))
+        {
+            printw("scheduler_execute: scene %d recall failed", preg->scene_number);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void scheduler_timeout_handle(void *ptimer)
+{
+    UNUSED(ptimer);
+    uint64_t now_ms;
+    if (!time_server_app_now(&now_ms))
+    {
+        return;
+    }
+
+    uint64_t now = now_ms / 1000;
+    while ((scheduler_heap_size > 0) && (scheduler_entries[scheduler_heap[0]].fire_tai <= now))
+    {
+        uint8_t index = scheduler_heap[0];
+        scheduler_execute(&scheduler_entries[index]);
+        scheduler_entries[index].fire_tai = scheduler_fire_next(&scheduler_entries[index], now);
+        scheduler_heap_update(index);
+    }
+
+    if ((0 != scheduler_next_change) && (now >= scheduler_next_change))
+    {
+        /* the local time offset has changed */
+        scheduler_queue_build(now);
+    }
+
+    scheduler_arm(now_ms);
+}
+
+void scheduler_server_app_time_changed(void)
+{
+    uint64_t now_ms;
+    if (!time_server_app_now(&now_ms))
+    {
+        scheduler_queue_build(0);
+        scheduler_arm(0);
+        return;
+    }
+
+    scheduler_queue_build(now_ms / 1000);
+    scheduler_arm(now_ms);
+}
+
+static int32_t scheduler_server_data(const mesh_model_info_p pmodel_info, uint32_t type,
+                                     void *pargs)
+{
+    switch (type)
+    {
+    case SCHEDULER_SERVER_GET:
+        {
+            scheduler_server_get_t *pdata = pargs;
+            pdata->schedulers = 0;
+            for (uint8_t index = 0; index < SCHEDULER_NUM; ++index)
+            {
+                if (SCHEDULER_NO_ACTION != scheduler_entries[index].reg.action)
+                {
+                    pdata->schedulers |= (1 << index);
+                }
+            }
+        }
+        break;
+    case SCHEDULER_SERVER_GET_ACTION:
+        {
+            scheduler_server_get_action_t *pdata = pargs;
+            pdata->scheduler = scheduler_entries[pdata->index].reg;
+        }
+        break;
+    case SCHEDULER_SERVER_SET_ACTION:
+        {
+            scheduler_server_set_action_t *pdata = pargs;
+            uint8_t index = pdata->index;
+            uint64_t now_ms;
+            scheduler_entries[index].reg = *pdata;
+            scheduler_entries[index].roll_day = SCHEDULER_ROLL_DAY_NONE;
+            if (time_server_app_now(&now_ms))
+            {
+                scheduler_entries[index].fire_tai = scheduler_fire_next(&scheduler_entries[index],
+                                                                        now_ms / 1000);
+                scheduler_heap_update(index);
+                scheduler_arm(now_ms);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+
+    return 0;
+}
+
+void scheduler_server_models_init(uint8_t element_index, mesh_model_info_p ponoff_server,
+                                  mesh_model_info_p pscene_server)
+{
+    for (uint8_t index = 0; index < SCHEDULER_NUM; ++index)
+    {
+        memset(&scheduler_entries[index], 0, sizeof(scheduler_entry_t));
+        scheduler_entries[index].reg.index = index;
+        scheduler_entries[index].reg.action = SCHEDULER_NO_ACTION;
+        scheduler_entries[index].roll_day = SCHEDULER_ROLL_DAY_NONE;
+        scheduler_heap_pos[index] = SCHEDULER_INDEX_NULL;
+    }
+    scheduler_heap_size = 0;
+    scheduler_onoff_server = ponoff_server;
+    scheduler_scene_server = pscene_server;
+
+    scheduler_timer = plt_timer_create("scheduler", SCHEDULER_MAX_INTERVAL, FALSE,
+                                       SCHEDULER_TIMER_ID, scheduler_timeout_handle);
+    if (NULL == scheduler_timer)
+    {
+        printe("scheduler_server_models_init: allocate scheduler timer failed!");
+    }
+    time_server_app_reg_change_cb(scheduler_server_app_time_changed);
+
+    scheduler_server.model_data_cb = scheduler_server_data;
+    scheduler_server_reg(element_index, &scheduler_server);
+
+    scheduler_setup_server.model_data_cb = scheduler_server_data;
+    scheduler_setup_server_reg(element_index, &scheduler_setup_server);
+}
@@ -0,0 +1,53 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+* @file     scheduler_server_app.h
+* @brief    Head file for scheduler server application.
+* @details  Data structs and external functions declaration.
+* @author   bill
+* @date     2018-12-20
+* @version  v1.0
+* *************************************************************************************
+*/
+
+#ifndef _SCHEDULER_SERVER_APP_H_
+#define _SCHEDULER_SERVER_APP_H_
+
+#include "platform_types.h"
+#include "mesh_api.h"
+
+BEGIN_DECLS
+
+/**
+ * @addtogroup SCHEDULER_SERVER_APP
+ * @{
+ */
+
+/**
+ * @defgroup Scheduler_Server_App_Exported_Functions Scheduler Server App Exported Functions
+ * @brief
+ * @{
+ */
+/**
+ * @brief initialize scheduler server models
+ * @param[in] element_index: model element index
+ * @param[in] ponoff_server: generic on off server that executes the turn on/off actions
+ * @param[in] pscene_server: scene server that executes the scene recall actions, NULL if none
+ * @note the schedules fire against the tai clock of time_server_app, register it as well
+ */
+void scheduler_server_models_init(uint8_t element_index, mesh_model_info_p ponoff_server,
+                                  mesh_model_info_p pscene_server);
+
+/**
+ * @brief recompute all the schedules
+ * @note call it when the tai clock, time zone or tai-utc delta has changed
+ */
+void scheduler_server_app_time_changed(void);
+/** @} */
+/** @} */
+
+END_DECLS
+
+#endif /** _SCHEDULER_SERVER_APP_H_ */
+
@@ -0,0 +1,237 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+* @file     time_server_app.c
+* @brief    Source file for time server application.
+* @details  Keeps the tai clock set by the time messages on top of plt_time_read_ms.
+* @author   bill
+* @date     2018-12-20
+* @version  v1.0
+* *************************************************************************************
+*/
+
+#include <string.h>
+#include "mesh_api.h"
+#include "time_model.h"
+#include "time_server_app.h"
+
+/* time models */
+static mesh_model_info_t time_server;
+static mesh_model_info_t time_setup_server;
+
+static bool time_known;
+static uint64_t time_base_tai_ms; //!< tai time at time_base_tick
+static uint32_t time_base_tick;
+static uint8_t time_uncertainty;
+static bool time_authority;
+static time_role_t time_role;
+static uint16_t time_tai_utc_delta_current = 0xff;
+static uint16_t time_tai_utc_delta_new = 0xff;
+static uint64_t time_tai_of_delta_change;
+static uint8_t time_zone_offset_current = 0x40;
+static uint8_t time_zone_offset_new = 0x40;
+static uint64_t time_tai_of_zone_change;
+static time_server_app_change_cb_t time_change_cb;
+
+static uint64_t time_tai_seconds_get(const uint8_t tai_seconds[5])
+{
+    return ((uint64_t)tai_seconds[4] << 32) | LE_EXTRN2DWORD(tai_seconds);
+}
+
+static void time_tai_seconds_put(uint8_t tai_seconds[5], uint64_t seconds)
+{
+    LE_DWORD2EXTRN(tai_seconds, (uint32_t)seconds);
+    tai_seconds[4] = (uint8_t)(seconds >> 32);
+}
+
+/**
+ * @brief apply the scheduled changes whose tai time has come
+ */
+static void time_changes_apply(uint64_t tai_seconds)
+{
+    if ((0 != time_tai_of_delta_change) && (tai_seconds >= time_tai_of_delta_change))
+    {
+        time_tai_utc_delta_current = time_tai_utc_delta_new;
+        time_tai_of_delta_change = 0;
+    }
+    if ((0 != time_tai_of_zone_change) && (tai_seconds >= time_tai_of_zone_change))
+    {
+        time_zone_offset_current = time_zone_offset_new;
+        time_tai_of_zone_change = 0;
+    }
+}
+
+bool time_server_app_now(uint64_t *ptai_ms)
+{
+    if (!time_known)
+    {
+        return FALSE;
+    }
+
+    /* rebase on every read, so the 32 bit tick never wraps between two reads */
+    uint32_t tick = plt_time_read_ms();
+    time_base_tai_ms += (uint32_t)(tick - time_base_tick);
+    time_base_tick = tick;
+    time_changes_apply(time_base_tai_ms / 1000);
+    *ptai_ms = time_base_tai_ms;
+    return TRUE;
+}
+
+int32_t time_server_app_local_offset(uint64_t tai_seconds)
+{
+    uint16_t tai_utc_delta = time_tai_utc_delta_current;
+    uint8_t zone_offset = time_zone_offset_current;
+    if ((0 != time_tai_of_delta_change) && (tai_seconds >= time_tai_of_delta_change))
+    {
+        tai_utc_delta = time_tai_utc_delta_new;
+    }
+    if ((0 != time_tai_of_zone_change) && (tai_seconds >= time_tai_of_zone_change))
+    {
+        zone_offset = time_zone_offset_new;
+    }
+
+    return (int32_t)time_zone_offset_convert(zone_offset) * 15 * 60 -
+           tai_utc_delta_convert(tai_utc_delta);
+}
+
+uint64_t time_server_app_next_change(void)
+{
+    if (0 == time_tai_of_delta_change)
+    {
+        return time_tai_of_zone_change;
+    }
+    if (0 == time_tai_of_zone_change)
+    {
+        return time_tai_of_delta_change;
+    }
+    return MIN(time_tai_of_delta_change, time_tai_of_zone_change);
+}
+
+void time_server_app_reg_change_cb(time_server_app_change_cb_t pf)
+{
+    time_change_cb = pf;
+}
+
+static void time_set(const uint8_t tai_seconds[5], uint8_t subsecond, uint8_t uncertainty,
+                     uint16_t tai_utc_delta, uint8_t time_zone_offset)
+{
+    uint64_t seconds = time_tai_seconds_get(tai_seconds);
+    /* 0 tai seconds means the time is unknown */
+    time_known = (0 != seconds);
+    time_base_tai_ms = seconds * 1000 + (subsecond * 1000 >> 8);
+    time_base_tick = plt_time_read_ms();
+    time_uncertainty = uncertainty;
+    time_tai_utc_delta_current = tai_utc_delta;
+    time_zone_offset_current = time_zone_offset;
+    printi("time_set: tai %d s, delta %d, zone %d", (uint32_t)seconds,
+           tai_utc_delta_convert(tai_utc_delta), time_zone_offset_convert(time_zone_offset));
+}
+
+static int32_t time_server_data(const mesh_model_info_p pmodel_info, uint32_t type, void *pargs)
+{
+    bool changed = FALSE;
+    switch (type)
+    {
+    case TIME_SERVER_GET:
+        {
+            time_server_get_t *pdata = pargs;
+            uint64_t tai_ms;
+            memset(pdata, 0, sizeof(time_server_get_t));
+            if (time_server_app_now(&tai_ms))
+            {
+                time_tai_seconds_put(pdata->tai_seconds, tai_ms / 1000);
+                pdata->subsecond = (tai_ms % 1000) * 256 / 1000;
+                pdata->uncertainty = time_uncertainty;
+                pdata->time_authority = time_authority;
+                pdata->tai_utc_delta = time_tai_utc_delta_current;
+                pdata->time_zone_offset = time_zone_offset_current;
+            }
+        }
+        break;
+    case TIME_SERVER_GET_ROLE:
+        {
+            time_server_get_role_t *pdata = pargs;
+            pdata->role = time_role;
+        }
+        break;
+    case TIME_SERVER_GET_ZONE:
+        {
+            time_server_get_zone_t *pdata = pargs;
+            pdata->time_zone_offset_current = time_zone_offset_current;
+            pdata->time_zone_offset_new = time_zone_offset_new;
+            time_tai_seconds_put(pdata->tai_of_zone_change, time_tai_of_zone_change);
+        }
+        break;
+    case TIME_SERVER_GET_TAI_UTC_DELTA:
+        {
+            time_server_get_tai_utc_delta_t *pdata = pargs;
+            pdata->tai_utc_delta_current = time_tai_utc_delta_current;
+            pdata->tai_utc_delta_new = time_tai_utc_delta_new;
+            time_tai_seconds_put(pdata->tai_of_delta_change, time_tai_of_delta_change);
+        }
+        break;
+    case TIME_SERVER_SET:
+        {
+            time_server_set_t *pdata = pargs;
+            time_set(pdata->tai_seconds, pdata->subsecond, pdata->uncertainty, pdata->tai_utc_delta,
+                     pdata->time_zone_offset);
+            time_authority = pdata->time_authority;
+            changed = TRUE;
+        }
+        break;
+    case TIME_SERVER_SET_ROLE:
+        {
+            time_server_set_role_t *pdata = pargs;
+            time_role = pdata->role;
+        }
+        break;
+    case TIME_SERVER_STATUS_SET:
+        {
+            time_server_status_set_t *pdata = pargs;
+            time_set(pdata->tai_seconds, pdata->subsecond, pdata->uncertainty, pdata->tai_utc_delta,
+                     pdata->time_zone_offset);
+            changed = TRUE;
+        }
+        break;
+    case TIME_SERVER_SET_ZONE:
+        {
+            time_server_set_zone_t *pdata = pargs;
+            time_zone_offset_new = pdata->time_zone_offset_new;
+            time_tai_of_zone_change = time_tai_seconds_get(pdata->tai_of_zone_change);
+            changed = TRUE;
+        }
+        break;
+    case TIME_SERVER_SET_TAI_UTC_DELTA:
+        {
+            time_server_set_tai_utc_delta_t *pdata = pargs;
+            time_tai_utc_delta_new = pdata->tai_utc_delta_new;
+            time_tai_of_delta_change = time_tai_seconds_get(pdata->tai_of_delta_change);
+            changed = TRUE;
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (changed)
+    {
+        uint64_t tai_ms;
+        if (time_server_app_now(&tai_ms) && (NULL != time_change_cb))
+        {
+            time_change_cb();
+        }
+    }
+
+    return 0;
+}
+
+void time_server_models_init(uint8_t element_index)
+{
+    time_server.model_data_cb = time_server_data;
+    time_server_reg(element_index, &time_server);
+
+    time_setup_server.model_data_cb = time_server_data;
+    time_setup_server_reg(element_index, &time_setup_server);
+}
+
@@ -0,0 +1,80 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+* @file     time_server_app.h
+* @brief    Head file for time server application.
+* @details  Data structs and external functions declaration.
+* @author   bill
+* @date     2018-12-20
+* @version  v1.0
+* *************************************************************************************
+*/
+
+#ifndef _TIME_SERVER_APP_H_
+#define _TIME_SERVER_APP_H_
+
+#include "platform_types.h"
+
+BEGIN_DECLS
+
+/**
+ * @addtogroup TIME_SERVER_APP
+ * @{
+ */
+
+/**
+ * @defgroup Time_Server_App_Exported_Types Time Server App Exported Types
+ * @brief
+ * @{
+ */
+/** called when the time, time zone or tai-utc delta is changed by a message */
+typedef void (*time_server_app_change_cb_t)(void);
+/** @} */
+
+/**
+ * @defgroup Time_Server_App_Exported_Functions Time Server App Exported Functions
+ * @brief
+ * @{
+ */
+/**
+ * @brief initialize time server models
+ * @param[in] element_index: model element index
+ */
+void time_server_models_init(uint8_t element_index);
+
+/**
+ * @brief get current tai time
+ * @param[out] ptai_ms: milliseconds since 2000-01-01T00:00:00 TAI
+ * @retval TRUE: time is known
+ * @retval FALSE: time is not set yet
+ * @note the clock follows plt_time_read_ms, call it at least once every 49 days
+ */
+bool time_server_app_now(uint64_t *ptai_ms);
+
+/**
+ * @brief get the offset from tai to local time
+ * @param[in] tai_seconds: tai time the offset applies to
+ * @return local time - tai time, in seconds
+ * @note the scheduled tai-utc delta and time zone changes take effect at their tai time
+ */
+int32_t time_server_app_local_offset(uint64_t tai_seconds);
+
+/**
+ * @brief get the next scheduled tai-utc delta or time zone change
+ * @return tai seconds of the change, 0 if none
+ */
+uint64_t time_server_app_next_change(void);
+
+/**
+ * @brief register time change callback
+ * @param[in] pf: callback
+ */
+void time_server_app_reg_change_cb(time_server_app_change_cb_t pf);
+/** @} */
+/** @} */
+
+END_DECLS
+
+#endif /** _TIME_SERVER_APP_H_ */
+
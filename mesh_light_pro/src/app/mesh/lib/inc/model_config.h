@@ -17,12 +17,28 @@
 /** set this value to 1 if enable delay execution module */
 #define MODEL_ENABLE_DELAY_EXECUTION                       0
 
+/** maximum delayed model messages pending at the same time, range: 1 ~ 254 */
+#ifndef MODEL_DELAY_EXECUTION_NUM_MAX
+#define MODEL_DELAY_EXECUTION_NUM_MAX                      16
+#endif
+
 /** set this value to 1 if need to notify application when user stop transition */
 #define MODEL_ENABLE_USER_STOP_TRANSITION_NOTIFICATION     0
 
 /** set this value to 1 if need to notify model when user stop delay execution */
 #define MODEL_ENABLE_USER_STOP_DELAY_NOTIFICATION          0
 
+/** maximum model state transitions running at the same time, range: 1 ~ 254 */
+#ifndef MODEL_TRANSITION_NUM_MAX
+#define MODEL_TRANSITION_NUM_MAX                           16
+#endif
+
+/** hash buckets of the scene register index, power of 2 and bigger than the number of scenes,
+    range: 2 ~ 256 */
+#ifndef MODEL_SCENE_INDEX_SIZE
+#define MODEL_SCENE_INDEX_SIZE                             32
+#endif
+
 /** do not modify this field unless you really want to use model functions in different threads */
 #define MODEL_ENABLE_MULTI_THREAD                          0
 
@@ -48,6 +48,22 @@ BEGIN_DECLS
 #define MESH_MODEL_ALI_VENDOR                           0x000001A8
 /** @} */
 
+/**
+ * @defgroup ALI_ATTR_TYPE Attribute Type
+ * @brief Attribute types carried by the vendor messages, values are little endian
+ * @{
+ */
+#define ALI_ATTR_TYPE_ON_OFF                            0x0100 //!< 1 byte, 0 off, 1 on
+#define ALI_ATTR_TYPE_LIGHTNESS                         0x0121 //!< 2 bytes, light lightness actual
+#define ALI_ATTR_TYPE_TEMPERATURE                       0x0122 //!< 2 bytes, kelvin
+#define ALI_ATTR_TYPE_HSL                               0x0123 //!< 6 bytes, lightness, hue, saturation
+#define ALI_ATTR_TYPE_SCENE_MODE                        0xF004 //!< 2 bytes, scene number
+
+#define ALI_ATTR_HEADER_SIZE                            4 //!< type and length
+#define ALI_ATTR_VALUE_MAX_LEN                          8 //!< longest value reported by the server
+#define ALI_ATTR_MAX_NUM                                8 //!< attributes in one message
+/** @} */
+
 /**
  * @defgroup ALI_MESH_MSG Mesh Msg
  * @brief Mesh message types used by models
@@ -59,6 +75,7 @@ enum
 } _SHORT_ENUM_;
 typedef uint16_t ali_msg_type_t;
 
+/** get carries one or more attribute types */
 typedef struct
 {
     uint8_t opcode[ACCESS_OPCODE_SIZE(MESH_MSG_ALI_GET)];
@@ -66,6 +83,7 @@ typedef struct
     ali_msg_type_t type;
 } _PACKED_ ali_get_t;
 
+/** set and stat carry one or more attributes, each one is type, len and value */
 typedef struct
 {
     uint8_t opcode[ACCESS_OPCODE_SIZE(MESH_MSG_ALI_SET)];
@@ -166,12 +184,90 @@ typedef struct
 } _PACKED_ ali_ota_stat_t;
 /** @} */
 
+/**
+ * @defgroup ALI_SERVER_DATA Server Data
+ * @brief Data types and structure used by data process callback
+ * @{
+ */
+#define ALI_SERVER_GET                                  0 //!< @ref ali_server_get_t
+#define ALI_SERVER_SET                                  1 //!< @ref ali_server_set_t
+
+/** attribute parsed from a message, the value is not copied */
+typedef struct
+{
+    ali_msg_type_t type;
+    uint16_t len;
+    const uint8_t *pvalue;
+} ali_attr_t;
+
+typedef struct
+{
+    ali_msg_type_t type;
+    uint16_t len; //!< 0 if the type is not supported
+    uint8_t value[ALI_ATTR_VALUE_MAX_LEN];
+} ali_server_get_t;
+
+/** all attributes of one set, the callback applies them as one light update and returns a
+ *  negative value to reject the whole set */
+typedef struct
+{
+    uint8_t tid;
+    bool ack; //!< the present values are sent back to the source
+    uint8_t num;
+    const ali_attr_t *pattrs;
+} ali_server_set_t;
+/** @} */
+
 /**
  * @defgroup ALI_SERVER_API Server API
  * @brief Functions declaration
  * @{
  */
 
+/**
+ * @brief register ali vendor server
+ * @param[in] element_index: element index that model registered to
+ * @param[in] pmodel_info: pointer to ali vendor server model context
+ * @retval TRUE: register success
+ * @retval FALSE: register failed
+ */
+bool ali_server_reg(uint8_t element_index, mesh_model_info_p pmodel_info);
+
+/**
+ * @brief parse the attributes of a message
+ * @param[in] pdata: first attribute
+ * @param[in] len: length of all attributes
+ * @param[out] pattrs: attributes, the values point into pdata
+ * @param[in,out] pnum: size of pattrs, number of attributes parsed
+ * @retval TRUE: all attributes parsed
+ * @retval FALSE: no attribute, an attribute exceeds the message or pattrs is full
+ */
+bool ali_attrs_parse(const uint8_t *pdata, uint16_t len, ali_attr_t *pattrs, uint8_t *pnum);
+
+/**
+ * @brief send the present values of attributes in one stat
+ * @param[in] pmodel_info: pointer to ali vendor server model context
+ * @param[in] dst: destination, 0 to publish
+ * @param[in] app_key_index: app key index
+ * @param[in] tid: transaction id
+ * @param[in] ptypes: attribute types
+ * @param[in] num: number of attribute types
+ * @return send status
+ * @note types not supported by the model data callback are left out
+ */
+mesh_msg_send_cause_t ali_stat(const mesh_model_info_p pmodel_info, uint16_t dst,
+                               uint16_t app_key_index, uint8_t tid, const ali_msg_type_t *ptypes,
+                               uint8_t num);
+
+/**
+ * @brief publish the present values of attributes in one stat
+ * @param[in] pmodel_info: pointer to ali vendor server model context
+ * @param[in] ptypes: attribute types
+ * @param[in] num: number of attribute types
+ * @return send status
+ */
+mesh_msg_send_cause_t ali_publish(const mesh_model_info_p pmodel_info, const ali_msg_type_t *ptypes,
+                                  uint8_t num);
 /** @} */
 /** @} */
 
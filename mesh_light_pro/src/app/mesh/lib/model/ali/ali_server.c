@@ -14,3 +14,219 @@
 /* Add Includes here */
 #include <string.h>
 #include "trace.h"
+#include "ali.h"
+
+#define ALI_STAT_MAX_LEN                    (MEMBER_OFFSET(ali_stat_t, type) + ALI_ATTR_MAX_NUM * \
+                                             (ALI_ATTR_HEADER_SIZE + ALI_ATTR_VALUE_MAX_LEN))
+
+typedef struct
+{
+    uint8_t tid; //!< transaction id of the published stat
+} ali_server_info_t;
+
+/* attributes published periodically, the ones not supported are left out */
+static const ali_msg_type_t ali_pub_types[] =
+{
+    ALI_ATTR_TYPE_ON_OFF,
+    ALI_ATTR_TYPE_LIGHTNESS,
+    ALI_ATTR_TYPE_TEMPERATURE,
+    ALI_ATTR_TYPE_HSL,
+};
+
+bool ali_attrs_parse(const uint8_t *pdata, uint16_t len, ali_attr_t *pattrs, uint8_t *pnum)
+{
+    uint8_t num = 0;
+    while (len > 0)
+    {
+        if ((len < ALI_ATTR_HEADER_SIZE) || (num >= *pnum))
+        {
+            return FALSE;
+        }
+
+        uint16_t value_len = LE_EXTRN2WORD(pdata + 2);
+        if (value_len > len - ALI_ATTR_HEADER_SIZE)
+        {
+            return FALSE;
+        }
+        pattrs[num].type = LE_EXTRN2WORD(pdata);
+        pattrs[num].len = value_len;
+        pattrs[num].pvalue = pdata + ALI_ATTR_HEADER_SIZE;
+        num ++;
+
+        pdata += ALI_ATTR_HEADER_SIZE + value_len;
+        len -= ALI_ATTR_HEADER_SIZE + value_len;
+    }
+
+    *pnum = num;
+    return (num > 0);
+}
+
+mesh_msg_send_cause_t ali_stat(const mesh_model_info_p pmodel_info, uint16_t dst,
+                               uint16_t app_key_index, uint8_t tid, const ali_msg_type_t *ptypes,
+                               uint8_t num)
+{
+    uint8_t msg[ALI_STAT_MAX_LEN];
+    ACCESS_OPCODE_BYTE(msg, MESH_MSG_ALI_STAT);
+    msg[MEMBER_OFFSET(ali_stat_t, tid)] = tid;
+    uint16_t msg_len = MEMBER_OFFSET(ali_stat_t, type);
+
+    num = MIN(num, ALI_ATTR_MAX_NUM);
+    for (uint8_t index = 0; index < num; ++index)
+    {
+        ali_server_get_t get_data;
+        get_data.type = ptypes[index];
+        get_data.len = 0;
+        if (NULL != pmodel_info->model_data_cb)
+        {
+            pmodel_info->model_data_cb(pmodel_info, ALI_SERVER_GET, &get_data);
+        }
+        if ((0 == get_data.len) || (get_data.len > ALI_ATTR_VALUE_MAX_LEN))
+        {
+            continue;
+        }
+
+        LE_WORD2EXTRN(msg + msg_len, get_data.type);
+        LE_WORD2EXTRN(msg + msg_len + 2, get_data.len);
+        memcpy(msg + msg_len + ALI_ATTR_HEADER_SIZE, get_data.value, get_data.len);
+        msg_len += ALI_ATTR_HEADER_SIZE + get_data.len;
+    }
+
+    if (MEMBER_OFFSET(ali_stat_t, type) == msg_len)
+    {
+        return MESH_MSG_SEND_CAUSE_INVALID_ACCESS_PARAMETER;
+    }
+
+    mesh_msg_t mesh_msg;
+    mesh_msg.pmodel_info = pmodel_info;
+    access_cfg(&mesh_msg);
+    mesh_msg.pbuffer = msg;
+    mesh_msg.msg_len = msg_len;
+    if (0 != dst)
+    {
+        mesh_msg.dst = dst;
+        mesh_msg.app_key_index = app_key_index;
+    }
+    return access_send(&mesh_msg);
+}
+
+mesh_msg_send_cause_t ali_publish(const mesh_model_info_p pmodel_info, const ali_msg_type_t *ptypes,
+                                  uint8_t num)
+{
+    mesh_msg_send_cause_t ret = MESH_MSG_SEND_CAUSE_INVALID_DST;
+    if (mesh_model_pub_check(pmodel_info))
+    {
+        ali_server_info_t *pinfo = pmodel_info->pargs;
+        pinfo->tid ++;
+        ret = ali_stat(pmodel_info, 0, 0, pinfo->tid, ptypes, num);
+    }
+
+    return ret;
+}
+
+/**
+ * @brief default ali vendor server receive function
+ * @param[in] pmesh_msg: received mesh message
+ * @return process result
+ */
+static bool ali_server_receive(mesh_msg_p pmesh_msg)
+{
+    bool ret = TRUE;
+    uint8_t *pbuffer = pmesh_msg->pbuffer + pmesh_msg->msg_offset;
+    mesh_model_info_p pmodel_info = pmesh_msg->pmodel_info;
+
+    switch (pmesh_msg->access_opcode)
+    {
+    case MESH_MSG_ALI_GET:
+        {
+            ali_get_t *pmsg = (ali_get_t *)pbuffer;
+            uint16_t len = pmesh_msg->msg_len - MEMBER_OFFSET(ali_get_t, type);
+            if ((pmesh_msg->msg_len >= sizeof(ali_get_t)) && (0 == (len & 1)))
+            {
+                ali_msg_type_t types[ALI_ATTR_MAX_NUM];
+                uint8_t num = MIN(len / 2, ALI_ATTR_MAX_NUM);
+                const uint8_t *ptype = pbuffer + MEMBER_OFFSET(ali_get_t, type);
+                for (uint8_t index = 0; index < num; ++index)
+                {
+                    types[index] = LE_EXTRN2WORD(ptype + 2 * index);
+                }
+                ali_stat(pmodel_info, pmesh_msg->src, pmesh_msg->app_key_index, pmsg->tid, types, num);
+            }
+        }
+        break;
+    case MESH_MSG_ALI_SET:
+    case MESH_MSG_ALI_SET_UNACK:
+        if (pmesh_msg->msg_len > MEMBER_OFFSET(ali_set_t, type))
+        {
+            ali_set_t *pmsg = (ali_set_t *)pbuffer;
+            ali_attr_t attrs[ALI_ATTR_MAX_NUM];
+            uint8_t num = ALI_ATTR_MAX_NUM;
+            if (!ali_attrs_parse(pbuffer + MEMBER_OFFSET(ali_set_t, type),
+                                 pmesh_msg->msg_len - MEMBER_OFFSET(ali_set_t, type), attrs, &num))
+            {
+                printw("ali_server_receive: invalid attributes, len %d", pmesh_msg->msg_len);
+                break;
+            }
+
+            ali_server_set_t set_data = {pmsg->tid, (MESH_MSG_ALI_SET == pmesh_msg->access_opcode), num, attrs};
+            int32_t result = 0;
+            if (NULL != pmodel_info->model_data_cb)
+            {
+                result = pmodel_info->model_data_cb(pmodel_info, ALI_SERVER_SET, &set_data);
+            }
+
+            if ((result >= 0) && set_data.ack)
+            {
+                ali_msg_type_t types[ALI_ATTR_MAX_NUM];
+                for (uint8_t index = 0; index < num; ++index)
+                {
+                    types[index] = attrs[index].type;
+                }
+                ali_stat(pmodel_info, pmesh_msg->src, pmesh_msg->app_key_index, pmsg->tid, types, num);
+            }
+        }
+        break;
+    default:
+        ret = FALSE;
+        break;
+    }
+    return ret;
+}
+
+static int32_t ali_server_publish(mesh_model_info_p pmodel_info, bool retrans)
+{
+    ali_publish(pmodel_info, ali_pub_types, sizeof(ali_pub_types) / sizeof(ali_msg_type_t));
+    return 0;
+}
+
+bool ali_server_reg(uint8_t element_index, mesh_model_info_p pmodel_info)
+{
+    if (NULL == pmodel_info)
+    {
+        return FALSE;
+    }
+
+    pmodel_info->model_id = MESH_MODEL_ALI_VENDOR;
+    if (NULL == pmodel_info->model_receive)
+    {
+        pmodel_info->pargs = plt_malloc(sizeof(ali_server_info_t), RAM_TYPE_DATA_ON);
+        if (NULL == pmodel_info->pargs)
+        {
+            printe("ali_server_reg: fail to allocate memory for the new model extension data!");
+            return FALSE;
+        }
+        memset(pmodel_info->pargs, 0, sizeof(ali_server_info_t));
+
+        pmodel_info->model_receive = ali_server_receive;
+        if (NULL == pmodel_info->model_data_cb)
+        {
+            printw("ali_server_reg: missing model data process callback!");
+        }
+    }
+
+    if (NULL == pmodel_info->model_pub_cb)
+    {
+        pmodel_info->model_pub_cb = ali_server_publish;
+    }
+
+    return mesh_model_reg(element_index, pmodel_info);
+}
@@ -14,119 +14,203 @@
 
 
 #define DELAY_EXECUTION_TIMER_ID      100
+#define DELAY_INDEX_NULL              0xff
 
-typedef struct _delay_list
+typedef struct
 {
-    struct _delay_list *next;
-} delay_list_t;
-
-typedef struct _delay_execution_t
-{
-    plt_timer_t delay_timer;
     const mesh_model_info_t *pmodel_info;
     uint32_t delay_type;
     delay_execution_cb delay_execution;
-    delay_list_t node;
+    uint32_t delta; //!< ms after the previous entry, the head is relative to delay_base_time
+    uint8_t next;
 } delay_execution_t;
 
-static delay_list_t delay_list_head;
-
+/* delta queue, all delays share one timer armed to the head */
+static delay_execution_t delay_pool[MODEL_DELAY_EXECUTION_NUM_MAX];
+static uint8_t delay_head = DELAY_INDEX_NULL;
+static uint8_t delay_free_head = DELAY_INDEX_NULL;
+static uint32_t delay_base_time;
+static plt_timer_t delay_timer;
 
 #if MODEL_ENABLE_MULTI_THREAD
 #define DELAY_INFINITE_WAIT      0xffffffff
 plt_mutex_t delay_mutex;
 #endif
 
-static void delay_execution_timeout_handle(void *ptimer)
+/**
+ * @brief consume the time elapsed since last call, expired entries are left with 0 delta
+ */
+static void delay_execution_advance(void)
 {
-#if MODEL_ENABLE_MULTI_THREAD
-    plt_mutex_take(delay_mutex, DELAY_INFINITE_WAIT);
-#endif
+    uint32_t now = plt_time_read_ms();
+    uint32_t elapsed = now - delay_base_time;
+    delay_base_time = now;
+    for (uint8_t index = delay_head; (DELAY_INDEX_NULL != index) && (elapsed > 0);
+         index = delay_pool[index].next)
+    {
+        uint32_t consume = MIN(delay_pool[index].delta, elapsed);
+        delay_pool[index].delta -= consume;
+        elapsed -= consume;
+    }
+}
 
-    delay_list_t *pcur = delay_list_head.next;
-    delay_list_t *pprev = &delay_list_head;
-    delay_execution_t *pexecute = NULL;
-    for (; pcur != &delay_list_head; pprev = pcur, pcur = pcur->next)
+static void delay_execution_arm(void)
+{
+    if (DELAY_INDEX_NULL == delay_head)
     {
-        pexecute = CONTAINER_OF(pcur, delay_execution_t, node);
-        if (pexecute->delay_timer == ptimer)
+        if (plt_timer_is_active(delay_timer))
         {
-            pprev->next = pcur->next;
-            break;
+            plt_timer_stop(delay_timer, 0);
         }
     }
+    else
+    {
+        plt_timer_change_period(delay_timer, MAX(delay_pool[delay_head].delta, 1), 0);
+    }
+}
 
+/**
+ * @brief unlink entry from the queue, its delta is given to the next one
+ * @return entry index, DELAY_INDEX_NULL if not found
+ */
+static uint8_t delay_execution_remove(const mesh_model_info_t *pmodel_info, uint32_t delay_type)
+{
+    uint8_t *pprev = &delay_head;
+    while (DELAY_INDEX_NULL != *pprev)
+    {
+        uint8_t index = *pprev;
+        if ((delay_pool[index].pmodel_info == pmodel_info) &&
+            (delay_pool[index].delay_type == delay_type))
+        {
+            *pprev = delay_pool[index].next;
+            if (DELAY_INDEX_NULL != delay_pool[index].next)
+            {
+                delay_pool[delay_pool[index].next].delta += delay_pool[index].delta;
+            }
+            return index;
+        }
+        pprev = &delay_pool[index].next;
+    }
+
+    return DELAY_INDEX_NULL;
+}
+
+static void delay_execution_free(uint8_t index)
+{
+    delay_pool[index].next = delay_free_head;
+    delay_free_head = index;
+}
+
+static void delay_execution_timeout_handle(void *ptimer)
+{
+    UNUSED(ptimer);
 #if MODEL_ENABLE_MULTI_THREAD
-    plt_mutex_give(delay_mutex);
+    plt_mutex_take(delay_mutex, DELAY_INFINITE_WAIT);
 #endif
 
-    if (pcur != &delay_list_head)
+    delay_execution_advance();
+    while ((DELAY_INDEX_NULL != delay_head) && (0 == delay_pool[delay_head].delta))
     {
-        /* free expired delay and notify model */
-        if (NULL != pexecute->delay_execution)
+        /* free expired delay and notify model, the callback may start new delays */
+        uint8_t index = delay_head;
+        delay_execution_t execute = delay_pool[index];
+        delay_head = execute.next;
+        delay_execution_free(index);
+
+#if MODEL_ENABLE_MULTI_THREAD
+        plt_mutex_give(delay_mutex);
+#endif
+        if (NULL != execute.delay_execution)
         {
-            pexecute->delay_execution((mesh_model_info_t *)(pexecute->pmodel_info), pexecute->delay_type);
+            execute.delay_execution((mesh_model_info_t *)(execute.pmodel_info), execute.delay_type);
         }
-        plt_timer_delete(pexecute->delay_timer, 0);
-        plt_free(pexecute, RAM_TYPE_DATA_ON);
+#if MODEL_ENABLE_MULTI_THREAD
+        plt_mutex_take(delay_mutex, DELAY_INFINITE_WAIT);
+#endif
+        delay_execution_advance();
     }
+
+    delay_execution_arm();
+
+#if MODEL_ENABLE_MULTI_THREAD
+    plt_mutex_give(delay_mutex);
+#endif
 }
 
 bool delay_execution_timer_start(const mesh_model_info_t *pmodel_info,
                                  uint32_t delay_type, uint32_t delay_time,
                                  delay_execution_cb delay_execution)
 {
-    delay_list_t *pcur = delay_list_head.next;
-    delay_execution_t *pexecute = NULL;
-    for (; pcur != &delay_list_head; pcur = pcur->next)
+    if (NULL == delay_timer)
     {
-        pexecute = CONTAINER_OF(pcur, delay_execution_t, node);
-        if ((pexecute->pmodel_info == pmodel_info) && (pexecute->delay_type == delay_type))
+        delay_timer = plt_timer_create("delay", DELAY_EXECUTION_STEP_RESOLUTION, FALSE,
+                                       DELAY_EXECUTION_TIMER_ID, delay_execution_timeout_handle);
+        if (NULL == delay_timer)
         {
-            /* find same delay execution, update it */
-            pexecute->delay_execution = delay_execution;
-            plt_timer_change_period(pexecute->delay_timer, delay_time, 0);
-            printi("delay_execution_timer_start: update timer");
-            return TRUE;
+            printe("delay_execution_timer_start: allocate delay execution timer failed!");
+            return FALSE;
         }
     }
 
-    /* new delay execution */
-    pexecute = plt_malloc(sizeof(delay_execution_t), RAM_TYPE_DATA_ON);
-    if (NULL == pexecute)
+#if MODEL_ENABLE_MULTI_THREAD
+    plt_mutex_take(delay_mutex, DELAY_INFINITE_WAIT);
+#endif
+
+    delay_execution_advance();
+    /* the running timer expires when the head delta runs out */
+    uint8_t head = delay_head;
+    uint32_t head_delta = (DELAY_INDEX_NULL == head) ? 0 : delay_pool[head].delta;
+    /* find same delay execution, update it */
+    uint8_t index = delay_execution_remove(pmodel_info, delay_type);
+    if (DELAY_INDEX_NULL != index)
     {
-        printe("delay_execution_timer_start: allocate delay execution structure failed!");
-        return FALSE;
+        printi("delay_execution_timer_start: update timer");
     }
-    pexecute->delay_timer = plt_timer_create("delay", delay_time, FALSE, DELAY_EXECUTION_TIMER_ID,
-                                             delay_execution_timeout_handle);
-    if (NULL == pexecute->delay_timer)
+    else
     {
-        printe("delay_execution_timer_start: allocate delay execution timer failed!");
-        plt_free(pexecute, RAM_TYPE_DATA_ON);
-        return FALSE;
-    }
-    pexecute->pmodel_info = pmodel_info;
-    pexecute->delay_type = delay_type;
-    pexecute->delay_execution = delay_execution;
-    pexecute->node.next = NULL;
-
+        index = delay_free_head;
+        if (DELAY_INDEX_NULL == index)
+        {
 #if MODEL_ENABLE_MULTI_THREAD
-    plt_mutex_take(delay_mutex, DELAY_INFINITE_WAIT);
+            plt_mutex_give(delay_mutex);
 #endif
+            printe("delay_execution_timer_start: delay execution pool is full!");
+            return FALSE;
+        }
+        delay_free_head = delay_pool[index].next;
+    }
+
+    delay_pool[index].pmodel_info = pmodel_info;
+    delay_pool[index].delay_type = delay_type;
+    delay_pool[index].delay_execution = delay_execution;
+
+    /* sort insert, entries with the same deadline keep their start order */
+    uint8_t *pprev = &delay_head;
+    while ((DELAY_INDEX_NULL != *pprev) && (delay_pool[*pprev].delta <= delay_time))
+    {
+        delay_time -= delay_pool[*pprev].delta;
+        pprev = &delay_pool[*pprev].next;
+    }
+    delay_pool[index].delta = delay_time;
+    delay_pool[index].next = *pprev;
+    if (DELAY_INDEX_NULL != *pprev)
+    {
+        delay_pool[*pprev].delta -= delay_time;
+    }
+    *pprev = index;
 
-    /* prepend node */
-    pcur = delay_list_head.next;
-    pexecute->node.next = pcur;
-    delay_list_head.next = &pexecute->node;
+    /* the running timer still expires at the head deadline if the head and its delta are
+     * unchanged, a restarted head entry keeps its index but gets a new delta */
+    if ((head != delay_head) || (delay_pool[delay_head].delta != head_delta) ||
+        !plt_timer_is_active(delay_timer))
+    {
+        delay_execution_arm();
+    }
 
 #if MODEL_ENABLE_MULTI_THREAD
     plt_mutex_give(delay_mutex);
 #endif
 
-    /* start delay execution */
-    plt_timer_start(pexecute->delay_timer, 0);
-
     return TRUE;
 }
 
@@ -138,36 +222,30 @@ void delay_execution_timer_stop(const mesh_model_info_t *pmodel_info,
     plt_mutex_take(delay_mutex, DELAY_INFINITE_WAIT);
 #endif
 
-    delay_list_t *pcur = delay_list_head.next;
-    delay_list_t *pprev = &delay_list_head;
-    delay_execution_t *pexecute = NULL;
-    for (; pcur != &delay_list_head; pprev = pcur, pcur = pcur->next)
+    uint8_t index = delay_execution_remove(pmodel_info, delay_type);
+    if (DELAY_INDEX_NULL != index)
     {
-        delay_execution_t *pexecute = CONTAINER_OF(pcur, delay_execution_t, node);
-        if ((pexecute->pmodel_info == pmodel_info) &&
-            (pexecute->delay_type == delay_type))
-        {
-            pprev->next = pcur->next;
-            break;
-        }
-    }
-
+#if MODEL_ENABLE_USER_STOP_DELAY_NOTIFICATION
+        delay_execution_t execute = delay_pool[index];
+#endif
+        delay_execution_free(index);
+        /* the timer is left to expire if the head is removed, it rearms then */
 #if MODEL_ENABLE_MULTI_THREAD
-    plt_mutex_give(delay_mutex);
+        plt_mutex_give(delay_mutex);
 #endif
-
-    if (pcur != &delay_list_head)
-    {
-        /* free expired delay and notify model */
 #if MODEL_ENABLE_USER_STOP_DELAY_NOTIFICATION
-        if (NULL != pexecute->delay_execution)
+        /* notify model */
+        if (NULL != execute.delay_execution)
         {
-            pexecute->delay_execution((mesh_model_info_t *)(pexecute->pmodel_info), pexecute->delay_type);
+            execute.delay_execution((mesh_model_info_t *)(execute.pmodel_info), execute.delay_type);
         }
 #endif
-        plt_timer_delete(pexecute->delay_timer, 0);
-        plt_free(pexecute, RAM_TYPE_DATA_ON);
+        return;
     }
+
+#if MODEL_ENABLE_MULTI_THREAD
+    plt_mutex_give(delay_mutex);
+#endif
 }
 
 bool delay_execution_init(void)
@@ -183,9 +261,13 @@ bool delay_execution_init(void)
     }
 #endif
 
-    if (NULL == delay_list_head.next)
+    if ((DELAY_INDEX_NULL == delay_head) && (DELAY_INDEX_NULL == delay_free_head))
     {
-        delay_list_head.next = &delay_list_head;
+        for (uint8_t i = 0; i < MODEL_DELAY_EXECUTION_NUM_MAX; ++i)
+        {
+            delay_pool[i].next = (i + 1 < MODEL_DELAY_EXECUTION_NUM_MAX) ? (i + 1) : DELAY_INDEX_NULL;
+        }
+        delay_free_head = 0;
     }
 
     return TRUE;
@@ -157,6 +157,17 @@ typedef struct
  */
 bool generic_on_off_server_reg(uint8_t element_index, mesh_model_info_p pmodel_info);
 
+/**
+ * @brief set generic on off locally, as if a set message was received without delay
+ * @param[in] pmodel_info: pointer to generic on off server model context
+ * @param[in] on_off: desired on/off value
+ * @param[in] trans_time: transition time
+ * @return present on/off value
+ */
+generic_on_off_t generic_on_off_server_execute(mesh_model_info_p pmodel_info,
+                                               generic_on_off_t on_off,
+                                               generic_transition_time_t trans_time);
+
 /**
  * @brief publish generic on off
  * @param[in] pmodel_info: pointer to generic on off server model context
@@ -156,6 +156,19 @@ static generic_on_off_t generic_on_off_process(const mesh_model_info_p pmodel_in
     return on_off_after_set;
 }
 
+generic_on_off_t generic_on_off_server_execute(mesh_model_info_p pmodel_info,
+                                               generic_on_off_t on_off,
+                                               generic_transition_time_t trans_time)
+{
+    generic_on_off_info_t *ponoff_info = pmodel_info->pargs;
+    ponoff_info->target_on_off = on_off;
+#if MODEL_ENABLE_DELAY_EXECUTION
+    ponoff_info->trans_time = trans_time;
+    ponoff_info->delay_time = 0;
+#endif
+    return generic_on_off_process(pmodel_info, on_off, trans_time);
+}
+
 #if MODEL_ENABLE_DELAY_EXECUTION
 static int32_t generic_on_off_delay_execution(mesh_model_info_t *pmodel_info, uint32_t delay_type)
 {
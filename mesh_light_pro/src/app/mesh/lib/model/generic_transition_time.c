@@ -14,24 +14,44 @@
 #include "mesh_api.h"
 #include "generic_types.h"
 
-typedef struct _trans_list
+/* wheel resolution is one mesh tick */
+#define TRANS_TICK_MS               100
+/* three levels of 64 slots cover 64^3 ticks, the longest step is 6000 ticks */
+#define TRANS_WHEEL_BITS            6
+#define TRANS_WHEEL_SIZE            (1 << TRANS_WHEEL_BITS)
+#define TRANS_WHEEL_MASK            (TRANS_WHEEL_SIZE - 1)
+#define TRANS_WHEEL_LEVEL_NUM       3
+#define TRANS_HASH_SIZE             16
+#define TRANS_INDEX_NULL            0xff
+
+typedef enum
 {
-    struct _trans_list *prev;
-    struct _trans_list *next;
-} trans_list_t, *trans_list_p;
+    TRANS_STATE_FREE,
+    TRANS_STATE_PENDING, //!< in the wheel
+    TRANS_STATE_FIRING, //!< step change callback is running
+} trans_state_t;
 
-typedef struct _trans_time_remain
+typedef struct
 {
     mesh_model_info_p pmodel_info;
     uint32_t trans_type;
-    generic_transition_time_t total_time;
-    int8_t remain_num_steps;
-    int16_t remain_step_ticks;
     generic_transition_step_change_cb step_change;
-    trans_list_t node;
+    uint32_t expire_tick;
+    generic_transition_time_t total_time;
+    uint8_t remain_num_steps;
+    uint8_t state;
+    uint8_t slot; //!< wheel slot, level * TRANS_WHEEL_SIZE + index
+    uint8_t prev; //!< slot list
+    uint8_t next;
+    uint8_t hash_next; //!< hash bucket list
 } trans_time_remain_t, *trans_time_remain_p;
 
-static trans_list_t trans_list_head;
+static trans_time_remain_t trans_pool[MODEL_TRANSITION_NUM_MAX];
+static uint8_t trans_free_head;
+static uint8_t trans_wheel[TRANS_WHEEL_LEVEL_NUM * TRANS_WHEEL_SIZE];
+static uint8_t trans_hash[TRANS_HASH_SIZE];
+static uint32_t trans_tick;
+static uint8_t trans_active_num;
 
 #if MODEL_ENABLE_MULTI_THREAD
 #define TRANS_INFINITE_WAIT      0xffffffff
@@ -40,75 +60,142 @@ plt_mutex_t trans_mutex;
 
 const int16_t tick_map[] = {1, 10, 100, 6000};
 
-static __INLINE bool trans_time_is_empty(void)
+static uint8_t trans_hash_index(const mesh_model_info_p pmodel_info, uint32_t trans_type)
 {
-    return (trans_list_head.next == &trans_list_head);
+    uint32_t key = (uint32_t)pmodel_info ^ (trans_type * 0x9e3779b1);
+    return (key ^ (key >> 8) ^ (key >> 16)) & (TRANS_HASH_SIZE - 1);
 }
 
-
-static bool trans_time_insert(const mesh_model_info_p pmodel_info,
-                              uint32_t trans_type,
-                              generic_transition_time_t trans_time,
-                              generic_transition_step_change_cb step_change)
+static uint8_t trans_find(const mesh_model_info_p pmodel_info, uint32_t trans_type)
 {
-    trans_list_p pcur = trans_list_head.next;
-    trans_time_remain_p ptime = NULL;
-    for (; pcur != &trans_list_head; pcur = pcur->next)
+    uint8_t index = trans_hash[trans_hash_index(pmodel_info, trans_type)];
+    while (TRANS_INDEX_NULL != index)
     {
-        ptime = CONTAINER_OF(pcur, trans_time_remain_t, node);
-        if ((ptime->pmodel_info == pmodel_info) &&
-            (ptime->trans_type == trans_type))
+        if ((trans_pool[index].pmodel_info == pmodel_info) &&
+            (trans_pool[index].trans_type == trans_type))
         {
             break;
         }
+        index = trans_pool[index].hash_next;
     }
 
-    if (pcur != &trans_list_head)
+    return index;
+}
+
+static void trans_wheel_link(uint8_t index)
+{
+    trans_time_remain_p ptime = &trans_pool[index];
+    uint32_t delta = ptime->expire_tick - trans_tick;
+    uint8_t level = 0;
+    while ((level < TRANS_WHEEL_LEVEL_NUM - 1) &&
+           (delta >= (1UL << (TRANS_WHEEL_BITS * (level + 1)))))
     {
-        /* reset transition time */
-        ptime->total_time = trans_time;
-        ptime->remain_num_steps = trans_time.num_steps;
-        ptime->remain_step_ticks = tick_map[trans_time.step_resolution];
-        return TRUE;
+        level ++;
     }
 
-    trans_time_remain_p premain_time = plt_malloc(sizeof(trans_time_remain_t), RAM_TYPE_DATA_ON);
-    if (NULL == premain_time)
+    ptime->slot = level * TRANS_WHEEL_SIZE + ((ptime->expire_tick >> (TRANS_WHEEL_BITS * level)) &
+                                              TRANS_WHEEL_MASK);
+    ptime->prev = TRANS_INDEX_NULL;
+    ptime->next = trans_wheel[ptime->slot];
+    if (TRANS_INDEX_NULL != ptime->next)
     {
-        printe("trans_time_insert: allocate transition time memory failed");
-        return FALSE;
+        trans_pool[ptime->next].prev = index;
     }
-    premain_time->pmodel_info = pmodel_info;
-    premain_time->trans_type = trans_type;
-    premain_time->total_time = trans_time;
-    premain_time->remain_num_steps = trans_time.num_steps;
-    premain_time->remain_step_ticks = tick_map[trans_time.step_resolution];
-    premain_time->step_change = step_change;
-    premain_time->node.next = NULL;
-    premain_time->node.prev = NULL;
+    trans_wheel[ptime->slot] = index;
+}
 
+static void trans_wheel_unlink(uint8_t index)
+{
+    trans_time_remain_p ptime = &trans_pool[index];
+    if (TRANS_INDEX_NULL == ptime->prev)
+    {
+        trans_wheel[ptime->slot] = ptime->next;
+    }
+    else
+    {
+        trans_pool[ptime->prev].next = ptime->next;
+    }
+    if (TRANS_INDEX_NULL != ptime->next)
+    {
+        trans_pool[ptime->next].prev = ptime->prev;
+    }
+}
+
+/**
+ * @brief schedule the next step of the transition
+ */
+static void trans_arm(uint8_t index)
+{
+    trans_time_remain_p ptime = &trans_pool[index];
+    ptime->expire_tick = trans_tick + tick_map[ptime->total_time.step_resolution];
+    ptime->state = TRANS_STATE_PENDING;
+    trans_wheel_link(index);
+}
+
+static void trans_release(uint8_t index)
+{
+    trans_time_remain_p ptime = &trans_pool[index];
+    if (TRANS_STATE_PENDING == ptime->state)
+    {
+        trans_wheel_unlink(index);
+    }
+
+    uint8_t *pnext = &trans_hash[trans_hash_index(ptime->pmodel_info, ptime->trans_type)];
+    while (*pnext != index)
+    {
+        pnext = &trans_pool[*pnext].hash_next;
+    }
+    *pnext = ptime->hash_next;
+
+    ptime->state = TRANS_STATE_FREE;
+    ptime->next = trans_free_head;
+    trans_free_head = index;
+    trans_active_num --;
+}
+
+static bool trans_time_insert(const mesh_model_info_p pmodel_info,
+                              uint32_t trans_type,
+                              generic_transition_time_t trans_time,
+                              generic_transition_step_change_cb step_change)
+{
 #if MODEL_ENABLE_MULTI_THREAD
     plt_mutex_take(trans_mutex, TRANS_INFINITE_WAIT);
 #endif
 
-    /* sort insert */
-    pcur = trans_list_head.next;
-    for (; pcur != &trans_list_head; pcur = pcur->next)
+    uint8_t index = trans_find(pmodel_info, trans_type);
+    if (TRANS_INDEX_NULL != index)
     {
-        trans_time_remain_p ptime = CONTAINER_OF(pcur, trans_time_remain_t, node);
-        int32_t cur_time_tick = ptime->remain_num_steps * tick_map[ptime->total_time.step_resolution];
-        int32_t insert_time_tick = premain_time->remain_num_steps *
-                                   tick_map[ptime->total_time.step_resolution];
-        if (cur_time_tick > insert_time_tick)
+        /* reset transition time */
+        if (TRANS_STATE_PENDING == trans_pool[index].state)
         {
-            break;
+            trans_wheel_unlink(index);
+        }
+    }
+    else
+    {
+        index = trans_free_head;
+        if (TRANS_INDEX_NULL == index)
+        {
+#if MODEL_ENABLE_MULTI_THREAD
+            plt_mutex_give(trans_mutex);
+#endif
+            printe("trans_time_insert: transition pool is full");
+            return FALSE;
         }
+        trans_free_head = trans_pool[index].next;
+
+        uint8_t hash = trans_hash_index(pmodel_info, trans_type);
+        trans_pool[index].pmodel_info = pmodel_info;
+        trans_pool[index].trans_type = trans_type;
+        trans_pool[index].step_change = step_change;
+        trans_pool[index].hash_next = trans_hash[hash];
+        trans_hash[hash] = index;
+        trans_active_num ++;
     }
 
-    pcur->prev->next = &premain_time->node;
-    premain_time->node.prev = pcur->prev;
-    pcur->prev = &premain_time->node;
-    premain_time->node.next = pcur;
+    trans_pool[index].total_time = trans_time;
+    trans_pool[index].remain_num_steps = trans_time.num_steps;
+    trans_arm(index);
 
 #if MODEL_ENABLE_MULTI_THREAD
     plt_mutex_give(trans_mutex);
@@ -117,25 +204,75 @@ static bool trans_time_insert(const mesh_model_info_p pmodel_info,
     return TRUE;
 }
 
-static bool trans_time_remove_head(void)
+/**
+ * @brief move the entries of an upper level slot to lower levels
+ */
+static void trans_wheel_cascade(uint8_t level)
 {
-    trans_list_p pfirst = trans_list_head.next;
-    if (pfirst == &trans_list_head)
+    uint8_t slot = level * TRANS_WHEEL_SIZE + ((trans_tick >> (TRANS_WHEEL_BITS * level)) &
+                                               TRANS_WHEEL_MASK);
+    uint8_t index = trans_wheel[slot];
+    trans_wheel[slot] = TRANS_INDEX_NULL;
+    while (TRANS_INDEX_NULL != index)
     {
-        return FALSE;
+        uint8_t next = trans_pool[index].next;
+        trans_wheel_link(index);
+        index = next;
     }
+}
 
-    trans_time_remain_p premain_time = CONTAINER_OF(pfirst, trans_time_remain_t, node);
-    if (premain_time->remain_num_steps <= 0)
+static void trans_time_fire(uint8_t index)
+{
+    trans_time_remain_p ptime = &trans_pool[index];
+    if (ptime->remain_num_steps > 0)
     {
-        /* remove first */
-        pfirst->prev->next = pfirst->next;
-        pfirst->next->prev = pfirst->prev;
-        plt_free(premain_time, RAM_TYPE_DATA_ON);
-        return TRUE;
+        ptime->remain_num_steps --;
     }
 
-    return FALSE;
+    ptime->state = TRANS_STATE_FIRING;
+    if (NULL != ptime->step_change)
+    {
+        int32_t ret = MODEL_SUCCESS;
+        /* notify remaining step change */
+        generic_transition_time_t total_time = ptime->total_time;
+        generic_transition_time_t remaining_time = {ptime->remain_num_steps, total_time.step_resolution};
+#if MODEL_ENABLE_MULTI_THREAD
+        plt_mutex_give(trans_mutex);
+#endif
+        ret = ptime->step_change(ptime->pmodel_info, ptime->trans_type, total_time, remaining_time);
+#if MODEL_ENABLE_MULTI_THREAD
+        plt_mutex_take(trans_mutex, TRANS_INFINITE_WAIT);
+#endif
+        if (TRANS_STATE_FIRING != ptime->state)
+        {
+            /* stopped or restarted by the callback */
+            return;
+        }
+
+        if ((MODEL_STOP_TRANSITION == ret) &&
+            (ptime->remain_num_steps > 0))
+        {
+            ptime->remain_num_steps = 0;
+#if MODEL_ENABLE_USER_STOP_TRANSITION_NOTIFICATION
+            /* notify transition end */
+            remaining_time.num_steps = 0;
+            ptime->step_change(ptime->pmodel_info, ptime->trans_type, total_time, remaining_time);
+            if (TRANS_STATE_FIRING != ptime->state)
+            {
+                return;
+            }
+#endif
+        }
+    }
+
+    if (0 == ptime->remain_num_steps)
+    {
+        trans_release(index);
+    }
+    else
+    {
+        trans_arm(index);
+    }
 }
 
 static void trans_time_timeout_handle(void)
@@ -144,49 +281,30 @@ static void trans_time_timeout_handle(void)
     plt_mutex_take(trans_mutex, TRANS_INFINITE_WAIT);
 #endif
 
-    trans_list_p pcur = trans_list_head.next;
-    trans_time_remain_p ptime = NULL;
-    for (; pcur != &trans_list_head; pcur = pcur->next)
+    trans_tick ++;
+    for (uint8_t level = TRANS_WHEEL_LEVEL_NUM - 1; level > 0; --level)
     {
-        ptime = CONTAINER_OF(pcur, trans_time_remain_t, node);
-        ptime->remain_step_ticks --;
-        if (ptime->remain_step_ticks < 0)
+        if (0 == (trans_tick & ((1UL << (TRANS_WHEEL_BITS * level)) - 1)))
         {
-            if (ptime->remain_num_steps > 0)
-            {
-                ptime->remain_num_steps --;
-            }
-            /* reload step tick */
-            ptime->remain_step_ticks = tick_map[ptime->total_time.step_resolution];
-            if (NULL != ptime->step_change)
-            {
-                int32_t ret = MODEL_SUCCESS;
-                /* notify remaining step change */
-                generic_transition_time_t remaining_time = {ptime->remain_num_steps, ptime->total_time.step_resolution};
-                ret = ptime->step_change(ptime->pmodel_info, ptime->trans_type, ptime->total_time, remaining_time);
-                if ((MODEL_STOP_TRANSITION == ret) &&
-                    (ptime->remain_num_steps > 0))
-                {
-                    ptime->remain_num_steps = 0;
-                    remaining_time.num_steps = 0;
-#if MODEL_ENABLE_USER_STOP_TRANSITION_NOTIFICATION
-                    /* notify transition end */
-                    ptime->step_change(ptime->pmodel_info, ptime->trans_type, ptime->total_time, remaining_time);
-#endif
-                }
-            }
+            trans_wheel_cascade(level);
         }
     }
 
-    /* remove expired transition */
-    while (trans_time_remove_head());
+    /* all entries of current slot expire now, callbacks can not add entries to this slot */
+    uint8_t slot = trans_tick & TRANS_WHEEL_MASK;
+    uint8_t index;
+    while (TRANS_INDEX_NULL != (index = trans_wheel[slot]))
+    {
+        trans_wheel_unlink(index);
+        trans_time_fire(index);
+    }
 
 #if MODEL_ENABLE_MULTI_THREAD
     plt_mutex_give(trans_mutex);
 #endif
 
     /* check empty */
-    if (trans_time_is_empty())
+    if (0 == trans_active_num)
     {
         printi("stop transition timer");
         mesh_tick_timer_stop();
@@ -203,7 +321,7 @@ bool generic_transition_timer_start(const mesh_model_info_p pmodel,
     {
         if (trans_time_insert(pmodel, trans_type, trans_time, step_change))
         {
-            mesh_tick_timer_start(100, trans_time_timeout_handle);
+            mesh_tick_timer_start(TRANS_TICK_MS, trans_time_timeout_handle);
             ret = TRUE;
         }
     }
@@ -224,16 +342,10 @@ void generic_transition_timer_stop(const mesh_model_info_p pmodel_info,
     plt_mutex_take(trans_mutex, TRANS_INFINITE_WAIT);
 #endif
 
-    trans_list_p pcur = trans_list_head.next;
-    for (; pcur != &trans_list_head; pcur = pcur->next)
+    uint8_t index = trans_find(pmodel_info, trans_type);
+    if (TRANS_INDEX_NULL != index)
     {
-        trans_time_remain_p ptime = CONTAINER_OF(pcur, trans_time_remain_t, node);
-        if ((ptime->pmodel_info == pmodel_info) &&
-            (ptime->trans_type == trans_type))
-        {
-            ptime->remain_num_steps = 0;
-            break;
-        }
+        trans_release(index);
     }
 
 #if MODEL_ENABLE_MULTI_THREAD
@@ -248,23 +360,12 @@ generic_transition_time_t generic_transition_time_get(const mesh_model_info_p pm
 #if MODEL_ENABLE_MULTI_THREAD
     plt_mutex_take(trans_mutex, TRANS_INFINITE_WAIT);
 #endif
-    trans_list_p pcur = trans_list_head.next;
-    trans_time_remain_p ptime = NULL;
-    for (; pcur != &trans_list_head; pcur = pcur->next)
-    {
-        ptime = CONTAINER_OF(pcur, trans_time_remain_t, node);
-        if ((ptime->pmodel_info == pmodel_info) &&
-            (ptime->trans_type == trans_type))
-        {
-            break;
-        }
-    }
-
+    uint8_t index = trans_find(pmodel_info, trans_type);
     generic_transition_time_t remaining_time = {0, 0};
-    if (pcur != &trans_list_head)
+    if (TRANS_INDEX_NULL != index)
     {
-        remaining_time.num_steps = ptime->remain_num_steps;
-        remaining_time.step_resolution = ptime->total_time.step_resolution;
+        remaining_time.num_steps = trans_pool[index].remain_num_steps;
+        remaining_time.step_resolution = trans_pool[index].total_time.step_resolution;
     }
 
 #if MODEL_ENABLE_MULTI_THREAD
@@ -274,6 +375,11 @@ generic_transition_time_t generic_transition_time_get(const mesh_model_info_p pm
     return remaining_time;
 }
 
+uint32_t generic_transition_step_time(generic_transition_time_t trans_time)
+{
+    return (uint32_t)tick_map[trans_time.step_resolution] * TRANS_TICK_MS;
+}
+
 
 bool generic_transition_time_init(void)
 {
@@ -288,11 +394,16 @@ bool generic_transition_time_init(void)
     }
 #endif
 
-    if ((NULL == trans_list_head.prev) &&
-        (NULL == trans_list_head.next))
+    if (0 == trans_active_num)
     {
-        trans_list_head.prev = &trans_list_head;
-        trans_list_head.next = &trans_list_head;
+        memset(trans_wheel, TRANS_INDEX_NULL, sizeof(trans_wheel));
+        memset(trans_hash, TRANS_INDEX_NULL, sizeof(trans_hash));
+        for (uint8_t i = 0; i < MODEL_TRANSITION_NUM_MAX; ++i)
+        {
+            trans_pool[i].state = TRANS_STATE_FREE;
+            trans_pool[i].next = (i + 1 < MODEL_TRANSITION_NUM_MAX) ? (i + 1) : TRANS_INDEX_NULL;
+        }
+        trans_free_head = 0;
     }
 
     return TRUE;
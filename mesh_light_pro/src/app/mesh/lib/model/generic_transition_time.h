@@ -102,6 +102,13 @@ void generic_transition_timer_stop(const mesh_model_info_p pmodel_info,
  */
 generic_transition_time_t generic_transition_time_get(const mesh_model_info_p pmodel_info,
                                                       uint32_t trans_type);
+
+/**
+ * @brief get the time of one transition step
+ * @param[in] trans_time: transition time
+ * @return step time of the step resolution, the unit is ms
+ */
+uint32_t generic_transition_step_time(generic_transition_time_t trans_time);
 /** @} */
 /** @} */
 
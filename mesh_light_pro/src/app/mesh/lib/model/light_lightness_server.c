@@ -11,7 +11,6 @@
 * *************************************************************************************
 */
 
-#include <math.h>
 #include "light_lightness.h"
 #if MODEL_ENABLE_DELAY_EXECUTION
 #include "delay_execution.h"
@@ -32,14 +31,45 @@ typedef struct
 } light_lightness_info_t, *light_lightness_info_p;
 
 
+/**
+ * @brief integer square root
+ * @return floor of the square root
+ */
+static uint32_t light_lightness_sqrt(uint32_t value)
+{
+    uint32_t root = 0;
+    uint32_t bit = 1UL << 30;
+    while (bit > value)
+    {
+        bit >>= 2;
+    }
+
+    while (0 != bit)
+    {
+        if (value >= root + bit)
+        {
+            value -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return root;
+}
+
 uint16_t light_lightness_linear_to_actual(uint16_t lightness_linear)
 {
-    return (uint16_t)(65535 * sqrt(lightness_linear / 65535.0));
+    /* 65535 * sqrt(linear / 65535) */
+    return light_lightness_sqrt((uint32_t)lightness_linear * 65535);
 }
 
 uint16_t light_lightness_actual_to_linear(uint16_t lightness_actual)
 {
-    return (uint16_t)(lightness_actual / 65535.0 * lightness_actual);
+    return (uint32_t)lightness_actual * lightness_actual / 65535;
 }
 
 int16_t light_lightness_to_generic_level(uint16_t lightness)
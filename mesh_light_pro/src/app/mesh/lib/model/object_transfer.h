@@ -140,7 +140,7 @@ typedef struct
     uint16_t block_num;
     uint16_t chunk_size;
     obj_block_check_algo_t check_algo;
-    uint8_t checksum_value[1];
+    uint8_t checksum_value[4]; //!< variable length, crc32 is little endian
     //uint16_t current_block_size; //!< optional
 } _PACKED_ obj_block_transfer_start_t;
 
@@ -242,7 +242,11 @@ typedef struct
     uint8_t max_block_size_log;
     uint8_t *block_data;
     uint8_t checksum_value[4];
-    uint8_t checksum_len;
+    uint8_t checksum_len; //!< 0 if the client sends no checksum, the block is not checked
+    uint16_t chunk_missing_num; //!< chunks of the current block not received yet
+    uint16_t checksum_chunk; //!< chunks before it are in checksum_calc
+    uint32_t checksum_calc; //!< checksum of the received chunks, in order
+    bool checksum_failed; //!< current block received but checksum mismatched, all chunks cleared
     //uint16_t max_chunk_num;
 } obj_transfer_server_ctx_t;
 
@@ -17,6 +17,7 @@
 #include <string.h>
 #include "mesh_api.h"
 #include "object_transfer.h"
+#include "crc32.h"
 
 static const uint8_t checksum_len[OBJ_BLOCK_CHECK_ALGO_NUM] = {4};
 
@@ -104,13 +105,68 @@ mesh_msg_send_cause_t obj_info_stat(mesh_msg_p pmesh_msg, uint8_t min_block_size
     return obj_transfer_server_send(pmesh_msg, (uint8_t *)&msg, sizeof(obj_info_stat_t));
 }
 
+/**
+ * @brief add the chunks received in order to the checksum
+ * @note every chunk is added once, as soon as the chunks before it have been received,
+ *       the checksum is ready when the last chunk arrives
+ */
+static void obj_transfer_server_update_checksum(void)
+{
+    if (0 == obj_transfer_server_ctx.checksum_len)
+    {
+        return;
+    }
+
+    uint16_t chunk_num = (obj_transfer_server_ctx.current_block_size + obj_transfer_server_ctx.chunk_size
+                          - 1) / obj_transfer_server_ctx.chunk_size;
+    while ((obj_transfer_server_ctx.checksum_chunk < chunk_num) &&
+           plt_bit_pool_get(obj_transfer_server_ctx.chunk_flag, obj_transfer_server_ctx.checksum_chunk))
+    {
+        uint32_t offset = obj_transfer_server_ctx.checksum_chunk * obj_transfer_server_ctx.chunk_size;
+        uint32_t len = obj_transfer_server_ctx.current_block_size - offset;
+        if (len > obj_transfer_server_ctx.chunk_size)
+        {
+            len = obj_transfer_server_ctx.chunk_size;
+        }
+        switch (obj_transfer_server_ctx.check_algo)
+        {
+        case OBJ_BLOCK_CHECK_ALGO_CRC32:
+            obj_transfer_server_ctx.checksum_calc = crc32_update(obj_transfer_server_ctx.checksum_calc,
+                                                                 obj_transfer_server_ctx.block_data + offset, len);
+            break;
+        default:
+            break;
+        }
+        obj_transfer_server_ctx.checksum_chunk++;
+    }
+}
+
+/**
+ * @brief clear the received chunks of the current block
+ * @param[in] chunk_num: chunks of the current block
+ */
+static void obj_transfer_server_clear_chunks(uint16_t chunk_num)
+{
+    memset(obj_transfer_server_ctx.chunk_flag, 0, sizeof(obj_transfer_server_ctx.chunk_flag));
+    obj_transfer_server_ctx.chunk_missing_num = chunk_num;
+    obj_transfer_server_ctx.checksum_chunk = 0;
+    obj_transfer_server_ctx.checksum_calc = 0;
+}
+
 bool obj_transfer_server_verify_checksum(void)
 {
-    bool ret;
+    bool ret = false;
+    if (0 == obj_transfer_server_ctx.checksum_len)
+    {
+        /* the client sends no checksum */
+        return true;
+    }
+
     switch (obj_transfer_server_ctx.check_algo)
     {
     case OBJ_BLOCK_CHECK_ALGO_CRC32:
-        ret = true;
+        ret = (LE_EXTRN2DWORD(obj_transfer_server_ctx.checksum_value) ==
+               obj_transfer_server_ctx.checksum_calc);
         break;
     default:
         break;
@@ -124,6 +180,12 @@ void obj_transfer_server_handle_obj_block_transfer_start(mesh_msg_p pmesh_msg)
     uint8_t *pbuffer = pmesh_msg->pbuffer + pmesh_msg->msg_offset;
     obj_block_transfer_start_t *pmsg = (obj_block_transfer_start_t *)pbuffer;
 
+    if (pmesh_msg->msg_len < MEMBER_OFFSET(obj_block_transfer_start_t, checksum_value))
+    {
+        stat = OBJ_BLOCK_TRANSFER_STAT_INVALID_PARAMETER;
+        goto end;
+    }
+
     if (obj_transfer_server_ctx.phase == OBJ_TRANSFER_PHASE_IDLE)
     {
         stat = OBJ_BLOCK_TRANSFER_STAT_INVALID_STATE;
@@ -180,8 +242,8 @@ void obj_transfer_server_handle_obj_block_transfer_start(mesh_msg_p pmesh_msg)
         goto end;
     }
 
-    obj_transfer_server_ctx.checksum_len = pmesh_msg->msg_len - MEMBER_OFFSET(
-                                               obj_block_transfer_start_t, checksum_value);
+    uint16_t value_len = pmesh_msg->msg_len - MEMBER_OFFSET(obj_block_transfer_start_t,
+                                                            checksum_value);
     if (pmsg->check_algo > OBJ_BLOCK_CHECK_ALGO_CRC32)
     {
         stat = OBJ_BLOCK_TRANSFER_STAT_UNKNOWN_CHECK_ALGO;
@@ -189,11 +251,11 @@ void obj_transfer_server_handle_obj_block_transfer_start(mesh_msg_p pmesh_msg)
     }
     else
     {
-        if (obj_transfer_server_ctx.checksum_len != checksum_len[pmsg->check_algo])
+        /* a client without checksum sends no value, the block is accepted unchecked */
+        if ((0 != value_len) && (value_len != checksum_len[pmsg->check_algo]))
         {
-            /* not check now */
-            //stat = OBJ_BLOCK_TRANSFER_STAT_UNKNOWN_CHECK_ALGO;
-            //goto end;
+            stat = OBJ_BLOCK_TRANSFER_STAT_UNKNOWN_CHECK_ALGO;
+            goto end;
         }
     }
 
@@ -204,7 +266,9 @@ void obj_transfer_server_handle_obj_block_transfer_start(mesh_msg_p pmesh_msg)
         //obj_transfer_server_ctx.current_block_num = pmsg->block_num;
         obj_transfer_server_ctx.chunk_size = pmsg->chunk_size;
         obj_transfer_server_ctx.check_algo = pmsg->check_algo;
-        memset(obj_transfer_server_ctx.chunk_flag, 0, sizeof(obj_transfer_server_ctx.chunk_flag));
+        obj_transfer_server_ctx.checksum_len = value_len;
+        obj_transfer_server_ctx.checksum_failed = FALSE;
+        obj_transfer_server_clear_chunks(chunk_num);
         memcpy(obj_transfer_server_ctx.checksum_value, pmsg->checksum_value,
                obj_transfer_server_ctx.checksum_len);
         printi("obj_transfer_server_handle_obj_block_transfer_start: block num %d, chunk size %d, check algo %d len %d, value ",
@@ -280,25 +344,24 @@ void obj_transfer_server_handle_obj_chunk_transfer(mesh_msg_p pmesh_msg)
     plt_bit_pool_set(obj_transfer_server_ctx.chunk_flag, pmsg->chunk_num, TRUE);
     memcpy(obj_transfer_server_ctx.block_data + pmsg->chunk_num * obj_transfer_server_ctx.chunk_size,
            pmsg->data, chunk_size);
+    obj_transfer_server_ctx.chunk_missing_num--;
+    obj_transfer_server_ctx.checksum_failed = FALSE;
+    obj_transfer_server_update_checksum();
 
     // check block complete
-    uint16_t loop;
-    for (loop = 0; loop < chunk_num; loop++)
-    {
-        if (!plt_bit_pool_get(obj_transfer_server_ctx.chunk_flag, loop))
-        {
-            break;
-        }
-    }
-    if (loop < chunk_num)
+    if (obj_transfer_server_ctx.chunk_missing_num)
     {
         goto end;
     }
 
     if (false == obj_transfer_server_verify_checksum())
     {
-        /* What to do? */
-        memset(obj_transfer_server_ctx.chunk_flag, 0, sizeof(obj_transfer_server_ctx.chunk_flag));
+        /* drop the block before it reaches the flash, all the chunks are requested again */
+        printw("obj_transfer_server_handle_obj_chunk_transfer: block %d checksum 0x%08x, expected 0x%08x",
+               obj_transfer_server_ctx.current_block_num, obj_transfer_server_ctx.checksum_calc,
+               LE_EXTRN2DWORD(obj_transfer_server_ctx.checksum_value));
+        obj_transfer_server_clear_chunks(chunk_num);
+        obj_transfer_server_ctx.checksum_failed = TRUE;
         ret = __LINE__;
         goto end;
     }
@@ -358,16 +421,20 @@ void obj_transfer_server_handle_obj_block_get(mesh_msg_p pmesh_msg)
     }
     else
     {
-        // TODO:
-        uint16_t *chunk_list = plt_malloc(OBJ_TRANSFER_MAX_CHUNK_NUM << 1, RAM_TYPE_DATA_OFF);
+        uint16_t *chunk_list = NULL;
         uint16_t chunk_list_len = 0;
         uint16_t chunk_num = 0;
+        if (obj_transfer_server_ctx.chunk_missing_num)
+        {
+            chunk_list = plt_malloc(obj_transfer_server_ctx.chunk_missing_num << 1, RAM_TYPE_DATA_OFF);
+        }
         if (chunk_list)
         {
             chunk_num = (obj_transfer_server_ctx.current_block_size +
                          obj_transfer_server_ctx.chunk_size - 1) /
                         obj_transfer_server_ctx.chunk_size;
-            for (uint16_t loop = 0; loop < chunk_num; loop++)
+            for (uint16_t loop = 0; (loop < chunk_num) &&
+                 (chunk_list_len < obj_transfer_server_ctx.chunk_missing_num); loop++)
             {
                 if (!plt_bit_pool_get(obj_transfer_server_ctx.chunk_flag, loop))
                 {
@@ -376,10 +443,21 @@ void obj_transfer_server_handle_obj_block_get(mesh_msg_p pmesh_msg)
                 }
             }
         }
-        obj_block_stat(pmesh_msg, chunk_list_len ? (chunk_list_len >= chunk_num ?
-                                                    OBJ_BLOCK_TRANSFER_STAT_INVALID_BLOCK_NUM : OBJ_BLOCK_TRANSFER_STAT_NOT_ALL_CHUNCK_RECEIVED) :
-                       OBJ_BLOCK_TRANSFER_STAT_ACCEPTED, chunk_list, chunk_list_len);
-        plt_free(chunk_list, RAM_TYPE_DATA_OFF);
+        obj_block_transfer_stat_stat_t stat = OBJ_BLOCK_TRANSFER_STAT_ACCEPTED;
+        if (obj_transfer_server_ctx.checksum_failed)
+        {
+            stat = OBJ_BLOCK_TRANSFER_STAT_WRONG_CHECKSUM;
+        }
+        else if (chunk_list_len)
+        {
+            stat = (chunk_list_len >= chunk_num) ? OBJ_BLOCK_TRANSFER_STAT_INVALID_BLOCK_NUM :
+                   OBJ_BLOCK_TRANSFER_STAT_NOT_ALL_CHUNCK_RECEIVED;
+        }
+        obj_block_stat(pmesh_msg, stat, chunk_list, chunk_list_len);
+        if (chunk_list)
+        {
+            plt_free(chunk_list, RAM_TYPE_DATA_OFF);
+        }
     }
 }
 
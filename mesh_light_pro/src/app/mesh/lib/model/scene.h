@@ -240,6 +240,17 @@ bool scene_setup_server_reg(uint8_t element_index, mesh_model_info_p pmodel_info
 mesh_msg_send_cause_t scene_publish(const mesh_model_info_p pmodel_info,
                                     uint16_t scene);
 
+/**
+ * @brief recall scene locally, as if a recall message was received without delay
+ * @param[in] pmodel_info: pointer to scene server model context
+ * @param[in] scene_number: scene to recall
+ * @param[in] trans_time: transition time
+ * @retval TRUE: scene recalled
+ * @retval FALSE: scene not found
+ */
+bool scene_server_execute(mesh_model_info_p pmodel_info, uint16_t scene_number,
+                          generic_transition_time_t trans_time);
+
 /**
  * @brief set scene server storage memory
  * @param[in] pmodel_info: pointer to scene server model context
@@ -18,31 +18,162 @@
 #endif
 
 
+#define SCENE_INDEX_MASK              (MODEL_SCENE_INDEX_SIZE - 1)
+
+/* scene register index shared by the scene server and scene setup server */
+typedef struct _scene_index_t
+{
+    struct _scene_index_t *next;
+    scene_storage_memory_t *scenes;
+    uint16_t num_scenes;
+    uint8_t slot[MODEL_SCENE_INDEX_SIZE]; //!< scene position + 1, 0 means empty bucket
+} scene_index_t;
+
+static scene_index_t *scene_index_list;
+
 typedef struct
 {
     scene_storage_memory_t *scenes;
     uint16_t num_scenes;
+    scene_index_t *pindex;
     scene_status_code_t status_recall;
     uint16_t target_scene;
+    scene_storage_memory_t *state_memory; //!< target scene, looked up once on recall
 #if MODEL_ENABLE_DELAY_EXECUTION
     generic_transition_time_t trans_time;
     uint32_t delay_time;
-    scene_storage_memory_t *state_memory;
 #endif
 } scene_info_t;
 
+static uint8_t scene_index_hash(uint16_t scene_number)
+{
+    return (scene_number ^ (scene_number >> 8)) & SCENE_INDEX_MASK;
+}
+
+void scene_index_insert(scene_index_t *pindex, uint16_t position)
+{
+    uint8_t bucket = scene_index_hash(pindex->scenes[position].scene_number);
+    while (0 != pindex->slot[bucket])
+    {
+        bucket = (bucket + 1) & SCENE_INDEX_MASK;
+    }
+    pindex->slot[bucket] = position + 1;
+}
+
+/**
+ * @brief remove scene from index, call it before the scene number is cleared
+ */
+void scene_index_remove(scene_index_t *pindex, uint16_t position)
+{
+    uint8_t bucket = scene_index_hash(pindex->scenes[position].scene_number);
+    while (pindex->slot[bucket] != position + 1)
+    {
+        if (0 == pindex->slot[bucket])
+        {
+            return;
+        }
+        bucket = (bucket + 1) & SCENE_INDEX_MASK;
+    }
+
+    /* shift back the following entries of the probe run, so no tombstone is needed */
+    uint8_t hole = bucket;
+    pindex->slot[hole] = 0;
+    for (bucket = (hole + 1) & SCENE_INDEX_MASK; 0 != pindex->slot[bucket];
+         bucket = (bucket + 1) & SCENE_INDEX_MASK)
+    {
+        uint8_t home = scene_index_hash(pindex->scenes[pindex->slot[bucket] - 1].scene_number);
+        /* entry may move to the hole if its home is not in (hole, bucket] */
+        if (((bucket - home) & SCENE_INDEX_MASK) >= ((bucket - hole) & SCENE_INDEX_MASK))
+        {
+            pindex->slot[hole] = pindex->slot[bucket];
+            pindex->slot[bucket] = 0;
+            hole = bucket;
+        }
+    }
+}
+
+scene_storage_memory_t *scene_index_find(const scene_index_t *pindex, uint16_t scene_number)
+{
+    uint8_t bucket = scene_index_hash(scene_number);
+    for (uint16_t i = 0; (i < MODEL_SCENE_INDEX_SIZE) && (0 != pindex->slot[bucket]); ++i)
+    {
+        scene_storage_memory_t *pscene = &pindex->scenes[pindex->slot[bucket] - 1];
+        if (pscene->scene_number == scene_number)
+        {
+            return pscene;
+        }
+        bucket = (bucket + 1) & SCENE_INDEX_MASK;
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief get the index of scene storage memories, build it on first use
+ * @return index, NULL if there are too many scenes to be indexed
+ */
+scene_index_t *scene_index_attach(scene_storage_memory_t *scenes, uint16_t num_scenes)
+{
+    if (num_scenes >= MODEL_SCENE_INDEX_SIZE)
+    {
+        printw("scene_index_attach: %d scenes exceed index size, use linear search", num_scenes);
+        return NULL;
+    }
+
+    scene_index_t *pindex = scene_index_list;
+    while ((NULL != pindex) && (pindex->scenes != scenes))
+    {
+        pindex = pindex->next;
+    }
+
+    if (NULL == pindex)
+    {
+        pindex = plt_malloc(sizeof(scene_index_t), RAM_TYPE_DATA_ON);
+        if (NULL == pindex)
+        {
+            printe("scene_index_attach: fail to allocate memory for the scene index!");
+            return NULL;
+        }
+        pindex->next = scene_index_list;
+        scene_index_list = pindex;
+    }
+    else if (pindex->num_scenes == num_scenes)
+    {
+        return pindex;
+    }
+
+    pindex->scenes = scenes;
+    pindex->num_scenes = num_scenes;
+    memset(pindex->slot, 0, sizeof(pindex->slot));
+    for (uint16_t i = 0; i < num_scenes; ++i)
+    {
+        if (IS_SCENE_NUMBER_VALID(scenes[i].scene_number))
+        {
+            scene_index_insert(pindex, i);
+        }
+    }
+
+    return pindex;
+}
+
 void scene_server_set_storage_memory(mesh_model_info_p pmodel_info, scene_storage_memory_t *scenes,
                                      uint16_t num_scenes)
 {
     scene_info_t *pinfo = pmodel_info->pargs;
     pinfo->scenes = scenes;
     pinfo->num_scenes = num_scenes;
+    pinfo->pindex = scene_index_attach(scenes, num_scenes);
 }
 
 static scene_storage_memory_t *scene_storage_memory_get(const mesh_model_info_p pmodel_info,
                                                         uint16_t scene_number)
 {
     scene_info_t *pinfo = pmodel_info->pargs;
+    if (NULL != pinfo->pindex)
+    {
+        return scene_index_find(pinfo->pindex, scene_number);
+    }
+
     for (uint16_t i = 0; i < pinfo->num_scenes; ++i)
     {
         if (pinfo->scenes[i].scene_number == scene_number)
@@ -154,7 +285,12 @@ static int32_t scene_trans_step_change(const mesh_model_info_p pmodel_info, uint
 {
     int32_t ret = MODEL_SUCCESS;
     scene_info_t *pinfo = pmodel_info->pargs;
-    scene_storage_memory_t *state_memory = scene_storage_memory_get(pmodel_info, pinfo->target_scene);
+    scene_storage_memory_t *state_memory = pinfo->state_memory;
+    if ((NULL != state_memory) && (state_memory->scene_number != pinfo->target_scene))
+    {
+        /* the storage is reused once the scene is deleted */
+        state_memory = NULL;
+    }
     scene_server_recall_t set_data;
     if (NULL != state_memory)
     {
@@ -247,11 +383,39 @@ static uint16_t scene_process(const mesh_model_info_p pmodel_info,
     return scene_after_set;
 }
 
+bool scene_server_execute(mesh_model_info_p pmodel_info, uint16_t scene_number,
+                          generic_transition_time_t trans_time)
+{
+    scene_info_t *pinfo = pmodel_info->pargs;
+    scene_storage_memory_t *state_memory = scene_storage_memory_get(pmodel_info, scene_number);
+    pinfo->target_scene = scene_number;
+    pinfo->state_memory = state_memory;
+#if MODEL_ENABLE_DELAY_EXECUTION
+    pinfo->trans_time = trans_time;
+    pinfo->delay_time = 0;
+#endif
+    if (NULL == state_memory)
+    {
+        pinfo->status_recall = SCENE_STATUS_NOT_FOUND;
+        return FALSE;
+    }
+
+    scene_process(pmodel_info, state_memory, scene_number, trans_time);
+    pinfo->status_recall = SCENE_STATUS_SUCCESS;
+    return TRUE;
+}
+
 #if MODEL_ENABLE_DELAY_EXECUTION
 static int32_t scene_delay_execution(mesh_model_info_t *pmodel_info, uint32_t delay_type)
 {
     scene_info_t *pinfo = pmodel_info->pargs;
     pinfo->delay_time = 0;
+    if (pinfo->state_memory->scene_number != pinfo->target_scene)
+    {
+        /* scene has been deleted before delay done */
+        pinfo->status_recall = SCENE_STATUS_NOT_FOUND;
+        return 0;
+    }
     scene_process(pmodel_info, pinfo->state_memory, pinfo->target_scene, pinfo->trans_time);
 
     return 0;
@@ -326,10 +490,10 @@ static bool scene_server_receive(mesh_msg_p pmesh_msg)
                     uint16_t current_scene = 0;
                     pinfo->target_scene = pmsg->scene_number;
                     scene_storage_memory_t *state_memory = scene_storage_memory_get(pmodel_info, pmsg->scene_number);
+                    pinfo->state_memory = state_memory;
 #if MODEL_ENABLE_DELAY_EXECUTION
                     pinfo->trans_time = trans_time;
                     pinfo->delay_time = delay_time;
-                    pinfo->state_memory = state_memory;
 #endif
                     if (NULL != state_memory)
                     {
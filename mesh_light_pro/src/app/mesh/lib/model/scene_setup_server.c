@@ -13,10 +13,13 @@
 
 #include "scene.h"
 
+typedef struct _scene_index_t scene_index_t;
+
 typedef struct
 {
     scene_storage_memory_t *scenes;
     uint16_t num_scenes;
+    scene_index_t *pindex;
     scene_status_code_t status_register;
 } scene_setup_info_t;
 
@@ -25,6 +28,10 @@ extern uint16_t get_current_scene(const mesh_model_info_p pmodel_info);
 extern mesh_msg_send_cause_t scene_register_status(mesh_model_info_p pmodel_info, uint16_t dst,
                                                    uint16_t app_key_index,
                                                    scene_status_code_t status, uint16_t current_scene);
+extern scene_index_t *scene_index_attach(scene_storage_memory_t *scenes, uint16_t num_scenes);
+extern scene_storage_memory_t *scene_index_find(const scene_index_t *pindex, uint16_t scene_number);
+extern void scene_index_insert(scene_index_t *pindex, uint16_t position);
+extern void scene_index_remove(scene_index_t *pindex, uint16_t position);
 
 
 
@@ -34,6 +41,31 @@ void scene_setup_server_set_storage_memory(mesh_model_info_p pmodel_info,
     scene_setup_info_t *info = pmodel_info->pargs;
     info->scenes = scenes;
     info->num_scenes = num_scenes;
+    info->pindex = scene_index_attach(scenes, num_scenes);
+}
+
+/**
+ * @brief find scene position
+ * @return position, num_scenes if not found
+ */
+static uint16_t scene_setup_position_get(const scene_setup_info_t *pinfo, uint16_t scene_number)
+{
+    if (NULL != pinfo->pindex)
+    {
+        scene_storage_memory_t *pscene = scene_index_find(pinfo->pindex, scene_number);
+        return (NULL == pscene) ? pinfo->num_scenes : (pscene - pinfo->scenes);
+    }
+
+    uint16_t index;
+    for (index = 0; index < pinfo->num_scenes; ++index)
+    {
+        if (scene_number == pinfo->scenes[index].scene_number)
+        {
+            break;
+        }
+    }
+
+    return index;
 }
 
 static bool scene_setup_server_receive(mesh_msg_p pmesh_msg)
@@ -52,20 +84,17 @@ static bool scene_setup_server_receive(mesh_msg_p pmesh_msg)
             if (IS_SCENE_NUMBER_VALID(pmsg->scene_number))
             {
                 scene_setup_info_t *pinfo = pmodel_info->pargs;
-                uint16_t index = 0;
+                uint16_t index = scene_setup_position_get(pinfo, pmsg->scene_number);
                 uint16_t empty_index = pinfo->num_scenes;
-                /* find store place */
-                for (index = 0; index < pinfo->num_scenes; ++index)
+                if (index >= pinfo->num_scenes)
                 {
-                    if (0 == pinfo->scenes[index].scene_number)
-                    {
-                        /* store to last empty location, just for easy process */
-                        empty_index = index;
-                    }
-
-                    if (pmsg->scene_number == pinfo->scenes[index].scene_number)
+                    /* find store place */
+                    for (empty_index = 0; empty_index < pinfo->num_scenes; ++empty_index)
                     {
-                        break;
+                        if (0 == pinfo->scenes[empty_index].scene_number)
+                        {
+                            break;
+                        }
                     }
                 }
 
@@ -82,6 +111,10 @@ static bool scene_setup_server_receive(mesh_msg_p pmesh_msg)
                     /* store new */
                     store_data.scene_number = pmsg->scene_number;
                     pinfo->scenes[empty_index].scene_number = pmsg->scene_number;
+                    if (NULL != pinfo->pindex)
+                    {
+                        scene_index_insert(pinfo->pindex, empty_index);
+                    }
                     store_data.pmemory = pinfo->scenes[empty_index].pmemory;
                 }
                 else
@@ -116,19 +149,16 @@ static bool scene_setup_server_receive(mesh_msg_p pmesh_msg)
             {
                 /* find store index */
                 scene_setup_info_t *pinfo = pmodel_info->pargs;
-                uint16_t index = 0;
-                for (index = 0; index < pinfo->num_scenes; ++index)
-                {
-                    if (pmsg->scene_number == pinfo->scenes[index].scene_number)
-                    {
-                        break;
-                    }
-                }
+                uint16_t index = scene_setup_position_get(pinfo, pmsg->scene_number);
 
                 pinfo->status_register = SCENE_STATUS_SUCCESS;
                 if (index < pinfo->num_scenes)
                 {
                     /* delete exists */
+                    if (NULL != pinfo->pindex)
+                    {
+                        scene_index_remove(pinfo->pindex, index);
+                    }
                     pinfo->scenes[index].scene_number = 0;
                 }
                 else
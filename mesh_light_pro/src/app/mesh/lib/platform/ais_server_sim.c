@@ -0,0 +1,335 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     ais_server_sim.c
+  * @brief    Host test of the ais server ota staging.
+  * @details  A phone sends images of word aligned and odd sizes to the real ais server in frames
+  *           of several lengths, and resends from the reported size when a program call fails.
+  *           The flash takes whole words only, like sil_dfu_update, clears bits on write and is
+  *           erased when the image reaches a sector. Every run checks the fw info state, the
+  *           programmed image, the erased padding behind it, that the streaming crc matched
+  *           without a read back, and the heap. Build it on a linux host with the keil include
+  *           path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> ais_server_sim.c
+  *           platform_sim.c -o ais_server_sim
+  *           and run it with the program failure rate in percent of the calls,
+  *           e.g. ./ais_server_sim 5
+  * @note     ais_server.c is included to reach its context.
+  * @author   bill
+  * @date     2018-12-26
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+/* product values of the ali light board */
+#define ALI_PRODUCT_ID                      973
+#define ALI_VERSION_ID                      0x00000001
+
+#include "ais_server.c"
+
+#define AIS_SIM_FLASH_SIZE                  OTA_TMP_SIZE
+#define AIS_SIM_FRAME_MAX                   236
+#define AIS_SIM_TRY_MAX                     100000
+#define AIS_SIM_SECTOR_SIZE                 0x1000
+
+typedef struct
+{
+    uint32_t frames;
+    uint32_t resends;
+    uint32_t prog_calls;
+    uint32_t prog_fails;
+    uint32_t unaligned; //!< program calls sil_dfu_update would reject
+    uint32_t read_backs; //!< dfu_check_checksum fallbacks
+    bool ready;
+    bool rebooted;
+} ais_sim_result_t;
+
+static ais_sim_result_t ais_sim_result;
+static uint32_t ais_sim_fail_percent;
+static uint8_t ais_sim_image[AIS_SIM_FLASH_SIZE];
+static uint8_t ais_sim_flash[AIS_SIM_FLASH_SIZE];
+static uint8_t ais_sim_notif[32];
+static uint16_t ais_sim_notif_len;
+static uint64_t ais_sim_rng = 1;
+
+void *evt_queue_handle = &evt_queue_handle;
+void *io_queue_handle = &io_queue_handle;
+
+static uint32_t ais_sim_rand(void)
+{
+    ais_sim_rng ^= ais_sim_rng >> 12;
+    ais_sim_rng ^= ais_sim_rng << 25;
+    ais_sim_rng ^= ais_sim_rng >> 27;
+    return (uint32_t)((ais_sim_rng * 2685821657736338717ULL) >> 32);
+}
+
+static uint16_t ais_sim_crc16(const uint8_t *pdata, uint32_t len)
+{
+    uint16_t crc = AIS_OTA_CRC16_INIT;
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        crc ^= (uint16_t)pdata[i] << 8;
+        for (uint8_t bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+/** os and stack */
+bool os_msg_send_intern(void *p_handle, void *p_msg, uint32_t wait_ms, const char *p_func,
+                        uint32_t file_line)
+{
+    return true;
+}
+
+bool server_send_data(uint8_t conn_id, T_SERVER_ID service_id, uint16_t attrib_index,
+                      uint8_t *p_data, uint16_t data_len, T_GATT_PDU_TYPE type)
+{
+    ais_sim_notif_len = MIN(data_len, sizeof(ais_sim_notif));
+    memcpy(ais_sim_notif, p_data, ais_sim_notif_len);
+    return true;
+}
+
+bool server_add_service(T_SERVER_ID *p_out_service_id, uint8_t *p_database, uint16_t length,
+                        const T_FUN_GATT_SERVICE_CBS srv_cbs)
+{
+    *p_out_service_id = 1;
+    return true;
+}
+
+T_GAP_CAUSE gap_get_param(T_GAP_PARAM_TYPE param, void *p_value)
+{
+    return GAP_CAUSE_SUCCESS;
+}
+
+void mesh_reboot(mesh_reboot_reason_t reason, uint32_t delay_ms)
+{
+    ais_sim_result.rebooted = TRUE;
+}
+
+bool gap_sched_link_check(void)
+{
+    return TRUE;
+}
+
+void *gap_sched_task_get(void)
+{
+    return NULL;
+}
+
+void bearer_send(bearer_pkt_type_t pkt_type, uint8_t *pbuffer, uint16_t data_len)
+{
+}
+
+uint32_t get_header_addr_by_img_id(T_IMG_ID image_id)
+{
+    return 0;
+}
+
+/** flash: whole words only, nor cells only clear bits, a sector erase sets them again */
+bool unlock_flash_all(void)
+{
+    return true;
+}
+
+void lock_flash(void)
+{
+}
+
+bool flash_lock(T_LOCK_TYPE flash_lock_mode)
+{
+    return true;
+}
+
+void flash_unlock(T_LOCK_TYPE flash_lock_mode)
+{
+}
+
+uint32_t sil_dfu_update(uint16_t signature, uint32_t offset, uint32_t length, uint32_t *p_void)
+{
+    ais_sim_result.prog_calls ++;
+    if ((length % 4) || (offset % 4))
+    {
+        ais_sim_result.unaligned ++;
+        return __LINE__;
+    }
+    if (offset + length > AIS_SIM_FLASH_SIZE)
+    {
+        return __LINE__;
+    }
+    /* the sectors are erased when the image reaches them */
+    for (uint32_t sector = (offset + AIS_SIM_SECTOR_SIZE - 1) & ~(AIS_SIM_SECTOR_SIZE - 1);
+         sector < offset + length; sector += AIS_SIM_SECTOR_SIZE)
+    {
+        memset(ais_sim_flash + sector, 0xff, AIS_SIM_SECTOR_SIZE);
+    }
+    if (ais_sim_rand() % 100 < ais_sim_fail_percent)
+    {
+        /* half of the words are written before the failure */
+        length = length / 8 * 4;
+        ais_sim_result.prog_fails ++;
+        for (uint32_t i = 0; i < length; ++i)
+        {
+            ais_sim_flash[offset + i] &= ((uint8_t *)p_void)[i];
+        }
+        return __LINE__;
+    }
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        ais_sim_flash[offset + i] &= ((uint8_t *)p_void)[i];
+    }
+    return 0;
+}
+
+uint32_t sil_dfu_set_ready(uint16_t signature)
+{
+    ais_sim_result.ready = TRUE;
+    return 0;
+}
+
+bool dfu_check_checksum(uint16_t signature)
+{
+    ais_sim_result.read_backs ++;
+    return 0 == memcmp(ais_sim_flash, ais_sim_image, ais_server_ctx.ota.image_size);
+}
+
+/** phone */
+static void ais_sim_phone_send(ais_cmd_t cmd, uint8_t seq, const void *pdata, uint8_t len)
+{
+    uint8_t buffer[sizeof(ais_header_t) + AIS_SIM_FRAME_MAX];
+    ais_pdu_t *pmsg = (ais_pdu_t *)buffer;
+    memset(buffer, 0, sizeof(buffer));
+    pmsg->header.cmd = cmd;
+    pmsg->header.frame_seq = seq;
+    pmsg->header.frame_num = 15;
+    pmsg->header.frame_len = len;
+    memcpy(pmsg->payload, pdata, len);
+    ais_sim_notif_len = 0;
+    ais_server_handle_msg(0, pmsg, sizeof(ais_header_t) + len);
+}
+
+/**
+ * @brief run one ota of the image
+ * @return the error number
+ */
+static uint32_t ais_sim_run(uint32_t image_len, uint8_t frame_len)
+{
+    uint32_t errors = 0;
+    memset(&ais_sim_result, 0, sizeof(ais_sim_result));
+    memset(ais_sim_flash, 0, sizeof(ais_sim_flash));
+    for (uint32_t i = 0; i < image_len; ++i)
+    {
+        ais_sim_image[i] = ais_sim_rand();
+    }
+    T_IMG_HEADER_FORMAT *pheader = (T_IMG_HEADER_FORMAT *)ais_sim_image;
+    pheader->ctrl_header.image_id = ais_image_id[AIS_IMAGE_TYPE_APP];
+
+    ais_ota_upd_req_t req = {AIS_IMAGE_TYPE_APP, ALI_VERSION_ID + 1, image_len,
+                             ais_sim_crc16(ais_sim_image, image_len), AIS_OTA_TYPE_FULL
+                            };
+    ais_sim_phone_send(AIS_OTA_UPD_REQ, 0, &req, sizeof(req));
+    ais_pdu_t *presp = (ais_pdu_t *)ais_sim_notif;
+    if ((AIS_OTA_UPD_RESP != presp->header.cmd) || (1 != presp->ota_upd_resp.state))
+    {
+        printf("%u bytes: update request refused\n", image_len);
+        return 1;
+    }
+
+    uint32_t offset = 0;
+    uint8_t seq = 0;
+    for (uint32_t tries = 0; (offset < image_len) && (tries < AIS_SIM_TRY_MAX); ++tries)
+    {
+        uint8_t len = MIN(frame_len, image_len - offset);
+        ais_sim_phone_send(AIS_OTA_FW_DATA, seq, ais_sim_image + offset, len);
+        ais_sim_result.frames ++;
+        if (AIS_OTA_FRAME_INFO != presp->header.cmd)
+        {
+            printf("%u bytes: no frame info at %u\n", image_len, offset);
+            return 1;
+        }
+        seq = (presp->ota_frame_info.frame_seq + 1) % 16;
+        if (presp->ota_frame_info.rx_size != offset + len)
+        {
+            ais_sim_result.resends ++;
+        }
+        offset = presp->ota_frame_info.rx_size;
+    }
+
+    ais_ota_fw_info_req_t info_req = {1};
+    ais_sim_phone_send(AIS_OTA_FW_INFO_REQ, 0, &info_req, sizeof(info_req));
+    if ((AIS_OTA_FW_INFO != presp->header.cmd) || (1 != presp->ota_fw_info.state) ||
+        !ais_sim_result.rebooted)
+    {
+        printf("%u bytes, %u byte frames: ota failed, %u of %u program calls unaligned\n",
+               image_len, frame_len, ais_sim_result.unaligned, ais_sim_result.prog_calls);
+        errors ++;
+    }
+    if (0 != memcmp(ais_sim_flash, ais_sim_image, image_len))
+    {
+        printf("%u bytes, %u byte frames: image corrupted\n", image_len, frame_len);
+        errors ++;
+    }
+    for (uint32_t i = image_len; i < ((image_len + 3) & ~3); ++i)
+    {
+        if (0xff != ais_sim_flash[i])
+        {
+            printf("%u bytes, %u byte frames: padding 0x%02x at %u\n", image_len, frame_len,
+                   ais_sim_flash[i], i);
+            errors ++;
+        }
+    }
+    if (!ais_sim_result.ready || ais_sim_result.read_backs)
+    {
+        printf("%u bytes, %u byte frames: streaming crc not matched\n", image_len, frame_len);
+        errors ++;
+    }
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    ais_sim_fail_percent = (argc > 1) ? strtoul(argv[1], NULL, 0) : 0;
+
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    plt_sim_stat_clear();
+
+    printf("%u%% program failures\n", ais_sim_fail_percent);
+    printf("   image frame frames resends program calls fails\n");
+    static const uint32_t image_lens[] = {1024, 4097, 4098, 4099, 65536, 100003};
+    static const uint8_t frame_lens[] = {16, 96, 236};
+    uint32_t errors = 0;
+    for (uint32_t i = 0; i < sizeof(image_lens) / sizeof(image_lens[0]); ++i)
+    {
+        for (uint32_t f = 0; f < sizeof(frame_lens); ++f)
+        {
+            errors += ais_sim_run(image_lens[i], frame_lens[f]);
+            printf("%8u %5u %6u %7u %13u %5u\n", image_lens[i], frame_lens[f],
+                   ais_sim_result.frames, ais_sim_result.resends, ais_sim_result.prog_calls,
+                   ais_sim_result.prog_fails);
+        }
+    }
+
+    plt_sim_stat_t stat;
+    plt_sim_stat_get(&stat);
+    if (0 != stat.mem_used)
+    {
+        printf("%u bytes leaked\n", stat.mem_used);
+        errors ++;
+    }
+    printf("%s\n", errors ? "FAIL" : "PASS");
+    return errors ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
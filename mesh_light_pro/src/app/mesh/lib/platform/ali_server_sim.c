@@ -0,0 +1,421 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     ali_server_sim.c
+  * @brief    Host fuzz test and benchmark of the ali attribute parsing.
+  * @details  ali_attrs_parse is fed random buffers, valid attribute lists and valid lists which
+  *           are truncated or have a bit flipped, each one copied to a heap buffer of exactly its
+  *           length, so that the address sanitizer catches a read past the end. The result is
+  *           checked against a plain walk of the type, length and value triplets. The time to
+  *           parse a set of on off, lightness, temperature and hsl is reported. Then ali set, get
+  *           and unacknowledged set messages are fed to the ali server of the light: one set
+  *           updates the light once and is answered once, an invalid or truncated set is
+  *           neither applied nor answered, the scene mode is the base of the other attributes,
+  *           off wins and the unacknowledged sets within ALI_INDICATE_DELAY are indicated once.
+  *           Build it on a linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> ali_server_sim.c
+  *           light_controller_app.c platform_sim.c -lm -o ali_server_sim
+  *           and add -fsanitize=address to catch the overreads. Run it with the number of fuzz
+  *           cases, e.g. ./ali_server_sim 2000000
+  * @author   bill
+  * @date     2018-12-26
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+/* the ali server model and the light state of the app are static */
+#include "dimmable_light.c"
+#include "light_cwrgb_app.c"
+#include "ali_server.c"
+#include "ali_server_app.c"
+
+#define ALI_SERVER_SIM_SENT_NUM             8
+#define ALI_SERVER_SIM_MSG_SIZE             64
+#define ALI_SERVER_SIM_COST_LOOPS           50000000
+#define ALI_SERVER_SIM_SRC                  0x0001
+#define ALI_SERVER_SIM_PUB_DST              0xfeed
+#define ALI_SERVER_SIM_SCENE                7
+
+#define ALI_SERVER_SIM_CHECK(cond) \
+    do \
+    { \
+        if (!(cond)) \
+        { \
+            printf("  line %d: %s\n", __LINE__, #cond); \
+            ali_server_sim_fails ++; \
+        } \
+    } while (0)
+
+static uint8_t ali_server_sim_sent[ALI_SERVER_SIM_SENT_NUM][ALI_SERVER_SIM_MSG_SIZE];
+static uint16_t ali_server_sim_sent_len[ALI_SERVER_SIM_SENT_NUM];
+static uint16_t ali_server_sim_sent_dst[ALI_SERVER_SIM_SENT_NUM];
+static uint32_t ali_server_sim_sent_num;
+static uint32_t ali_server_sim_store_num;
+static uint32_t ali_server_sim_fails;
+static uint64_t ali_server_sim_rng = 1;
+static light_ctl_hsl_scene_t ali_server_sim_scene = {{30000, 5000, 0}, {20000, 10000, 40000}};
+
+/* the server sends and publishes through the access layer, not linked here */
+mesh_msg_send_cause_t access_cfg(mesh_msg_p pmsg)
+{
+    pmsg->dst = ALI_SERVER_SIM_PUB_DST;
+    pmsg->app_key_index = 0;
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+mesh_msg_send_cause_t access_send(mesh_msg_p pmsg)
+{
+    if (ali_server_sim_sent_num < ALI_SERVER_SIM_SENT_NUM)
+    {
+        memcpy(ali_server_sim_sent[ali_server_sim_sent_num], pmsg->pbuffer, pmsg->msg_len);
+        ali_server_sim_sent_len[ali_server_sim_sent_num] = pmsg->msg_len;
+        ali_server_sim_sent_dst[ali_server_sim_sent_num] = pmsg->dst;
+    }
+    ali_server_sim_sent_num ++;
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+bool mesh_model_reg(uint8_t element_index, mesh_model_info_p pmodel_info)
+{
+    UNUSED(element_index);
+    UNUSED(pmodel_info);
+    return TRUE;
+}
+
+bool mesh_model_pub_check(mesh_model_info_p pmodel_info)
+{
+    UNUSED(pmodel_info);
+    return TRUE;
+}
+
+/* the scenes and the light state live in the storage module, not linked here */
+const void *light_scene_state_get(uint16_t scene_number)
+{
+    return (ALI_SERVER_SIM_SCENE == scene_number) ? &ali_server_sim_scene : NULL;
+}
+
+bool light_state_store(void)
+{
+    ali_server_sim_store_num ++;
+    return TRUE;
+}
+
+static uint32_t ali_server_sim_rand(void)
+{
+    /* xorshift64* */
+    ali_server_sim_rng ^= ali_server_sim_rng >> 12;
+    ali_server_sim_rng ^= ali_server_sim_rng << 25;
+    ali_server_sim_rng ^= ali_server_sim_rng >> 27;
+    return (uint32_t)((ali_server_sim_rng * 2685821657736338717ULL) >> 32);
+}
+
+/* the attributes of a valid list, -1 if the list is invalid */
+static int32_t ali_server_sim_walk(const uint8_t *pdata, uint16_t len, uint8_t max_num)
+{
+    int32_t num = 0;
+    uint32_t offset = 0;
+    while (offset < len)
+    {
+        if ((len - offset < ALI_ATTR_HEADER_SIZE) || (num >= max_num))
+        {
+            return -1;
+        }
+        offset += ALI_ATTR_HEADER_SIZE + LE_EXTRN2WORD(pdata + offset + 2);
+        if (offset > len)
+        {
+            return -1;
+        }
+        num ++;
+    }
+    return num ? num : -1;
+}
+
+static uint16_t ali_server_sim_put(uint8_t *pdata, uint16_t type, uint16_t len,
+                                   const uint8_t *pvalue)
+{
+    LE_WORD2EXTRN(pdata, type);
+    LE_WORD2EXTRN(pdata + 2, len);
+    memcpy(pdata + ALI_ATTR_HEADER_SIZE, pvalue, len);
+    return ALI_ATTR_HEADER_SIZE + len;
+}
+
+/* hand an access message to the ali server as the access layer does */
+static void ali_server_sim_receive(uint32_t opcode, const uint8_t *ppayload, uint16_t len)
+{
+    uint8_t buf[ACCESS_OPCODE_SIZE(MESH_MSG_ALI_SET) + ALI_SERVER_SIM_MSG_SIZE];
+    ACCESS_OPCODE_BYTE(buf, opcode);
+    memcpy(buf + ACCESS_OPCODE_SIZE(opcode), ppayload, len);
+    mesh_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.pbuffer = buf;
+    msg.msg_len = ACCESS_OPCODE_SIZE(opcode) + len;
+    msg.access_opcode = opcode;
+    msg.pmodel_info = &ali_server;
+    msg.src = ALI_SERVER_SIM_SRC;
+    ali_server.model_receive(&msg);
+}
+
+/* one fuzz case of up to ALI_SERVER_SIM_MSG_SIZE bytes */
+static uint16_t ali_server_sim_case(uint32_t index, uint8_t *pdata)
+{
+    uint16_t len = 0;
+    if (0 == index % 3)
+    {
+        len = ali_server_sim_rand() % ALI_SERVER_SIM_MSG_SIZE;
+        for (uint16_t i = 0; i < len; ++i)
+        {
+            pdata[i] = ali_server_sim_rand();
+        }
+        if (ali_server_sim_rand() & 1)
+        {
+            /* plausible lengths */
+            for (uint16_t i = 3; i < len; i += 4)
+            {
+                pdata[i] = 0;
+            }
+        }
+        return len;
+    }
+
+    uint8_t num = 1 + ali_server_sim_rand() % 10;
+    for (uint8_t k = 0; (k < num) &&
+         (len + ALI_ATTR_HEADER_SIZE + ALI_ATTR_VALUE_MAX_LEN <= ALI_SERVER_SIM_MSG_SIZE); ++k)
+    {
+        uint8_t value[ALI_ATTR_VALUE_MAX_LEN];
+        for (uint8_t i = 0; i < ALI_ATTR_VALUE_MAX_LEN; ++i)
+        {
+            value[i] = ali_server_sim_rand();
+        }
+        len += ali_server_sim_put(pdata + len, ali_server_sim_rand(),
+                                  ali_server_sim_rand() % (ALI_ATTR_VALUE_MAX_LEN + 1), value);
+    }
+    if (2 == index % 3)
+    {
+        len = ali_server_sim_rand() % (len + 1);
+    }
+    if ((0 == ali_server_sim_rand() % 4) && len)
+    {
+        pdata[ali_server_sim_rand() % len] ^= 1 << (ali_server_sim_rand() % 8);
+    }
+    return len;
+}
+
+static void ali_server_sim_fuzz(uint32_t cases)
+{
+    uint32_t valid = 0;
+    uint32_t fails = ali_server_sim_fails;
+    for (uint32_t n = 0; (n < cases) && (ali_server_sim_fails - fails < 10); ++n)
+    {
+        uint8_t data[ALI_SERVER_SIM_MSG_SIZE];
+        uint16_t len = ali_server_sim_case(n, data);
+        /* exactly len bytes, the sanitizer catches a read past the end */
+        uint8_t *pdata = malloc(len ? len : 1);
+        memcpy(pdata, data, len);
+        ali_attr_t attrs[ALI_ATTR_MAX_NUM];
+        uint8_t num = ALI_ATTR_MAX_NUM;
+        bool ok = ali_attrs_parse(pdata, len, attrs, &num);
+        int32_t walk = ali_server_sim_walk(pdata, len, ALI_ATTR_MAX_NUM);
+        ALI_SERVER_SIM_CHECK(ok == (walk > 0));
+        if (ok)
+        {
+            const uint8_t *pattr = pdata;
+            ALI_SERVER_SIM_CHECK(num == walk);
+            for (uint8_t i = 0; i < num; ++i)
+            {
+                ALI_SERVER_SIM_CHECK(attrs[i].pvalue == pattr + ALI_ATTR_HEADER_SIZE);
+                ALI_SERVER_SIM_CHECK(attrs[i].pvalue + attrs[i].len <= pdata + len);
+                pattr += ALI_ATTR_HEADER_SIZE + attrs[i].len;
+            }
+            ALI_SERVER_SIM_CHECK(pattr == pdata + len);
+            valid ++;
+        }
+        free(pdata);
+    }
+    printf("fuzz: %u cases, %u valid, %u failures\n", cases, valid, ali_server_sim_fails - fails);
+}
+
+/* on off, lightness, temperature and hsl */
+static uint16_t ali_server_sim_set_build(uint8_t *pdata)
+{
+    const uint8_t on[1] = {1};
+    const uint8_t lightness[2] = {0x10, 0x27};
+    const uint8_t temperature[2] = {0x88, 0x13};
+    const uint8_t hsl[6] = {0x20, 0x4e, 0x10, 0x27, 0x40, 0x9c};
+    uint16_t len = 0;
+    len += ali_server_sim_put(pdata + len, ALI_ATTR_TYPE_ON_OFF, sizeof(on), on);
+    len += ali_server_sim_put(pdata + len, ALI_ATTR_TYPE_LIGHTNESS, sizeof(lightness), lightness);
+    len += ali_server_sim_put(pdata + len, ALI_ATTR_TYPE_TEMPERATURE, sizeof(temperature),
+                              temperature);
+    len += ali_server_sim_put(pdata + len, ALI_ATTR_TYPE_HSL, sizeof(hsl), hsl);
+    return len;
+}
+
+static void ali_server_sim_cost(void)
+{
+    uint8_t set[ALI_SERVER_SIM_MSG_SIZE];
+    uint16_t len = ali_server_sim_set_build(set);
+    volatile uint32_t sink = 0;
+    struct timespec begin;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &begin);
+    for (uint32_t i = 0; i < ALI_SERVER_SIM_COST_LOOPS; ++i)
+    {
+        ali_attr_t attrs[ALI_ATTR_MAX_NUM];
+        uint8_t num = ALI_ATTR_MAX_NUM;
+        /* the type changes, the parse can not be hoisted */
+        set[0] ^= (i & 1);
+        ali_attrs_parse(set, len, attrs, &num);
+        sink += num + attrs[num - 1].len;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double ns = ((end.tv_sec - begin.tv_sec) * 1e9 + (end.tv_nsec - begin.tv_nsec)) /
+                ALI_SERVER_SIM_COST_LOOPS;
+    printf("parse on the host: %u bytes, 4 attributes, %.1f ns, %.0f MB/s (%u)\n", len, ns,
+           len / ns * 1e3, sink & 1);
+}
+
+static void ali_server_sim_messages(void)
+{
+    const uint8_t lightness[2] = {0x10, 0x27};
+    const uint8_t temperature[2] = {0x88, 0x13};
+    uint8_t set[ALI_SERVER_SIM_MSG_SIZE];
+    uint16_t set_len = ali_server_sim_set_build(set);
+    ali_server_models_init(0);
+    plt_sim_log_enable(FALSE);
+
+    /* one set, one light update, one stat back to the source */
+    uint8_t msg[ALI_SERVER_SIM_MSG_SIZE + 1];
+    msg[0] = 0x42;
+    memcpy(msg + 1, set, set_len);
+    ali_server_sim_sent_num = 0;
+    ali_server_sim_store_num = 0;
+    ali_server_sim_receive(MESH_MSG_ALI_SET, msg, 1 + set_len);
+    light_ctl_t ctl = light_get_ctl();
+    light_hsl_t hsl = light_get_hsl();
+    printf("set: ctl %u %uK, hsl %u %u %u, sent %u, stored %u\n", ctl.lightness, ctl.temperature,
+           hsl.lightness, hsl.hue, hsl.saturation, ali_server_sim_sent_num,
+           ali_server_sim_store_num);
+    ALI_SERVER_SIM_CHECK((10000 == ctl.lightness) && (5000 == ctl.temperature));
+    ALI_SERVER_SIM_CHECK((20000 == hsl.lightness) && (10000 == hsl.hue) &&
+                         (40000 == hsl.saturation));
+    ALI_SERVER_SIM_CHECK((1 == ali_server_sim_sent_num) && (1 == ali_server_sim_store_num) &&
+                         (ALI_SERVER_SIM_SRC == ali_server_sim_sent_dst[0]));
+    ALI_SERVER_SIM_CHECK(ali_server_sim_sent_len[0] == ACCESS_OPCODE_SIZE(MESH_MSG_ALI_STAT) + 1 +
+                         set_len);
+    ALI_SERVER_SIM_CHECK((0x42 == ali_server_sim_sent[0][MEMBER_OFFSET(ali_stat_t, tid)]) &&
+                         (0 == memcmp(ali_server_sim_sent[0] + MEMBER_OFFSET(ali_stat_t, type), set,
+                                      set_len)));
+
+    /* an invalid attribute leaves the light alone and is not answered */
+    const uint8_t bad_temperature[2] = {0x10, 0x00};
+    uint8_t bad[ALI_SERVER_SIM_MSG_SIZE];
+    uint16_t bad_len = 1;
+    bad[0] = 0x43;
+    bad_len += ali_server_sim_put(bad + bad_len, ALI_ATTR_TYPE_LIGHTNESS, sizeof(temperature),
+                                  temperature);
+    bad_len += ali_server_sim_put(bad + bad_len, ALI_ATTR_TYPE_TEMPERATURE,
+                                  sizeof(bad_temperature), bad_temperature);
+    ali_server_sim_sent_num = 0;
+    ali_server_sim_receive(MESH_MSG_ALI_SET, bad, bad_len);
+    ALI_SERVER_SIM_CHECK((10000 == light_get_ctl().lightness) && (0 == ali_server_sim_sent_num));
+    /* a valid temperature, but the message is one byte short of it */
+    bad[bad_len - 2] = 0x88;
+    bad[bad_len - 1] = 0x13;
+    ali_server_sim_receive(MESH_MSG_ALI_SET, bad, bad_len - 1);
+    ALI_SERVER_SIM_CHECK((10000 == light_get_ctl().lightness) && (0 == ali_server_sim_sent_num));
+
+    /* the scene mode is the base, the lightness overrides it */
+    uint8_t scene[2] = {ALI_SERVER_SIM_SCENE, 0};
+    uint8_t scene_msg[ALI_SERVER_SIM_MSG_SIZE];
+    uint16_t scene_len = 1;
+    scene_msg[0] = 0x44;
+    scene_len += ali_server_sim_put(scene_msg + scene_len, ALI_ATTR_TYPE_SCENE_MODE, sizeof(scene),
+                                    scene);
+    scene_len += ali_server_sim_put(scene_msg + scene_len, ALI_ATTR_TYPE_LIGHTNESS,
+                                    sizeof(lightness), lightness);
+    ali_server_sim_receive(MESH_MSG_ALI_SET, scene_msg, scene_len);
+    ctl = light_get_ctl();
+    hsl = light_get_hsl();
+    ALI_SERVER_SIM_CHECK((10000 == ctl.lightness) && (5000 == ctl.temperature) &&
+                         (10000 == hsl.lightness) && (40000 == hsl.saturation));
+    /* a missing scene is not answered */
+    scene[0] = ALI_SERVER_SIM_SCENE + 1;
+    scene_len = 1;
+    scene_len += ali_server_sim_put(scene_msg + scene_len, ALI_ATTR_TYPE_SCENE_MODE, sizeof(scene),
+                                    scene);
+    ali_server_sim_sent_num = 0;
+    ali_server_sim_receive(MESH_MSG_ALI_SET, scene_msg, scene_len);
+    ALI_SERVER_SIM_CHECK(0 == ali_server_sim_sent_num);
+
+    /* several attributes in one get, on off is reported on */
+    uint8_t get[7] = {0x45};
+    LE_WORD2EXTRN(get + 1, ALI_ATTR_TYPE_ON_OFF);
+    LE_WORD2EXTRN(get + 3, ALI_ATTR_TYPE_SCENE_MODE);
+    LE_WORD2EXTRN(get + 5, ALI_ATTR_TYPE_TEMPERATURE);
+    ali_server_sim_sent_num = 0;
+    ali_server_sim_receive(MESH_MSG_ALI_GET, get, sizeof(get));
+    uint16_t stat_len = MEMBER_OFFSET(ali_stat_t, type) + (ALI_ATTR_HEADER_SIZE + 1) +
+                        2 * (ALI_ATTR_HEADER_SIZE + 2);
+    ALI_SERVER_SIM_CHECK((1 == ali_server_sim_sent_num) &&
+                         (stat_len == ali_server_sim_sent_len[0]) &&
+                         (1 == ali_server_sim_sent[0][MEMBER_OFFSET(ali_stat_t, type) +
+                                                      ALI_ATTR_HEADER_SIZE]));
+
+    /* off wins over the rest */
+    const uint8_t off[1] = {0};
+    uint8_t off_msg[ALI_SERVER_SIM_MSG_SIZE];
+    uint16_t off_len = 1;
+    off_msg[0] = 0x46;
+    off_len += ali_server_sim_put(off_msg + off_len, ALI_ATTR_TYPE_LIGHTNESS, sizeof(lightness),
+                                  lightness);
+    off_len += ali_server_sim_put(off_msg + off_len, ALI_ATTR_TYPE_ON_OFF, sizeof(off), off);
+    ali_server_sim_receive(MESH_MSG_ALI_SET, off_msg, off_len);
+    ALI_SERVER_SIM_CHECK(!ali_light_is_on());
+
+    /* the unacknowledged sets within the window are indicated once, with the last state */
+    uint8_t *plightness = msg + 1 + (ALI_ATTR_HEADER_SIZE + 1) + ALI_ATTR_HEADER_SIZE;
+    ali_server_sim_sent_num = 0;
+    for (uint8_t i = 0; i < 5; ++i)
+    {
+        msg[0] = 0x50 + i;
+        LE_WORD2EXTRN(plightness, 1000 * (i + 1));
+        ali_server_sim_receive(MESH_MSG_ALI_SET_UNACK, msg, 1 + set_len);
+        plt_sim_clock_advance(50);
+    }
+    ALI_SERVER_SIM_CHECK(0 == ali_server_sim_sent_num);
+    plt_sim_clock_advance(ALI_INDICATE_DELAY);
+    printf("indicate: %u stat, len %u\n", ali_server_sim_sent_num, ali_server_sim_sent_len[0]);
+    ALI_SERVER_SIM_CHECK((1 == ali_server_sim_sent_num) &&
+                         (ALI_SERVER_SIM_PUB_DST == ali_server_sim_sent_dst[0]));
+    ALI_SERVER_SIM_CHECK(ali_server_sim_sent_len[0] == MEMBER_OFFSET(ali_stat_t, type) + set_len);
+    ALI_SERVER_SIM_CHECK(5000 == LE_EXTRN2WORD(ali_server_sim_sent[0] +
+                                               MEMBER_OFFSET(ali_stat_t, type) +
+                                               (ALI_ATTR_HEADER_SIZE + 1) + ALI_ATTR_HEADER_SIZE));
+    plt_sim_clock_advance(1000);
+    ALI_SERVER_SIM_CHECK(1 == ali_server_sim_sent_num);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t cases = (argc > 1) ? strtoul(argv[1], NULL, 0) : 2000000;
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+
+    ali_server_sim_fuzz(cases);
+    ali_server_sim_cost();
+    ali_server_sim_messages();
+
+    printf("%s\n", ali_server_sim_fails ? "FAIL" : "PASS");
+    return ali_server_sim_fails ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
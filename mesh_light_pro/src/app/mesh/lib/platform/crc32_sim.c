@@ -0,0 +1,194 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     crc32_sim.c
+  * @brief    Host test and benchmark of crc32.
+  * @details  crc32_update is checked against the known answer of "123456789" and against a
+  *           bitwise reference over random ranges split at random points, as the object transfer
+  *           server feeds it chunk by chunk. Then the bitwise, the byte table, the slice-by-4 of
+  *           crc32.c and a slice-by-8 kernel hash blocks of a chunk, 1K and 4K bytes, the
+  *           throughput is reported. The figures are of the host, compare the kernels with each
+  *           other only. Build it on a linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 <keil include path> crc32_sim.c crc32.c -o crc32_sim
+  *           and run it with the mega bytes hashed by the slice kernels, e.g. ./crc32_sim 256
+  * @author   bill
+  * @date     2018-12-25
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "crc32.h"
+
+#if PLATFORM_HOST_SIM
+
+#define CRC32_SIM_POLY                      0xEDB88320
+#define CRC32_SIM_DATA_SIZE                 8192
+
+typedef uint32_t (*crc32_sim_kernel_t)(uint32_t crc, const uint8_t *pdata, uint32_t len);
+
+static uint8_t crc32_sim_data[CRC32_SIM_DATA_SIZE];
+static uint32_t crc32_sim_table[8][256];
+static uint64_t crc32_sim_rng = 1;
+
+static uint32_t crc32_sim_rand(void)
+{
+    /* xorshift64* */
+    crc32_sim_rng ^= crc32_sim_rng >> 12;
+    crc32_sim_rng ^= crc32_sim_rng << 25;
+    crc32_sim_rng ^= crc32_sim_rng >> 27;
+    return (uint32_t)((crc32_sim_rng * 2685821657736338717ULL) >> 32);
+}
+
+static uint32_t crc32_sim_bitwise(uint32_t crc, const uint8_t *pdata, uint32_t len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+        crc ^= *pdata++;
+        for (uint8_t k = 0; k < 8; ++k)
+        {
+            crc = (crc >> 1) ^ (CRC32_SIM_POLY & (0 - (crc & 1)));
+        }
+    }
+    return ~crc;
+}
+
+static void crc32_sim_table_init(void)
+{
+    for (uint32_t i = 0; i < 256; ++i)
+    {
+        uint32_t crc = i;
+        for (uint8_t k = 0; k < 8; ++k)
+        {
+            crc = (crc >> 1) ^ (CRC32_SIM_POLY & (0 - (crc & 1)));
+        }
+        crc32_sim_table[0][i] = crc;
+    }
+    for (uint8_t j = 1; j < 8; ++j)
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            crc32_sim_table[j][i] = (crc32_sim_table[j - 1][i] >> 8) ^
+                                    crc32_sim_table[0][crc32_sim_table[j - 1][i] & 0xff];
+        }
+    }
+}
+
+static uint32_t crc32_sim_byte(uint32_t crc, const uint8_t *pdata, uint32_t len)
+{
+    crc = ~crc;
+    while (len--)
+    {
+        crc = crc32_sim_table[0][(crc ^ *pdata++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/* 8K of tables, twice crc32.c */
+static uint32_t crc32_sim_slice8(uint32_t crc, const uint8_t *pdata, uint32_t len)
+{
+    crc = ~crc;
+    while (len >= 8)
+    {
+        uint32_t low;
+        uint32_t high;
+        memcpy(&low, pdata, 4);
+        memcpy(&high, pdata + 4, 4);
+        low ^= crc;
+        crc = crc32_sim_table[7][low & 0xff] ^ crc32_sim_table[6][(low >> 8) & 0xff] ^
+              crc32_sim_table[5][(low >> 16) & 0xff] ^ crc32_sim_table[4][low >> 24] ^
+              crc32_sim_table[3][high & 0xff] ^ crc32_sim_table[2][(high >> 8) & 0xff] ^
+              crc32_sim_table[1][(high >> 16) & 0xff] ^ crc32_sim_table[0][high >> 24];
+        pdata += 8;
+        len -= 8;
+    }
+    while (len--)
+    {
+        crc = crc32_sim_table[0][(crc ^ *pdata++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static double crc32_sim_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void crc32_sim_bench(const char *name, crc32_sim_kernel_t kernel, uint32_t block,
+                            uint32_t total)
+{
+    volatile uint32_t sink = 0;
+    double begin = crc32_sim_now();
+    for (uint32_t done = 0; done < total; done += block)
+    {
+        /* odd address, the chunks of a block do not start aligned */
+        sink ^= kernel(0, crc32_sim_data + 1, block);
+    }
+    double time = crc32_sim_now() - begin;
+    printf("  %-10s block %4u: %7.1f MB/s\n", name, block, total / time / 1e6);
+    (void)sink;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t mbytes = (argc > 1) ? strtoul(argv[1], NULL, 0) : 256;
+    if (0 == mbytes)
+    {
+        mbytes = 1;
+    }
+    uint32_t fails = 0;
+
+    for (uint32_t i = 0; i < CRC32_SIM_DATA_SIZE; ++i)
+    {
+        crc32_sim_data[i] = crc32_sim_rand();
+    }
+    crc32_sim_table_init();
+
+    if (0xCBF43926 != crc32_update(0, (const uint8_t *)"123456789", 9))
+    {
+        printf("known answer wrong\n");
+        fails ++;
+    }
+    for (uint32_t n = 0; n < 2000; ++n)
+    {
+        uint32_t offset = crc32_sim_rand() % 64;
+        uint32_t len = crc32_sim_rand() % 3000;
+        uint32_t cut = len ? (crc32_sim_rand() % len) : 0;
+        uint32_t crc = crc32_update(crc32_update(0, crc32_sim_data + offset, cut),
+                                    crc32_sim_data + offset + cut, len - cut);
+        if ((crc != crc32_sim_bitwise(0, crc32_sim_data + offset, len)) ||
+            (crc != crc32_sim_slice8(0, crc32_sim_data + offset, len)))
+        {
+            if (fails < 5)
+            {
+                printf("offset %u len %u cut %u: crc 0x%08x wrong\n", offset, len, cut, crc);
+            }
+            fails ++;
+        }
+    }
+    printf("known answer and 2000 split ranges: %u failures\n", fails);
+
+    uint32_t total = mbytes << 20;
+    const uint32_t blocks[] = {100, 1024, 4096};
+    printf("throughput on the host:\n");
+    for (uint8_t i = 0; i < sizeof(blocks) / sizeof(blocks[0]); ++i)
+    {
+        crc32_sim_bench("bitwise", crc32_sim_bitwise, blocks[i], total / 16);
+        crc32_sim_bench("byte", crc32_sim_byte, blocks[i], total / 4);
+        crc32_sim_bench("slice-by-4", crc32_update, blocks[i], total);
+        crc32_sim_bench("slice-by-8", crc32_sim_slice8, blocks[i], total);
+    }
+
+    printf("%s\n", fails ? "FAIL" : "PASS");
+    return fails ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
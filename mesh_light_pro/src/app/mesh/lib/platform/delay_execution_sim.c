@@ -0,0 +1,241 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     delay_execution_sim.c
+  * @brief    Host stress test of the delay execution queue.
+  * @details  Random delayed sets, restarts and stops of many (model, type) pairs arrive every
+  *           millisecond of virtual time, and a part of the callbacks start a new delay of their
+  *           own, so hundreds of delays overlap. Every callback is checked against the deadline
+  *           of its last start: none may fire early, after a stop or twice, and none may be lost.
+  *           The pending high water mark, the lateness, the software timers and the heap
+  *           allocations are reported. Restarts that shorten or lengthen the head entry of the
+  *           queue are checked on their own before the stress run. Build it on a linux host
+  *           with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE -DMODEL_DELAY_EXECUTION_NUM_MAX=250
+  *           <keil include path> delay_execution_sim.c delay_execution.c platform_sim.c
+  *           -o delay_execution_sim
+  *           and run it with the number of operations and the time to spread them over in ms,
+  *           e.g. ./delay_execution_sim 2000 10000
+  * @author   bill
+  * @date     2018-12-20
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mesh_api.h"
+#include "delay_execution.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define DELAY_SIM_MODEL_NUM             120
+#define DELAY_SIM_TYPE_NUM              2
+#define DELAY_SIM_DELAY_MAX             (255 * DELAY_EXECUTION_STEP_RESOLUTION) //!< delay field of the messages
+
+typedef struct
+{
+    bool pending;
+    uint64_t deadline; //!< ms
+} delay_sim_expect_t;
+
+static mesh_model_info_t delay_sim_models[DELAY_SIM_MODEL_NUM];
+static delay_sim_expect_t delay_sim_expect[DELAY_SIM_MODEL_NUM][DELAY_SIM_TYPE_NUM];
+static uint32_t delay_sim_pending;
+static uint32_t delay_sim_pending_max;
+static uint32_t delay_sim_fired;
+static uint32_t delay_sim_early;
+static uint32_t delay_sim_unexpected;
+static uint32_t delay_sim_late_max;
+static uint32_t delay_sim_start_fail;
+static bool delay_sim_chain;
+
+static uint64_t delay_sim_now(void)
+{
+    return plt_sim_time_get_us() / 1000;
+}
+
+static int32_t delay_sim_execution(mesh_model_info_t *pmodel_info, uint32_t delay_type);
+
+static void delay_sim_start(uint32_t model, uint32_t type, uint32_t delay)
+{
+    delay_sim_expect_t *pexpect = &delay_sim_expect[model][type];
+    if (!delay_execution_timer_start(&delay_sim_models[model], type, delay, delay_sim_execution))
+    {
+        delay_sim_start_fail ++;
+        return;
+    }
+    if (!pexpect->pending)
+    {
+        pexpect->pending = TRUE;
+        delay_sim_pending ++;
+        if (delay_sim_pending > delay_sim_pending_max)
+        {
+            delay_sim_pending_max = delay_sim_pending;
+        }
+    }
+    pexpect->deadline = delay_sim_now() + delay;
+}
+
+static int32_t delay_sim_execution(mesh_model_info_t *pmodel_info, uint32_t delay_type)
+{
+    uint32_t model = pmodel_info - delay_sim_models;
+    delay_sim_expect_t *pexpect = &delay_sim_expect[model][delay_type];
+    uint64_t now = delay_sim_now();
+    delay_sim_fired ++;
+    if (!pexpect->pending)
+    {
+        printf("%llu ms: model %u type %u fired without a pending delay\n", (unsigned long long)now,
+               model, delay_type);
+        delay_sim_unexpected ++;
+        return 0;
+    }
+    if (now < pexpect->deadline)
+    {
+        printf("%llu ms: model %u type %u fired %llu ms early\n", (unsigned long long)now, model,
+               delay_type, (unsigned long long)(pexpect->deadline - now));
+        delay_sim_early ++;
+    }
+    else if (now - pexpect->deadline > delay_sim_late_max)
+    {
+        delay_sim_late_max = now - pexpect->deadline;
+    }
+    pexpect->pending = FALSE;
+    delay_sim_pending --;
+
+    /* a quarter of the executions delay another message of the same model */
+    if (delay_sim_chain && (0 == rand() % 4))
+    {
+        delay_sim_start(model, rand() % DELAY_SIM_TYPE_NUM, (rand() % 256) *
+                        DELAY_EXECUTION_STEP_RESOLUTION);
+    }
+    return 0;
+}
+
+/**
+  * @brief restart the head entry after 10 ms and check it fires at the new deadline
+  * @param[in] first: the first delay of the head entry
+  * @param[in] other: the delay of a second entry behind the head, 0 for none
+  * @param[in] second: the restart delay of the head entry
+  * @return the failure number
+  */
+static uint32_t delay_sim_head_case(uint32_t first, uint32_t other, uint32_t second)
+{
+    uint32_t fail = 0;
+    delay_sim_start(0, 0, first);
+    if (other)
+    {
+        delay_sim_start(1, 0, other);
+    }
+    plt_sim_clock_advance(10);
+    delay_sim_start(0, 0, second);
+    uint64_t deadline = delay_sim_expect[0][0].deadline;
+    while (delay_sim_expect[0][0].pending && (delay_sim_now() < deadline + DELAY_SIM_DELAY_MAX))
+    {
+        plt_sim_clock_advance(1);
+    }
+    if (delay_sim_expect[0][0].pending || (delay_sim_now() != deadline))
+    {
+        printf("head restart %u -> %u ms behind %u ms: fired %llu ms after the deadline\n", first,
+               second, other, (unsigned long long)(delay_sim_now() - deadline));
+        fail ++;
+    }
+    plt_sim_clock_advance(DELAY_SIM_DELAY_MAX + 1);
+    if (delay_sim_pending)
+    {
+        printf("head restart %u -> %u ms behind %u ms: %u lost\n", first, second, other,
+               delay_sim_pending);
+        fail ++;
+    }
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t ops = (argc > 1) ? strtoul(argv[1], NULL, 0) : 2000;
+    uint32_t spread = (argc > 2) ? strtoul(argv[2], NULL, 0) : 10000;
+    if (0 == spread)
+    {
+        spread = 1;
+    }
+
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    srand(1);
+    delay_execution_init();
+
+    /* shortened head alone and in front of another entry, lengthened head */
+    uint32_t head_fail = delay_sim_head_case(1000, 0, 100);
+    head_fail += delay_sim_head_case(500, 800, 300);
+    head_fail += delay_sim_head_case(100, 0, 1000);
+    head_fail += delay_sim_head_case(100, 800, 1000);
+    printf("head restarts: %u failed\n", head_fail);
+    delay_sim_late_max = 0;
+    delay_sim_chain = TRUE;
+    plt_sim_stat_clear();
+
+    uint32_t starts = 0, stops = 0;
+    uint32_t timer_max = 0;
+    uint32_t done = 0;
+    for (uint32_t ms = 0; ms < spread; ++ms)
+    {
+        /* spread the operations evenly over the time */
+        uint32_t num = (uint32_t)((uint64_t)ops * (ms + 1) / spread) - done;
+        for (uint32_t i = 0; i < num; ++i)
+        {
+            uint32_t model = rand() % DELAY_SIM_MODEL_NUM;
+            uint32_t type = rand() % DELAY_SIM_TYPE_NUM;
+            if (rand() % 100 < 15)
+            {
+                delay_execution_timer_stop(&delay_sim_models[model], type);
+                if (delay_sim_expect[model][type].pending)
+                {
+                    delay_sim_expect[model][type].pending = FALSE;
+                    delay_sim_pending --;
+                }
+                stops ++;
+            }
+            else
+            {
+                delay_sim_start(model, type, (rand() % 256) * DELAY_EXECUTION_STEP_RESOLUTION);
+                starts ++;
+            }
+        }
+        done += num;
+        plt_sim_clock_advance(1);
+
+        plt_sim_stat_t stat;
+        plt_sim_stat_get(&stat);
+        if (stat.timer_active_num > timer_max)
+        {
+            timer_max = stat.timer_active_num;
+        }
+    }
+
+    /* drain, the chained executions keep coming for a while */
+    for (uint32_t ms = 0; (ms < 100 * DELAY_SIM_DELAY_MAX) && (delay_sim_pending > 0); ++ms)
+    {
+        plt_sim_clock_advance(1);
+    }
+    plt_sim_clock_advance(DELAY_SIM_DELAY_MAX + 1);
+
+    plt_sim_stat_t stat;
+    plt_sim_stat_get(&stat);
+    printf("%u starts and %u stops over %u ms on %u pairs, pool of %u\n", starts, stops, spread,
+           DELAY_SIM_MODEL_NUM * DELAY_SIM_TYPE_NUM, MODEL_DELAY_EXECUTION_NUM_MAX);
+    printf("pending max %u, fired %u, early %u, unexpected %u, lost %u, late max %u ms, "
+           "start failed %u\n", delay_sim_pending_max, delay_sim_fired, delay_sim_early,
+           delay_sim_unexpected, delay_sim_pending, delay_sim_late_max, delay_sim_start_fail);
+    printf("active timers max %u, heap allocs %u\n", timer_max, stat.mem_alloc_count);
+
+    bool fail = head_fail || delay_sim_early || delay_sim_unexpected || delay_sim_pending ||
+                (delay_sim_late_max > 1) || (timer_max > 1);
+    printf("%s\n", fail ? "FAIL" : "PASS");
+    return fail ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
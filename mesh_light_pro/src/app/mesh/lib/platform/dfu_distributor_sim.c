@@ -0,0 +1,692 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     dfu_distributor_sim.c
+  * @brief    Host airtime simulator of the dfu distribution to many nodes.
+  * @details  The real distributor sends an image to N simulated nodes over a lossy air, the
+  *           nodes answer as the object transfer and firmware update servers do. A network pdu is
+  *           lost at a receiver with the given rate. Unsegmented requests and responses are lost
+  *           as a whole and retried by the distributor timer, segmented unicast messages are
+  *           acked by the transport and resent segment by segment, segmented group messages are
+  *           sent once and lost with any of their segments. Every chunk is checked against the
+  *           image and every block against its crc32. The airtime is reported together with the
+  *           airtime of sending every block to every node by unicast, as before the group
+  *           distribution. Build it on a linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> dfu_distributor_sim.c
+  *           crc32.c platform_sim.c -o dfu_distributor_sim
+  *           and run it with the number of nodes, the loss rate in percent, the image size in KB
+  *           and the index of a node which never answers, e.g. ./dfu_distributor_sim 300 5 40 7,
+  *           without parameters it sweeps 10, 50 and 300 nodes at 0%, 5% and 20% loss. It
+  *           fails when a live node is not applied up to 20% loss, or when a sweep run takes
+  *           longer than its wall time limit.
+  * @note     All the nodes are in direct range, relaying is not simulated.
+  * @author   bill
+  * @date     2018-12-24
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#include "dfu_distributor_app.c"
+
+#define DFU_DIST_SIM_NODE_NUM_MAX           1000
+#define DFU_DIST_SIM_IMAGE_MAX              (256 * 1024)
+#define DFU_DIST_SIM_NODE_ADDR              0x0100
+#define DFU_DIST_SIM_GROUP_ADDR             0xc000
+#define DFU_DIST_SIM_PDU_US                 1128 //!< one network pdu on the three adv channels
+#define DFU_DIST_SIM_SEG_LEN                12 //!< access bytes of a segment
+#define DFU_DIST_SIM_UNSEG_LEN_MAX          15 //!< access bytes and trans mic of an unsegmented pdu
+#define DFU_DIST_SIM_TRANS_MIC_LEN          4
+#define DFU_DIST_SIM_MIN_BLOCK_LOG          10
+#define DFU_DIST_SIM_MAX_BLOCK_LOG          12
+#define DFU_DIST_SIM_MAX_CHUNK_NUM          20
+#define DFU_DIST_SIM_QUEUE_SIZE             64
+#define DFU_DIST_SIM_MSG_LEN_MAX            64
+#define DFU_DIST_SIM_LOSS_DELIVER_MAX       20 //!< every live node shall apply up to this loss
+
+typedef struct
+{
+    uint32_t block_size;
+    uint16_t block_num; //!< blocks completed
+    bool receiving; //!< block started, waiting for the chunks
+    uint16_t chunk_size;
+    uint16_t chunk_num;
+    uint8_t chunk_flags[plt_bit_pool_size(DFU_DIST_SIM_MAX_CHUNK_NUM)];
+    uint32_t checksum;
+    bool applied;
+} dfu_dist_sim_node_t;
+
+typedef struct
+{
+    bool send_cb; //!< send callback of a chunk, a response otherwise
+    uint16_t src;
+    uint32_t opcode;
+    uint16_t len;
+    uint8_t data[DFU_DIST_SIM_MSG_LEN_MAX];
+} dfu_dist_sim_event_t;
+
+typedef struct
+{
+    uint64_t pdus;
+    uint32_t timeouts;
+    uint64_t time_us; //!< airtime and the waiting for lost responses
+    uint32_t chunk_errors; //!< chunks not matching the image
+    uint32_t block_errors; //!< blocks failing the crc32
+} dfu_dist_sim_result_t;
+
+static uint32_t dfu_dist_sim_node_num;
+static double dfu_dist_sim_loss;
+static int32_t dfu_dist_sim_dead = -1; //!< node never answering
+static uint32_t dfu_dist_sim_object_size;
+static uint8_t *dfu_dist_sim_image; //!< below 4G, the header address is 32 bits
+static dfu_dist_sim_node_t dfu_dist_sim_nodes[DFU_DIST_SIM_NODE_NUM_MAX];
+static dfu_dist_sim_result_t dfu_dist_sim_result;
+static dfu_dist_sim_event_t dfu_dist_sim_queue[DFU_DIST_SIM_QUEUE_SIZE];
+static uint32_t dfu_dist_sim_queue_head;
+static uint32_t dfu_dist_sim_queue_num;
+static bool dfu_dist_sim_timeout;
+static uint64_t dfu_dist_sim_rng = 1;
+
+void *evt_queue_handle = &evt_queue_handle;
+void *io_queue_handle = &io_queue_handle;
+
+static uint32_t dfu_dist_sim_rand(void)
+{
+    dfu_dist_sim_rng ^= dfu_dist_sim_rng >> 12;
+    dfu_dist_sim_rng ^= dfu_dist_sim_rng << 25;
+    dfu_dist_sim_rng ^= dfu_dist_sim_rng >> 27;
+    return (uint32_t)((dfu_dist_sim_rng * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+static bool dfu_dist_sim_lost(void)
+{
+    return (dfu_dist_sim_rand() >> 8) < dfu_dist_sim_loss * (1 << 24);
+}
+
+/** air */
+static uint32_t dfu_dist_sim_seg_num(uint16_t access_len)
+{
+    uint16_t len = access_len + DFU_DIST_SIM_TRANS_MIC_LEN;
+    return (len <= DFU_DIST_SIM_UNSEG_LEN_MAX) ? 1 : (len + DFU_DIST_SIM_SEG_LEN - 1) /
+           DFU_DIST_SIM_SEG_LEN;
+}
+
+static void dfu_dist_sim_air(uint32_t pdus)
+{
+    static uint32_t air_us;
+    dfu_dist_sim_result.pdus += pdus;
+    air_us += pdus * DFU_DIST_SIM_PDU_US;
+    plt_sim_clock_advance(air_us / 1000);
+    air_us %= 1000;
+}
+
+/**
+ * @brief send one message to a unicast address
+ * @return TRUE if it arrives
+ */
+static bool dfu_dist_sim_unicast(uint16_t access_len)
+{
+    uint32_t seg_num = dfu_dist_sim_seg_num(access_len);
+    if (1 == seg_num)
+    {
+        dfu_dist_sim_air(1);
+        return !dfu_dist_sim_lost();
+    }
+    /* every segment is resent until it gets through, then one segment ack */
+    for (uint32_t seg = 0; seg < seg_num; ++seg)
+    {
+        do
+        {
+            dfu_dist_sim_air(1);
+        }
+        while (dfu_dist_sim_lost());
+    }
+    dfu_dist_sim_air(1);
+    return TRUE;
+}
+
+/**
+ * @brief one node receives a message sent to the group once
+ */
+static bool dfu_dist_sim_group_rx(uint16_t access_len)
+{
+    for (uint32_t seg = dfu_dist_sim_seg_num(access_len); seg > 0; --seg)
+    {
+        if (dfu_dist_sim_lost())
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+static dfu_dist_sim_node_t *dfu_dist_sim_node_get(uint16_t addr)
+{
+    uint32_t index = addr - DFU_DIST_SIM_NODE_ADDR;
+    if ((addr < DFU_DIST_SIM_NODE_ADDR) || (index >= dfu_dist_sim_node_num))
+    {
+        printf("message to unknown node 0x%04x\n", addr);
+        exit(1);
+    }
+    return (index == dfu_dist_sim_dead) ? NULL : &dfu_dist_sim_nodes[index];
+}
+
+static dfu_dist_sim_event_t *dfu_dist_sim_event_push(void)
+{
+    if (DFU_DIST_SIM_QUEUE_SIZE == dfu_dist_sim_queue_num)
+    {
+        printf("event queue overflow\n");
+        exit(1);
+    }
+    dfu_dist_sim_event_t *pevent = &dfu_dist_sim_queue[(dfu_dist_sim_queue_head +
+                                                                              dfu_dist_sim_queue_num) % DFU_DIST_SIM_QUEUE_SIZE];
+    dfu_dist_sim_queue_num ++;
+    return pevent;
+}
+
+/* the node answers the distributor */
+static void dfu_dist_sim_respond(uint16_t src, uint32_t opcode, void *pmsg, uint16_t len)
+{
+    ACCESS_OPCODE_BYTE((uint8_t *)pmsg, opcode);
+    if (!dfu_dist_sim_unicast(len))
+    {
+        return;
+    }
+    dfu_dist_sim_event_t *pevent = dfu_dist_sim_event_push();
+    pevent->send_cb = FALSE;
+    pevent->src = src;
+    pevent->opcode = opcode;
+    pevent->len = len;
+    memcpy(pevent->data, pmsg, len);
+}
+
+/* the request of the distributor reaches the node */
+static dfu_dist_sim_node_t *dfu_dist_sim_request(uint16_t dst, uint16_t len)
+{
+    if (!dfu_dist_sim_unicast(len))
+    {
+        return NULL;
+    }
+    return dfu_dist_sim_node_get(dst);
+}
+
+static uint32_t dfu_dist_sim_block_size(const dfu_dist_sim_node_t *pnode, uint16_t block_num)
+{
+    uint32_t offset = block_num * pnode->block_size;
+    return MIN(pnode->block_size, dfu_dist_sim_object_size - offset);
+}
+
+/** platform */
+/* not inlined: gcc would take the one byte events for io messages */
+__attribute__((noinline))
+bool os_msg_send_intern(void *p_handle, void *p_msg, uint32_t wait_ms, const char *p_func,
+                        uint32_t file_line)
+{
+    if ((io_queue_handle == p_handle) && (DFU_DIST_TIMEOUT_MSG == ((T_IO_MSG *)p_msg)->type))
+    {
+        dfu_dist_sim_timeout = TRUE;
+    }
+    return true;
+}
+
+uint32_t get_header_addr_by_img_id(T_IMG_ID image_id)
+{
+    return (uint32_t)(uintptr_t)dfu_dist_sim_image;
+}
+
+bool plt_bit_pool_get(uint8_t *pool, uint32_t bit)
+{
+    return (pool[bit >> 3] >> (bit & 7)) & 1;
+}
+
+void plt_bit_pool_set(uint8_t *pool, uint32_t bit, bool set)
+{
+    if (set)
+    {
+        pool[bit >> 3] |= 1 << (bit & 7);
+    }
+    else
+    {
+        pool[bit >> 3] &= ~(1 << (bit & 7));
+    }
+}
+
+uint8_t plt_log2(uint32_t value)
+{
+    uint8_t log = 0;
+    while (value > 1)
+    {
+        value >>= 1;
+        log ++;
+    }
+    return log;
+}
+
+uint32_t plt_exp2(uint8_t log)
+{
+    return 1UL << log;
+}
+
+/** clients, the nodes answer as the servers */
+void fw_update_client_reg(model_receive_pf pf)
+{
+}
+
+void obj_transfer_client_reg(model_receive_pf model_receive, model_send_cb_pf model_send_cb)
+{
+}
+
+mesh_msg_send_cause_t obj_info_get(uint16_t dst)
+{
+    if (NULL != dfu_dist_sim_request(dst, sizeof(obj_info_get_t)))
+    {
+        obj_info_stat_t msg;
+        msg.min_block_size_log = DFU_DIST_SIM_MIN_BLOCK_LOG;
+        msg.max_block_size_log = DFU_DIST_SIM_MAX_BLOCK_LOG;
+        msg.max_chunk_num = DFU_DIST_SIM_MAX_CHUNK_NUM;
+        dfu_dist_sim_respond(dst, MESH_MSG_OBJ_INFO_STAT, &msg, sizeof(msg));
+    }
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+static void dfu_dist_sim_fw_update_stat(uint16_t dst, uint16_t len, fw_update_phase_t phase)
+{
+    dfu_dist_sim_node_t *pnode = dfu_dist_sim_request(dst, len);
+    if (NULL != pnode)
+    {
+        fw_update_stat_t msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.phase = phase;
+        if (FW_UPDATE_PHASE_IDLE == phase)
+        {
+            pnode->applied = TRUE;
+        }
+        dfu_dist_sim_respond(dst, MESH_MSG_FW_UPDATE_STAT, &msg, sizeof(msg));
+    }
+}
+
+mesh_msg_send_cause_t fw_update_prepare(uint16_t dst, uint16_t company_id,
+                                        fw_update_fw_id_t firmware_id,
+                                        uint8_t object_id[8], uint8_t vendor_validate_data[], uint16_t validate_len)
+{
+    dfu_dist_sim_fw_update_stat(dst, sizeof(fw_update_prepare_t) + validate_len,
+                                FW_UPDATE_PHASE_PREPARED);
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+mesh_msg_send_cause_t fw_update_start(uint16_t dst, fw_update_policy_t policy, uint16_t company_id,
+                                      fw_update_fw_id_t firmware_id)
+{
+    dfu_dist_sim_fw_update_stat(dst, sizeof(fw_update_start_t), FW_UPDATE_PHASE_IN_PROGRESS);
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+mesh_msg_send_cause_t fw_update_apply(uint16_t dst, uint16_t company_id,
+                                      fw_update_fw_id_t firmware_id)
+{
+    dfu_dist_sim_fw_update_stat(dst, sizeof(fw_update_apply_t), FW_UPDATE_PHASE_IDLE);
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+mesh_msg_send_cause_t obj_transfer_start(uint16_t dst, uint8_t object_id[8], uint32_t object_size,
+                                         uint8_t curr_block_size_log)
+{
+    dfu_dist_sim_node_t *pnode = dfu_dist_sim_request(dst, sizeof(obj_transfer_start_t));
+    if (NULL != pnode)
+    {
+        obj_transfer_stat_t msg;
+        memset(&msg, 0, sizeof(msg));
+        if (object_size != dfu_dist_sim_object_size)
+        {
+            printf("node 0x%04x: object size %u, expect %u\n", dst, object_size,
+                   dfu_dist_sim_object_size);
+            exit(1);
+        }
+        pnode->block_size = plt_exp2(curr_block_size_log);
+        msg.stat = OBJ_TRANSFER_STAT_READY;
+        msg.object_size = object_size;
+        msg.block_size_log = curr_block_size_log;
+        dfu_dist_sim_respond(dst, MESH_MSG_OBJ_TRANSFER_STAT, &msg, sizeof(msg));
+    }
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+mesh_msg_send_cause_t obj_block_transfer_start(uint16_t dst, uint8_t object_id[8],
+                                               uint16_t block_num,
+                                               uint16_t chunk_size, obj_block_check_algo_t check_algo, uint8_t checksum_value[],
+                                               uint16_t checksum_value_len)
+{
+    dfu_dist_sim_node_t *pnode = dfu_dist_sim_request(dst, MEMBER_OFFSET(obj_block_transfer_start_t,
+                                                                          checksum_value) + checksum_value_len);
+    if (NULL == pnode)
+    {
+        return MESH_MSG_SEND_CAUSE_SUCCESS;
+    }
+
+    obj_block_transfer_stat_t msg;
+    msg.stat = OBJ_BLOCK_TRANSFER_STAT_ACCEPTED;
+    if ((block_num == pnode->block_num) && !pnode->receiving)
+    {
+        /* a retried start of the block being received keeps the chunks */
+        pnode->receiving = TRUE;
+        pnode->chunk_size = chunk_size;
+        pnode->chunk_num = (dfu_dist_sim_block_size(pnode, block_num) + chunk_size - 1) / chunk_size;
+        memset(pnode->chunk_flags, 0, sizeof(pnode->chunk_flags));
+        pnode->checksum = LE_EXTRN2DWORD(checksum_value);
+        if ((OBJ_BLOCK_CHECK_ALGO_CRC32 != check_algo) || (4 != checksum_value_len) ||
+            (pnode->chunk_num > DFU_DIST_SIM_MAX_CHUNK_NUM))
+        {
+            printf("node 0x%04x: block %u chunk size %u checksum len %u\n", dst, block_num, chunk_size,
+                   checksum_value_len);
+            exit(1);
+        }
+    }
+    dfu_dist_sim_respond(dst, MESH_MSG_OBJ_BLOCK_TRANSFER_STAT, &msg, sizeof(msg));
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+static void dfu_dist_sim_chunk_rx(uint32_t index, uint16_t chunk_num, const uint8_t *pdata,
+                                  uint16_t len)
+{
+    dfu_dist_sim_node_t *pnode = &dfu_dist_sim_nodes[index];
+    if ((index == dfu_dist_sim_dead) || !pnode->receiving || (chunk_num >= pnode->chunk_num))
+    {
+        return;
+    }
+    uint32_t offset = pnode->block_num * pnode->block_size + chunk_num * pnode->chunk_size;
+    uint32_t block_end = pnode->block_num * pnode->block_size + dfu_dist_sim_block_size(pnode,
+                                                                                          pnode->block_num);
+    if ((len != MIN(pnode->chunk_size, block_end - offset)) ||
+        (0 != memcmp(pdata, dfu_dist_sim_image + offset, len)))
+    {
+        /* a dropped node still waits for an old block, its crc32 would reject the chunk */
+        if (pnode->block_num == dfu_dist_ctx.block_loop)
+        {
+            dfu_dist_sim_result.chunk_errors ++;
+        }
+        return;
+    }
+    plt_bit_pool_set(pnode->chunk_flags, chunk_num, TRUE);
+}
+
+mesh_msg_send_cause_t obj_chunk_transfer(uint16_t dst, uint16_t chunk_num, uint8_t data[],
+                                         uint16_t len)
+{
+    uint16_t access_len = MEMBER_OFFSET(obj_chunk_transfer_t, data) + len;
+    if (MESH_IS_GROUP_ADDR(dst))
+    {
+        dfu_dist_sim_air(dfu_dist_sim_seg_num(access_len));
+        for (uint32_t index = 0; index < dfu_dist_sim_node_num; ++index)
+        {
+            if (dfu_dist_sim_group_rx(access_len))
+            {
+                dfu_dist_sim_chunk_rx(index, chunk_num, data, len);
+            }
+        }
+    }
+    else if (dfu_dist_sim_unicast(access_len))
+    {
+        dfu_dist_sim_node_get(dst);
+        dfu_dist_sim_chunk_rx(dst - DFU_DIST_SIM_NODE_ADDR, chunk_num, data, len);
+    }
+
+    dfu_dist_sim_event_t *pevent = dfu_dist_sim_event_push();
+    pevent->send_cb = TRUE;
+    pevent->opcode = MESH_MSG_OBJ_CHUNCK_TRANSFER;
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+mesh_msg_send_cause_t obj_block_get(uint16_t dst, uint8_t object_id[8], uint16_t block_num)
+{
+    dfu_dist_sim_node_t *pnode = dfu_dist_sim_request(dst, sizeof(obj_block_get_t));
+    if (NULL == pnode)
+    {
+        return MESH_MSG_SEND_CAUSE_SUCCESS;
+    }
+
+    uint8_t buffer[DFU_DIST_SIM_MSG_LEN_MAX];
+    obj_block_stat_t *pmsg = (obj_block_stat_t *)buffer;
+    uint16_t missing_num = 0;
+    pmsg->stat = OBJ_BLOCK_TRANSFER_STAT_ACCEPTED;
+    if ((block_num == pnode->block_num) && pnode->receiving)
+    {
+        for (uint16_t chunk = 0; chunk < pnode->chunk_num; ++chunk)
+        {
+            if (!plt_bit_pool_get(pnode->chunk_flags, chunk))
+            {
+                pmsg->chunk_list[missing_num++] = chunk;
+            }
+        }
+        if (missing_num)
+        {
+            pmsg->stat = (missing_num == pnode->chunk_num) ? OBJ_BLOCK_TRANSFER_STAT_INVALID_BLOCK_NUM :
+                         OBJ_BLOCK_TRANSFER_STAT_NOT_ALL_CHUNCK_RECEIVED;
+        }
+        else
+        {
+            /* write the block after checking it */
+            uint32_t crc = crc32_update(0, dfu_dist_sim_image + block_num * pnode->block_size,
+                                        dfu_dist_sim_block_size(pnode, block_num));
+            if (crc != pnode->checksum)
+            {
+                dfu_dist_sim_result.block_errors ++;
+            }
+            pnode->receiving = FALSE;
+            pnode->block_num ++;
+        }
+    }
+    else if (block_num > pnode->block_num)
+    {
+        pmsg->stat = OBJ_BLOCK_TRANSFER_STAT_FRESH_BLOCKED;
+    }
+    dfu_dist_sim_respond(dst, MESH_MSG_OBJ_BLOCK_STAT, pmsg,
+                         MEMBER_OFFSET(obj_block_stat_t, chunk_list) + missing_num * sizeof(uint16_t));
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+/**
+ * @brief airtime of sending every block to every node by unicast
+ * @note the largest block, every request answered, the nodes which answer complete
+ */
+static uint64_t dfu_dist_sim_unicast_pdus(void)
+{
+    uint64_t pdus = dfu_dist_sim_result.pdus;
+    uint32_t block_size = plt_exp2(DFU_DIST_SIM_MAX_BLOCK_LOG);
+    uint32_t block_num = (dfu_dist_sim_object_size + block_size - 1) / block_size;
+    for (uint32_t index = 0; index < dfu_dist_sim_node_num; ++index)
+    {
+        for (uint32_t block = 0; block < block_num; ++block)
+        {
+            uint32_t size = MIN(block_size, dfu_dist_sim_object_size - block * block_size);
+            uint16_t chunk_size = (size + DFU_DIST_SIM_MAX_CHUNK_NUM - 1) / DFU_DIST_SIM_MAX_CHUNK_NUM;
+            dfu_dist_sim_unicast(sizeof(obj_block_transfer_start_t));
+            dfu_dist_sim_unicast(sizeof(obj_block_transfer_stat_t));
+            for (uint32_t offset = 0; offset < size; offset += chunk_size)
+            {
+                dfu_dist_sim_unicast(MEMBER_OFFSET(obj_chunk_transfer_t, data) + MIN(chunk_size,
+                                                                                     size - offset));
+            }
+            dfu_dist_sim_unicast(sizeof(obj_block_get_t));
+            dfu_dist_sim_unicast(MEMBER_OFFSET(obj_block_stat_t, chunk_list));
+        }
+    }
+    pdus = dfu_dist_sim_result.pdus - pdus;
+    dfu_dist_sim_result.pdus -= pdus;
+    return pdus;
+}
+
+/**
+ * @brief distribute the image once
+ * @return number of nodes which applied the whole image
+ */
+static uint32_t dfu_dist_sim_run(void)
+{
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    memset(&dfu_dist_ctx, 0, sizeof(dfu_dist_ctx));
+    memset(dfu_dist_sim_nodes, 0, sizeof(dfu_dist_sim_nodes));
+    memset(&dfu_dist_sim_result, 0, sizeof(dfu_dist_sim_result));
+    dfu_dist_sim_queue_head = 0;
+    dfu_dist_sim_queue_num = 0;
+    dfu_dist_sim_timeout = FALSE;
+
+    static uint16_t node_list[DFU_DIST_SIM_NODE_NUM_MAX];
+    for (uint32_t index = 0; index < dfu_dist_sim_node_num; ++index)
+    {
+        node_list[index] = DFU_DIST_SIM_NODE_ADDR + index;
+    }
+    uint8_t firmware_id[FW_UPDATE_FW_ID_LEN] = {1, 2, 3, 4};
+    uint8_t object_id[8] = {0};
+    dfu_dist_models_init();
+    if (!dfu_dist_start(0x005d, firmware_id, object_id, DFU_DIST_SIM_GROUP_ADDR, node_list,
+                        dfu_dist_sim_node_num))
+    {
+        printf("distribution start fail\n");
+        exit(1);
+    }
+
+    while (DFU_DIST_IDLE != dfu_dist_ctx.fsm)
+    {
+        if (dfu_dist_sim_queue_num > 0)
+        {
+            dfu_dist_sim_event_t event = dfu_dist_sim_queue[dfu_dist_sim_queue_head];
+            dfu_dist_sim_queue_head = (dfu_dist_sim_queue_head + 1) % DFU_DIST_SIM_QUEUE_SIZE;
+            dfu_dist_sim_queue_num --;
+            if (event.send_cb)
+            {
+                obj_transfer_client_send_cb(NULL, MESH_MSG_SEND_STAT_SENT, event.opcode);
+            }
+            else
+            {
+                mesh_msg_t msg;
+                memset(&msg, 0, sizeof(msg));
+                msg.pbuffer = event.data;
+                msg.msg_len = event.len;
+                msg.access_opcode = event.opcode;
+                msg.src = event.src;
+                msg.dst = DFU_DIST_SIM_NODE_ADDR - 1;
+                if (!obj_transfer_client_receive(&msg))
+                {
+                    fw_update_client_receive(&msg);
+                }
+            }
+        }
+        else if (dfu_dist_sim_timeout)
+        {
+            dfu_dist_sim_timeout = FALSE;
+            dfu_dist_sim_result.timeouts ++;
+            dfu_dist_handle_timeout();
+        }
+        else
+        {
+            /* waiting for a lost response */
+            plt_sim_clock_advance_to_next(DFU_DIST_RETRY_PERIOD);
+        }
+    }
+
+    dfu_dist_sim_result.time_us = plt_sim_time_get_us();
+    uint32_t applied = 0;
+    for (uint32_t index = 0; index < dfu_dist_sim_node_num; ++index)
+    {
+        uint16_t block_num = (dfu_dist_sim_object_size + dfu_dist_sim_nodes[index].block_size - 1) /
+                             MAX(1, dfu_dist_sim_nodes[index].block_size);
+        if (dfu_dist_sim_nodes[index].applied && (dfu_dist_sim_nodes[index].block_num == block_num))
+        {
+            applied ++;
+        }
+    }
+    return applied;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint32_t node_nums[] = {10, 50, 300};
+    static const uint32_t losses[] = {0, 5, 20};
+    /* wall time limits of the sweep in seconds, about a quarter above the current results */
+    static const uint32_t time_limits[] = {10, 300, 2100, 25, 700, 3600, 120, 1600, 11000};
+    uint32_t node_num = (argc > 1) ? strtoul(argv[1], NULL, 0) : 0;
+    uint32_t loss = (argc > 2) ? strtoul(argv[2], NULL, 0) : 5;
+    uint32_t image_kb = (argc > 3) ? strtoul(argv[3], NULL, 0) : 40;
+    dfu_dist_sim_dead = (argc > 4) ? atoi(argv[4]) : -1;
+    if ((node_num > DFU_DIST_SIM_NODE_NUM_MAX) || (loss >= 100) ||
+        (image_kb * 1024 > DFU_DIST_SIM_IMAGE_MAX) || (0 == image_kb))
+    {
+        printf("nodes shall be 1 ~ %u, loss below 100%%, image 1 ~ %u KB\n", DFU_DIST_SIM_NODE_NUM_MAX,
+               DFU_DIST_SIM_IMAGE_MAX / 1024);
+        return 1;
+    }
+
+    dfu_dist_sim_image = mmap(NULL, DFU_DIST_SIM_IMAGE_MAX, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+    if (MAP_FAILED == dfu_dist_sim_image)
+    {
+        printf("map image fail\n");
+        return 1;
+    }
+    for (uint32_t i = 0; i < DFU_DIST_SIM_IMAGE_MAX; ++i)
+    {
+        dfu_dist_sim_image[i] = dfu_dist_sim_rand();
+    }
+    /* the object is the payload behind the header */
+    T_IMG_HEADER_FORMAT *pheader = (T_IMG_HEADER_FORMAT *)dfu_dist_sim_image;
+    pheader->ctrl_header.payload_len = image_kb * 1024 - 1024;
+    dfu_dist_sim_object_size = image_kb * 1024;
+
+    printf("%u KB image, %.3f ms a network pdu\n", image_kb, DFU_DIST_SIM_PDU_US / 1000.0);
+    printf("nodes  loss   air group s   unicast s  speedup  timeouts    total s  applied\n");
+    uint32_t errors = 0;
+    uint32_t run_num = node_num ? 1 : sizeof(node_nums) / sizeof(node_nums[0]) * sizeof(losses) /
+                       sizeof(losses[0]);
+    for (uint32_t run = 0; run < run_num; ++run)
+    {
+        dfu_dist_sim_node_num = node_num ? node_num : node_nums[run / 3];
+        dfu_dist_sim_loss = (node_num ? loss : losses[run % 3]) / 100.0;
+        dfu_dist_sim_rng = 1;
+        uint32_t applied = dfu_dist_sim_run();
+        dfu_dist_sim_result_t result = dfu_dist_sim_result;
+        uint64_t unicast_pdus = dfu_dist_sim_unicast_pdus();
+        uint32_t expect = dfu_dist_sim_node_num - (((dfu_dist_sim_dead >= 0) &&
+                                                    (dfu_dist_sim_dead < dfu_dist_sim_node_num)) ? 1 : 0);
+
+        plt_sim_stat_t stat;
+        plt_sim_stat_get(&stat);
+        printf("%5u %4.0f%% %11.1f %11.1f %7.1fx %9u %10.1f %4u/%-4u\n", dfu_dist_sim_node_num,
+               dfu_dist_sim_loss * 100, result.pdus * DFU_DIST_SIM_PDU_US / 1e6,
+               unicast_pdus * DFU_DIST_SIM_PDU_US / 1e6, (double)unicast_pdus / result.pdus,
+               result.timeouts, result.time_us / 1e6, applied, dfu_dist_sim_node_num);
+        if (result.chunk_errors || result.block_errors || (0 != stat.mem_used))
+        {
+            printf("%u chunk errors, %u block errors, %u bytes leaked\n", result.chunk_errors,
+                   result.block_errors, stat.mem_used);
+            errors ++;
+        }
+        /* a live node is dropped only when it makes no progress for DFU_DIST_RESEND_ROUND_MAX
+         * rounds or misses DFU_DIST_RETRY_TIMES + 1 passes of a phase, which shall not happen
+         * up to DFU_DIST_SIM_LOSS_DELIVER_MAX */
+        if ((applied > expect) ||
+            ((dfu_dist_sim_loss * 100 <= DFU_DIST_SIM_LOSS_DELIVER_MAX) && (applied != expect)))
+        {
+            printf("%u nodes applied, expect %u\n", applied, expect);
+            errors ++;
+        }
+        if ((0 == node_num) && (result.time_us > time_limits[run] * 1000000ULL))
+        {
+            printf("%.1f s taken, limit %u s\n", result.time_us / 1e6, time_limits[run]);
+            errors ++;
+        }
+    }
+
+    printf("%s\n", errors ? "FAIL" : "PASS");
+    return errors ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -0,0 +1,680 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     dfu_server_sim.c
+  * @brief    Host simulation of the dfu server receive pipeline against a slow flash.
+  * @details  A phone runs the buffer check ota procedure against the real dfu server over a
+  *           simulated link: connection events, as many packets per event as the airtime
+  *           allows, a limited number of stack rx buffers, and notifications seen at the next
+  *           event. The gatt writes and the io messages of the server share one app task, so the
+  *           flash work of the server blocks the reception. The flash has a sector erase time and a
+  *           word program time and may fail a program call at random, the server recovers and the
+  *           phone resends. Every run checks the programmed image. Each configuration runs once
+  *           with the spare buffer freed, so the server programs in place as before the pipeline,
+  *           and once pipelined, and the ota times are reported. Build it on a linux host with the
+  *           keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> dfu_server_sim.c
+  *           platform_sim.c -o dfu_server_sim
+  *           and run it with the image size in KB, the sector erase time in ms, the program time of
+  *           a word in us and the program failure rate in percent of the calls,
+  *           e.g. ./dfu_server_sim 120 45 25 0
+  * @note     dfu_server.c is included to reach its statics, OTP is redirected to a ram copy.
+  * @author   bill
+  * @date     2018-12-24
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "otp.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+static T_OTP_CFG dfu_sim_otp;
+#undef OTP
+#define OTP                                 (&dfu_sim_otp)
+
+#include "dfu_server.c"
+
+#define DFU_SIM_IMAGE_MAX                   (512 * 1024)
+#define DFU_SIM_FIFO_SIZE                   64
+#define DFU_SIM_NOTIF_MAX                   8
+#define DFU_SIM_PKT_LEN_MAX                 244
+#define DFU_SIM_EVENT_PKT_MAX               6 //!< packets the phone sends in one connection event
+#define DFU_SIM_RX_BUF_NUM                  8 //!< stack buffers of received writes
+#define DFU_SIM_TIME_MAX_US                 (600ULL * 1000000)
+
+typedef enum
+{
+    DFU_SIM_ITEM_DATA,
+    DFU_SIM_ITEM_CP,
+    DFU_SIM_ITEM_PROGRAM,
+} dfu_sim_item_type_t;
+
+typedef struct
+{
+    dfu_sim_item_type_t type;
+    uint16_t len;
+    uint8_t data[DFU_SIM_PKT_LEN_MAX];
+} dfu_sim_item_t;
+
+typedef struct
+{
+    uint8_t len;
+    uint8_t data[11];
+} dfu_sim_notif_t;
+
+typedef enum
+{
+    DFU_SIM_PHONE_TARGET_INFO,
+    DFU_SIM_PHONE_START,
+    DFU_SIM_PHONE_CHECK_EN,
+    DFU_SIM_PHONE_SEND,
+    DFU_SIM_PHONE_WAIT_CRC,
+    DFU_SIM_PHONE_VALID,
+    DFU_SIM_PHONE_DONE,
+} dfu_sim_phone_state_t;
+
+typedef struct
+{
+    uint32_t image_len;
+    uint32_t erase_us;
+    uint32_t word_us;
+    uint32_t fail_percent;
+    uint32_t pkt_len;
+    uint32_t interval_us;
+    bool pipeline;
+} dfu_sim_cfg_t;
+
+typedef struct
+{
+    uint64_t time_us;
+    uint32_t resends;
+    uint32_t prog_fails;
+    uint32_t rx_full_events; //!< events the phone could not send for lack of rx buffers
+    bool valid;
+    bool rebooted;
+} dfu_sim_result_t;
+
+static dfu_sim_cfg_t dfu_sim_cfg;
+static dfu_sim_result_t dfu_sim_result;
+static uint8_t dfu_sim_image[DFU_SIM_IMAGE_MAX];
+static uint8_t dfu_sim_flash[DFU_SIM_IMAGE_MAX + SECTOR_SIZE];
+static uint64_t dfu_sim_busy_us; //!< flash and crc time of the item being handled
+static uint64_t dfu_sim_rng = 1;
+
+/* app task queue: received writes and io messages in order */
+static dfu_sim_item_t dfu_sim_fifo[DFU_SIM_FIFO_SIZE];
+static uint32_t dfu_sim_fifo_head;
+static uint32_t dfu_sim_fifo_num;
+static uint32_t dfu_sim_rx_num; //!< received writes in the queue
+
+/* notifications on the way to the phone */
+static dfu_sim_notif_t dfu_sim_notifs[DFU_SIM_NOTIF_MAX];
+static uint64_t dfu_sim_notif_ready[DFU_SIM_NOTIF_MAX];
+static uint32_t dfu_sim_notif_num;
+static uint32_t dfu_sim_notif_stamped;
+
+/* phone */
+static dfu_sim_phone_state_t dfu_sim_phone_state;
+static uint32_t dfu_sim_phone_offset; //!< image offset of the buffer being sent
+static uint32_t dfu_sim_phone_sent; //!< bytes of the buffer sent
+static uint32_t dfu_sim_phone_buf_len;
+static bool dfu_sim_phone_cp_pending;
+static uint8_t dfu_sim_phone_cp[17];
+static uint8_t dfu_sim_phone_cp_len;
+
+void *evt_queue_handle = &evt_queue_handle;
+void *io_queue_handle = &io_queue_handle;
+gap_sched_t gap_scheduler;
+
+static uint32_t dfu_sim_rand(void)
+{
+    dfu_sim_rng ^= dfu_sim_rng >> 12;
+    dfu_sim_rng ^= dfu_sim_rng << 25;
+    dfu_sim_rng ^= dfu_sim_rng >> 27;
+    return (uint32_t)((dfu_sim_rng * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+static uint16_t dfu_sim_crc16(const uint8_t *pdata, uint32_t len)
+{
+    uint16_t crc = 0xffff;
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        crc ^= (uint16_t)pdata[i] << 8;
+        for (uint8_t bit = 0; bit < 8; ++bit)
+        {
+            crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void dfu_sim_fifo_push(dfu_sim_item_type_t type, const uint8_t *pdata, uint16_t len)
+{
+    if (DFU_SIM_FIFO_SIZE == dfu_sim_fifo_num)
+    {
+        printf("app task queue overflow\n");
+        exit(1);
+    }
+    dfu_sim_item_t *pitem = &dfu_sim_fifo[(dfu_sim_fifo_head + dfu_sim_fifo_num) % DFU_SIM_FIFO_SIZE];
+    pitem->type = type;
+    pitem->len = len;
+    if (NULL != pdata)
+    {
+        memcpy(pitem->data, pdata, len);
+    }
+    dfu_sim_fifo_num ++;
+    if (DFU_SIM_ITEM_PROGRAM != type)
+    {
+        dfu_sim_rx_num ++;
+    }
+}
+
+/** os and stack */
+/* not inlined: gcc would take the one byte events for io messages */
+__attribute__((noinline))
+bool os_msg_send_intern(void *p_handle, void *p_msg, uint32_t wait_ms, const char *p_func,
+                        uint32_t file_line)
+{
+    /* the event queue only wakes the task, the io messages are queued */
+    if ((io_queue_handle == p_handle) && (DFU_SERVER_PROGRAM_MSG == ((T_IO_MSG *)p_msg)->type))
+    {
+        dfu_sim_fifo_push(DFU_SIM_ITEM_PROGRAM, NULL, 0);
+    }
+    return true;
+}
+
+bool server_send_data(uint8_t conn_id, T_SERVER_ID service_id, uint16_t attrib_index,
+                      uint8_t *p_data, uint16_t data_len, T_GATT_PDU_TYPE type)
+{
+    if (DFU_SIM_NOTIF_MAX == dfu_sim_notif_num)
+    {
+        printf("notification overflow\n");
+        exit(1);
+    }
+    dfu_sim_notif_t *pnotif = &dfu_sim_notifs[dfu_sim_notif_num++];
+    pnotif->len = MIN(data_len, sizeof(pnotif->data));
+    memcpy(pnotif->data, p_data, pnotif->len);
+    return true;
+}
+
+bool server_add_service(T_SERVER_ID *p_out_service_id, uint8_t *p_database, uint16_t length,
+                        const T_FUN_GATT_SERVICE_CBS srv_cbs)
+{
+    *p_out_service_id = 1;
+    return true;
+}
+
+T_GAP_CAUSE le_get_conn_param(T_LE_CONN_PARAM_TYPE param, void *p_value, uint8_t conn_id)
+{
+    *(uint16_t *)p_value = dfu_sim_cfg.pkt_len + 3;
+    return GAP_CAUSE_SUCCESS;
+}
+
+T_GAP_CAUSE le_disconnect(uint8_t conn_id)
+{
+    return GAP_CAUSE_SUCCESS;
+}
+
+T_GAP_CAUSE le_update_conn_param(uint8_t conn_id, uint16_t conn_interval_min,
+                                 uint16_t conn_interval_max, uint16_t conn_latency,
+                                 uint16_t supervision_timeout, uint16_t ce_length_min, uint16_t ce_length_max)
+{
+    return GAP_CAUSE_SUCCESS;
+}
+
+void mesh_reboot(mesh_reboot_reason_t reason, uint32_t delay_ms)
+{
+    dfu_sim_result.rebooted = TRUE;
+}
+
+void WDG_SystemReset(T_WDG_MODE wdg_mode, T_SW_RESET_REASON reset_reason)
+{
+    printf("unexpected system reset\n");
+    exit(1);
+}
+
+bool gap_sched_link_check(void)
+{
+    return TRUE;
+}
+
+void gap_sched_scan(bool on_off)
+{
+}
+
+void *gap_sched_task_get(void)
+{
+    return NULL;
+}
+
+void bearer_send(bearer_pkt_type_t pkt_type, uint8_t *pbuffer, uint16_t data_len)
+{
+}
+
+void data_uart_debug(char *fmt, ...)
+{
+}
+
+void plt_swap2(uint8_t *dst, uint8_t *src, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; ++i)
+    {
+        dst[i] = src[len - 1 - i];
+    }
+}
+
+bool aes256_ecb_decrypt_msb2lsb(uint8_t *input, const uint8_t *key, uint8_t *output)
+{
+    return true;
+}
+
+uint32_t get_header_addr_by_img_id(T_IMG_ID image_id)
+{
+    return 0;
+}
+
+/** flash: nor cells only clear bits, a sector erase sets them again */
+bool unlock_flash_all(void)
+{
+    return true;
+}
+
+void lock_flash(void)
+{
+}
+
+bool flash_lock(T_LOCK_TYPE flash_lock_mode)
+{
+    return true;
+}
+
+void flash_unlock(T_LOCK_TYPE flash_lock_mode)
+{
+}
+
+uint32_t dfu_flash_erase(uint16_t signature, uint32_t offset)
+{
+    offset &= ~(SECTOR_SIZE - 1);
+    if (offset < sizeof(dfu_sim_flash))
+    {
+        memset(dfu_sim_flash + offset, 0xff, SECTOR_SIZE);
+    }
+    dfu_sim_busy_us += dfu_sim_cfg.erase_us;
+    return 0;
+}
+
+uint32_t dfu_flash_check_blank(uint16_t signature, uint32_t offset, uint16_t nSize)
+{
+    dfu_sim_busy_us += nSize / 40;
+    for (uint32_t i = offset; (i < offset + nSize) && (i < sizeof(dfu_sim_flash)); ++i)
+    {
+        if (0xff != dfu_sim_flash[i])
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+uint32_t sil_dfu_update(uint16_t signature, uint32_t offset, uint32_t length, uint32_t *p_void)
+{
+    if (offset + length > dfu_sim_cfg.image_len)
+    {
+        return 1;
+    }
+    /* the sectors are erased when the image reaches them */
+    for (uint32_t sector = (offset + SECTOR_SIZE - 1) & ~(SECTOR_SIZE - 1); sector < offset + length;
+         sector += SECTOR_SIZE)
+    {
+        dfu_flash_erase(signature, sector);
+    }
+    if ((offset > 0) && (dfu_sim_rand() % 100 < dfu_sim_cfg.fail_percent))
+    {
+        /* half of the data is written before the failure */
+        length /= 2;
+        dfu_sim_result.prog_fails ++;
+        for (uint32_t i = 0; i < length; ++i)
+        {
+            dfu_sim_flash[offset + i] &= ((uint8_t *)p_void)[i];
+        }
+        dfu_sim_busy_us += (uint64_t)dfu_sim_cfg.word_us * length / 4;
+        return 1;
+    }
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        dfu_sim_flash[offset + i] &= ((uint8_t *)p_void)[i];
+    }
+    dfu_sim_busy_us += (uint64_t)dfu_sim_cfg.word_us * ((length + 3) / 4);
+    return 0;
+}
+
+uint32_t dfu_checkbufcrc(uint8_t *buf, uint32_t length, uint16_t mCrcVal)
+{
+    /* about 40 cycles a byte at 40 MHz */
+    dfu_sim_busy_us += length;
+    return (dfu_sim_crc16(buf, length) == mCrcVal) ? 0 : 1;
+}
+
+bool dfu_check_checksum(uint16_t signature)
+{
+    dfu_sim_busy_us += dfu_sim_cfg.image_len / 40;
+    return 0 == memcmp(dfu_sim_flash, dfu_sim_image, dfu_sim_cfg.image_len);
+}
+
+uint32_t dfu_report_target_ic_type(uint16_t signature, uint8_t *p_ic_type)
+{
+    *p_ic_type = 5;
+    return 0;
+}
+
+bool dfu_reset(uint16_t signature)
+{
+    return true;
+}
+
+void dfu_fw_active_reset(void)
+{
+    printf("unexpected active reset\n");
+    exit(1);
+}
+
+/** phone */
+static void dfu_sim_phone_cp_send(const uint8_t *pdata, uint8_t len)
+{
+    memcpy(dfu_sim_phone_cp, pdata, len);
+    dfu_sim_phone_cp_len = len;
+    dfu_sim_phone_cp_pending = TRUE;
+}
+
+static void dfu_sim_phone_buffer_start(uint32_t offset)
+{
+    dfu_sim_phone_offset = offset;
+    dfu_sim_phone_sent = 0;
+    dfu_sim_phone_buf_len = MIN(DFU_TEMP_BUFFER_SIZE, dfu_sim_cfg.image_len - offset);
+    dfu_sim_phone_state = DFU_SIM_PHONE_SEND;
+}
+
+static void dfu_sim_phone_notify(const dfu_sim_notif_t *pnotif)
+{
+    uint8_t cp[17];
+    uint8_t opcode = pnotif->data[1];
+    uint8_t status = pnotif->data[2];
+    switch (opcode)
+    {
+    case DFU_OPCODE_REPORT_TARGET_INFO:
+        cp[0] = DFU_OPCODE_START_DFU;
+        memcpy(cp + 1, dfu_sim_image, DFU_HEADER_SIZE);
+        memset(cp + 1 + DFU_HEADER_SIZE, 0, 4);
+        dfu_sim_phone_cp_send(cp, DFU_LENGTH_START_DFU);
+        dfu_sim_phone_state = DFU_SIM_PHONE_START;
+        break;
+    case DFU_OPCODE_START_DFU:
+        cp[0] = DFU_OPCODE_BUFFER_CHECK_EN;
+        dfu_sim_phone_cp_send(cp, 1);
+        dfu_sim_phone_state = DFU_SIM_PHONE_CHECK_EN;
+        break;
+    case DFU_OPCODE_BUFFER_CHECK_EN:
+        cp[0] = DFU_OPCODE_RECEIVE_FW_IMAGE_INFO;
+        LE_UINT16_TO_ARRAY(cp + 1, AppPatch);
+        LE_UINT32_TO_ARRAY(cp + 3, DFU_HEADER_SIZE);
+        dfu_sim_phone_cp_send(cp, DFU_LENGTH_RECEIVE_FW_IMAGE_INFO);
+        dfu_sim_phone_buffer_start(DFU_HEADER_SIZE);
+        break;
+    case DFU_OPCODE_REPORT_BUFFER_CRC:
+        {
+            uint32_t offset;
+            LE_ARRAY_TO_UINT32(offset, pnotif->data + 3);
+            if (DFU_ARV_SUCCESS != status)
+            {
+                dfu_sim_result.resends ++;
+            }
+            if (offset >= dfu_sim_cfg.image_len)
+            {
+                cp[0] = DFU_OPCODE_VALID_FW;
+                LE_UINT16_TO_ARRAY(cp + 1, AppPatch);
+                dfu_sim_phone_cp_send(cp, DFU_LENGTH_VALID_FW);
+                dfu_sim_phone_state = DFU_SIM_PHONE_VALID;
+            }
+            else
+            {
+                dfu_sim_phone_buffer_start(offset);
+            }
+        }
+        break;
+    case DFU_OPCODE_VALID_FW:
+        dfu_sim_result.valid = (DFU_ARV_SUCCESS == status);
+        cp[0] = DFU_OPCODE_ACTIVE_IMAGE_RESET;
+        dfu_sim_phone_cp_send(cp, DFU_LENGTH_ACTIVE_IMAGE_RESET);
+        dfu_sim_phone_state = DFU_SIM_PHONE_DONE;
+        break;
+    default:
+        printf("unexpected notification 0x%02x status %u\n", opcode, status);
+        exit(1);
+    }
+}
+
+/* the next write of the phone, FALSE if it waits for a notification */
+static bool dfu_sim_phone_send(void)
+{
+    if (dfu_sim_phone_cp_pending)
+    {
+        dfu_sim_phone_cp_pending = FALSE;
+        dfu_sim_fifo_push(DFU_SIM_ITEM_CP, dfu_sim_phone_cp, dfu_sim_phone_cp_len);
+        return TRUE;
+    }
+    if (DFU_SIM_PHONE_SEND != dfu_sim_phone_state)
+    {
+        return FALSE;
+    }
+
+    uint16_t len = MIN(dfu_sim_cfg.pkt_len, dfu_sim_phone_buf_len - dfu_sim_phone_sent);
+    dfu_sim_fifo_push(DFU_SIM_ITEM_DATA, dfu_sim_image + dfu_sim_phone_offset + dfu_sim_phone_sent,
+                      len);
+    dfu_sim_phone_sent += len;
+    if (dfu_sim_phone_sent == dfu_sim_phone_buf_len)
+    {
+        uint8_t cp[5];
+        cp[0] = DFU_OPCODE_REPORT_BUFFER_CRC;
+        LE_UINT16_TO_ARRAY(cp + 1, dfu_sim_phone_buf_len);
+        LE_UINT16_TO_ARRAY(cp + 3, dfu_sim_crc16(dfu_sim_image + dfu_sim_phone_offset,
+                                                 dfu_sim_phone_buf_len));
+        dfu_sim_phone_cp_send(cp, sizeof(cp));
+        dfu_sim_phone_state = DFU_SIM_PHONE_WAIT_CRC;
+    }
+    return TRUE;
+}
+
+/* handle one item of the app task queue, return its cpu time */
+static uint64_t dfu_sim_item_handle(dfu_sim_item_t *pitem)
+{
+    dfu_sim_busy_us = 0;
+    switch (pitem->type)
+    {
+    case DFU_SIM_ITEM_DATA:
+        dfu_attr_write_cb(0, dfu_server_id, INDEX_DFU_PACKET_VALUE, WRITE_WITHOUT_RESPONSE,
+                          pitem->len, pitem->data, NULL);
+        return 20 + pitem->len / 8 + dfu_sim_busy_us;
+    case DFU_SIM_ITEM_CP:
+        dfu_attr_write_cb(0, dfu_server_id, INDEX_DFU_CONTROL_POINT_CHAR_VALUE, WRITE_REQUEST,
+                          pitem->len, pitem->data, NULL);
+        return 50 + dfu_sim_busy_us;
+    default:
+        dfu_server_program();
+        return 10 + dfu_sim_busy_us;
+    }
+}
+
+/* airtime of one write and its empty ack, 1M phy */
+static uint32_t dfu_sim_pkt_airtime(uint32_t len)
+{
+    return (len + 3 + 4 + 10) * 8 + 150 + 80 + 150;
+}
+
+static void dfu_sim_run(void)
+{
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    memset(&dfu_sim_result, 0, sizeof(dfu_sim_result));
+    memset(dfu_sim_flash, 0x00, sizeof(dfu_sim_flash));
+    memset(&dfu_ctx, 0, sizeof(dfu_ctx));
+    gSilBufCheckEN = false;
+    dfu_sim_fifo_head = 0;
+    dfu_sim_fifo_num = 0;
+    dfu_sim_rx_num = 0;
+    dfu_sim_notif_num = 0;
+    dfu_sim_notif_stamped = 0;
+    dfu_sim_phone_cp_pending = FALSE;
+    dfu_sim_rng = 1;
+
+    dfu_cccd_update_cb(0, dfu_server_id, INDEX_DFU_CHAR_CCCD_INDEX, GATT_CLIENT_CHAR_CONFIG_NOTIFY);
+    if (!dfu_sim_cfg.pipeline && (NULL != dfu_program_buffer))
+    {
+        /* no spare buffer, the server programs in place */
+        plt_free(dfu_program_buffer, RAM_TYPE_DATA_ON);
+        dfu_program_buffer = NULL;
+    }
+
+    uint8_t cp[3] = {DFU_OPCODE_REPORT_TARGET_INFO};
+    LE_UINT16_TO_ARRAY(cp + 1, AppPatch);
+    dfu_sim_phone_cp_send(cp, DFU_LENGTH_REPORT_TARGET_INFO);
+    dfu_sim_phone_state = DFU_SIM_PHONE_TARGET_INFO;
+
+    uint32_t event_pkt_max = MIN(DFU_SIM_EVENT_PKT_MAX, MAX(1, dfu_sim_cfg.interval_us * 4 / 5 /
+                                                         dfu_sim_pkt_airtime(dfu_sim_cfg.pkt_len)));
+    uint64_t cpu_free = 0;
+    uint64_t now;
+    for (now = 0; (now < DFU_SIM_TIME_MAX_US) && !dfu_sim_result.rebooted;
+         now += dfu_sim_cfg.interval_us)
+    {
+        /* the phone sees the notifications sent before this event */
+        uint32_t num = 0;
+        while ((num < dfu_sim_notif_stamped) && (dfu_sim_notif_ready[num] <= now))
+        {
+            dfu_sim_phone_notify(&dfu_sim_notifs[num]);
+            num ++;
+        }
+        if (num > 0)
+        {
+            memmove(dfu_sim_notifs, dfu_sim_notifs + num, (dfu_sim_notif_num - num) * sizeof(dfu_sim_notif_t));
+            memmove(dfu_sim_notif_ready, dfu_sim_notif_ready + num,
+                    (dfu_sim_notif_num - num) * sizeof(uint64_t));
+            dfu_sim_notif_num -= num;
+            dfu_sim_notif_stamped -= num;
+        }
+
+        for (uint32_t pkt = 0; pkt < event_pkt_max; ++pkt)
+        {
+            if (DFU_SIM_RX_BUF_NUM == dfu_sim_rx_num)
+            {
+                dfu_sim_result.rx_full_events ++;
+                break;
+            }
+            if (!dfu_sim_phone_send())
+            {
+                break;
+            }
+        }
+
+        /* the app task works until the next event */
+        uint64_t t = MAX(cpu_free, now);
+        while ((dfu_sim_fifo_num > 0) && (t < now + dfu_sim_cfg.interval_us))
+        {
+            dfu_sim_item_t *pitem = &dfu_sim_fifo[dfu_sim_fifo_head];
+            dfu_sim_fifo_head = (dfu_sim_fifo_head + 1) % DFU_SIM_FIFO_SIZE;
+            dfu_sim_fifo_num --;
+            if (DFU_SIM_ITEM_PROGRAM != pitem->type)
+            {
+                dfu_sim_rx_num --;
+            }
+            t += dfu_sim_item_handle(pitem);
+            for (; dfu_sim_notif_stamped < dfu_sim_notif_num; ++dfu_sim_notif_stamped)
+            {
+                dfu_sim_notif_ready[dfu_sim_notif_stamped] = t;
+            }
+        }
+        cpu_free = t;
+    }
+    dfu_sim_result.time_us = now;
+    dfu_server_disconnect_cb(0);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t image_kb = (argc > 1) ? strtoul(argv[1], NULL, 0) : 120;
+    uint32_t erase_ms = (argc > 2) ? strtoul(argv[2], NULL, 0) : 45;
+    uint32_t word_us = (argc > 3) ? strtoul(argv[3], NULL, 0) : 25;
+    uint32_t fail_percent = (argc > 4) ? strtoul(argv[4], NULL, 0) : 0;
+    if ((image_kb * 1024 > DFU_SIM_IMAGE_MAX) || (image_kb * 1024 <= IMG_HEADER_SIZE) ||
+        (fail_percent >= 100))
+    {
+        printf("image shall be 2 ~ %u KB, failure rate below 100%%\n", DFU_SIM_IMAGE_MAX / 1024);
+        return 1;
+    }
+
+    /* random image behind the header of the start dfu message */
+    dfu_sim_cfg.image_len = image_kb * 1024;
+    for (uint32_t i = 0; i < dfu_sim_cfg.image_len; ++i)
+    {
+        dfu_sim_image[i] = dfu_sim_rand();
+    }
+    T_START_DFU_PARA *pheader = (T_START_DFU_PARA *)dfu_sim_image;
+    pheader->signature = AppPatch;
+    pheader->image_length = dfu_sim_cfg.image_len - IMG_HEADER_SIZE;
+    dfu_sim_cfg.erase_us = erase_ms * 1000;
+    dfu_sim_cfg.word_us = word_us;
+    dfu_sim_cfg.fail_percent = fail_percent;
+    dfu_server_id = 1;
+
+    printf("%u KB image, %u ms sector erase, %u us word program, %u%% program failures\n", image_kb,
+           erase_ms, word_us, fail_percent);
+    printf("packet interval    in place  pipelined    cut  resends fails rx full\n");
+    static const uint32_t pkt_lens[] = {20, 244};
+    static const uint32_t intervals[] = {7500, 15000, 30000};
+    uint32_t errors = 0;
+    for (uint32_t p = 0; p < sizeof(pkt_lens) / sizeof(pkt_lens[0]); ++p)
+    {
+        for (uint32_t i = 0; i < sizeof(intervals) / sizeof(intervals[0]); ++i)
+        {
+            dfu_sim_result_t results[2];
+            for (uint32_t mode = 0; mode < 2; ++mode)
+            {
+                dfu_sim_cfg.pkt_len = pkt_lens[p];
+                dfu_sim_cfg.interval_us = intervals[i];
+                dfu_sim_cfg.pipeline = (1 == mode);
+                dfu_sim_run();
+                results[mode] = dfu_sim_result;
+                if (!dfu_sim_result.valid || !dfu_sim_result.rebooted)
+                {
+                    printf("%s: image %s, %s\n", mode ? "pipelined" : "in place",
+                           dfu_sim_result.valid ? "valid" : "INVALID",
+                           dfu_sim_result.rebooted ? "rebooted" : "NOT finished");
+                    errors ++;
+                }
+            }
+            printf("%6u %6.1f ms %8.2f s %8.2f s %5.1f%% %4u/%-4u %2u/%-2u %4u/%-4u\n", pkt_lens[p],
+                   intervals[i] / 1000.0, results[0].time_us / 1e6, results[1].time_us / 1e6,
+                   100.0 * ((double)results[0].time_us - results[1].time_us) / results[0].time_us,
+                   results[0].resends, results[1].resends, results[0].prog_fails, results[1].prog_fails,
+                   results[0].rx_full_events, results[1].rx_full_events);
+        }
+    }
+
+    plt_sim_stat_t stat;
+    plt_sim_stat_get(&stat);
+    if (0 != stat.mem_used)
+    {
+        printf("%u bytes leaked\n", stat.mem_used);
+        errors ++;
+    }
+    printf("%s\n", errors ? "FAIL" : "PASS");
+    return errors ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -0,0 +1,211 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     dimming_curve_sim.c
+  * @brief    Host accuracy report and benchmark of the dimming curve tables.
+  * @details  The lightness to pwm count conversion of dimmable_light.c is compared for every
+  *           lightness against a double reference of the configured curve and against the former
+  *           float scaling, then the cycles of one conversion are measured against the former
+  *           float path. The integer lightness linear and actual conversions of the lightness
+  *           server are checked and timed against the former double code the same way.
+  *           dimmable_light.c is included to reach its static conversion. Build it on a linux
+  *           host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> dimming_curve_sim.c
+  *           light_lightness_server.c generic_transition_time.c platform_sim.c -lm
+  *           -o dimming_curve_sim
+  *           and add -DLIGHT_DIMMING_CURVE=DIMMING_CURVE_CIE1931 or another curve to check it.
+  * @note     The host has hardware double multiply and sqrt, the cortex-m4 runs double math in
+  *           the software floating point library, so the host cycles favour the former code.
+  * @author   bill
+  * @date     2018-12-17
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "dimmable_light.c"
+#include "light_lightness.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define DIMMING_CURVE_SIM_BENCH_NUM         (1 << 24)
+
+/* light_lightness_server.c sends through the access layer, not linked here */
+mesh_msg_send_cause_t access_cfg(mesh_msg_p pmsg)
+{
+    UNUSED(pmsg);
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+mesh_msg_send_cause_t access_send(mesh_msg_p pmsg)
+{
+    UNUSED(pmsg);
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+bool mesh_model_reg(uint8_t element_index, mesh_model_info_p pmodel_info)
+{
+    UNUSED(element_index);
+    UNUSED(pmodel_info);
+    return TRUE;
+}
+
+bool mesh_model_pub_check(mesh_model_info_p pmodel_info)
+{
+    UNUSED(pmodel_info);
+    return FALSE;
+}
+
+static uint64_t dimming_curve_sim_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/* output of the configured curve in 0 ~ 1 */
+static double dimming_curve_sim_ref(uint16_t lightness)
+{
+    double x = lightness / 65535.0;
+    switch (LIGHT_DIMMING_CURVE)
+    {
+    case DIMMING_CURVE_SQUARE_LAW:
+        return x * x;
+    case DIMMING_CURVE_CIE1931:
+        {
+            double l = 100 * x;
+            return (l <= 8) ? (l / 903.3) : pow((l + 16) / 116, 3);
+        }
+    case DIMMING_CURVE_CUSTOM:
+        return DIMMING_CURVE_CLAMP_Q16(DIMMING_CURVE_CUSTOM_Q16((uint32_t)lightness)) / 65535.0;
+    default:
+        return x;
+    }
+}
+
+/* former float scaling, always linear */
+static uint32_t dimming_curve_sim_float_count(uint16_t lightness)
+{
+    if (0xffff == lightness)
+    {
+        return LED_PWM_COUNT;
+    }
+    return (LED_PWM_COUNT / 65535.0) * lightness;
+}
+
+static uint16_t dimming_curve_sim_float_linear_to_actual(uint16_t lightness_linear)
+{
+    return (uint16_t)(65535 * sqrt(lightness_linear / 65535.0));
+}
+
+static uint16_t dimming_curve_sim_float_actual_to_linear(uint16_t lightness_actual)
+{
+    return (uint16_t)(lightness_actual / 65535.0 * lightness_actual);
+}
+
+int main(void)
+{
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+
+    static const char *const names[] = {"linear", "square law", "cie1931", "custom"};
+    printf("curve %s, %u table points, %u bytes\n", names[LIGHT_DIMMING_CURVE],
+           DIMMING_CURVE_POINTS, (uint32_t)sizeof(light_curve_count));
+
+    /* table against the double reference and the former float scaling */
+    uint32_t err_max = 0, err_lightness = 0, float_err_max = 0;
+    bool monotonic = TRUE;
+    uint32_t prev = 0;
+    for (uint32_t lightness = 0; lightness < 65536; ++lightness)
+    {
+        uint32_t count = light_lightness_to_count(lightness);
+        double ref = LED_PWM_COUNT * dimming_curve_sim_ref(lightness);
+        uint32_t err = (uint32_t)fabs(count - ref + 0.5);
+        if (err > err_max)
+        {
+            err_max = err;
+            err_lightness = lightness;
+        }
+        int32_t diff = (int32_t)count - (int32_t)dimming_curve_sim_float_count(lightness);
+        if ((uint32_t)abs(diff) > float_err_max)
+        {
+            float_err_max = abs(diff);
+        }
+        if (count < prev)
+        {
+            monotonic = FALSE;
+        }
+        prev = count;
+    }
+    printf("max error %u counts of %u at lightness %u, %s, ends %u and %u\n", err_max,
+           LED_PWM_COUNT, err_lightness, monotonic ? "monotonic" : "NOT monotonic",
+           light_lightness_to_count(0), light_lightness_to_count(65535));
+    if (DIMMING_CURVE_LINEAR == LIGHT_DIMMING_CURVE)
+    {
+        printf("max difference to the former float scaling %u counts\n", float_err_max);
+    }
+
+    /* lightness linear and actual against the former double code */
+    uint32_t to_actual_differ = 0, to_linear_differ = 0;
+    for (uint32_t lightness = 0; lightness < 65536; ++lightness)
+    {
+        if (light_lightness_linear_to_actual(lightness) !=
+            dimming_curve_sim_float_linear_to_actual(lightness))
+        {
+            to_actual_differ ++;
+        }
+        if (light_lightness_actual_to_linear(lightness) !=
+            dimming_curve_sim_float_actual_to_linear(lightness))
+        {
+            to_linear_differ ++;
+        }
+    }
+    printf("linear to actual differ %u, actual to linear differ %u of 65536\n", to_actual_differ,
+           to_linear_differ);
+
+    /* cycles per call */
+    volatile uint32_t sink = 0;
+    uint64_t begin = dimming_curve_sim_cycles();
+    for (uint32_t i = 0; i < DIMMING_CURVE_SIM_BENCH_NUM; ++i)
+    {
+        sink += dimming_curve_sim_float_count((uint16_t)(i * 40503));
+    }
+    double float_count = (double)(dimming_curve_sim_cycles() - begin) / DIMMING_CURVE_SIM_BENCH_NUM;
+    begin = dimming_curve_sim_cycles();
+    for (uint32_t i = 0; i < DIMMING_CURVE_SIM_BENCH_NUM; ++i)
+    {
+        sink += light_lightness_to_count((uint16_t)(i * 40503));
+    }
+    double table_count = (double)(dimming_curve_sim_cycles() - begin) / DIMMING_CURVE_SIM_BENCH_NUM;
+    begin = dimming_curve_sim_cycles();
+    for (uint32_t i = 0; i < DIMMING_CURVE_SIM_BENCH_NUM; ++i)
+    {
+        sink += dimming_curve_sim_float_linear_to_actual((uint16_t)(i * 40503));
+    }
+    double float_sqrt = (double)(dimming_curve_sim_cycles() - begin) / DIMMING_CURVE_SIM_BENCH_NUM;
+    begin = dimming_curve_sim_cycles();
+    for (uint32_t i = 0; i < DIMMING_CURVE_SIM_BENCH_NUM; ++i)
+    {
+        sink += light_lightness_linear_to_actual((uint16_t)(i * 40503));
+    }
+    double int_sqrt = (double)(dimming_curve_sim_cycles() - begin) / DIMMING_CURVE_SIM_BENCH_NUM;
+    printf("host cycles per call: lightness to count float %.1f, table %.1f; "
+           "linear to actual double %.1f, integer %.1f (%u)\n", float_count, table_count, float_sqrt,
+           int_sqrt, sink & 1);
+
+    return (!monotonic || to_actual_differ || to_linear_differ) ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
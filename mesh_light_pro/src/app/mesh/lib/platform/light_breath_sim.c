@@ -0,0 +1,103 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     light_breath_sim.c
+  * @brief    Host simulation of the lazy hsl state under a breathing workload.
+  * @details  The red, green and blue channels breathe out of phase, each one written on its own
+  *           every LIGHT_MONITOR_INTERVAL of virtual time, while an hsl get arrives periodically.
+  *           Every hsl read is checked against a fresh rgb_2_hsl of the channels, and the channel
+  *           writes, the conversions done and the conversions avoided are reported. Build it on a
+  *           linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> light_breath_sim.c
+  *           dimmable_light.c light_controller_app.c light_cwrgb_app.c platform_sim.c -lm
+  *           -o light_breath_sim
+  *           and run it with the breath time in s, the breath period in ms and the hsl get
+  *           interval in ms, e.g. ./light_breath_sim 10 2000 1000
+  * @author   bill
+  * @date     2018-12-10
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "light_config.h"
+#include "light_controller_app.h"
+#include "light_cwrgb_app.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+/* light_cwrgb_app.c stores the state through the storage module, not linked here */
+bool light_state_store(void)
+{
+    return TRUE;
+}
+
+/* triangle breath between 0 and 65535, phase in thirds of the period */
+static uint16_t light_breath_sim_level(uint32_t time, uint32_t period, uint32_t phase)
+{
+    uint32_t t = (time + period * phase / 3) % period;
+    uint32_t half = period / 2;
+    return (t < half) ? (uint16_t)(65535ULL * t / half) : (uint16_t)(65535ULL * (period - t) / half);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t duration = (argc > 1) ? strtoul(argv[1], NULL, 0) * 1000 : 10000;
+    uint32_t period = (argc > 2) ? strtoul(argv[2], NULL, 0) : 2000;
+    uint32_t get_interval = (argc > 3) ? strtoul(argv[3], NULL, 0) : 1000;
+    if (period < 2 || 0 == get_interval)
+    {
+        printf("invalid period or get interval\n");
+        return 1;
+    }
+
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    light_cwrgb_driver_init();
+    light_controller_init();
+
+    light_hsl_cache_stat_t begin;
+    light_get_hsl_cache_stat(&begin);
+    uint32_t gets = 0;
+    uint32_t mismatch = 0;
+    for (uint32_t time = 0; time < duration; time += LIGHT_MONITOR_INTERVAL)
+    {
+        light_set_red_lightness(light_breath_sim_level(time, period, 0));
+        light_set_green_lightness(light_breath_sim_level(time, period, 1));
+        light_set_blue_lightness(light_breath_sim_level(time, period, 2));
+        plt_sim_clock_advance(LIGHT_MONITOR_INTERVAL);
+
+        if ((time + LIGHT_MONITOR_INTERVAL) % get_interval < LIGHT_MONITOR_INTERVAL)
+        {
+            light_rgb_t rgb = light_get_rgb_lightness();
+            light_hsl_t expect = rgb_2_hsl(rgb);
+            light_hsl_t hsl = light_get_hsl();
+            gets ++;
+            if (0 != memcmp(&hsl, &expect, sizeof(hsl)))
+            {
+                printf("%u ms: hsl %u %u %u, expect %u %u %u\n", time, hsl.hue, hsl.saturation,
+                       hsl.lightness, expect.hue, expect.saturation, expect.lightness);
+                mismatch ++;
+            }
+            /* a second read without a write converts nothing */
+            light_get_hsl();
+        }
+    }
+
+    light_hsl_cache_stat_t end;
+    light_get_hsl_cache_stat(&end);
+    uint32_t writes = end.invalidate_count - begin.invalidate_count;
+    uint32_t converts = end.convert_count - begin.convert_count;
+    printf("%u ms breath of %u ms period, hsl get every %u ms\n", duration, period, get_interval);
+    printf("channel writes %u, hsl gets %u, conversions %u, avoided %u, mismatches %u\n", writes,
+           gets * 2, converts, writes - converts, mismatch);
+
+    return (mismatch || converts > gets) ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -0,0 +1,439 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     light_ctl_sim.c
+  * @brief    Host test of the ctl mixing of the cold and warm channels.
+  * @details  The CTL_LOCUS table of light_cwrgb_app.c is recomputed by the krystek fit and the
+  *           krystek fit is checked against planck's law with the cie 1931 2 degree observer fit
+  *           of wyman, sloan and shirley. ctl_2_cw is checked against a reference mix in double,
+  *           the target point moved along the locus normal by the delta uv and projected on the
+  *           chord of the two leds, with either locus. Then the round trip by cw_2_ctl, the ctl
+  *           kept across turn off and on, the transition steps and the cost of ctl_2_cw are
+  *           checked. Build it on a linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> light_ctl_sim.c
+  *           light_controller_app.c platform_sim.c -lm -o light_ctl_sim
+  *           and run it, or print the table again for light_cwrgb_app.c, e.g. ./light_ctl_sim table
+  * @author   bill
+  * @date     2018-12-26
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+/* the mixing table and the ctl state are static */
+#include "dimmable_light.c"
+#include "light_cwrgb_app.c"
+
+#define LIGHT_CTL_SIM_CHROMA_ERR            0.0005 //!< cie 1960 uv
+#define LIGHT_CTL_SIM_LOCUS_ERR             0.003 //!< krystek vs planck's law
+#define LIGHT_CTL_SIM_MIRED_ERR             1.0
+#define LIGHT_CTL_SIM_CW_ERR                64
+#define LIGHT_CTL_SIM_TABLE_ERR             2 //!< 1e-6 uv, the rounding of the table
+#define LIGHT_CTL_SIM_COST_LOOPS            2000000
+
+#define LIGHT_CTL_SIM_ROW(u, v, nu, nv)     {u, v, nu, nv}
+
+typedef void (*light_ctl_sim_locus_t)(double t, double *pu, double *pv);
+
+static const int32_t light_ctl_sim_table[CTL_LOCUS_POINTS][4] = {CTL_LOCUS(LIGHT_CTL_SIM_ROW)};
+static const double light_ctl_sim_cold_u = LIGHT_CTL_COLD_U / 1e6;
+static const double light_ctl_sim_cold_v = LIGHT_CTL_COLD_V / 1e6;
+static const double light_ctl_sim_warm_u = LIGHT_CTL_WARM_U / 1e6;
+static const double light_ctl_sim_warm_v = LIGHT_CTL_WARM_V / 1e6;
+
+static double light_ctl_sim_lobe(double x, double mu, double s1, double s2)
+{
+    double t = (x - mu) / ((x < mu) ? s1 : s2);
+    return exp(-0.5 * t * t);
+}
+
+/* planckian locus by planck's law and the piecewise gaussian fit of the cmf, about 1e-3 uv */
+static void light_ctl_sim_planck(double t, double *pu, double *pv)
+{
+    double x = 0;
+    double y = 0;
+    double z = 0;
+    for (double l = 360; l <= 830; l += 1)
+    {
+        double m = l * 1e-9;
+        double p = 1.0 / (pow(m, 5) * (exp(1.4388e-2 / (m * t)) - 1));
+        x += p * (1.056 * light_ctl_sim_lobe(l, 599.8, 37.9, 31.0) +
+                  0.362 * light_ctl_sim_lobe(l, 442.0, 16.0, 26.7) -
+                  0.065 * light_ctl_sim_lobe(l, 501.1, 20.4, 26.2));
+        y += p * (0.821 * light_ctl_sim_lobe(l, 568.8, 46.9, 40.5) +
+                  0.286 * light_ctl_sim_lobe(l, 530.9, 16.3, 31.1));
+        z += p * (1.217 * light_ctl_sim_lobe(l, 437.0, 11.8, 36.0) +
+                  0.681 * light_ctl_sim_lobe(l, 459.0, 26.0, 13.8));
+    }
+    double den = x + 15 * y + 3 * z;
+    *pu = 4 * x / den;
+    *pv = 6 * y / den;
+}
+
+/* planckian locus by the krystek rational fit of the cie tables, about 1e-4 uv */
+static void light_ctl_sim_krystek(double t, double *pu, double *pv)
+{
+    *pu = (0.860117757 + 1.54118254e-4 * t + 1.28641212e-7 * t * t) /
+          (1 + 8.42420235e-4 * t + 7.08145163e-7 * t * t);
+    *pv = (0.317398726 + 4.22806245e-5 * t + 4.20481691e-8 * t * t) /
+          (1 - 2.89741816e-5 * t + 1.61456053e-7 * t * t);
+}
+
+/* the locus point and its unit normal towards positive delta uv */
+static void light_ctl_sim_normal(light_ctl_sim_locus_t locus, double t, double *pu, double *pv,
+                                 double *pnu, double *pnv)
+{
+    double u0;
+    double v0;
+    double u1;
+    double v1;
+    locus(t, pu, pv);
+    locus(t * 0.9999, &u0, &v0);
+    locus(t * 1.0001, &u1, &v1);
+    double len = hypot(u1 - u0, v1 - v0);
+    *pnu = -(v1 - v0) / len;
+    *pnv = (u1 - u0) / len;
+    if (*pnv < 0)
+    {
+        *pnu = -*pnu;
+        *pnv = -*pnv;
+    }
+}
+
+/* cold luminance share of the reference mix */
+static double light_ctl_sim_share(light_ctl_sim_locus_t locus, double t, double duv)
+{
+    double u;
+    double v;
+    double nu;
+    double nv;
+    light_ctl_sim_normal(locus, t, &u, &v, &nu, &nv);
+    u += duv * nu;
+    v += duv * nv;
+    double du = light_ctl_sim_cold_u - light_ctl_sim_warm_u;
+    double dv = light_ctl_sim_cold_v - light_ctl_sim_warm_v;
+    double s = ((u - light_ctl_sim_warm_u) * du + (v - light_ctl_sim_warm_v) * dv) /
+               (du * du + dv * dv);
+    s = (s < 0) ? 0 : ((s > 1) ? 1 : s);
+    return s * light_ctl_sim_cold_v / ((1 - s) * light_ctl_sim_warm_v + s * light_ctl_sim_cold_v);
+}
+
+/* chromaticity of the mix of a cold luminance share */
+static void light_ctl_sim_mix(double share, double *pu, double *pv)
+{
+    double cold = share / light_ctl_sim_cold_v;
+    double warm = (1 - share) / light_ctl_sim_warm_v;
+    *pu = (cold * light_ctl_sim_cold_u + warm * light_ctl_sim_warm_u) / (cold + warm);
+    *pv = (cold * light_ctl_sim_cold_v + warm * light_ctl_sim_warm_v) / (cold + warm);
+}
+
+/* cct of a point, the nearest krystek locus point by golden section search in mired */
+static double light_ctl_sim_cct(double u, double v)
+{
+    double low = CTL_MIRED_MIN;
+    double high = CTL_MIRED_MIN + (CTL_LOCUS_POINTS - 1) * CTL_MIRED_STEP;
+    for (uint8_t i = 0; i < 80; ++i)
+    {
+        double m1 = low + (high - low) * 0.382;
+        double m2 = low + (high - low) * 0.618;
+        double u1;
+        double v1;
+        double u2;
+        double v2;
+        light_ctl_sim_krystek(1e6 / m1, &u1, &v1);
+        light_ctl_sim_krystek(1e6 / m2, &u2, &v2);
+        if (hypot(u1 - u, v1 - v) < hypot(u2 - u, v2 - v))
+        {
+            high = m2;
+        }
+        else
+        {
+            low = m1;
+        }
+    }
+    return 1e6 / ((low + high) / 2);
+}
+
+/* recompute the table, print it in the CTL_LOCUS format if asked, return the failures */
+static uint32_t light_ctl_sim_table_check(bool print)
+{
+    uint32_t fails = 0;
+    int32_t err_max = 0;
+    for (uint8_t i = 0; i < CTL_LOCUS_POINTS; ++i)
+    {
+        double u;
+        double v;
+        double nu;
+        double nv;
+        light_ctl_sim_normal(light_ctl_sim_krystek, 1e6 / (CTL_MIRED_MIN + i * CTL_MIRED_STEP),
+                             &u, &v, &nu, &nv);
+        int32_t row[4] = {lround(u * 1e6), lround(v * 1e6), lround(nu * 1e6), lround(nv * 1e6)};
+        if (print)
+        {
+            printf("    f(%d, %d, %d, %d), \\\n", row[0], row[1], row[2], row[3]);
+        }
+        for (uint8_t k = 0; k < 4; ++k)
+        {
+            int32_t err = abs(row[k] - light_ctl_sim_table[i][k]);
+            if (err > err_max)
+            {
+                err_max = err;
+            }
+            if (err > LIGHT_CTL_SIM_TABLE_ERR)
+            {
+                if (fails < 5)
+                {
+                    printf("  locus row %u column %u: %d, expected %d\n", i, k,
+                           light_ctl_sim_table[i][k], row[k]);
+                }
+                fails ++;
+            }
+        }
+    }
+    printf("locus table: %u points, max err %d e-6 uv\n", CTL_LOCUS_POINTS, err_max);
+
+    double locus_max = 0;
+    for (double t = 2000; t <= 15000; t += 100)
+    {
+        double u1;
+        double v1;
+        double u2;
+        double v2;
+        light_ctl_sim_krystek(t, &u1, &v1);
+        light_ctl_sim_planck(t, &u2, &v2);
+        locus_max = fmax(locus_max, hypot(u1 - u2, v1 - v2));
+    }
+    printf("locus: krystek vs planck's law 2000K ~ 15000K, max %.6f uv\n", locus_max);
+    return fails;
+}
+
+/* ctl_2_cw against the reference mix of a locus, return the max chromaticity error */
+static double light_ctl_sim_mix_check(const char *name, light_ctl_sim_locus_t locus,
+                                      uint32_t *pfails)
+{
+    static const int16_t duvs[] = {0, -328, 328, -655, 655}; //!< 0, +-0.01, +-0.02
+    double share_max = 0;
+    double chroma_max = 0;
+    double cct_max = 0;
+    uint32_t points = 0;
+    for (uint32_t t = 800; t <= 20000; t += (t < 3000) ? 25 : 100)
+    {
+        for (uint8_t k = 0; k < sizeof(duvs) / sizeof(duvs[0]); ++k)
+        {
+            light_ctl_t ctl = {65535, t, duvs[k]};
+            light_cw_t cw = ctl_2_cw(ctl);
+            if ((uint32_t)cw.cold + cw.warm != 65535)
+            {
+                printf("  %uK: cold %u warm %u, lightness not kept\n", t, cw.cold, cw.warm);
+                (*pfails) ++;
+            }
+            double ref = light_ctl_sim_share(locus, t, duvs[k] / 32768.0);
+            double share = cw.cold / 65535.0;
+            double u1;
+            double v1;
+            double u2;
+            double v2;
+            light_ctl_sim_mix(share, &u1, &v1);
+            light_ctl_sim_mix(ref, &u2, &v2);
+            share_max = fmax(share_max, fabs(share - ref));
+            chroma_max = fmax(chroma_max, hypot(u1 - u2, v1 - v2));
+            if ((0 == duvs[k]) && (t >= 2700) && (t <= 6500))
+            {
+                cct_max = fmax(cct_max, fabs(light_ctl_sim_cct(u1, v1) - t));
+            }
+            points ++;
+        }
+    }
+    printf("mix vs %-8s: %u points, max share err %.5f, max chromaticity err %.6f uv, "
+           "max cct err %.1f K (2700K ~ 6500K)\n", name, points, share_max, chroma_max, cct_max);
+    return chroma_max;
+}
+
+static uint32_t light_ctl_sim_round_trip(void)
+{
+    uint32_t fails = 0;
+    double mired_max = 0;
+    for (uint32_t t = 2700; t <= 6500; t += 10)
+    {
+        light_ctl_t ctl = {50000, t, 0};
+        light_ctl_t back = cw_2_ctl(ctl_2_cw(ctl));
+        mired_max = fmax(mired_max, fabs(1e6 / back.temperature - 1e6 / t));
+        if (50000 != back.lightness)
+        {
+            printf("  %uK: lightness %u\n", t, back.lightness);
+            fails ++;
+        }
+    }
+    printf("round trip: max err %.2f mired\n", mired_max);
+    if (mired_max > LIGHT_CTL_SIM_MIRED_ERR)
+    {
+        fails ++;
+    }
+
+    for (uint32_t cold = 0; cold <= 65535; cold += 257)
+    {
+        light_cw_t cw = {cold, 65535 - cold};
+        light_ctl_t ctl = cw_2_ctl(cw);
+        light_cw_t back = ctl_2_cw(ctl);
+        if (abs((int32_t)back.cold - (int32_t)cw.cold) > LIGHT_CTL_SIM_CW_ERR)
+        {
+            printf("  cold %u: %uK, back %u\n", cold, ctl.temperature, back.cold);
+            fails ++;
+        }
+    }
+    return fails;
+}
+
+static uint32_t light_ctl_sim_state(void)
+{
+    uint32_t fails = 0;
+    light_cwrgb_driver_init();
+    light_ctl_t set = {40000, 4321, -200};
+    light_set_ctl(set);
+    light_cw_turn_off();
+    light_ctl_t ctl = light_get_ctl();
+    if ((0 != ctl.lightness) || (4321 != ctl.temperature) || (-200 != ctl.delta_uv))
+    {
+        printf("  off: %u %uK %d\n", ctl.lightness, ctl.temperature, ctl.delta_uv);
+        fails ++;
+    }
+    light_cw_turn_on();
+    ctl = light_get_ctl();
+    if ((40000 != ctl.lightness) || (4321 != ctl.temperature) || (-200 != ctl.delta_uv))
+    {
+        printf("  on: %u %uK %d\n", ctl.lightness, ctl.temperature, ctl.delta_uv);
+        fails ++;
+    }
+
+    /* mixed by the warm channel, read back from the channels */
+    light_set_warm_lightness(0);
+    ctl = light_get_ctl();
+    printf("warm off: %u %uK %d\n", ctl.lightness, ctl.temperature, ctl.delta_uv);
+    if ((ctl.temperature < 6400) || (0 != ctl.delta_uv))
+    {
+        fails ++;
+    }
+    return fails;
+}
+
+static uint32_t light_ctl_sim_transition(void)
+{
+    uint32_t fails = 0;
+    light_ctl_t start = {10000, 2700, 0};
+    light_ctl_t target = {60000, 6500, 300};
+    light_ctl_t trans_start;
+    light_ctl_t ctl;
+    uint16_t temperature = 0;
+    uint16_t lightness = 0;
+    light_set_ctl(start);
+    for (int8_t remaining = 20; remaining >= 0; --remaining)
+    {
+        bool done = light_ctl_transition_step(&trans_start, target,
+                                              LIGHT_CTL_FIELD_LIGHTNESS | LIGHT_CTL_FIELD_TEMPERATURE,
+                                              20, remaining, 100);
+        plt_sim_clock_advance(100);
+        ctl = light_get_ctl();
+        if (10 == remaining)
+        {
+            light_cw_t cw = light_get_cw_lightness();
+            printf("transition half: %u %uK %d, cold %u warm %u\n", ctl.lightness,
+                   ctl.temperature, ctl.delta_uv, cw.cold, cw.warm);
+        }
+        if ((ctl.temperature < temperature) || (ctl.lightness < lightness) ||
+            (done != (0 == remaining)))
+        {
+            printf("  step %d: %u %uK, done %d\n", remaining, ctl.lightness, ctl.temperature, done);
+            fails ++;
+        }
+        temperature = ctl.temperature;
+        lightness = ctl.lightness;
+    }
+    ctl = light_get_ctl();
+    if ((60000 != ctl.lightness) || (6500 != ctl.temperature) || (300 != ctl.delta_uv))
+    {
+        printf("  end: %u %uK %d\n", ctl.lightness, ctl.temperature, ctl.delta_uv);
+        fails ++;
+    }
+
+    /* the temperature alone keeps the lightness */
+    light_ctl_t temperature_target = {0, 3000, 0};
+    for (int8_t remaining = 5; remaining >= 0; --remaining)
+    {
+        light_ctl_transition_step(&trans_start, temperature_target, LIGHT_CTL_FIELD_TEMPERATURE, 5,
+                                  remaining, 1000);
+        plt_sim_clock_advance(1000);
+    }
+    ctl = light_get_ctl();
+    if ((60000 != ctl.lightness) || (3000 != ctl.temperature))
+    {
+        printf("  temperature only: %u %uK\n", ctl.lightness, ctl.temperature);
+        fails ++;
+    }
+
+    /* no transition time */
+    light_ctl_t lightness_target = {123, 5000, 0};
+    if (!light_ctl_transition_step(&trans_start, lightness_target, LIGHT_CTL_FIELD_LIGHTNESS, 0, 0,
+                                   100))
+    {
+        fails ++;
+    }
+    ctl = light_get_ctl();
+    if ((123 != ctl.lightness) || (3000 != ctl.temperature))
+    {
+        printf("  immediate: %u %uK\n", ctl.lightness, ctl.temperature);
+        fails ++;
+    }
+    return fails;
+}
+
+static void light_ctl_sim_cost(void)
+{
+    uint32_t sum = 0;
+    clock_t begin = clock();
+    for (uint32_t i = 0; i < LIGHT_CTL_SIM_COST_LOOPS; ++i)
+    {
+        light_ctl_t ctl = {i & 0xffff, 800 + i % 19200, (int16_t)(i * 7)};
+        sum += ctl_2_cw(ctl).cold;
+    }
+    double ns = (double)(clock() - begin) / CLOCKS_PER_SEC * 1e9 / LIGHT_CTL_SIM_COST_LOOPS;
+    printf("ctl_2_cw on the host: %.1f ns (%u)\n", ns, sum & 1);
+}
+
+int main(int argc, char **argv)
+{
+    bool print = (argc > 1) && (0 == strcmp(argv[1], "table"));
+    uint32_t fails = 0;
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+
+    fails += light_ctl_sim_table_check(print);
+    if (light_ctl_sim_mix_check("krystek", light_ctl_sim_krystek, &fails) >
+        LIGHT_CTL_SIM_CHROMA_ERR)
+    {
+        fails ++;
+    }
+    /* the planck reference only adds the error of the locus fits */
+    if (light_ctl_sim_mix_check("planck", light_ctl_sim_planck, &fails) >
+        LIGHT_CTL_SIM_LOCUS_ERR + LIGHT_CTL_SIM_CHROMA_ERR)
+    {
+        fails ++;
+    }
+    fails += light_ctl_sim_round_trip();
+    fails += light_ctl_sim_state();
+    fails += light_ctl_sim_transition();
+    light_ctl_sim_cost();
+
+    printf("%s\n", fails ? "FAIL" : "PASS");
+    return fails ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -0,0 +1,85 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     light_fade_sim.c
+  * @brief    Host benchmark of the cpu wakeups of a linear fade.
+  * @details  A linear fade of the cold channel runs through light_set_lightness_linear on the
+  *           virtual clock, the application timer wakeups, the fade interrupts and the largest
+  *           pwm duty step seen are reported. Build it on a linux host with the keil include path,
+  *           e.g. gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> light_fade_sim.c
+  *           dimmable_light.c light_controller_app.c light_cwrgb_app.c platform_sim.c -lm
+  *           -o light_fade_sim
+  *           and add -DLIGHT_HW_FADE=0 to measure the software steps of LIGHT_MONITOR_INTERVAL.
+  *           Run it with the fade time in ms and the lightness range, e.g.
+  *           ./light_fade_sim 20000 0 65535
+  * @author   bill
+  * @date     2018-12-10
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include "light_config.h"
+#include "light_controller_app.h"
+#include "light_cwrgb_app.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+/* light_cwrgb_app.c stores the state through the storage module, not linked here */
+bool light_state_store(void)
+{
+    return TRUE;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t time = (argc > 1) ? strtoul(argv[1], NULL, 0) : 20000;
+    uint16_t begin = (argc > 2) ? strtoul(argv[2], NULL, 0) : 0;
+    uint16_t end = (argc > 3) ? strtoul(argv[3], NULL, 0) : 65535;
+
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    light_cwrgb_driver_init();
+    light_controller_init();
+
+    light_t *light = light_get_cold();
+    light_set_lightness(light, begin);
+    const plt_sim_pwm_t *pwm = plt_sim_pwm_get(light->tim_id);
+    plt_sim_stat_clear();
+
+    light_set_lightness_linear(light, end, time, NULL);
+    uint32_t high_count = pwm->high_count;
+    uint32_t period = pwm->high_count + pwm->low_count;
+    uint32_t step_max = 0;
+    uint32_t elapsed = 0;
+    /* the fade interrupt comes every pwm period, sample faster than that */
+    while (is_light_busy(light) && elapsed < time + 1000)
+    {
+        plt_sim_clock_advance(1);
+        elapsed ++;
+        uint32_t step = (pwm->high_count > high_count) ? (pwm->high_count - high_count) :
+                        (high_count - pwm->high_count);
+        if (step > step_max)
+        {
+            step_max = step;
+        }
+        high_count = pwm->high_count;
+    }
+
+    plt_sim_stat_t stat;
+    plt_sim_stat_get(&stat);
+    printf("%s fade %u -> %u in %u ms, done after %u ms, end lightness %u\n",
+           LIGHT_HW_FADE ? "hardware" : "software", begin, end, time, elapsed, light->lightness);
+    printf("app timer wakeups %u (%.2f/s), fade interrupts %u, pwm changes %u\n",
+           stat.timer_wakeups, stat.timer_wakeups * 1000.0 / time, stat.irq_count,
+           stat.pwm_change_count);
+    printf("max duty step %u/%u (%.3f%%)\n", step_max, period, step_max * 100.0 / period);
+
+    return (light->lightness != end || is_light_busy(light)) ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
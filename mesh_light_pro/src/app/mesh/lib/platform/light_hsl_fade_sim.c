@@ -0,0 +1,445 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     light_hsl_fade_sim.c
+  * @brief    Host test and benchmark of the hsl fade of the rgb channels.
+  * @details  hsl_2_rgb is checked against the former conversion, which went by the three hue
+  *           offsets, over a grid of the hsl space. Then fades of light_fade_hsl are run on the
+  *           light controller by the virtual clock. Every step the channels must be hsl_2_rgb of
+  *           the reported hsl, and they are compared with the hsl of the ideal linear fade in
+  *           double, by the channel error and by the cie 1976 delta e of the srgb colours. The
+  *           fade stopped by a new set, a too short fade and the transition steps are checked,
+  *           then the cost of the conversions and of a fade step is reported. Build it on a linux
+  *           host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> light_hsl_fade_sim.c
+  *           light_controller_app.c platform_sim.c -lm -o light_hsl_fade_sim
+  *           and run it with the number of random fades, e.g. ./light_hsl_fade_sim 200
+  * @author   bill
+  * @date     2018-12-26
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+/* the fade state and the conversion kernels are static */
+#include "dimmable_light.c"
+#include "light_cwrgb_app.c"
+
+#define LIGHT_HSL_FADE_SIM_CHANNEL_ERR           8 //!< of 65535
+#define LIGHT_HSL_FADE_SIM_DELTA_E               0.05
+#define LIGHT_HSL_FADE_SIM_COST_LOOPS            2000000
+
+typedef light_rgb_t (*light_hsl_fade_sim_convert_t)(light_hsl_t hsl);
+
+typedef struct
+{
+    double channel_err;
+    double delta_e;
+} light_hsl_fade_sim_err_t;
+
+static uint64_t light_hsl_fade_sim_rng = 1;
+static light_hsl_fade_sim_err_t light_hsl_fade_sim_err_max;
+
+static uint32_t light_hsl_fade_sim_rand(void)
+{
+    /* xorshift64* */
+    light_hsl_fade_sim_rng ^= light_hsl_fade_sim_rng >> 12;
+    light_hsl_fade_sim_rng ^= light_hsl_fade_sim_rng << 25;
+    light_hsl_fade_sim_rng ^= light_hsl_fade_sim_rng >> 27;
+    return (uint32_t)((light_hsl_fade_sim_rng * 2685821657736338717ULL) >> 32);
+}
+
+/* the former conversion, one hue offset per channel */
+static uint32_t light_hsl_fade_sim_former_hue(uint32_t v1, uint32_t v2, uint32_t h6)
+{
+    if (h6 < HUE_Q16_ONE)
+    {
+        return v1 + (uint32_t)(((uint64_t)(v2 - v1) * h6) >> 16);
+    }
+    else if (h6 < 3 * HUE_Q16_ONE)
+    {
+        return v2;
+    }
+    else if (h6 < 4 * HUE_Q16_ONE)
+    {
+        return v1 + (uint32_t)(((uint64_t)(v2 - v1) * (4 * HUE_Q16_ONE - h6)) >> 16);
+    }
+    return v1;
+}
+
+static light_rgb_t light_hsl_fade_sim_former(light_hsl_t hsl)
+{
+    light_rgb_t rgb = {hsl.lightness, hsl.lightness, hsl.lightness};
+    if (0 != hsl.saturation)
+    {
+        uint32_t v1;
+        uint32_t v2;
+        uint32_t h6 = 6 * (uint32_t)hsl.hue;
+        hsl_2_bounds(hsl.lightness, hsl.saturation, &v1, &v2);
+        uint32_t h6_red = (h6 + 2 * HUE_Q16_ONE) % HUE_Q16_TURN;
+        uint32_t h6_blue = (h6 + HUE_Q16_TURN - 2 * HUE_Q16_ONE) % HUE_Q16_TURN;
+        rgb.red = (light_hsl_fade_sim_former_hue(v1, v2, h6_red) + 0xffff) >> 16;
+        rgb.green = (light_hsl_fade_sim_former_hue(v1, v2, h6) + 0xffff) >> 16;
+        rgb.blue = (light_hsl_fade_sim_former_hue(v1, v2, h6_blue) + 0xffff) >> 16;
+    }
+    return rgb;
+}
+
+static double light_hsl_fade_sim_hue(double p, double q, double t)
+{
+    t = (t < 0) ? (t + 1) : ((t > 1) ? (t - 1) : t);
+    if (t < 1.0 / 6)
+    {
+        return p + (q - p) * 6 * t;
+    }
+    if (t < 0.5)
+    {
+        return q;
+    }
+    if (t < 2.0 / 3)
+    {
+        return p + (q - p) * (2.0 / 3 - t) * 6;
+    }
+    return p;
+}
+
+/* hsl to rgb in double, all of them in [0, 1] */
+static void light_hsl_fade_sim_reference(double h, double s, double l, double *prgb)
+{
+    if (0 == s)
+    {
+        prgb[0] = prgb[1] = prgb[2] = l;
+        return;
+    }
+    double q = (l < 0.5) ? (l * (1 + s)) : (l + s - l * s);
+    double p = 2 * l - q;
+    prgb[0] = light_hsl_fade_sim_hue(p, q, h + 1.0 / 3);
+    prgb[1] = light_hsl_fade_sim_hue(p, q, h);
+    prgb[2] = light_hsl_fade_sim_hue(p, q, h - 1.0 / 3);
+}
+
+/* srgb to cie lab, d65 */
+static void light_hsl_fade_sim_lab(const double *prgb, double *plab)
+{
+    double lin[3];
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        lin[i] = (prgb[i] <= 0.04045) ? (prgb[i] / 12.92) : pow((prgb[i] + 0.055) / 1.055, 2.4);
+    }
+    double f[3] =
+    {
+        (0.4124 * lin[0] + 0.3576 * lin[1] + 0.1805 * lin[2]) / 0.95047,
+        0.2126 * lin[0] + 0.7152 * lin[1] + 0.0722 * lin[2],
+        (0.0193 * lin[0] + 0.1192 * lin[1] + 0.9505 * lin[2]) / 1.08883
+    };
+    for (uint8_t i = 0; i < 3; ++i)
+    {
+        f[i] = (f[i] > 0.008856) ? cbrt(f[i]) : (7.787 * f[i] + 16.0 / 116);
+    }
+    plab[0] = 116 * f[1] - 16;
+    plab[1] = 500 * (f[0] - f[1]);
+    plab[2] = 200 * (f[1] - f[2]);
+}
+
+/* run a fade on the light controller and check every step, return the failures */
+static uint32_t light_hsl_fade_sim_fade(const char *name, light_hsl_t begin, light_hsl_t end,
+                                        uint32_t time, bool verbose)
+{
+    light_set_hsl(begin);
+    uint32_t steps = time / LIGHT_MONITOR_INTERVAL;
+    if (!light_fade_hsl(end, time))
+    {
+        printf("  %s: fade not started\n", name);
+        return 1;
+    }
+
+    uint32_t fails = 0;
+    int32_t hue_delta = (int16_t)(end.hue - begin.hue);
+    light_hsl_fade_sim_err_t err = {0, 0};
+    bool green = FALSE;
+    uint32_t k = 0;
+    while (is_light_busy(&light_cwrgb[2]) && (k < steps + 5))
+    {
+        plt_sim_clock_advance(LIGHT_MONITOR_INTERVAL);
+        k ++;
+        light_rgb_t rgb = {light_cwrgb[2].lightness, light_cwrgb[3].lightness,
+                           light_cwrgb[4].lightness};
+        light_hsl_t hsl = light_get_hsl();
+        light_rgb_t expect = hsl_2_rgb(hsl);
+        if (0 != memcmp(&expect, &rgb, sizeof(rgb)))
+        {
+            if (fails < 5)
+            {
+                printf("  %s step %u: rgb %u %u %u, hsl_2_rgb %u %u %u\n", name, k, rgb.red,
+                       rgb.green, rgb.blue, expect.red, expect.green, expect.blue);
+            }
+            fails ++;
+        }
+        green = green || ((rgb.green > rgb.red) && (rgb.green > rgb.blue));
+
+        double t = fmin((double)k / steps, 1);
+        double ref[3];
+        double got[3] = {rgb.red / 65535.0, rgb.green / 65535.0, rgb.blue / 65535.0};
+        double h = fmod((begin.hue + hue_delta * t) / 65536.0 + 1, 1);
+        double s = (begin.saturation + (end.saturation - (double)begin.saturation) * t) / 65535;
+        double l = (begin.lightness + (end.lightness - (double)begin.lightness) * t) / 65535;
+        light_hsl_fade_sim_reference(h, s, l, ref);
+        double lab_ref[3];
+        double lab_got[3];
+        light_hsl_fade_sim_lab(ref, lab_ref);
+        light_hsl_fade_sim_lab(got, lab_got);
+        double delta_e = sqrt((lab_ref[0] - lab_got[0]) * (lab_ref[0] - lab_got[0]) +
+                              (lab_ref[1] - lab_got[1]) * (lab_ref[1] - lab_got[1]) +
+                              (lab_ref[2] - lab_got[2]) * (lab_ref[2] - lab_got[2]));
+        err.delta_e = fmax(err.delta_e, delta_e);
+        for (uint8_t i = 0; i < 3; ++i)
+        {
+            err.channel_err = fmax(err.channel_err, fabs(ref[i] - got[i]) * 65535);
+        }
+        if (verbose && ((0 == k % 4) || (k == steps)))
+        {
+            printf("  %4u ms hue %5.1f deg rgb %5u %5u %5u\n", k * LIGHT_MONITOR_INTERVAL,
+                   hsl.hue * 360.0 / 65536, rgb.red, rgb.green, rgb.blue);
+        }
+    }
+
+    light_hsl_t last = light_get_hsl();
+    light_rgb_t final = hsl_2_rgb(end);
+    if ((k != steps) || (0 != memcmp(&last, &end, sizeof(end))) ||
+        (light_cwrgb[2].lightness != final.red) || (light_cwrgb[3].lightness != final.green) ||
+        (light_cwrgb[4].lightness != final.blue))
+    {
+        printf("  %s: %u steps of %u, end hsl %u %u %u\n", name, k, steps, last.hue,
+               last.saturation, last.lightness);
+        fails ++;
+    }
+    if (verbose)
+    {
+        printf("%-18s %3u steps, max channel err %4.1f (%.4f%%), max delta e %.3f%s\n", name, steps,
+               err.channel_err, err.channel_err * 100 / 65535, err.delta_e,
+               green ? ", passes green" : "");
+    }
+    /* the shorter arc from red to magenta never passes green */
+    if ((0 == begin.hue) && (54613 == end.hue) && green)
+    {
+        printf("  %s passes green\n", name);
+        fails ++;
+    }
+    light_hsl_fade_sim_err_max.channel_err = fmax(light_hsl_fade_sim_err_max.channel_err,
+                                                  err.channel_err);
+    light_hsl_fade_sim_err_max.delta_e = fmax(light_hsl_fade_sim_err_max.delta_e, err.delta_e);
+    return fails;
+}
+
+static uint32_t light_hsl_fade_sim_convert_check(void)
+{
+    uint32_t points = 0;
+    uint32_t diffs = 0;
+    for (uint32_t h = 0; h < 65536; h += 7)
+    {
+        for (uint32_t s = 0; s < 65536; s += 1021)
+        {
+            for (uint32_t l = 0; l < 65536; l += 1013)
+            {
+                light_hsl_t hsl = {l, h, s};
+                light_rgb_t rgb = hsl_2_rgb(hsl);
+                light_rgb_t former = light_hsl_fade_sim_former(hsl);
+                points ++;
+                if (0 != memcmp(&rgb, &former, sizeof(rgb)))
+                {
+                    if (diffs < 5)
+                    {
+                        printf("  hsl %u %u %u: rgb %u %u %u, former %u %u %u\n", l, h, s, rgb.red,
+                               rgb.green, rgb.blue, former.red, former.green, former.blue);
+                    }
+                    diffs ++;
+                }
+            }
+        }
+    }
+    printf("hsl_2_rgb: %u points, %u differ from the former conversion\n", points, diffs);
+    return diffs;
+}
+
+static uint32_t light_hsl_fade_sim_stop_check(void)
+{
+    uint32_t fails = 0;
+    light_hsl_t red = {32768, 0, 65535};
+    light_hsl_t magenta = {32768, 54613, 65535};
+    light_hsl_t green = {32768, 21845, 65535};
+
+    /* a channel set stops the fade */
+    light_set_hsl(red);
+    light_fade_hsl(magenta, 1000);
+    plt_sim_clock_advance(200);
+    light_set_red_lightness(1000);
+    plt_sim_clock_advance(1000);
+    if ((1000 != light_cwrgb[2].lightness) || light_hsl_fading)
+    {
+        printf("  fade not stopped\n");
+        fails ++;
+    }
+
+    /* shorter than two steps sets at once */
+    if (light_fade_hsl(green, 60))
+    {
+        printf("  60 ms fade started\n");
+        fails ++;
+    }
+    light_hsl_t hsl = light_get_hsl();
+    if (0 != memcmp(&hsl, &green, sizeof(hsl)))
+    {
+        printf("  60 ms fade not set\n");
+        fails ++;
+    }
+
+    /* the first step starts the fade, the last one sets the target */
+    light_set_hsl(red);
+    if (light_hsl_transition_step(magenta, 10, 10, 100))
+    {
+        fails ++;
+    }
+    for (uint8_t remaining = 9; remaining > 0; --remaining)
+    {
+        plt_sim_clock_advance(100);
+        if (light_hsl_transition_step(magenta, 10, remaining, 100))
+        {
+            fails ++;
+        }
+    }
+    plt_sim_clock_advance(100);
+    if (!light_hsl_transition_step(magenta, 10, 0, 100))
+    {
+        fails ++;
+    }
+    hsl = light_get_hsl();
+    if ((0 != memcmp(&hsl, &magenta, sizeof(hsl))) || light_hsl_fading)
+    {
+        printf("  transition end: %u %u %u\n", hsl.hue, hsl.saturation, hsl.lightness);
+        fails ++;
+    }
+    return fails;
+}
+
+static double light_hsl_fade_sim_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static double light_hsl_fade_sim_convert_cost(light_hsl_fade_sim_convert_t convert,
+                                              volatile uint32_t *psink)
+{
+    /* called by pointer, the former conversion can not be inlined either */
+    light_hsl_fade_sim_convert_t volatile call = convert;
+    double begin = light_hsl_fade_sim_now();
+    for (uint32_t i = 0; i < LIGHT_HSL_FADE_SIM_COST_LOOPS; ++i)
+    {
+        light_hsl_t hsl = {65535, (uint16_t)(i * 13), (uint16_t)(i * 31)};
+        light_rgb_t rgb = call(hsl);
+        *psink += rgb.red + rgb.green + rgb.blue;
+    }
+    return (light_hsl_fade_sim_now() - begin) / LIGHT_HSL_FADE_SIM_COST_LOOPS;
+}
+
+static double light_hsl_fade_sim_step_cost(light_hsl_t begin, light_hsl_t end,
+                                           volatile uint32_t *psink)
+{
+    light_hsl_fade_t fade;
+    light_hsl_fade_init(&fade, begin, end, LIGHT_HSL_FADE_SIM_COST_LOOPS);
+    double start = light_hsl_fade_sim_now();
+    for (uint32_t i = 0; i < LIGHT_HSL_FADE_SIM_COST_LOOPS; ++i)
+    {
+        light_rgb_t rgb = light_hsl_fade_step(&fade);
+        *psink += rgb.red + rgb.green + rgb.blue;
+    }
+    return (light_hsl_fade_sim_now() - start) / LIGHT_HSL_FADE_SIM_COST_LOOPS;
+}
+
+static void light_hsl_fade_sim_cost(void)
+{
+    volatile uint32_t sink = 0;
+    double former = light_hsl_fade_sim_convert_cost(light_hsl_fade_sim_former, &sink);
+    double sextant = light_hsl_fade_sim_convert_cost(hsl_2_rgb, &sink);
+    /* the hue alone moves on the colour wheel, the bounds are kept */
+    light_hsl_t red = {32768, 0, 65535};
+    light_hsl_t magenta = {32768, 54613, 65535};
+    double hue = light_hsl_fade_sim_step_cost(red, magenta, &sink);
+    light_hsl_t dark = {1000, 0, 0};
+    light_hsl_t bright = {65000, 60000, 65535};
+    double all = light_hsl_fade_sim_step_cost(dark, bright, &sink);
+
+    double start = light_hsl_fade_sim_now();
+    for (uint32_t i = 0; i < LIGHT_HSL_FADE_SIM_COST_LOOPS; ++i)
+    {
+        double t = (double)i / LIGHT_HSL_FADE_SIM_COST_LOOPS;
+        double rgb[3];
+        light_hsl_fade_sim_reference(fmod(t * 5.0 / 6, 1), t, t, rgb);
+        sink += (uint32_t)(rgb[0] * 65535);
+    }
+    double reference = (light_hsl_fade_sim_now() - start) / LIGHT_HSL_FADE_SIM_COST_LOOPS;
+    printf("ns per call on the host: hsl_2_rgb former %.1f, sextant %.1f, fade step hue %.1f, "
+           "all fields %.1f, double %.1f (%u)\n", former, sextant, hue, all, reference, sink & 1);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t randoms = (argc > 1) ? strtoul(argv[1], NULL, 0) : 200;
+    uint32_t fails = 0;
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    light_cwrgb_driver_init();
+    light_controller_init();
+
+    fails += light_hsl_fade_sim_convert_check();
+
+    light_hsl_t red = {32768, 0, 65535};
+    light_hsl_t magenta = {32768, 54613, 65535};
+    light_hsl_t green = {32768, 21845, 65535};
+    light_hsl_t blue = {32768, 43690, 65535};
+    light_hsl_t dim_yellow = {6553, 10923, 40000};
+    light_hsl_t bright_cyan = {60000, 32768, 65535};
+    light_hsl_t grey = {20000, 30000, 0};
+    printf("red to magenta over 1 s:\n");
+    fails += light_hsl_fade_sim_fade("red to magenta", red, magenta, 1000, TRUE);
+    fails += light_hsl_fade_sim_fade("magenta to red", magenta, red, 1000, FALSE);
+    fails += light_hsl_fade_sim_fade("red to green", red, green, 1000, FALSE);
+    fails += light_hsl_fade_sim_fade("blue to red", blue, red, 2000, FALSE);
+    fails += light_hsl_fade_sim_fade("dim yellow to cyan", dim_yellow, bright_cyan, 3000, FALSE);
+    fails += light_hsl_fade_sim_fade("grey to blue", grey, blue, 500, FALSE);
+    fails += light_hsl_fade_sim_fade("blue to grey", blue, grey, 500, FALSE);
+    for (uint32_t i = 0; i < randoms; ++i)
+    {
+        light_hsl_t begin = {light_hsl_fade_sim_rand(), light_hsl_fade_sim_rand(),
+                             light_hsl_fade_sim_rand()};
+        light_hsl_t end = {light_hsl_fade_sim_rand(), light_hsl_fade_sim_rand(),
+                           light_hsl_fade_sim_rand()};
+        uint32_t time = 100 + (light_hsl_fade_sim_rand() % 100) * 100;
+        fails += light_hsl_fade_sim_fade("random", begin, end, time, FALSE);
+    }
+    printf("%u fades: max channel err %.1f, max delta e %.3f\n", randoms + 7,
+           light_hsl_fade_sim_err_max.channel_err, light_hsl_fade_sim_err_max.delta_e);
+    if ((light_hsl_fade_sim_err_max.channel_err > LIGHT_HSL_FADE_SIM_CHANNEL_ERR) ||
+        (light_hsl_fade_sim_err_max.delta_e > LIGHT_HSL_FADE_SIM_DELTA_E))
+    {
+        fails ++;
+    }
+
+    fails += light_hsl_fade_sim_stop_check();
+    light_hsl_fade_sim_cost();
+
+    printf("%s\n", fails ? "FAIL" : "PASS");
+    return fails ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -0,0 +1,327 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     light_hsl_sim.c
+  * @brief    Host accuracy report and benchmark of the hsl and rgb conversions.
+  * @details  hsl_2_rgb and rgb_2_hsl of light_cwrgb_app.c are compared against the former float
+  *           conversions kept below: hsl_2_rgb over a hue, saturation and lightness grid,
+  *           rgb_2_hsl over an rgb grid plus random samples, and the hsl -> rgb -> hsl round
+  *           trip of both. The time of one call of each is reported at the end. Build it on a
+  *           linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> light_hsl_sim.c
+  *           dimmable_light.c light_controller_app.c light_cwrgb_app.c platform_sim.c -lm
+  *           -o light_hsl_sim
+  *           and run it with the hue stride and the saturation and lightness stride of the grid,
+  *           e.g. ./light_hsl_sim 7 257, "./light_hsl_sim 1 1" walks every hsl value.
+  * @author   bill
+  * @date     2018-12-10
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "light_config.h"
+#include "light_cwrgb_app.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define LIGHT_HSL_SIM_RANDOM_NUM        20000000
+#define LIGHT_HSL_SIM_BENCH_NUM         4000000
+
+/* light_cwrgb_app.c stores the state through the storage module, not linked here */
+bool light_state_store(void)
+{
+    return TRUE;
+}
+
+static uint64_t light_hsl_sim_seed = 0x9e3779b97f4a7c15ULL;
+
+static uint32_t light_hsl_sim_rand(void)
+{
+    light_hsl_sim_seed ^= light_hsl_sim_seed << 13;
+    light_hsl_sim_seed ^= light_hsl_sim_seed >> 7;
+    light_hsl_sim_seed ^= light_hsl_sim_seed << 17;
+    return (uint32_t)(light_hsl_sim_seed >> 32);
+}
+
+static double light_hsl_sim_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/* former float conversions */
+static float float_hue_2_rgb(float v1, float v2, float h)
+{
+    if (h < 0)
+    {
+        h += 1;
+    }
+    else if (h > 1)
+    {
+        h -= 1;
+    }
+    if (6 * h < 1)
+    {
+        return v1 + (v2 - v1) * 6 * h;
+    }
+    else if (2 * h < 1)
+    {
+        return v2;
+    }
+    else if (3 * h < 2)
+    {
+        return v1 + (v2 - v1) * (4 - 6 * h);
+    }
+    else
+    {
+        return v1;
+    }
+}
+
+static light_rgb_t float_hsl_2_rgb(light_hsl_t hsl)
+{
+    light_rgb_t rgb = {0, 0, 0};
+    if (0 == hsl.saturation)
+    {
+        rgb.red = rgb.green = rgb.blue = hsl.lightness;
+    }
+    else
+    {
+        float h, s, l, v1, v2;
+        h = (float)hsl.hue / 65536;
+        s = (float)hsl.saturation / 65535;
+        l = (float)hsl.lightness / 65535;
+        if (l < 0.5f)
+        {
+            v2 = l * (1 + s);
+        }
+        else
+        {
+            v2 = (l + s) - (s * l);
+        }
+        v1 = 2 * l - v2;
+        rgb.red = ceil(65535 * float_hue_2_rgb(v1, v2, h + 1.0 / 3));
+        rgb.green = ceil(65535 * float_hue_2_rgb(v1, v2, h));
+        rgb.blue = ceil(65535 * float_hue_2_rgb(v1, v2, h - 1.0 / 3));
+    }
+
+    return rgb;
+}
+
+static light_hsl_t float_rgb_2_hsl(light_rgb_t rgb)
+{
+    light_hsl_t hsl = {0, 0, 0};
+    uint16_t max, min;
+    max = MAX(rgb.red, rgb.green);
+    max = MAX(max, rgb.blue);
+    min = MIN(rgb.red, rgb.green);
+    min = MIN(min, rgb.blue);
+    if (max == min)
+    {
+        hsl.hue = 0;
+    }
+    else if (max == rgb.red)
+    {
+        if (rgb.green >= rgb.blue)
+        {
+            hsl.hue = (65536 / 6) * (rgb.green - rgb.blue) / (max - min);
+        }
+        else
+        {
+            uint32_t tmp = 65536 - (65536 / 6) * (rgb.blue - rgb.green) / (max - min);
+            hsl.hue = (tmp == 65536) ? 0 : tmp;
+        }
+    }
+    else if (max == rgb.green)
+    {
+        hsl.hue = 65536 / 3 + (65536 / 6) * (rgb.blue - rgb.red) / (max - min);
+    }
+    else
+    {
+        hsl.hue = 65536 * 2 / 3 + (65536 / 6) * (rgb.red - rgb.green) / (max - min);
+    }
+    hsl.lightness = (max + min) >> 1;
+    if (hsl.lightness == 0 || max == min)
+    {
+        hsl.saturation = 0;
+    }
+    else if (hsl.lightness <= 32767)
+    {
+        hsl.saturation = ceil(65535 * (double)(max - min) / (max + min));
+    }
+    else
+    {
+        hsl.saturation = ceil(65535 * (double)(max - min) / (2 * 65535 - max - min));
+    }
+
+    return hsl;
+}
+
+typedef struct
+{
+    uint64_t num;
+    uint64_t differ;
+    uint32_t err_max;
+    uint64_t err_hist[4]; //!< 1, 2, 3, more than 3
+} light_hsl_sim_err_t;
+
+static void light_hsl_sim_err_add(light_hsl_sim_err_t *perr, uint16_t a, uint16_t b)
+{
+    uint32_t err = (a > b) ? (a - b) : (b - a);
+    perr->num ++;
+    if (err)
+    {
+        perr->differ ++;
+        perr->err_hist[(err > 3) ? 3 : (err - 1)] ++;
+        if (err > perr->err_max)
+        {
+            perr->err_max = err;
+        }
+    }
+}
+
+static void light_hsl_sim_err_print(const char *name, const light_hsl_sim_err_t *perr)
+{
+    printf("%-34s %12llu values, %10llu differ (%.4f%%), max %u, by 1/2/3/more %llu/%llu/%llu/%llu\n",
+           name, (unsigned long long)perr->num, (unsigned long long)perr->differ,
+           perr->num ? perr->differ * 100.0 / perr->num : 0.0, perr->err_max,
+           (unsigned long long)perr->err_hist[0], (unsigned long long)perr->err_hist[1],
+           (unsigned long long)perr->err_hist[2], (unsigned long long)perr->err_hist[3]);
+}
+
+/* hue is meaningless without saturation and wraps around */
+static uint16_t light_hsl_sim_hue_err(uint16_t a, uint16_t b)
+{
+    uint16_t err = a - b;
+    return (err > 32768) ? (uint16_t)(0 - err) : err;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t hue_stride = (argc > 1) ? strtoul(argv[1], NULL, 0) : 7;
+    uint32_t stride = (argc > 2) ? strtoul(argv[2], NULL, 0) : 257;
+    if (0 == hue_stride || 0 == stride)
+    {
+        printf("strides shall not be 0\n");
+        return 1;
+    }
+
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+
+    /* hsl_2_rgb against the float code, and the lightness and hue of the round trip */
+    light_hsl_sim_err_t rgb_err = {0};
+    light_hsl_sim_err_t trip_l = {0}, trip_h = {0}, float_trip_l = {0}, float_trip_h = {0};
+    for (uint32_t h = 0; h < 65536; h += hue_stride)
+    {
+        for (uint32_t s = 0; s < 65536; s += stride)
+        {
+            for (uint32_t l = 0; l < 65536; l += stride)
+            {
+                light_hsl_t hsl = {l, h, s};
+                light_rgb_t rgb = hsl_2_rgb(hsl);
+                light_rgb_t rgb_f = float_hsl_2_rgb(hsl);
+                light_hsl_sim_err_add(&rgb_err, rgb.red, rgb_f.red);
+                light_hsl_sim_err_add(&rgb_err, rgb.green, rgb_f.green);
+                light_hsl_sim_err_add(&rgb_err, rgb.blue, rgb_f.blue);
+
+                light_hsl_t back = rgb_2_hsl(rgb);
+                light_hsl_t back_f = float_rgb_2_hsl(rgb_f);
+                light_hsl_sim_err_add(&trip_l, back.lightness, l);
+                light_hsl_sim_err_add(&float_trip_l, back_f.lightness, l);
+                /* hue only survives with enough chroma to resolve it */
+                if (s >= 32768 && l >= 16384 && l <= 49151)
+                {
+                    light_hsl_sim_err_add(&trip_h, light_hsl_sim_hue_err(back.hue, h), 0);
+                    light_hsl_sim_err_add(&float_trip_h, light_hsl_sim_hue_err(back_f.hue, h), 0);
+                }
+            }
+        }
+    }
+
+    /* rgb_2_hsl against the float code */
+    light_hsl_sim_err_t hsl_err = {0};
+    for (uint32_t r = 0; r < 65536; r += stride)
+    {
+        for (uint32_t g = 0; g < 65536; g += stride)
+        {
+            for (uint32_t b = 0; b < 65536; b += stride)
+            {
+                light_rgb_t rgb = {r, g, b};
+                light_hsl_t hsl = rgb_2_hsl(rgb);
+                light_hsl_t hsl_f = float_rgb_2_hsl(rgb);
+                light_hsl_sim_err_add(&hsl_err, hsl.hue, hsl_f.hue);
+                light_hsl_sim_err_add(&hsl_err, hsl.saturation, hsl_f.saturation);
+                light_hsl_sim_err_add(&hsl_err, hsl.lightness, hsl_f.lightness);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < LIGHT_HSL_SIM_RANDOM_NUM; ++i)
+    {
+        uint32_t v = light_hsl_sim_rand();
+        light_rgb_t rgb = {v & 0xffff, v >> 16, light_hsl_sim_rand() & 0xffff};
+        light_hsl_t hsl = rgb_2_hsl(rgb);
+        light_hsl_t hsl_f = float_rgb_2_hsl(rgb);
+        light_hsl_sim_err_add(&hsl_err, hsl.hue, hsl_f.hue);
+        light_hsl_sim_err_add(&hsl_err, hsl.saturation, hsl_f.saturation);
+        light_hsl_sim_err_add(&hsl_err, hsl.lightness, hsl_f.lightness);
+    }
+
+    printf("grid: hue stride %u, saturation and lightness stride %u\n", hue_stride, stride);
+    light_hsl_sim_err_print("hsl_2_rgb channels vs float", &rgb_err);
+    light_hsl_sim_err_print("rgb_2_hsl fields vs float", &hsl_err);
+    light_hsl_sim_err_print("round trip lightness", &trip_l);
+    light_hsl_sim_err_print("float round trip lightness", &float_trip_l);
+    light_hsl_sim_err_print("round trip hue, s >= 50%", &trip_h);
+    light_hsl_sim_err_print("float round trip hue, s >= 50%", &float_trip_h);
+
+    /* benchmark */
+    volatile uint32_t sink = 0;
+    double t0 = light_hsl_sim_now_ns();
+    for (uint32_t i = 0; i < LIGHT_HSL_SIM_BENCH_NUM; ++i)
+    {
+        light_hsl_t hsl = {(uint16_t)(i * 7), (uint16_t)(i * 13), (uint16_t)(i * 31)};
+        light_rgb_t rgb = float_hsl_2_rgb(hsl);
+        sink += rgb.red + rgb.green + rgb.blue;
+    }
+    double t_float_rgb = (light_hsl_sim_now_ns() - t0) / LIGHT_HSL_SIM_BENCH_NUM;
+    t0 = light_hsl_sim_now_ns();
+    for (uint32_t i = 0; i < LIGHT_HSL_SIM_BENCH_NUM; ++i)
+    {
+        light_hsl_t hsl = {(uint16_t)(i * 7), (uint16_t)(i * 13), (uint16_t)(i * 31)};
+        light_rgb_t rgb = hsl_2_rgb(hsl);
+        sink += rgb.red + rgb.green + rgb.blue;
+    }
+    double t_rgb = (light_hsl_sim_now_ns() - t0) / LIGHT_HSL_SIM_BENCH_NUM;
+    t0 = light_hsl_sim_now_ns();
+    for (uint32_t i = 0; i < LIGHT_HSL_SIM_BENCH_NUM; ++i)
+    {
+        light_rgb_t rgb = {(uint16_t)(i * 7), (uint16_t)(i * 13), (uint16_t)(i * 31)};
+        light_hsl_t hsl = float_rgb_2_hsl(rgb);
+        sink += hsl.hue + hsl.saturation + hsl.lightness;
+    }
+    double t_float_hsl = (light_hsl_sim_now_ns() - t0) / LIGHT_HSL_SIM_BENCH_NUM;
+    t0 = light_hsl_sim_now_ns();
+    for (uint32_t i = 0; i < LIGHT_HSL_SIM_BENCH_NUM; ++i)
+    {
+        light_rgb_t rgb = {(uint16_t)(i * 7), (uint16_t)(i * 13), (uint16_t)(i * 31)};
+        light_hsl_t hsl = rgb_2_hsl(rgb);
+        sink += hsl.hue + hsl.saturation + hsl.lightness;
+    }
+    double t_hsl = (light_hsl_sim_now_ns() - t0) / LIGHT_HSL_SIM_BENCH_NUM;
+    printf("ns per call on the host: hsl_2_rgb float %.1f, integer %.1f; rgb_2_hsl float %.1f, "
+           "integer %.1f (%u)\n", t_float_rgb, t_rgb, t_float_hsl, t_hsl, sink & 1);
+
+    return 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -0,0 +1,305 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     obj_transfer_sim.c
+  * @brief    Host test of the crc32 block check of the object transfer server.
+  * @details  A client sends an object block by block to obj_transfer_server_receive, the chunks
+  *           of a block in random order and with duplicates, and asks Block Get until the block
+  *           is accepted, resending the chunks listed. A part of the chunks get a bit flipped on
+  *           the air. The blocks dropped for a wrong checksum are counted, the block stat is
+  *           checked to list every chunk after a drop and none after an accept, and the object
+  *           written by the data callback is compared with the image. A clean transfer and a
+  *           client which sends no checksum are run as well. Build it on a linux host with the
+  *           keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> obj_transfer_sim.c
+  *           object_transfer_server.c crc32.c platform_sim.c -o obj_transfer_sim
+  *           and run it with the per mille of chunks corrupted, e.g. ./obj_transfer_sim 50
+  * @author   bill
+  * @date     2018-12-25
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mesh_api.h"
+#include "object_transfer.h"
+#include "crc32.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define OBJ_SIM_IMAGE_SIZE                  50000
+#define OBJ_SIM_CHUNK_NUM_MAX               64
+#define OBJ_SIM_TRIES_MAX                   1000
+
+typedef struct
+{
+    uint32_t rejects; //!< blocks dropped for a wrong checksum
+    uint32_t data_cbs; //!< blocks handed to the data callback
+    uint32_t chunks; //!< chunk messages sent
+    uint32_t errors; //!< block stats inconsistent with the chunks
+    bool image_ok;
+} obj_sim_result_t;
+
+extern obj_transfer_server_ctx_t obj_transfer_server_ctx;
+bool obj_transfer_server_receive(mesh_msg_p pmesh_msg);
+
+static uint8_t obj_sim_image[OBJ_SIM_IMAGE_SIZE];
+static uint8_t obj_sim_written[OBJ_SIM_IMAGE_SIZE];
+static uint8_t obj_sim_id[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+static uint8_t obj_sim_rsp[512];
+static uint16_t obj_sim_rsp_len;
+static uint32_t obj_sim_data_cbs;
+static uint64_t obj_sim_rng = 1;
+
+static uint32_t obj_sim_rand(void)
+{
+    /* xorshift64* */
+    obj_sim_rng ^= obj_sim_rng >> 12;
+    obj_sim_rng ^= obj_sim_rng << 25;
+    obj_sim_rng ^= obj_sim_rng >> 27;
+    return (uint32_t)((obj_sim_rng * 2685821657736338717ULL) >> 32);
+}
+
+/** mesh library */
+mesh_msg_send_cause_t access_cfg(mesh_msg_p pmesh_msg)
+{
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+mesh_msg_send_cause_t access_send(mesh_msg_p pmesh_msg)
+{
+    memcpy(obj_sim_rsp, pmesh_msg->pbuffer, pmesh_msg->msg_len);
+    obj_sim_rsp_len = pmesh_msg->msg_len;
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+bool mesh_model_reg(uint8_t element_index, mesh_model_info_p pmodel_info)
+{
+    return TRUE;
+}
+
+bool plt_bit_pool_get(uint8_t *pool, uint32_t bit)
+{
+    return (pool[bit >> 3] >> (bit & 7)) & 1;
+}
+
+void plt_bit_pool_set(uint8_t *pool, uint32_t bit, bool set)
+{
+    if (set)
+    {
+        pool[bit >> 3] |= 1 << (bit & 7);
+    }
+    else
+    {
+        pool[bit >> 3] &= ~(1 << (bit & 7));
+    }
+}
+
+uint8_t plt_log2(uint32_t value)
+{
+    uint8_t log = 0;
+    while (value > 1)
+    {
+        value >>= 1;
+        log ++;
+    }
+    return log;
+}
+
+uint32_t plt_exp2(uint8_t log)
+{
+    return 1UL << log;
+}
+
+static int32_t obj_sim_data_cb(const mesh_model_info_p pmodel_info, uint32_t type, void *pargs)
+{
+    if (OBJ_TRANSFER_SERVER_CB_TYPE_DATA == type)
+    {
+        obj_transfer_server_ctx_t *pctx = pargs;
+        memcpy(obj_sim_written + pctx->current_block_num * pctx->block_size, pctx->block_data,
+               pctx->current_block_size);
+        obj_sim_data_cbs ++;
+    }
+    return 0;
+}
+
+static void obj_sim_receive(uint32_t opcode, void *pbuffer, uint16_t len)
+{
+    mesh_msg_t msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.access_opcode = opcode;
+    msg.pbuffer = pbuffer;
+    msg.msg_offset = 0;
+    msg.msg_len = len;
+    obj_transfer_server_receive(&msg);
+}
+
+static void obj_sim_chunk_send(uint32_t block_offset, uint16_t chunk_size, uint16_t chunk,
+                               uint16_t len, uint32_t corrupt)
+{
+    uint8_t buf[MEMBER_OFFSET(obj_chunk_transfer_t, data) + 512];
+    obj_chunk_transfer_t *pmsg = (obj_chunk_transfer_t *)buf;
+    ACCESS_OPCODE_BYTE(pmsg->opcode, MESH_MSG_OBJ_CHUNCK_TRANSFER);
+    pmsg->chunk_num = chunk;
+    memcpy(pmsg->data, obj_sim_image + block_offset + chunk * (uint32_t)chunk_size, len);
+    if (obj_sim_rand() % 1000 < corrupt)
+    {
+        pmsg->data[obj_sim_rand() % len] ^= 1 << (obj_sim_rand() % 8);
+    }
+    obj_sim_receive(MESH_MSG_OBJ_CHUNCK_TRANSFER, buf,
+                    MEMBER_OFFSET(obj_chunk_transfer_t, data) + len);
+}
+
+static void obj_sim_transfer(uint8_t block_size_log, uint16_t chunk_size, bool checksum,
+                             uint32_t corrupt, obj_sim_result_t *presult)
+{
+    memset(presult, 0, sizeof(*presult));
+    memset(obj_sim_written, 0, sizeof(obj_sim_written));
+    obj_sim_data_cbs = 0;
+    obj_transfer_server_clear();
+
+    obj_transfer_start_t start;
+    ACCESS_OPCODE_BYTE(start.opcode, MESH_MSG_OBJ_TRANSFER_START);
+    memcpy(start.object_id, obj_sim_id, sizeof(obj_sim_id));
+    start.object_size = OBJ_SIM_IMAGE_SIZE;
+    start.curr_block_size_log = block_size_log;
+    obj_sim_receive(MESH_MSG_OBJ_TRANSFER_START, &start, sizeof(start));
+
+    uint32_t block_size = 1UL << block_size_log;
+    uint32_t block_num = (OBJ_SIM_IMAGE_SIZE + block_size - 1) / block_size;
+    for (uint32_t block = 0; block < block_num; ++block)
+    {
+        uint32_t block_offset = block * block_size;
+        uint32_t cur_size = (OBJ_SIM_IMAGE_SIZE - block_offset < block_size) ?
+                            (OBJ_SIM_IMAGE_SIZE - block_offset) : block_size;
+        uint16_t chunk_num = (cur_size + chunk_size - 1) / chunk_size;
+
+        obj_block_transfer_start_t block_start;
+        ACCESS_OPCODE_BYTE(block_start.opcode, MESH_MSG_OBJ_BLOCK_TRANSFER_START);
+        memcpy(block_start.object_id, obj_sim_id, sizeof(obj_sim_id));
+        block_start.block_num = block;
+        block_start.chunk_size = chunk_size;
+        block_start.check_algo = OBJ_BLOCK_CHECK_ALGO_CRC32;
+        uint32_t crc = crc32_update(0, obj_sim_image + block_offset, cur_size);
+        memcpy(block_start.checksum_value, &crc, sizeof(crc));
+        obj_sim_receive(MESH_MSG_OBJ_BLOCK_TRANSFER_START, &block_start,
+                        MEMBER_OFFSET(obj_block_transfer_start_t, checksum_value) + (checksum ? 4 : 0));
+
+        uint16_t list[OBJ_SIM_CHUNK_NUM_MAX];
+        uint16_t list_num = chunk_num;
+        for (uint16_t i = 0; i < chunk_num; ++i)
+        {
+            list[i] = i;
+        }
+        for (uint32_t tries = 0; list_num > 0; ++tries)
+        {
+            if (tries > OBJ_SIM_TRIES_MAX)
+            {
+                printf("  block %u never accepted\n", block);
+                presult->errors ++;
+                return;
+            }
+
+            /* the missing chunks in random order, a quarter of them twice */
+            for (uint16_t i = list_num - 1; i > 0; --i)
+            {
+                uint16_t j = obj_sim_rand() % (i + 1);
+                uint16_t chunk = list[i];
+                list[i] = list[j];
+                list[j] = chunk;
+            }
+            for (uint16_t k = 0; k < list_num + list_num / 4; ++k)
+            {
+                uint16_t chunk = list[k % list_num];
+                uint16_t len = ((chunk == chunk_num - 1) && (cur_size % chunk_size)) ?
+                               (cur_size % chunk_size) : chunk_size;
+                obj_sim_chunk_send(block_offset, chunk_size, chunk, len, corrupt);
+                presult->chunks ++;
+                if (obj_transfer_server_ctx.checksum_failed)
+                {
+                    /* block dropped, the client learns it from the next block stat */
+                    break;
+                }
+            }
+
+            obj_block_get_t get;
+            ACCESS_OPCODE_BYTE(get.opcode, MESH_MSG_OBJ_BLOCK_GET);
+            memcpy(get.object_id, obj_sim_id, sizeof(obj_sim_id));
+            get.block_num = block;
+            obj_sim_receive(MESH_MSG_OBJ_BLOCK_GET, &get, sizeof(get));
+            obj_block_stat_t *pstat = (obj_block_stat_t *)obj_sim_rsp;
+            list_num = (obj_sim_rsp_len - MEMBER_OFFSET(obj_block_stat_t, chunk_list)) / 2;
+            memcpy(list, pstat->chunk_list, list_num * 2);
+            if (OBJ_BLOCK_TRANSFER_STAT_WRONG_CHECKSUM == pstat->stat)
+            {
+                presult->rejects ++;
+                if (list_num != chunk_num)
+                {
+                    printf("  block %u wrong checksum with %u chunks listed\n", block, list_num);
+                    presult->errors ++;
+                }
+            }
+            if ((OBJ_BLOCK_TRANSFER_STAT_ACCEPTED == pstat->stat) != (0 == list_num))
+            {
+                printf("  block %u stat %u with %u chunks listed\n", block, pstat->stat, list_num);
+                presult->errors ++;
+                return;
+            }
+        }
+    }
+    presult->data_cbs = obj_sim_data_cbs;
+    presult->image_ok = (0 == memcmp(obj_sim_written, obj_sim_image, OBJ_SIM_IMAGE_SIZE));
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t corrupt = (argc > 1) ? strtoul(argv[1], NULL, 0) : 50;
+    uint32_t fails = 0;
+
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    obj_transfer_server_reg(OBJ_SIM_IMAGE_SIZE, obj_sim_data_cb);
+    for (uint32_t i = 0; i < OBJ_SIM_IMAGE_SIZE; ++i)
+    {
+        obj_sim_image[i] = obj_sim_rand();
+    }
+
+    const struct
+    {
+        const char *name;
+        uint8_t block_size_log;
+        uint16_t chunk_size;
+        bool checksum;
+        uint32_t corrupt;
+    } cases[] =
+    {
+        {"clean, 4K blocks", 12, 256, TRUE, 0},
+        {"corrupted, 1K blocks", 10, 100, TRUE, corrupt},
+        {"no checksum, 1K blocks", 10, 100, FALSE, 0},
+    };
+    for (uint8_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        obj_sim_result_t result;
+        obj_sim_transfer(cases[i].block_size_log, cases[i].chunk_size, cases[i].checksum,
+                         cases[i].corrupt, &result);
+        printf("%-22s: %u chunks sent, %u blocks dropped, %u blocks written, image %s, "
+               "errors %u\n", cases[i].name, result.chunks, result.rejects, result.data_cbs,
+               result.image_ok ? "ok" : "wrong", result.errors);
+        fails += result.errors + (result.image_ok ? 0 : 1);
+        /* every corrupted block must be caught, no block may be dropped without a cause */
+        if ((cases[i].corrupt && cases[i].checksum) ? (0 == result.rejects) : (0 != result.rejects))
+        {
+            fails ++;
+        }
+    }
+
+    printf("%s\n", fails ? "FAIL" : "PASS");
+    return fails ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -26,6 +26,11 @@ extern "C"  {
   * @{
   */
 
+/** @brief set to 1 to build the light modules against the host simulation layer (platform_sim.c) */
+#ifndef PLATFORM_HOST_SIM
+#define PLATFORM_HOST_SIM   0
+#endif
+
 #ifndef _PACKED_
 #define _PACKED_  __attribute__ ((packed))
 #endif
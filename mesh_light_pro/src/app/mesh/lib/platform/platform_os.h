@@ -22,6 +22,9 @@
 #include "os_sync.h"
 #include "os_mem.h"
 #include "os_sched.h"
+#if PLATFORM_HOST_SIM
+#include "platform_sim.h"
+#endif
 
 BEGIN_DECLS
 
@@ -90,11 +93,16 @@ void plt_delay_us(uint32_t t);
 #define plt_delay_ms(t)                                             os_delay(t)
 
 /** @brief system time value increase progressively */
+#define PLT_TIME_READ_US_MAX_VALUE                                  (0x3FFFFFF/40)
+#if PLATFORM_HOST_SIM
+/* precision: 1us, range: 0 ~ 1.677 second, driven by the simulated clock */
+#define plt_time_read_us()                                          (plt_sim_time_read_us() % (PLT_TIME_READ_US_MAX_VALUE + 1))
+#else
 #define VENDOR_BASE_ADDRESS                                         0x40058000
 #define VENDOR_READ(Vendor_offset)                                  ((uint32_t)*((volatile uint32_t*)(VENDOR_BASE_ADDRESS+(Vendor_offset))))
-#define PLT_TIME_READ_US_MAX_VALUE                                  (0x3FFFFFF/40)
 /* precision: 1us, range: 0 ~ 1.677 second */
 #define plt_time_read_us()                                          ((VENDOR_READ(0x17C) & 0x3FFFFFF)/40)
+#endif
 
 /* precision: 10ms, range: 0 ~ 49 day*/
 #define plt_time_read_ms()                                          os_sys_time_get()
@@ -0,0 +1,805 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     platform_sim.c
+  * @brief    Source file for host simulation platform.
+  * @details  Replace the os, ftl, flash, timer peripheral and mesh stack services used by the
+  *           light modules with host implementations driven by a virtual clock.
+  * @author   bill
+  * @date     2018-12-10
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include "platform_os.h"
+#include "platform_diagnose.h"
+#include "platform_sim.h"
+#include "rtl876x_tim.h"
+#include "rtl876x_rcc.h"
+#include "rtl876x_pinmux.h"
+#include "rtl876x_nvic.h"
+#include "ftl.h"
+#include "ftl_app_cb.h"
+#include "flash_device.h"
+#include "mesh_api.h"
+
+#if PLATFORM_HOST_SIM
+
+typedef struct
+{
+    bool used;
+    bool active;
+    bool reload;
+    const char *name;
+    uint32_t timer_id;
+    uint32_t period_ms;
+    uint64_t expire_us;
+    void (*pf_cb)(void *);
+} plt_sim_timer_t;
+
+typedef struct
+{
+    uint32_t size;
+    uint32_t padding;
+} plt_sim_mem_header_t;
+
+static uint64_t sim_time_us;
+static plt_sim_timer_t sim_timers[PLT_SIM_TIMER_NUM];
+static plt_sim_pwm_t sim_pwms[PLT_SIM_PWM_NUM];
+static uint8_t sim_ftl_data[PLT_SIM_FTL_SIZE];
+static uint8_t sim_ftl_valid[PLT_SIM_FTL_SIZE / 4];
+static uint8_t sim_flash[PLT_SIM_FLASH_SIZE];
+static plt_sim_stat_t sim_stat;
+static uint8_t sim_node_state = PROV_NODE;
+static plt_timer_t sim_tick_timer;
+static tick_timeout_cb sim_tick_cb;
+static bool sim_log_enable;
+static uint32_t sim_rand_state = 1;
+
+/* interrupt handlers defined by the modules under test, TIM0 and TIM1 are reserved */
+void Timer2_Handler(void) __attribute__((weak));
+void Timer3_Handler(void) __attribute__((weak));
+void Timer4_Handler(void) __attribute__((weak));
+void Timer5_Handler(void) __attribute__((weak));
+void Timer6_Handler(void) __attribute__((weak));
+void Timer7_Handler(void) __attribute__((weak));
+
+uint32_t mesh_log_switch[MESH_LOG_LEVEL_COUNT][MESH_LOG_LEVEL_SIZE] =
+{
+    {0xffffffff}, {0xffffffff}, {0xffffffff}, {0xffffffff}
+};
+
+static plt_sim_timer_t *sim_timer_get(void *handle)
+{
+    plt_sim_timer_t *ptimer = (plt_sim_timer_t *)handle;
+    if ((ptimer < sim_timers) || (ptimer >= sim_timers + PLT_SIM_TIMER_NUM) || !ptimer->used)
+    {
+        return NULL;
+    }
+    return ptimer;
+}
+
+static plt_sim_pwm_t *sim_pwm_get(const TIM_TypeDef *tim)
+{
+    const TIM_TypeDef *tims[PLT_SIM_PWM_NUM] = {TIM0, TIM1, TIM2, TIM3, TIM4, TIM5, TIM6, TIM7};
+    for (uint8_t i = 0; i < PLT_SIM_PWM_NUM; ++i)
+    {
+        if (tims[i] == tim)
+        {
+            return &sim_pwms[i];
+        }
+    }
+    return NULL;
+}
+
+static void sim_timer_arm(plt_sim_timer_t *ptimer)
+{
+    if (!ptimer->active)
+    {
+        sim_stat.timer_active_num ++;
+    }
+    ptimer->active = TRUE;
+    ptimer->expire_us = sim_time_us + (uint64_t)ptimer->period_ms * 1000;
+    sim_stat.timer_starts ++;
+}
+
+static void sim_timer_disarm(plt_sim_timer_t *ptimer)
+{
+    if (ptimer->active)
+    {
+        sim_stat.timer_active_num --;
+    }
+    ptimer->active = FALSE;
+}
+
+static plt_sim_timer_t *sim_timer_next(uint64_t deadline_us)
+{
+    plt_sim_timer_t *pnext = NULL;
+    for (uint8_t i = 0; i < PLT_SIM_TIMER_NUM; ++i)
+    {
+        if (sim_timers[i].used && sim_timers[i].active && (sim_timers[i].expire_us <= deadline_us))
+        {
+            if ((NULL == pnext) || (sim_timers[i].expire_us < pnext->expire_us))
+            {
+                pnext = &sim_timers[i];
+            }
+        }
+    }
+    return pnext;
+}
+
+static void sim_timer_fire(plt_sim_timer_t *ptimer)
+{
+    sim_time_us = ptimer->expire_us;
+    if (ptimer->reload)
+    {
+        ptimer->expire_us += (uint64_t)ptimer->period_ms * 1000;
+    }
+    else
+    {
+        sim_timer_disarm(ptimer);
+    }
+    sim_stat.timer_wakeups ++;
+    ptimer->pf_cb(ptimer);
+}
+
+static plt_sim_pwm_t *sim_irq_next(uint64_t deadline_us)
+{
+    plt_sim_pwm_t *pnext = NULL;
+    for (uint8_t i = 0; i < PLT_SIM_PWM_NUM; ++i)
+    {
+        if (sim_pwms[i].enable && sim_pwms[i].int_enable && (sim_pwms[i].irq_time_us <= deadline_us))
+        {
+            if ((NULL == pnext) || (sim_pwms[i].irq_time_us < pnext->irq_time_us))
+            {
+                pnext = &sim_pwms[i];
+            }
+        }
+    }
+    return pnext;
+}
+
+static uint64_t sim_irq_period_us(const plt_sim_pwm_t *ppwm)
+{
+    /* 40MHz timer clock, at least 1us */
+    uint64_t period_us = ((uint64_t)ppwm->period + 1) / 40;
+    return (0 == period_us) ? 1 : period_us;
+}
+
+static void sim_irq_arm(plt_sim_pwm_t *ppwm)
+{
+    ppwm->irq_time_us = sim_time_us + sim_irq_period_us(ppwm);
+}
+
+static void sim_irq_fire(plt_sim_pwm_t *ppwm)
+{
+    void (*const handlers[PLT_SIM_PWM_NUM])(void) =
+    {
+        NULL, NULL, Timer2_Handler, Timer3_Handler, Timer4_Handler, Timer5_Handler, Timer6_Handler,
+        Timer7_Handler
+    };
+    sim_time_us = ppwm->irq_time_us;
+    ppwm->irq_time_us += sim_irq_period_us(ppwm);
+    sim_stat.irq_count ++;
+    if (NULL != handlers[ppwm - sim_pwms])
+    {
+        handlers[ppwm - sim_pwms]();
+    }
+}
+
+/**
+ * @brief fire the earliest software timer or interrupt not later than the deadline
+ * @return TRUE: one fired, FALSE: nothing to fire
+ */
+static bool sim_event_fire_next(uint64_t deadline_us)
+{
+    plt_sim_timer_t *ptimer = sim_timer_next(deadline_us);
+    plt_sim_pwm_t *ppwm = sim_irq_next(deadline_us);
+    if ((NULL != ppwm) && ((NULL == ptimer) || (ppwm->irq_time_us < ptimer->expire_us)))
+    {
+        sim_irq_fire(ppwm);
+        return TRUE;
+    }
+
+    if (NULL != ptimer)
+    {
+        sim_timer_fire(ptimer);
+        return TRUE;
+    }
+
+    return FALSE;
+}
+
+void plt_sim_reset(void)
+{
+    plt_sim_power_cycle();
+    memset(sim_ftl_data, 0xff, sizeof(sim_ftl_data));
+    memset(sim_ftl_valid, 0, sizeof(sim_ftl_valid));
+    memset(sim_flash, 0xff, sizeof(sim_flash));
+    memset(&sim_stat, 0, sizeof(sim_stat));
+    sim_node_state = PROV_NODE;
+    sim_rand_state = 1;
+}
+
+void plt_sim_power_cycle(void)
+{
+    sim_time_us = 0;
+    memset(sim_timers, 0, sizeof(sim_timers));
+    memset(sim_pwms, 0, sizeof(sim_pwms));
+    sim_stat.timer_active_num = 0;
+    sim_tick_timer = NULL;
+    sim_tick_cb = NULL;
+}
+
+void plt_sim_clock_advance(uint32_t ms)
+{
+    uint64_t deadline_us = sim_time_us + (uint64_t)ms * 1000;
+    while (sim_event_fire_next(deadline_us))
+    {
+    }
+    sim_time_us = deadline_us;
+}
+
+uint32_t plt_sim_clock_advance_to_next(uint32_t max_ms)
+{
+    uint64_t begin_us = sim_time_us;
+    if (!sim_event_fire_next(sim_time_us + (uint64_t)max_ms * 1000))
+    {
+        sim_time_us += (uint64_t)max_ms * 1000;
+    }
+    return (uint32_t)((sim_time_us - begin_us) / 1000);
+}
+
+uint64_t plt_sim_time_get_us(void)
+{
+    return sim_time_us;
+}
+
+uint32_t plt_sim_time_read_us(void)
+{
+    return (uint32_t)sim_time_us;
+}
+
+const plt_sim_pwm_t *plt_sim_pwm_get(const TIM_TypeDef *tim)
+{
+    return sim_pwm_get(tim);
+}
+
+void plt_sim_stat_get(plt_sim_stat_t *pstat)
+{
+    *pstat = sim_stat;
+}
+
+void plt_sim_stat_clear(void)
+{
+    uint32_t active_num = sim_stat.timer_active_num;
+    uint32_t mem_used = sim_stat.mem_used;
+    memset(&sim_stat, 0, sizeof(sim_stat));
+    sim_stat.timer_active_num = active_num;
+    sim_stat.mem_used = mem_used;
+    sim_stat.mem_peak = mem_used;
+}
+
+void plt_sim_node_state_set(uint8_t state)
+{
+    sim_node_state = state;
+}
+
+void plt_sim_log_enable(bool enable)
+{
+    sim_log_enable = enable;
+}
+
+/** os: critical section, scheduler, time */
+uint32_t os_lock(void)
+{
+    return 0;
+}
+
+void os_unlock(uint32_t s)
+{
+    UNUSED(s);
+}
+
+void os_delay(uint32_t ms)
+{
+    plt_sim_clock_advance(ms);
+}
+
+uint32_t os_sys_time_get(void)
+{
+    return (uint32_t)(sim_time_us / 1000);
+}
+
+void plt_delay_us(uint32_t t)
+{
+    sim_time_us += t;
+}
+
+uint32_t plt_time_diff(uint32_t begin_ms, uint32_t begin_us, uint32_t end_ms, uint32_t end_us)
+{
+    uint32_t diff_ms = end_ms - begin_ms;
+    if (diff_ms < (PLT_TIME_READ_US_MAX_VALUE / 1000))
+    {
+        uint32_t diff_us = (end_us >= begin_us) ? (end_us - begin_us) :
+                           (PLT_TIME_READ_US_MAX_VALUE + 1 - begin_us + end_us);
+        return diff_us | 0x80000000;
+    }
+    return diff_ms;
+}
+
+/* reproducible random numbers, the sequence restarts on reset */
+void plt_rand(uint8_t *prand, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; ++i)
+    {
+        sim_rand_state ^= sim_rand_state << 13;
+        sim_rand_state ^= sim_rand_state >> 17;
+        sim_rand_state ^= sim_rand_state << 5;
+        prand[i] = (uint8_t)sim_rand_state;
+    }
+}
+
+/** os: heap */
+void *os_mem_alloc_intern(RAM_TYPE ram_type, size_t size, const char *p_func, uint32_t file_line)
+{
+    UNUSED(ram_type);
+    UNUSED(p_func);
+    UNUSED(file_line);
+    plt_sim_mem_header_t *phead = malloc(sizeof(plt_sim_mem_header_t) + size);
+    if (NULL == phead)
+    {
+        return NULL;
+    }
+    phead->size = size;
+    sim_stat.mem_alloc_count ++;
+    sim_stat.mem_used += size;
+    if (sim_stat.mem_used > sim_stat.mem_peak)
+    {
+        sim_stat.mem_peak = sim_stat.mem_used;
+    }
+    return phead + 1;
+}
+
+void *os_mem_zalloc_intern(RAM_TYPE ram_type, size_t size, const char *p_func, uint32_t file_line)
+{
+    void *p = os_mem_alloc_intern(ram_type, size, p_func, file_line);
+    if (NULL != p)
+    {
+        memset(p, 0, size);
+    }
+    return p;
+}
+
+void os_mem_free(void *p_block)
+{
+    if (NULL == p_block)
+    {
+        return;
+    }
+    plt_sim_mem_header_t *phead = (plt_sim_mem_header_t *)p_block - 1;
+    sim_stat.mem_free_count ++;
+    sim_stat.mem_used -= phead->size;
+    free(phead);
+}
+
+size_t os_mem_peek(RAM_TYPE ram_type)
+{
+    UNUSED(ram_type);
+    return 0xffff - sim_stat.mem_used;
+}
+
+/** os: software timer */
+bool os_timer_create(void **pp_handle, const char *p_timer_name, uint32_t timer_id,
+                     uint32_t interval_ms, bool reload, void (*p_timer_callback)(void *))
+{
+    for (uint8_t i = 0; i < PLT_SIM_TIMER_NUM; ++i)
+    {
+        if (!sim_timers[i].used)
+        {
+            memset(&sim_timers[i], 0, sizeof(plt_sim_timer_t));
+            sim_timers[i].used = TRUE;
+            sim_timers[i].name = p_timer_name;
+            sim_timers[i].timer_id = timer_id;
+            sim_timers[i].period_ms = interval_ms;
+            sim_timers[i].reload = reload;
+            sim_timers[i].pf_cb = p_timer_callback;
+            *pp_handle = &sim_timers[i];
+            return TRUE;
+        }
+    }
+    *pp_handle = NULL;
+    return FALSE;
+}
+
+bool os_timer_start(void **pp_handle)
+{
+    plt_sim_timer_t *ptimer = sim_timer_get(*pp_handle);
+    if (NULL == ptimer)
+    {
+        return FALSE;
+    }
+    sim_timer_arm(ptimer);
+    return TRUE;
+}
+
+bool os_timer_restart(void **pp_handle, uint32_t interval_ms)
+{
+    plt_sim_timer_t *ptimer = sim_timer_get(*pp_handle);
+    if (NULL == ptimer)
+    {
+        return FALSE;
+    }
+    ptimer->period_ms = interval_ms;
+    sim_timer_arm(ptimer);
+    return TRUE;
+}
+
+bool os_timer_stop(void **pp_handle)
+{
+    plt_sim_timer_t *ptimer = sim_timer_get(*pp_handle);
+    if (NULL == ptimer)
+    {
+        return FALSE;
+    }
+    sim_timer_disarm(ptimer);
+    return TRUE;
+}
+
+bool os_timer_delete(void **pp_handle)
+{
+    plt_sim_timer_t *ptimer = sim_timer_get(*pp_handle);
+    if (NULL == ptimer)
+    {
+        return FALSE;
+    }
+    sim_timer_disarm(ptimer);
+    ptimer->used = FALSE;
+    *pp_handle = NULL;
+    return TRUE;
+}
+
+bool os_timer_state_get(void **pp_handle, uint32_t *p_timer_state)
+{
+    plt_sim_timer_t *ptimer = sim_timer_get(*pp_handle);
+    if (NULL == ptimer)
+    {
+        return FALSE;
+    }
+    *p_timer_state = ptimer->active;
+    return TRUE;
+}
+
+bool os_timer_id_get(void **pp_handle, uint32_t *p_timer_id)
+{
+    plt_sim_timer_t *ptimer = sim_timer_get(*pp_handle);
+    if (NULL == ptimer)
+    {
+        return FALSE;
+    }
+    *p_timer_id = ptimer->timer_id;
+    return TRUE;
+}
+
+plt_timer_t plt_timer_create(const char *name, uint32_t period_ms, bool reload, uint32_t timer_id,
+                             void (*pf_cb)(void *))
+{
+    plt_timer_t timer = NULL;
+    os_timer_create(&timer, name, timer_id, period_ms, reload, pf_cb);
+    return timer;
+}
+
+bool plt_timer_is_active(plt_timer_t timer)
+{
+    plt_sim_timer_t *ptimer = sim_timer_get(timer);
+    return (NULL != ptimer) && ptimer->active;
+}
+
+uint32_t plt_timer_get_id(plt_timer_t timer)
+{
+    plt_sim_timer_t *ptimer = sim_timer_get(timer);
+    return (NULL == ptimer) ? 0 : ptimer->timer_id;
+}
+
+/** ftl */
+uint32_t ftl_save(void *pdata, uint16_t offset, uint16_t size)
+{
+    if ((0 != (offset & 0x03)) || (0 != (size & 0x03)) || (0 == size))
+    {
+        return FTL_WRITE_ERROR_INVALID_PARAMETER;
+    }
+    if ((uint32_t)offset + size > PLT_SIM_FTL_SIZE)
+    {
+        return FTL_WRITE_ERROR_INVALID_ADDR;
+    }
+    memcpy(sim_ftl_data + offset, pdata, size);
+    memset(sim_ftl_valid + offset / 4, 1, size / 4);
+    sim_stat.ftl_save_count ++;
+    sim_stat.ftl_save_bytes += size;
+    return FTL_WRITE_SUCCESS;
+}
+
+uint32_t ftl_load(void *pdata, uint16_t offset, uint16_t size)
+{
+    if ((0 != (offset & 0x03)) || (0 != (size & 0x03)) || (0 == size))
+    {
+        return FTL_READ_ERROR_INVALID_PARAMETER;
+    }
+    if ((uint32_t)offset + size > PLT_SIM_FTL_SIZE)
+    {
+        return FTL_READ_ERROR_INVALID_LOGICAL_ADDR;
+    }
+    sim_stat.ftl_load_count ++;
+    for (uint16_t i = 0; i < size / 4; ++i)
+    {
+        if (!sim_ftl_valid[offset / 4 + i])
+        {
+            return FTL_READ_ERROR_READ_NOT_FOUND;
+        }
+    }
+    memcpy(pdata, sim_ftl_data + offset, size);
+    return FTL_READ_SUCCESS;
+}
+
+/** records of ftl_app_cb.c, the words of a record are saved at once here */
+uint32_t ftl_record_save(void *pdata, uint16_t offset, uint16_t size)
+{
+    if ((size > FTL_RECORD_SIZE_MAX) || (offset + size > FTL_RECORD_ADDR_MAX))
+    {
+        return FTL_WRITE_ERROR_INVALID_PARAMETER;
+    }
+    return ftl_save(pdata, offset, size);
+}
+
+uint32_t ftl_record_load(void *pdata, uint16_t offset, uint16_t size)
+{
+    return ftl_load(pdata, offset, size);
+}
+
+uint32_t ftl_ioctl(uint32_t cmd, uint32_t p1, uint32_t p2)
+{
+    UNUSED(p1);
+    UNUSED(p2);
+    if (FTL_IOCTL_CLEAR_ALL == cmd)
+    {
+        memset(sim_ftl_data, 0xff, sizeof(sim_ftl_data));
+        memset(sim_ftl_valid, 0, sizeof(sim_ftl_valid));
+    }
+    return 0;
+}
+
+/** flash, nor semantics: program clears bits only, erase sets a whole sector to 0xff */
+static bool sim_flash_range_check(uint32_t addr, uint32_t len)
+{
+    return (addr >= PLT_SIM_FLASH_ADDR) && (len <= PLT_SIM_FLASH_SIZE) &&
+           (addr - PLT_SIM_FLASH_ADDR <= PLT_SIM_FLASH_SIZE - len);
+}
+
+bool flash_erase_locked(T_ERASE_TYPE type, uint32_t addr)
+{
+    addr &= ~(0x1000 - 1);
+    if ((FLASH_ERASE_SECTOR != type) || !sim_flash_range_check(addr, 0x1000))
+    {
+        return FALSE;
+    }
+    memset(sim_flash + addr - PLT_SIM_FLASH_ADDR, 0xff, 0x1000);
+    sim_stat.flash_erase_count ++;
+    return TRUE;
+}
+
+bool flash_write_locked(uint32_t start_addr, uint32_t data_len, uint8_t *data)
+{
+    if (!sim_flash_range_check(start_addr, data_len))
+    {
+        return FALSE;
+    }
+    for (uint32_t i = 0; i < data_len; ++i)
+    {
+        sim_flash[start_addr - PLT_SIM_FLASH_ADDR + i] &= data[i];
+    }
+    sim_stat.flash_write_count += (data_len + 3) / 4;
+    return TRUE;
+}
+
+bool flash_auto_write_locked(uint32_t start_addr, uint32_t data)
+{
+    if (0 != (start_addr & 0x03))
+    {
+        return FALSE;
+    }
+    return flash_write_locked(start_addr, 4, (uint8_t *)&data);
+}
+
+bool flash_read_locked(uint32_t start_addr, uint32_t data_len, uint8_t *data)
+{
+    if (!sim_flash_range_check(start_addr, data_len))
+    {
+        return FALSE;
+    }
+    memcpy(data, sim_flash + start_addr - PLT_SIM_FLASH_ADDR, data_len);
+    sim_stat.flash_read_count ++;
+    return TRUE;
+}
+
+/** peripheral: rcc, pinmux and timer pwm */
+void RCC_PeriphClockCmd(uint32_t APBPeriph, uint32_t APBPeriph_Clock, FunctionalState NewState)
+{
+    UNUSED(APBPeriph);
+    UNUSED(APBPeriph_Clock);
+    UNUSED(NewState);
+}
+
+void Pinmux_Config(uint8_t Pin_Num, uint8_t Pin_Func)
+{
+    UNUSED(Pin_Num);
+    UNUSED(Pin_Func);
+}
+
+void Pad_Config(uint8_t Pin_Num, PAD_Mode AON_PAD_Mode, PAD_PWR_Mode AON_PAD_PwrOn,
+                PAD_Pull_Mode AON_PAD_Pull, PAD_OUTPUT_ENABLE_Mode AON_PAD_E, PAD_OUTPUT_VAL AON_PAD_O)
+{
+    UNUSED(Pin_Num);
+    UNUSED(AON_PAD_Mode);
+    UNUSED(AON_PAD_PwrOn);
+    UNUSED(AON_PAD_Pull);
+    UNUSED(AON_PAD_E);
+    UNUSED(AON_PAD_O);
+}
+
+void TIM_StructInit(TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct)
+{
+    memset(TIM_TimeBaseInitStruct, 0, sizeof(TIM_TimeBaseInitTypeDef));
+}
+
+void TIM_TimeBaseInit(TIM_TypeDef *TIMx, TIM_TimeBaseInitTypeDef *TIM_TimeBaseInitStruct)
+{
+    plt_sim_pwm_t *ppwm = sim_pwm_get(TIMx);
+    if ((NULL != ppwm) && (PWM_ENABLE == TIM_TimeBaseInitStruct->TIM_PWM_En))
+    {
+        ppwm->high_count = TIM_TimeBaseInitStruct->TIM_PWM_High_Count;
+        ppwm->low_count = TIM_TimeBaseInitStruct->TIM_PWM_Low_Count;
+        ppwm->change_time_us = sim_time_us;
+    }
+    else if (NULL != ppwm)
+    {
+        ppwm->period = TIM_TimeBaseInitStruct->TIM_Period;
+    }
+}
+
+void TIM_Cmd(TIM_TypeDef *TIMx, FunctionalState NewState)
+{
+    plt_sim_pwm_t *ppwm = sim_pwm_get(TIMx);
+    if (NULL != ppwm)
+    {
+        if ((ENABLE == NewState) && !ppwm->enable)
+        {
+            sim_irq_arm(ppwm);
+        }
+        ppwm->enable = (ENABLE == NewState);
+    }
+}
+
+void TIM_INTConfig(TIM_TypeDef *TIMx, FunctionalState NewState)
+{
+    plt_sim_pwm_t *ppwm = sim_pwm_get(TIMx);
+    if (NULL != ppwm)
+    {
+        ppwm->int_enable = (ENABLE == NewState);
+    }
+}
+
+void TIM_ChangePeriod(TIM_TypeDef *TIMx, uint32_t period)
+{
+    plt_sim_pwm_t *ppwm = sim_pwm_get(TIMx);
+    if (NULL != ppwm)
+    {
+        ppwm->period = period;
+        sim_irq_arm(ppwm);
+    }
+}
+
+void NVIC_Init(NVIC_InitTypeDef *NVIC_InitStruct)
+{
+    UNUSED(NVIC_InitStruct);
+}
+
+void TIM_PWMChangeFreqAndDuty(TIM_TypeDef *TIMx, uint32_t high_count, uint32_t low_count)
+{
+    plt_sim_pwm_t *ppwm = sim_pwm_get(TIMx);
+    if (NULL != ppwm)
+    {
+        ppwm->high_count = high_count;
+        ppwm->low_count = low_count;
+        ppwm->change_count ++;
+        ppwm->change_time_us = sim_time_us;
+        sim_stat.pwm_change_count ++;
+    }
+}
+
+/** trace */
+void log_buffer(uint32_t info, uint32_t log_str_index, uint8_t param_num, ...)
+{
+    UNUSED(param_num);
+    sim_stat.log_count ++;
+    if (sim_log_enable)
+    {
+        printf("[%10u.%03u] log 0x%08x, format 0x%08x\n", (uint32_t)(sim_time_us / 1000),
+               (uint32_t)(sim_time_us % 1000), info, log_str_index);
+    }
+}
+
+void log_direct(uint32_t info, const char *fmt, ...)
+{
+    UNUSED(info);
+    if (sim_log_enable)
+    {
+        va_list ap;
+        va_start(ap, fmt);
+        vprintf(fmt, ap);
+        va_end(ap);
+        printf("\n");
+    }
+}
+
+const char *trace_binary(uint32_t info, uint16_t length, uint8_t *p_data)
+{
+    UNUSED(info);
+    UNUSED(length);
+    UNUSED(p_data);
+    return "";
+}
+
+/** mesh stack */
+mesh_node_state_t mesh_node_state_restore(void)
+{
+    return (mesh_node_state_t)sim_node_state;
+}
+
+void mesh_node_clear(void)
+{
+    sim_node_state = UNPROV_DEVICE;
+}
+
+static void sim_tick_timeout(void *ptimer)
+{
+    UNUSED(ptimer);
+    if (NULL != sim_tick_cb)
+    {
+        sim_tick_cb();
+    }
+}
+
+void mesh_tick_timer_start(uint32_t tick_ms, tick_timeout_cb tick_cb)
+{
+    sim_tick_cb = tick_cb;
+    if (NULL == sim_tick_timer)
+    {
+        sim_tick_timer = plt_timer_create("tick", tick_ms, TRUE, 0, sim_tick_timeout);
+    }
+    else
+    {
+        plt_timer_change_period(sim_tick_timer, tick_ms, 0);
+    }
+    plt_timer_start(sim_tick_timer, 0);
+}
+
+void mesh_tick_timer_stop(void)
+{
+    if (NULL != sim_tick_timer)
+    {
+        plt_timer_stop(sim_tick_timer, 0);
+    }
+}
+
+bool mesh_tick_timer_is_running(void)
+{
+    return (NULL != sim_tick_timer) && plt_timer_is_active(sim_tick_timer);
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -0,0 +1,172 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     platform_sim.h
+  * @brief    Head file for host simulation platform.
+  * @details  Virtual clock, software timers, heap, ftl, flash and pwm simulation used to run the
+  *           light modules on a linux host. Build the modules with PLATFORM_HOST_SIM=1 and
+  *           link them with platform_sim.c instead of the rom/sdk libraries, e.g.
+  *           gcc -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> platform_sim.c
+  *           dimmable_light.c light_controller_app.c light_cwrgb_app.c light_storage_app.c
+  *           <harness.c>
+  * @author   bill
+  * @date     2018-12-10
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion */
+#ifndef _PLATFORM_SIM_H
+#define _PLATFORM_SIM_H
+
+/* Add Includes here */
+#include "platform_types.h"
+#include "rtl876x.h"
+
+BEGIN_DECLS
+
+/** @addtogroup Platform_Sim
+  * @{
+  */
+
+/** @defgroup Platform_Sim_Exported_Macros Exported Macros
+  * @brief
+  * @{
+  */
+#define PLT_SIM_TIMER_NUM                   32 //!< maximum simultaneous software timers
+#define PLT_SIM_PWM_NUM                     8 //!< TIM0 ~ TIM7
+#define PLT_SIM_FTL_SIZE                    4096 //!< simulated ftl logical space, in bytes
+#define PLT_SIM_FLASH_ADDR                  0x00878000 //!< simulated flash window, the last 32K of the flash
+#define PLT_SIM_FLASH_SIZE                  0x8000
+/** @} */
+
+/** @defgroup Platform_Sim_Exported_Types Exported Types
+  * @brief
+  * @{
+  */
+typedef struct
+{
+    bool enable;
+    uint32_t high_count;
+    uint32_t low_count;
+    uint32_t change_count; //!< TIM_PWMChangeFreqAndDuty invoke times
+    uint64_t change_time_us; //!< virtual time of the last duty change
+    bool int_enable;
+    uint32_t period; //!< TIM_Period of the timer mode, in 40MHz ticks
+    uint64_t irq_time_us; //!< virtual time of the next interrupt
+} plt_sim_pwm_t;
+
+typedef struct
+{
+    uint32_t timer_wakeups; //!< software timer callbacks fired
+    uint32_t irq_count; //!< hardware timer interrupts fired
+    uint32_t timer_starts;
+    uint32_t timer_active_num;
+    uint32_t mem_alloc_count;
+    uint32_t mem_free_count;
+    uint32_t mem_used; //!< heap bytes in use
+    uint32_t mem_peak; //!< heap bytes high water mark
+    uint32_t ftl_save_count;
+    uint32_t ftl_save_bytes;
+    uint32_t ftl_load_count;
+    uint32_t flash_read_count; //!< flash_read_locked invoke times
+    uint32_t flash_write_count; //!< flash words programmed
+    uint32_t flash_erase_count; //!< flash sectors erased
+    uint32_t pwm_change_count;
+    uint32_t log_count;
+} plt_sim_stat_t;
+/** @} */
+
+/** @defgroup Platform_Sim_Exported_Functions Exported Functions
+  * @brief
+  * @{
+  */
+
+/**
+  * @brief reset all the simulated resources
+  *
+  * Timers, heap statistics, ftl content and pwm state are cleared, the virtual clock goes back to 0.
+  * Modules which keep static state need to be deinitialized by the caller before reset.
+  * @return none
+  */
+void plt_sim_reset(void);
+
+/**
+  * @brief simulate a power cycle
+  *
+  * Timers, pwm state and the virtual clock are cleared as plt_sim_reset does, ftl and flash
+  * content are kept. Statistics are kept too.
+  * @return none
+  */
+void plt_sim_power_cycle(void);
+
+/**
+  * @brief advance the virtual clock
+  *
+  * Expired software timers and hardware timer interrupts are fired in the order of their deadline,
+  * the virtual clock is set to the deadline before each callback, so the callbacks observe the
+  * right time. Hardware timer interrupts invoke TimerN_Handler if the module under test defines it.
+  * @param[in] ms: time to advance
+  * @return none
+  */
+void plt_sim_clock_advance(uint32_t ms);
+
+/**
+  * @brief advance the virtual clock to the next software timer or interrupt deadline
+  * @param[in] max_ms: maximum time to advance if no timer expires before
+  * @return time advanced in ms
+  */
+uint32_t plt_sim_clock_advance_to_next(uint32_t max_ms);
+
+/**
+  * @brief get virtual time
+  * @return virtual time in us since the last reset
+  */
+uint64_t plt_sim_time_get_us(void);
+
+/**
+  * @brief virtual time source of plt_time_read_us
+  * @return virtual time in us, wraps around
+  */
+uint32_t plt_sim_time_read_us(void);
+
+/**
+  * @brief get simulated pwm state
+  * @param[in] tim: timer peripheral
+  * @return pwm state, NULL if the timer is invalid
+  */
+const plt_sim_pwm_t *plt_sim_pwm_get(const TIM_TypeDef *tim);
+
+/**
+  * @brief get simulation statistics
+  * @param[out] pstat: statistics
+  * @return none
+  */
+void plt_sim_stat_get(plt_sim_stat_t *pstat);
+
+/**
+  * @brief clear simulation statistics, the simulated resources are kept
+  * @return none
+  */
+void plt_sim_stat_clear(void);
+
+/**
+  * @brief set the node state returned by mesh_node_state_restore
+  * @param[in] state: mesh_node_state_t value
+  * @return none
+  */
+void plt_sim_node_state_set(uint8_t state);
+
+/**
+  * @brief set whether the logs are printed to stdout
+  * @param[in] enable: print or not
+  * @return none
+  */
+void plt_sim_log_enable(bool enable);
+/** @} */
+/** @} */
+
+END_DECLS
+
+#endif /* _PLATFORM_SIM_H */
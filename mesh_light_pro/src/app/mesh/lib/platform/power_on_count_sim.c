@@ -0,0 +1,161 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     power_on_count_sim.c
+  * @brief    Host test of the power on counter sector.
+  * @details  The light is switched on and off many times on the virtual clock, mostly for long,
+  *           sometimes in bursts of cycles shorter than LIGHT_POWER_ON_TIME. Every boot the
+  *           count and the node reset are checked against a model of the gesture, starting from
+  *           a blank and from a garbage sector. The flash erases, the words programmed per cycle
+  *           and the words read per boot are reported. The reset gesture alone and across a wrap
+  *           of the sector are checked at last. Build it on a linux host with the keil include
+  *           path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> power_on_count_sim.c
+  *           platform_sim.c -lm -o power_on_count_sim
+  *           and run it with the number of power cycles, e.g. ./power_on_count_sim 100000
+  * @author   bill
+  * @date     2018-12-25
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+/* the scan state of the counter is static, it is dropped by every power cycle */
+#include "dimmable_light.c"
+
+static uint64_t power_on_sim_rng = 1;
+
+static uint32_t power_on_sim_rand(void)
+{
+    /* xorshift64* */
+    power_on_sim_rng ^= power_on_sim_rng >> 12;
+    power_on_sim_rng ^= power_on_sim_rng << 25;
+    power_on_sim_rng ^= power_on_sim_rng >> 27;
+    return (uint32_t)((power_on_sim_rng * 2685821657736338717ULL) >> 32);
+}
+
+static void power_on_sim_boot(void)
+{
+    plt_sim_power_cycle();
+    light_power_on_scanned = FALSE;
+    light_power_on_count = 0;
+    power_on_timer = NULL;
+}
+
+static uint32_t power_on_sim_run(uint32_t cycles, bool garbage)
+{
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    power_on_sim_rng = garbage ? 2 : 1;
+    if (garbage)
+    {
+        uint8_t junk[64];
+        for (uint8_t i = 0; i < sizeof(junk); ++i)
+        {
+            junk[i] = power_on_sim_rand();
+        }
+        flash_write_locked(LIGHT_POWER_ON_COUNT_ADDR, sizeof(junk), junk);
+    }
+
+    /* short cycles right before this power on, as the gesture counts them */
+    uint32_t model = 0;
+    uint32_t resets = 0;
+    uint32_t fails = 0;
+    uint32_t read_max = 0;
+    for (uint32_t i = 0; i < cycles; ++i)
+    {
+        power_on_sim_boot();
+        plt_sim_stat_t stat;
+        plt_sim_stat_get(&stat);
+        uint32_t reads = stat.flash_read_count;
+        uint8_t count = light_power_on_count_get();
+        bool reset = light_power_on_count_check();
+        plt_sim_stat_get(&stat);
+        if (stat.flash_read_count - reads > read_max)
+        {
+            read_max = stat.flash_read_count - reads;
+        }
+
+        bool model_reset = (model >= LIGHT_POWER_ON_COUNT);
+        uint32_t model_count = model_reset ? LIGHT_POWER_ON_COUNT : model;
+        if ((count != model_count) || (reset != model_reset))
+        {
+            if (fails < 5)
+            {
+                printf("  cycle %u: count %u reset %d, expected %u %d\n", i, count, reset, model_count,
+                       model_reset);
+            }
+            fails ++;
+        }
+        resets += reset;
+
+        /* 40% short cycles, the others stay on up to 100s longer than LIGHT_POWER_ON_TIME */
+        uint32_t on_ms = (power_on_sim_rand() % 100 < 40) ?
+                         (power_on_sim_rand() % (LIGHT_POWER_ON_TIME - 1)) :
+                         (LIGHT_POWER_ON_TIME + power_on_sim_rand() % 100000);
+        plt_sim_clock_advance(on_ms);
+        model = (model_reset || (on_ms >= LIGHT_POWER_ON_TIME)) ? 0 : (model + 1);
+    }
+
+    plt_sim_stat_t stat;
+    plt_sim_stat_get(&stat);
+    printf("%-14s: %u cycles, %u resets, mismatches %u, erases %u, words programmed %u "
+           "(%.2f per cycle), words read per boot max %u, ftl saves %u\n",
+           garbage ? "garbage sector" : "blank sector", cycles, resets, fails,
+           stat.flash_erase_count, stat.flash_write_count, (double)stat.flash_write_count / cycles,
+           read_max, stat.ftl_save_count);
+    return fails;
+}
+
+/* LIGHT_POWER_ON_COUNT quick cycles, the next one resets the node, return the failures */
+static uint32_t power_on_sim_gesture(uint32_t long_cycles)
+{
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    for (uint32_t i = 0; i < long_cycles; ++i)
+    {
+        power_on_sim_boot();
+        light_power_on_count_check();
+        plt_sim_clock_advance(LIGHT_POWER_ON_TIME + 1000);
+    }
+
+    int32_t reset_at = -1;
+    for (uint32_t i = 0; i < LIGHT_POWER_ON_COUNT + 3; ++i)
+    {
+        power_on_sim_boot();
+        if (light_power_on_count_check() && (reset_at < 0))
+        {
+            reset_at = i;
+        }
+        plt_sim_clock_advance((i < LIGHT_POWER_ON_COUNT) ? 1000 : (LIGHT_POWER_ON_TIME + 1000));
+    }
+    plt_sim_stat_t stat;
+    plt_sim_stat_get(&stat);
+    uint32_t erases = (long_cycles + LIGHT_POWER_ON_COUNT + 3) / LIGHT_POWER_ON_CYCLE_NUM + 1;
+    printf("gesture after %u cycles: reset at power on %d, erases %u\n", long_cycles, reset_at,
+           stat.flash_erase_count);
+    return ((LIGHT_POWER_ON_COUNT != reset_at) || (stat.flash_erase_count != erases)) ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t cycles = (argc > 1) ? strtoul(argv[1], NULL, 0) : 100000;
+    uint32_t fails = 0;
+
+    fails += power_on_sim_run(cycles, FALSE);
+    fails += power_on_sim_run(cycles, TRUE);
+    fails += power_on_sim_gesture(0);
+    /* the quick cycles cross the erase of the sector */
+    fails += power_on_sim_gesture(LIGHT_POWER_ON_CYCLE_NUM - 3);
+
+    printf("%s\n", fails ? "FAIL" : "PASS");
+    return fails ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -0,0 +1,334 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     scene_recall_sim.c
+  * @brief    Host benchmark of the scene recall latency on a ctl and hsl node.
+  * @details  The ctl and hsl light models are registered as on the node, the full register of
+  *           LIGHT_FLASH_SCENE_NUM scenes is stored by scene store messages to the setup server and
+  *           written to flash, then reloaded from flash and checked. Scene recall messages are fed
+  *           to the scene server: immediate recalls of stored scenes, recalls of missing scenes and
+  *           recalls with a transition. Every recall is checked to light the stored ctl and hsl,
+  *           and the host cycles of one recall and of one transition tick are reported. Build it on
+  *           a linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE <keil include path> scene_recall_sim.c
+  *           light_ctl_hsl_server_app.c light_cwrgb_app.c light_controller_app.c
+  *           light_storage_app.c dimmable_light.c scene_server.c scene_setup_server.c
+  *           generic_on_off_server.c light_lightness_server.c light_lightness_setup_server.c
+  *           light_ctl_server.c light_ctl_setup_server.c light_ctl_temperature_server.c
+  *           light_hsl_server.c light_hsl_setup_server.c light_hsl_hue_server.c
+  *           light_hsl_saturation_server.c generic_transition_time.c delay_execution.c
+  *           platform_sim.c -lm -o scene_recall_sim
+  *           and run it with the number of recalls, e.g. ./scene_recall_sim 100000. Add
+  *           -DMODEL_SCENE_INDEX_SIZE=16 to measure the linear search of the register instead.
+  * @note     The cycles of one recall include the light driver and the simulated pwm.
+  * @author   bill
+  * @date     2018-12-20
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "mesh_api.h"
+#include "scene.h"
+#include "light_ctl_hsl_server_app.h"
+#include "light_controller_app.h"
+#include "light_cwrgb_app.h"
+#include "light_config.h"
+#include "light_storage_app.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define SCENE_RECALL_SIM_TICK_MS            100
+#define SCENE_RECALL_SIM_TRANS_NUM          100 //!< recalls with a transition
+
+typedef struct
+{
+    uint64_t count;
+    uint64_t cycles;
+    uint64_t cycles_max;
+} scene_recall_sim_stat_t;
+
+mesh_node_t mesh_node;
+static mesh_model_info_p scene_recall_sim_server;
+static mesh_model_info_p scene_recall_sim_setup_server;
+static uint16_t scene_recall_sim_numbers[LIGHT_FLASH_SCENE_NUM];
+static light_ctl_hsl_scene_t scene_recall_sim_states[LIGHT_FLASH_SCENE_NUM];
+static uint32_t scene_recall_sim_sent;
+static uint32_t scene_recall_sim_errors;
+static uint64_t scene_recall_sim_rng = 1;
+
+/* the models send status and publish through the access layer, not linked here */
+mesh_msg_send_cause_t access_cfg(mesh_msg_p pmsg)
+{
+    UNUSED(pmsg);
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+mesh_msg_send_cause_t access_send(mesh_msg_p pmsg)
+{
+    UNUSED(pmsg);
+    scene_recall_sim_sent ++;
+    return MESH_MSG_SEND_CAUSE_SUCCESS;
+}
+
+bool mesh_model_reg(uint8_t element_index, mesh_model_info_p pmodel_info)
+{
+    UNUSED(element_index);
+    if (MESH_MODEL_SCENE_SERVER == pmodel_info->model_id)
+    {
+        scene_recall_sim_server = pmodel_info;
+    }
+    else if (MESH_MODEL_SCENE_SETUP_SERVER == pmodel_info->model_id)
+    {
+        scene_recall_sim_setup_server = pmodel_info;
+    }
+    return TRUE;
+}
+
+bool mesh_model_pub_check(mesh_model_info_p pmodel_info)
+{
+    UNUSED(pmodel_info);
+    return TRUE;
+}
+
+static uint64_t scene_recall_sim_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/* xorshift64*, the runs are reproducible */
+static uint32_t scene_recall_sim_rand(void)
+{
+    scene_recall_sim_rng ^= scene_recall_sim_rng >> 12;
+    scene_recall_sim_rng ^= scene_recall_sim_rng << 25;
+    scene_recall_sim_rng ^= scene_recall_sim_rng >> 27;
+    return (uint32_t)((scene_recall_sim_rng * 0x2545f4914f6cdd1dULL) >> 32);
+}
+
+static void scene_recall_sim_stat_add(scene_recall_sim_stat_t *pstat, uint64_t cycles)
+{
+    pstat->count ++;
+    pstat->cycles += cycles;
+    if (cycles > pstat->cycles_max)
+    {
+        pstat->cycles_max = cycles;
+    }
+}
+
+static void scene_recall_sim_stat_print(const char *name, const scene_recall_sim_stat_t *pstat)
+{
+    printf("%-20s %8llu, %7.1f cycles mean, %7llu max\n", name, (unsigned long long)pstat->count,
+           pstat->count ? (double)pstat->cycles / pstat->count : 0.0,
+           (unsigned long long)pstat->cycles_max);
+}
+
+/* hand an access message to a model as the access layer does */
+static uint64_t scene_recall_sim_receive(mesh_model_info_p pmodel_info, uint32_t opcode,
+                                         void *pmsg, uint16_t msg_len)
+{
+    mesh_msg_t mesh_msg;
+    memset(&mesh_msg, 0, sizeof(mesh_msg));
+    mesh_msg.pmodel_info = pmodel_info;
+    mesh_msg.pbuffer = pmsg;
+    mesh_msg.msg_len = msg_len;
+    mesh_msg.access_opcode = opcode;
+    mesh_msg.src = 0x0001;
+    uint64_t begin = scene_recall_sim_cycles();
+    pmodel_info->model_receive(&mesh_msg);
+    return scene_recall_sim_cycles() - begin;
+}
+
+static uint64_t scene_recall_sim_recall(uint16_t scene_number, uint8_t num_steps)
+{
+    scene_recall_t msg;
+    ACCESS_OPCODE_BYTE(msg.opcode, MESH_MSG_SCENE_RECALL_UNACK);
+    msg.scene_number = scene_number;
+    msg.tid = scene_recall_sim_rand();
+    msg.trans_time.num_steps = num_steps;
+    msg.trans_time.step_resolution = GENERIC_TRANSITION_STEP_RESOLUTION_100MILLISECONDS;
+    msg.delay = 0;
+    return scene_recall_sim_receive(scene_recall_sim_server, MESH_MSG_SCENE_RECALL_UNACK, &msg,
+                                    sizeof(msg));
+}
+
+static bool scene_recall_sim_lit(uint32_t index)
+{
+    light_ctl_t ctl = light_get_ctl();
+    light_hsl_t hsl = light_get_hsl();
+    return (0 == memcmp(&ctl, &scene_recall_sim_states[index].ctl, sizeof(ctl))) &&
+           (0 == memcmp(&hsl, &scene_recall_sim_states[index].hsl, sizeof(hsl)));
+}
+
+static void scene_recall_sim_check(uint32_t index, const char *what)
+{
+    if (!scene_recall_sim_lit(index))
+    {
+        light_ctl_t ctl = light_get_ctl();
+        printf("%s of scene 0x%04x: ctl %u %u, expect %u %u\n", what, scene_recall_sim_numbers[index],
+               ctl.lightness, ctl.temperature, scene_recall_sim_states[index].ctl.lightness,
+               scene_recall_sim_states[index].ctl.temperature);
+        scene_recall_sim_errors ++;
+    }
+}
+
+static bool scene_recall_sim_stored(uint16_t scene_number)
+{
+    for (uint32_t i = 0; i < LIGHT_FLASH_SCENE_NUM; ++i)
+    {
+        if (scene_recall_sim_numbers[i] == scene_number)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* fill the register with random scenes, each one stores the light state set just before */
+static void scene_recall_sim_store_all(void)
+{
+    for (uint32_t i = 0; i < LIGHT_FLASH_SCENE_NUM; ++i)
+    {
+        uint16_t scene_number;
+        do
+        {
+            scene_number = scene_recall_sim_rand();
+        }
+        while (!IS_SCENE_NUMBER_VALID(scene_number) || scene_recall_sim_stored(scene_number));
+        scene_recall_sim_numbers[i] = scene_number;
+
+        light_ctl_t ctl;
+        memset(&ctl, 0, sizeof(ctl));
+        ctl.lightness = scene_recall_sim_rand();
+        ctl.temperature = 800 + scene_recall_sim_rand() % 19200;
+        light_hsl_t hsl;
+        hsl.hue = scene_recall_sim_rand();
+        hsl.saturation = scene_recall_sim_rand();
+        hsl.lightness = scene_recall_sim_rand();
+        light_set_ctl(ctl);
+        light_set_hsl(hsl);
+        scene_recall_sim_states[i].ctl = light_get_ctl();
+        scene_recall_sim_states[i].hsl = light_get_hsl();
+
+        scene_store_t msg;
+        ACCESS_OPCODE_BYTE(msg.opcode, MESH_MSG_SCENE_STORE_UNACK);
+        msg.scene_number = scene_number;
+        scene_recall_sim_receive(scene_recall_sim_setup_server, MESH_MSG_SCENE_STORE_UNACK, &msg,
+                                 sizeof(msg));
+        plt_sim_clock_advance(SCENE_RECALL_SIM_TICK_MS);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t recalls = (argc > 1) ? strtoul(argv[1], NULL, 0) : 100000;
+
+    plt_sim_reset();
+    plt_sim_log_enable(FALSE);
+    mesh_node.node_state = PROV_NODE;
+    light_cwrgb_driver_init();
+    light_controller_init();
+    light_ctl_hsl_server_models_init(0);
+    if ((NULL == scene_recall_sim_server) || (NULL == scene_recall_sim_setup_server))
+    {
+        printf("scene models are not registered\n");
+        return 1;
+    }
+    printf("%u scenes, %s lookup\n", LIGHT_FLASH_SCENE_NUM,
+           (LIGHT_FLASH_SCENE_NUM < MODEL_SCENE_INDEX_SIZE) ? "index" : "linear");
+
+    /* store the register, the records are written after the quiet time */
+    plt_sim_stat_clear();
+    scene_recall_sim_store_all();
+    plt_sim_clock_advance(LIGHT_STATE_STORE_DELAY_MAX);
+    plt_sim_stat_t stat;
+    plt_sim_stat_get(&stat);
+    light_state_store_stat_t store_stat;
+    light_state_store_stat_get(&store_stat);
+    printf("%u scenes stored, %u flash saves, %u scene records written\n", LIGHT_FLASH_SCENE_NUM,
+           stat.ftl_save_count, store_stat.scene_write_count);
+
+    /* reload the register from flash */
+    light_scene_restore(NULL, 0);
+    for (uint32_t i = 0; i < LIGHT_FLASH_SCENE_NUM; ++i)
+    {
+        const light_ctl_hsl_scene_t *pstate = light_scene_state_get(scene_recall_sim_numbers[i]);
+        if ((NULL == pstate) || (0 != memcmp(pstate, &scene_recall_sim_states[i], sizeof(*pstate))))
+        {
+            printf("scene 0x%04x: lost by the reload\n", scene_recall_sim_numbers[i]);
+            scene_recall_sim_errors ++;
+        }
+    }
+
+    /* immediate recalls of stored and of missing scenes */
+    scene_recall_sim_stat_t hit = {0}, miss = {0};
+    for (uint32_t r = 0; r < recalls; ++r)
+    {
+        if (0 == r % 4)
+        {
+            uint16_t scene_number;
+            do
+            {
+                scene_number = scene_recall_sim_rand();
+            }
+            while (!IS_SCENE_NUMBER_VALID(scene_number) || scene_recall_sim_stored(scene_number));
+            light_ctl_t before = light_get_ctl();
+            scene_recall_sim_stat_add(&miss, scene_recall_sim_recall(scene_number,
+                                                                     GENERIC_TRANSITION_NUM_STEPS_IMMEDIATE));
+            light_ctl_t after = light_get_ctl();
+            if (0 != memcmp(&before, &after, sizeof(before)))
+            {
+                printf("missing scene 0x%04x changed the light\n", scene_number);
+                scene_recall_sim_errors ++;
+            }
+        }
+        else
+        {
+            uint32_t index = scene_recall_sim_rand() % LIGHT_FLASH_SCENE_NUM;
+            scene_recall_sim_stat_add(&hit, scene_recall_sim_recall(scene_recall_sim_numbers[index],
+                                                                    GENERIC_TRANSITION_NUM_STEPS_IMMEDIATE));
+            scene_recall_sim_check(index, "recall");
+        }
+    }
+
+    /* recalls with a transition, the register is not searched by the steps */
+    scene_recall_sim_stat_t trans = {0}, tick = {0};
+    for (uint32_t r = 0; r < SCENE_RECALL_SIM_TRANS_NUM; ++r)
+    {
+        uint32_t index = scene_recall_sim_rand() % LIGHT_FLASH_SCENE_NUM;
+        uint8_t num_steps = 1 + scene_recall_sim_rand() % 20;
+        scene_recall_sim_stat_add(&trans, scene_recall_sim_recall(scene_recall_sim_numbers[index],
+                                                                  num_steps));
+        for (uint8_t step = 0; step <= num_steps; ++step)
+        {
+            uint64_t begin = scene_recall_sim_cycles();
+            plt_sim_clock_advance(SCENE_RECALL_SIM_TICK_MS);
+            scene_recall_sim_stat_add(&tick, scene_recall_sim_cycles() - begin);
+        }
+        scene_recall_sim_check(index, "transition");
+    }
+    plt_sim_clock_advance(LIGHT_STATE_STORE_DELAY_MAX);
+
+    scene_recall_sim_stat_print("recall stored", &hit);
+    scene_recall_sim_stat_print("recall missing", &miss);
+    scene_recall_sim_stat_print("recall transition", &trans);
+    scene_recall_sim_stat_print("transition tick", &tick);
+    printf("%u messages sent, %u errors\n", scene_recall_sim_sent, scene_recall_sim_errors);
+    printf("%s\n", scene_recall_sim_errors ? "FAIL" : "PASS");
+    return scene_recall_sim_errors ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
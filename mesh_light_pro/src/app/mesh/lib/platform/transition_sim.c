@@ -0,0 +1,193 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     transition_sim.c
+  * @brief    Host benchmark of the generic transition timer wheel.
+  * @details  N model transitions of random steps and step resolutions are started together,
+  *           half of them are restarted 1 s later, and the rounds repeat until the wheel is
+  *           empty, for N from 1 to MODEL_TRANSITION_NUM_MAX. Every step change is checked to
+  *           arrive exactly one step time after the previous one with one step less remaining,
+  *           and the cycles per mesh tick and the heap allocations are reported. Build it on a
+  *           linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 -DMESH_DEVICE -DMODEL_TRANSITION_NUM_MAX=64
+  *           <keil include path> transition_sim.c generic_transition_time.c platform_sim.c
+  *           -o transition_sim
+  *           and run it with the number of rounds, e.g. ./transition_sim 20
+  * @note     The cycles per tick include the timer simulation of platform_sim.
+  * @author   bill
+  * @date     2018-12-20
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mesh_api.h"
+#include "generic_transition_time.h"
+#include "generic_types.h"
+#include "platform_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define TRANSITION_SIM_TICK_MS          100
+#define TRANSITION_SIM_RESTART_MS       1000
+
+typedef struct
+{
+    generic_transition_time_t total_time;
+    uint8_t remain_num_steps; //!< steps still expected
+    uint64_t next_us; //!< virtual time of the next step change
+    bool running;
+} transition_sim_model_t;
+
+static mesh_model_info_t transition_sim_model_info[MODEL_TRANSITION_NUM_MAX];
+static transition_sim_model_t transition_sim_models[MODEL_TRANSITION_NUM_MAX];
+static uint32_t transition_sim_steps;
+static uint32_t transition_sim_errors;
+
+static uint64_t transition_sim_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    return plt_sim_time_get_us();
+#endif
+}
+
+static int32_t transition_sim_step_change(const mesh_model_info_p pmodel_info, uint32_t trans_type,
+                                          generic_transition_time_t total_time,
+                                          generic_transition_time_t remaining_time)
+{
+    UNUSED(trans_type);
+    transition_sim_model_t *pmodel = &transition_sim_models[pmodel_info -
+                                                                         transition_sim_model_info];
+    transition_sim_steps ++;
+    if (!pmodel->running || plt_sim_time_get_us() != pmodel->next_us ||
+        remaining_time.num_steps + 1 != pmodel->remain_num_steps ||
+        remaining_time.step_resolution != total_time.step_resolution)
+    {
+        printf("model %u: step at %llu us, expect %llu us, remaining %u, expect %u\n",
+               (uint32_t)(pmodel_info - transition_sim_model_info),
+               (unsigned long long)plt_sim_time_get_us(), (unsigned long long)pmodel->next_us,
+               remaining_time.num_steps, pmodel->remain_num_steps - 1);
+        transition_sim_errors ++;
+    }
+    pmodel->remain_num_steps = remaining_time.num_steps;
+    pmodel->next_us = plt_sim_time_get_us() + generic_transition_step_time(total_time) * 1000ULL;
+    if (0 == remaining_time.num_steps)
+    {
+        pmodel->running = FALSE;
+    }
+    return MODEL_SUCCESS;
+}
+
+static void transition_sim_start(uint32_t index)
+{
+    generic_transition_time_t trans_time;
+    uint32_t r = rand();
+    trans_time.num_steps = 1 + r % 20;
+    /* mostly 100 ms steps, the 1 s and 10 s steps exercise the upper wheel levels */
+    trans_time.step_resolution = ((r >> 8) % 8 == 0) ? GENERIC_TRANSITION_STEP_RESOLUTION_10SECONDS :
+                                 (((r >> 8) % 4 == 1) ? GENERIC_TRANSITION_STEP_RESOLUTION_1SECOND :
+                                  GENERIC_TRANSITION_STEP_RESOLUTION_100MILLISECONDS);
+    transition_sim_model_t *pmodel = &transition_sim_models[index];
+    if (!generic_transition_timer_start(&transition_sim_model_info[index], 0, trans_time,
+                                        transition_sim_step_change))
+    {
+        printf("model %u: start failed\n", index);
+        transition_sim_errors ++;
+        return;
+    }
+    pmodel->total_time = trans_time;
+    pmodel->remain_num_steps = trans_time.num_steps;
+    pmodel->next_us = plt_sim_time_get_us() + generic_transition_step_time(trans_time) * 1000ULL;
+    pmodel->running = TRUE;
+}
+
+static bool transition_sim_busy(uint32_t num)
+{
+    for (uint32_t i = 0; i < num; ++i)
+    {
+        if (transition_sim_models[i].running)
+        {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* advance one mesh tick, return the cycles spent */
+static uint64_t transition_sim_tick(void)
+{
+    uint64_t begin = transition_sim_cycles();
+    plt_sim_clock_advance(TRANSITION_SIM_TICK_MS);
+    return transition_sim_cycles() - begin;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t rounds = (argc > 1) ? strtoul(argv[1], NULL, 0) : 20;
+
+    plt_sim_log_enable(FALSE);
+    srand(1);
+    printf("pool of %u transitions, %u rounds\n", MODEL_TRANSITION_NUM_MAX, rounds);
+    for (uint32_t num = 1; num <= MODEL_TRANSITION_NUM_MAX; num *= 2)
+    {
+        plt_sim_reset();
+        generic_transition_time_init();
+        memset(transition_sim_models, 0, sizeof(transition_sim_models));
+        transition_sim_steps = 0;
+        uint32_t errors = transition_sim_errors;
+        uint64_t cycles = 0;
+        uint32_t ticks = 0;
+        plt_sim_stat_clear();
+        for (uint32_t round = 0; round < rounds; ++round)
+        {
+            /* start on a tick boundary, so the step times are exact */
+            for (uint32_t i = 0; i < num; ++i)
+            {
+                transition_sim_start(i);
+            }
+            for (uint32_t t = 0; t < TRANSITION_SIM_RESTART_MS; t += TRANSITION_SIM_TICK_MS)
+            {
+                cycles += transition_sim_tick();
+                ticks ++;
+            }
+            for (uint32_t i = 0; i < num; i += 2)
+            {
+                transition_sim_start(i);
+            }
+            while (transition_sim_busy(num))
+            {
+                cycles += transition_sim_tick();
+                ticks ++;
+            }
+            /* the tick timer stops when the wheel is empty */
+            if (mesh_tick_timer_is_running())
+            {
+                cycles += transition_sim_tick();
+                ticks ++;
+                if (mesh_tick_timer_is_running())
+                {
+                    printf("n %u round %u: tick timer still running\n", num, round);
+                    transition_sim_errors ++;
+                }
+            }
+        }
+        plt_sim_stat_t stat;
+        plt_sim_stat_get(&stat);
+        printf("n %2u: %6u ticks, %6u step changes, %6.1f cycles/tick, %u heap allocs, %u errors\n",
+               num, ticks, transition_sim_steps, (double)cycles / ticks, stat.mem_alloc_count,
+               transition_sim_errors - errors);
+    }
+
+    printf("%s\n", transition_sim_errors ? "FAIL" : "PASS");
+    return transition_sim_errors ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -32,6 +32,7 @@ BEGIN_DECLS
 
 #define AIS_SERVER_TIMEOUT_MSG                          116
 #define AIS_SERVER_ADV_PERIOD                           5000
+#define AIS_OTA_STAGE_SIZE                              1024 //!< ota data programmed at once, divides the flash sector
 
 ///@cond
 /** @brief  Index of each characteristic in service database. */
@@ -43,6 +43,8 @@
 static const uint8_t ais_read[] = {0x12, 0x34, 0x56, 0x78, 0x90, 0xab, 0xcd, 0xef};
 #endif
 
+#define AIS_OTA_CRC16_INIT                      0xffff
+
 static const uint16_t ais_image_id[AIS_IMAGE_TYPE_MAX] = {AppPatch, RomPatch};
 struct
 {
@@ -55,8 +57,10 @@ struct
         uint32_t image_size;
         uint32_t image_ver;
         uint32_t rx_size;
-        uint8_t frame_remainder_len;
-        uint8_t frame_remainder[4];
+        uint32_t stage_offset; //!< image offset of the staged data, data before it is programmed
+        uint16_t stage_len;
+        uint16_t stage_crc16; //!< crc of the programmed data
+        uint8_t *pstage;
     } ota;
     plt_timer_t timer;
 } ais_server_ctx;
@@ -394,13 +398,67 @@ uint32_t ais_server_get_image_ver(ais_image_type_t image_type)
     return ver;
 }
 
+/**
+ * @brief update crc16 ccitt of the ota image
+ */
+static uint16_t ais_server_ota_crc16(uint16_t crc, const uint8_t *pdata, uint32_t len)
+{
+    for (uint32_t i = 0; i < len; ++i)
+    {
+        crc = (uint8_t)(crc >> 8) | (crc << 8);
+        crc ^= pdata[i];
+        crc ^= (uint8_t)(crc & 0xff) >> 4;
+        crc ^= (crc << 8) << 4;
+        crc ^= ((crc & 0xff) << 4) << 1;
+    }
+
+    return crc;
+}
+
+/**
+ * @brief program the staged ota data
+ * @retval TRUE: programmed or nothing staged
+ * @retval FALSE: program fail, the staged data is dropped
+ */
+static bool ais_server_ota_flush(void)
+{
+    if (0 == ais_server_ctx.ota.stage_len)
+    {
+        return TRUE;
+    }
+
+    /* crc covers the data as received, sil_dfu_update marks the image header not ready */
+    uint16_t crc = ais_server_ota_crc16(ais_server_ctx.ota.stage_crc16, ais_server_ctx.ota.pstage,
+                                        ais_server_ctx.ota.stage_len);
+    /* sil_dfu_update programs whole words, pad the image tail with erased flash bytes */
+    uint16_t program_len = (ais_server_ctx.ota.stage_len + 3) & ~0x3;
+    memset(ais_server_ctx.ota.pstage + ais_server_ctx.ota.stage_len, 0xff,
+           program_len - ais_server_ctx.ota.stage_len);
+    unlock_flash_all();
+    uint32_t result = sil_dfu_update(ais_server_ctx.ota.image_id, ais_server_ctx.ota.stage_offset,
+                                     program_len, (uint32_t *)ais_server_ctx.ota.pstage);
+    lock_flash();
+    if (0 != result)
+    {
+        printe("ais_server_ota_flush: fail, offset %d, len %d, result %d", ais_server_ctx.ota.stage_offset,
+               ais_server_ctx.ota.stage_len, result);
+        ais_server_ctx.ota.stage_len = 0;
+        return FALSE;
+    }
+
+    ais_server_ctx.ota.stage_crc16 = crc;
+    ais_server_ctx.ota.stage_offset += ais_server_ctx.ota.stage_len;
+    ais_server_ctx.ota.stage_len = 0;
+    return TRUE;
+}
+
 void ais_server_handle_msg(uint8_t conn_id, ais_pdu_t *pmsg, uint16_t len)
 {
     bool ret =  false;
     ais_pdu_t resp;
-    printi("ais_server_handle_msg: image id 0x%04x, size %d/%d, remain %d, expected frame seq %d, conn_id %d, cmd 0x%x, len %d, pmsg =",
+    printi("ais_server_handle_msg: image id 0x%04x, size %d/%d, staged %d, expected frame seq %d, conn_id %d, cmd 0x%x, len %d, pmsg =",
            ais_server_ctx.ota.image_id, ais_server_ctx.ota.rx_size, ais_server_ctx.ota.image_size,
-           ais_server_ctx.ota.frame_remainder_len, ais_server_ctx.ota.frame_seq, conn_id, pmsg->header.cmd,
+           ais_server_ctx.ota.stage_len, ais_server_ctx.ota.frame_seq, conn_id, pmsg->header.cmd,
            len);
     dprinti((uint8_t *)pmsg, len);
     switch (pmsg->header.cmd)
@@ -420,12 +478,18 @@ void ais_server_handle_msg(uint8_t conn_id, ais_pdu_t *pmsg, uint16_t len)
         {
             ret = true;
             if (pmsg->ota_upd_req.ver <= ais_server_get_image_ver(pmsg->ota_upd_req.image_type) ||
-                OTA_TMP_SIZE < pmsg->ota_upd_req.fw_size || 0 == pmsg->ota_upd_req.fw_size
-                || (pmsg->ota_upd_req.fw_size & 0x3) != 0)
+                OTA_TMP_SIZE < pmsg->ota_upd_req.fw_size || 0 == pmsg->ota_upd_req.fw_size)
             {
                 resp.ota_upd_resp.state = 0;
                 resp.ota_upd_resp.rx_size = 0;
             }
+            else if ((NULL == ais_server_ctx.ota.pstage) &&
+                     (NULL == (ais_server_ctx.ota.pstage = plt_malloc(AIS_OTA_STAGE_SIZE, RAM_TYPE_DATA_ON))))
+            {
+                printe("ais_server_handle_msg: fail to allocate ota stage buffer");
+                resp.ota_upd_resp.state = 0;
+                resp.ota_upd_resp.rx_size = 0;
+            }
             else
             {
                 if (pmsg->ota_upd_req.ota_type == AIS_OTA_TYPE_FULL)
@@ -449,7 +513,9 @@ void ais_server_handle_msg(uint8_t conn_id, ais_pdu_t *pmsg, uint16_t len)
                     ais_server_ctx.ota.image_size = pmsg->ota_upd_req.fw_size;
                     ais_server_ctx.ota.crc16 = pmsg->ota_upd_req.crc16;
                     ais_server_ctx.ota.image_ver = pmsg->ota_upd_req.ver;
-                    ais_server_ctx.ota.frame_remainder_len = 0;
+                    ais_server_ctx.ota.stage_offset = 0;
+                    ais_server_ctx.ota.stage_len = 0;
+                    ais_server_ctx.ota.stage_crc16 = AIS_OTA_CRC16_INIT;
                 }
                 ais_server_ctx.ota.frame_seq = 0;
                 ais_server_ctx.ota.frame_num = 0;
@@ -473,16 +539,32 @@ void ais_server_handle_msg(uint8_t conn_id, ais_pdu_t *pmsg, uint16_t len)
             resp.ota_fw_info.state = 0;
             if (pmsg->ota_fw_info_req.state == 1)
             {
-                // TODO: calculate the fw crc first
-                if (ais_server_ctx.ota.image_size == ais_server_ctx.ota.rx_size)
+                if ((ais_server_ctx.ota.image_size == ais_server_ctx.ota.rx_size) &&
+                    ais_server_ota_flush())
                 {
                     unlock_flash_all();
-                    flash_lock(FLASH_LOCK_USER_MODE_READ);
-                    resp.ota_fw_info.state = dfu_check_checksum(ais_server_ctx.ota.image_id);
-                    flash_unlock(FLASH_LOCK_USER_MODE_READ);
+                    if (ais_server_ctx.ota.stage_crc16 == ais_server_ctx.ota.crc16)
+                    {
+                        /* every word has been verified when programmed, no need to read back */
+                        resp.ota_fw_info.state = (0 == sil_dfu_set_ready(ais_server_ctx.ota.image_id));
+                    }
+                    else
+                    {
+                        printw("ais_server_handle_msg: image crc 0x%04x, expected 0x%04x, check flash",
+                               ais_server_ctx.ota.stage_crc16, ais_server_ctx.ota.crc16);
+                        flash_lock(FLASH_LOCK_USER_MODE_READ);
+                        resp.ota_fw_info.state = dfu_check_checksum(ais_server_ctx.ota.image_id);
+                        flash_unlock(FLASH_LOCK_USER_MODE_READ);
+                    }
                     lock_flash();
                 }
             }
+            if (NULL != ais_server_ctx.ota.pstage)
+            {
+                plt_free(ais_server_ctx.ota.pstage, RAM_TYPE_DATA_ON);
+                ais_server_ctx.ota.pstage = NULL;
+            }
+            ais_server_ctx.ota.rx_size = 0;
             ais_server_send_ota_msg(conn_id, &resp, sizeof(ais_header_t) + sizeof(ais_ota_fw_info_t));
             if (ais_server_app_cb)
             {
@@ -509,9 +591,13 @@ void ais_server_handle_msg(uint8_t conn_id, ais_pdu_t *pmsg, uint16_t len)
                 printw("ais_server_handle_msg: fail, frame len declared %d, rx %d", pmsg->header.frame_len,
                        len - sizeof(ais_header_t));
             }
+            else if ((NULL == ais_server_ctx.ota.pstage) ||
+                     (ais_server_ctx.ota.rx_size + pmsg->header.frame_len > ais_server_ctx.ota.image_size))
+            {
+                printw("ais_server_handle_msg: fail, frame out of image, rx %d", pmsg->header.frame_len);
+            }
             else
             {
-                uint8_t offset = 0;
                 uint8_t *payload = pmsg->payload;
                 uint16_t payload_len = pmsg->header.frame_len;
                 ais_server_ctx.ota.frame_seq = (pmsg->header.frame_seq + 1) % 16;
@@ -526,35 +612,36 @@ void ais_server_handle_msg(uint8_t conn_id, ais_pdu_t *pmsg, uint16_t len)
                     }
                 }
 
-                if (ais_server_ctx.ota.frame_remainder_len)
+                bool programmed = TRUE;
+                while (payload_len > 0)
                 {
-                    memcpy(ais_server_ctx.ota.frame_remainder + ais_server_ctx.ota.frame_remainder_len, pmsg->payload,
-                           4 - ais_server_ctx.ota.frame_remainder_len);
-                    unlock_flash_all();
-                    sil_dfu_update(ais_server_ctx.ota.image_id,
-                                   ais_server_ctx.ota.rx_size - ais_server_ctx.ota.frame_remainder_len, 4,
-                                   (uint32_t *)ais_server_ctx.ota.frame_remainder);
-                    lock_flash();
-                    offset = 4 - ais_server_ctx.ota.frame_remainder_len;
-                    payload += offset;
-                    payload_len -= MIN(payload_len, offset);
+                    /* stage up to the next stage boundary, so whole pages are programmed at once */
+                    uint16_t stage_size = AIS_OTA_STAGE_SIZE - ais_server_ctx.ota.stage_offset % AIS_OTA_STAGE_SIZE;
+                    uint16_t copy_len = MIN(payload_len, stage_size - ais_server_ctx.ota.stage_len);
+                    memcpy(ais_server_ctx.ota.pstage + ais_server_ctx.ota.stage_len, payload, copy_len);
+                    ais_server_ctx.ota.stage_len += copy_len;
+                    payload += copy_len;
+                    payload_len -= copy_len;
+                    if ((ais_server_ctx.ota.stage_len == stage_size) ||
+                        (ais_server_ctx.ota.stage_offset + ais_server_ctx.ota.stage_len ==
+                         ais_server_ctx.ota.image_size))
+                    {
+                        if (!ais_server_ota_flush())
+                        {
+                            programmed = FALSE;
+                            break;
+                        }
+                    }
                 }
-                ais_server_ctx.ota.frame_remainder_len = payload_len % 4;
-                payload_len = payload_len & 0xfffc;
-                if (payload_len)
+                if (!programmed)
                 {
-                    unlock_flash_all();
-                    sil_dfu_update(ais_server_ctx.ota.image_id, ais_server_ctx.ota.rx_size + offset, payload_len,
-                                   (uint32_t *)payload);
-                    lock_flash();
+                    /* report the programmed size, the data after it needs to be sent again */
+                    ais_server_ctx.ota.rx_size = ais_server_ctx.ota.stage_offset;
                 }
-
-                if (ais_server_ctx.ota.frame_remainder_len)
+                else
                 {
-                    memcpy(ais_server_ctx.ota.frame_remainder, payload + payload_len,
-                           ais_server_ctx.ota.frame_remainder_len);
+                    ais_server_ctx.ota.rx_size += pmsg->header.frame_len;
                 }
-                ais_server_ctx.ota.rx_size += pmsg->header.frame_len;
                 if (ais_server_app_cb)
                 {
                     ais_cb_msg_t cb_msg = {conn_id, AIS_CB_OTA, {.ota = {.state = AIS_OTA_GOING, .progress = ais_server_ctx.ota.rx_size * 100 / ais_server_ctx.ota.image_size}}};
@@ -60,6 +60,7 @@ uint16_t mBufSize;
 uint16_t mCrcVal;
 
 void silence_BufferCheckProc(uint16_t _mBufferSize, uint16_t _mCrc);
+void dfu_server_buffer_check(uint16_t _mBufferSize, uint16_t _mCrc);
 uint32_t dfu_update(uint16_t signature, uint32_t offset, uint32_t length, void *p_void);
 uint32_t dfu_flash_check_blank(uint16_t signature, uint32_t offset, uint16_t nSize);
 
@@ -240,6 +241,226 @@ void dfu_server_timer_stop(void)
     }
 }
 
+/* received buffer being programmed in the background */
+typedef struct
+{
+    uint8_t *pbuffer; //!< NULL if idle
+    uint32_t offset; //!< image offset of the buffer
+    uint16_t length;
+    uint16_t programmed;
+    uint8_t result; //!< result of the last programmed buffer
+    bool check_pending; //!< buffer crc report waits for the programming
+    bool posted; //!< program message is in the io queue
+} dfu_program_t;
+
+static dfu_program_t dfu_program = {.result = DFU_ARV_SUCCESS};
+static uint8_t *dfu_program_buffer; //!< the buffer not receiving, NULL if not allocated
+
+static bool dfu_server_program_post(void)
+{
+    uint8_t event = EVENT_IO_TO_APP;
+    T_IO_MSG msg;
+    msg.type = DFU_SERVER_PROGRAM_MSG;
+    if (dfu_program.posted)
+    {
+        return TRUE;
+    }
+    if (os_msg_send(io_queue_handle, &msg, 0) == false)
+    {
+        return FALSE;
+    }
+    else if (os_msg_send(evt_queue_handle, &event, 0) == false)
+    {
+        return FALSE;
+    }
+    dfu_program.posted = TRUE;
+
+    return TRUE;
+}
+
+/**
+ * @brief program one chunk of the buffer
+ */
+static void dfu_server_program_chunk(void)
+{
+    uint16_t length = MIN(dfu_program.length - dfu_program.programmed, DFU_PROGRAM_CHUNK_SIZE);
+    unlock_flash_all();
+    uint32_t result = sil_dfu_update(dfu_ctx.signature, dfu_program.offset + dfu_program.programmed,
+                                     length, (uint32_t *)(dfu_program.pbuffer + dfu_program.programmed));
+    lock_flash();
+    dfu_program.programmed += length;
+    if (0 != result)
+    {
+        DFU_PRINT_ERROR2("dfu_server_program_chunk: offset 0x%x fail %d",
+                         dfu_program.offset + dfu_program.programmed - length, result);
+        dfu_program.pbuffer = NULL;
+        dfu_program.result = DFU_ARV_FAIL_PROG_ERROR;
+        if (!gSilBufCheckEN)
+        {
+            /*eflash write fail, we should restart ota procedure.*/
+            dfu_reset(dfu_ctx.signature);
+            dfu_fw_active_reset();
+        }
+    }
+    else if (dfu_program.programmed == dfu_program.length)
+    {
+        dfu_program.pbuffer = NULL;
+        dfu_program.result = DFU_ARV_SUCCESS;
+        if ((dfu_program.offset + dfu_program.length - gSilDfuResendOffset) >= SECTOR_SIZE)
+        {
+            gSilDfuResendOffset += SECTOR_SIZE;
+        }
+    }
+}
+
+/**
+ * @brief program the rest of the buffer now
+ */
+static void dfu_server_program_flush(void)
+{
+    while (NULL != dfu_program.pbuffer)
+    {
+        dfu_server_program_chunk();
+    }
+}
+
+/**
+ * @brief drop the buffer being programmed
+ */
+static void dfu_server_program_abort(void)
+{
+    dfu_program.pbuffer = NULL;
+    dfu_program.check_pending = FALSE;
+    dfu_program.result = DFU_ARV_SUCCESS;
+}
+
+/**
+ * @brief acknowledge the received buffer and program it, in the background if there is a
+ *        spare buffer to receive the next one
+ */
+static void dfu_server_program_start(void)
+{
+    dfu_program.pbuffer = g_pOtaTempBufferHead;
+    dfu_program.offset = dfu_ctx.curr_offset;
+    dfu_program.length = ota_tmp_buf_used_size;
+    dfu_program.programmed = 0;
+    dfu_ctx.curr_offset += ota_tmp_buf_used_size;
+    ota_tmp_buf_used_size = 0;
+
+    if (NULL != dfu_program_buffer)
+    {
+        g_pOtaTempBufferHead = dfu_program_buffer;
+        dfu_program_buffer = dfu_program.pbuffer;
+        if (dfu_server_program_post())
+        {
+            return;
+        }
+    }
+    dfu_server_program_flush();
+}
+
+void dfu_server_program(void)
+{
+    dfu_program.posted = FALSE;
+    if (NULL == dfu_program.pbuffer)
+    {
+        /* aborted */
+        return;
+    }
+
+    dfu_server_program_chunk();
+    if (NULL != dfu_program.pbuffer)
+    {
+        if (!dfu_server_program_post())
+        {
+            dfu_server_program_flush();
+        }
+        else
+        {
+            return;
+        }
+    }
+
+    if (dfu_program.check_pending)
+    {
+        dfu_program.check_pending = FALSE;
+        dfu_server_buffer_check(mBufSize, mCrcVal);
+    }
+}
+
+/**
+ * @brief erase the sectors written since the resend offset and ask the client to resend
+ */
+static void dfu_server_program_recover(void)
+{
+    uint8_t notif_data[7] = {0};
+    uint32_t ret = 0;
+    uint32_t cnt = 0;
+    notif_data[0] = DFU_OPCODE_NOTIF;
+    notif_data[1] = DFU_OPCODE_REPORT_BUFFER_CRC;
+    notif_data[2] = DFU_ARV_FAIL_PROG_ERROR;
+    dfu_ctx.curr_offset = dfu_program.offset;
+    dfu_program.result = DFU_ARV_SUCCESS;
+    ota_tmp_buf_used_size = 0;
+
+    unlock_flash_all();
+    do
+    {
+        dfu_flash_erase(dfu_ctx.signature, gSilDfuResendOffset);
+        //delay_ms_asm(200);
+        signal = os_lock();
+        ret = dfu_flash_check_blank(dfu_ctx.signature, gSilDfuResendOffset, SECTOR_SIZE);
+        os_unlock(signal);
+        if (ret)
+        {
+            cnt++;
+        }
+        else
+        {
+            break;
+        }
+        if (cnt >= 3)     //check 0xff failed,erase failed
+        {
+            notif_data[2] = DFU_ARV_FAIL_ERASE_ERROR;
+            break;
+        }
+    }
+    while (1);
+
+    if ((DFU_ARV_FAIL_PROG_ERROR == notif_data[2]) &&
+        ((dfu_ctx.curr_offset - gSilDfuResendOffset) > SECTOR_SIZE)) //need erase two sector
+    {
+        cnt = 0;
+        do
+        {
+            //erase sector :addr ~ gDfuResendOffset+SECTOR_SIZE;
+            dfu_flash_erase(dfu_ctx.signature, gSilDfuResendOffset + SECTOR_SIZE);
+            signal = os_lock();
+            ret = dfu_flash_check_blank(dfu_ctx.signature, gSilDfuResendOffset + SECTOR_SIZE, SECTOR_SIZE);
+            os_unlock(signal);
+            if (ret)
+            {
+                cnt++;
+            }
+            else
+            {
+                break;
+            }
+            if (cnt >= 3)     //check 0xff failed,erase failed
+            {
+                notif_data[2] = DFU_ARV_FAIL_ERASE_ERROR;
+                break;
+            }
+        }
+        while (1);
+    }
+    lock_flash();
+    dfu_ctx.curr_offset =  gSilDfuResendOffset;
+    LE_UINT32_TO_ARRAY(&notif_data[3], dfu_ctx.curr_offset);
+    server_send_data(0, dfu_server_id, INDEX_DFU_CONTROL_POINT_CHAR_VALUE, \
+                     notif_data, 7, GATT_PDU_TYPE_NOTIFICATION);
+}
+
 /**
  * @brief dfu_server_buffer_check
  *
@@ -254,6 +475,21 @@ void dfu_server_buffer_check(uint16_t _mBufferSize, uint16_t _mCrc)
     notif_data[0] = DFU_OPCODE_NOTIF;
     notif_data[1] = DFU_OPCODE_REPORT_BUFFER_CRC;
 
+    if (NULL != dfu_program.pbuffer)
+    {
+        /* hold the notification until the previous buffer is programmed, so the client is at
+         * most one buffer ahead of the flash */
+        dfu_program.check_pending = TRUE;
+        return;
+    }
+
+    if (DFU_ARV_SUCCESS != dfu_program.result)
+    {
+        /* the previous buffer failed after being acknowledged, drop this one and resend */
+        dfu_server_program_recover();
+        return;
+    }
+
     if (mBufSize > DFU_TEMP_BUFFER_SIZE)
     {
         //invalid para
@@ -300,102 +536,21 @@ void dfu_server_buffer_check(uint16_t _mBufferSize, uint16_t _mCrc)
             }
 
             DFU_PRINT_TRACE1(" p_dfu->cur_offset, %x", dfu_ctx.curr_offset);
-            unlock_flash_all();
-            uint32_t result = sil_dfu_update(dfu_ctx.signature, dfu_ctx.curr_offset, ota_tmp_buf_used_size,
-                                             (uint32_t *)g_pOtaTempBufferHead);
-
-            if (result == 0)
+            dfu_server_program_start();
+            if (DFU_ARV_SUCCESS != dfu_program.result)
             {
-                lock_flash();
-                dfu_ctx.curr_offset += ota_tmp_buf_used_size;
-
-                if ((dfu_ctx.curr_offset - gSilDfuResendOffset) >= SECTOR_SIZE)
-                {
-                    gSilDfuResendOffset += SECTOR_SIZE;
-                }
-                ota_tmp_buf_used_size = 0;
-                notif_data[2] = DFU_ARV_SUCCESS; //valid
-                LE_UINT32_TO_ARRAY(&notif_data[3], dfu_ctx.curr_offset);
-                server_send_data(0, dfu_server_id, INDEX_DFU_CONTROL_POINT_CHAR_VALUE, \
-                                 notif_data, 7, GATT_PDU_TYPE_NOTIFICATION);
+                /* programmed in place and failed */
+                dfu_server_program_recover();
                 return;
             }
-            else
-            {
-                uint32_t ret = 0;
-                uint32_t cnt = 0;
-                do
-                {
-                    dfu_flash_erase(dfu_ctx.signature, gSilDfuResendOffset);
-                    //delay_ms_asm(200);
-                    signal = os_lock();
-                    ret = dfu_flash_check_blank(dfu_ctx.signature, gSilDfuResendOffset, SECTOR_SIZE);
-                    os_unlock(signal);
-                    if (ret)
-                    {
-                        cnt++;
-                    }
-                    else
-                    {
-                        break;
-                    }
-                    if (cnt >= 3)     //check 0xff failed,erase failed
-                    {
-                        lock_flash();
-                        //erase error
-                        ota_tmp_buf_used_size = 0;
-                        dfu_ctx.curr_offset =  gSilDfuResendOffset;
-                        notif_data[2] = DFU_ARV_FAIL_ERASE_ERROR;
-                        LE_UINT32_TO_ARRAY(&notif_data[3], dfu_ctx.curr_offset);
-                        server_send_data(0, dfu_server_id, INDEX_DFU_CONTROL_POINT_CHAR_VALUE, \
-                                         notif_data, 7, GATT_PDU_TYPE_NOTIFICATION);
-                        return;
-                    }
-                }
-                while (1);
 
-                if ((dfu_ctx.curr_offset - gSilDfuResendOffset) > SECTOR_SIZE) //need erase two sector
-                {
-                    cnt = 0;
-                    do
-                    {
-                        //erase sector :addr ~ gDfuResendOffset+SECTOR_SIZE;
-                        dfu_flash_erase(dfu_ctx.signature, gSilDfuResendOffset + SECTOR_SIZE);
-                        signal = os_lock();
-                        ret = dfu_flash_check_blank(dfu_ctx.signature, gSilDfuResendOffset + SECTOR_SIZE, SECTOR_SIZE);
-                        os_unlock(signal);
-                        if (ret)
-                        {
-                            cnt++;
-                        }
-                        else
-                        {
-                            break;
-                        }
-                        if (cnt >= 3)     //check 0xff failed,erase failed
-                        {
-                            lock_flash();
-                            //erase error
-                            ota_tmp_buf_used_size = 0;
-                            dfu_ctx.curr_offset =  gSilDfuResendOffset;
-                            notif_data[2] = DFU_ARV_FAIL_ERASE_ERROR;
-                            LE_UINT32_TO_ARRAY(&notif_data[3], dfu_ctx.curr_offset);
-                            server_send_data(0, dfu_server_id, INDEX_DFU_CONTROL_POINT_CHAR_VALUE, \
-                                             notif_data, 7, GATT_PDU_TYPE_NOTIFICATION);
-                            return;
-                        }
-                    }
-                    while (1);
-                }
-                lock_flash();
-                ota_tmp_buf_used_size = 0;
-                dfu_ctx.curr_offset =  gSilDfuResendOffset;
-                notif_data[2] = DFU_ARV_FAIL_PROG_ERROR;
-                LE_UINT32_TO_ARRAY(&notif_data[3], dfu_ctx.curr_offset);
-                server_send_data(0, dfu_server_id, INDEX_DFU_CONTROL_POINT_CHAR_VALUE, \
-                                 notif_data, 7, GATT_PDU_TYPE_NOTIFICATION);
-                return;
-            }
+            /* acknowledge before the buffer is programmed, the client sends the next buffer
+             * meanwhile and its crc report is held until the programming is done */
+            notif_data[2] = DFU_ARV_SUCCESS; //valid
+            LE_UINT32_TO_ARRAY(&notif_data[3], dfu_ctx.curr_offset);
+            server_send_data(0, dfu_server_id, INDEX_DFU_CONTROL_POINT_CHAR_VALUE, \
+                             notif_data, 7, GATT_PDU_TYPE_NOTIFICATION);
+            return;
         }
     }
     else
@@ -450,6 +605,7 @@ void  dfu_server_handle_cp(uint16_t length, uint8_t *p_value)
             }
 #endif
 
+            dfu_server_program_abort();
             if (OTP->ota_with_encryption_data)
             {
                 //DFU_PRINT_TRACE1("Data before decryped: %b", TRACE_BINARY(16, p));
@@ -526,6 +682,7 @@ void  dfu_server_handle_cp(uint16_t length, uint8_t *p_value)
     case DFU_OPCODE_RECEIVE_FW_IMAGE_INFO:
         if (length == DFU_LENGTH_RECEIVE_FW_IMAGE_INFO)
         {
+            dfu_server_program_flush();
             LE_ARRAY_TO_UINT16(dfu_ctx.signature, p);
             p += 2;
             LE_ARRAY_TO_UINT32(dfu_ctx.curr_offset, p);
@@ -546,6 +703,8 @@ void  dfu_server_handle_cp(uint16_t length, uint8_t *p_value)
         if (length == DFU_LENGTH_VALID_FW)
         {
             bool check_result;
+            dfu_server_program_flush();
+            dfu_program.result = DFU_ARV_SUCCESS;
             LE_ARRAY_TO_UINT16(dfu_ctx.signature, p);
             DFU_PRINT_TRACE1("DFU_OPCODE_VALID_FW: signature = 0x%x", dfu_ctx.signature);
             unlock_flash_all();
@@ -582,6 +741,7 @@ void  dfu_server_handle_cp(uint16_t length, uint8_t *p_value)
         {
             /*notify bootloader to reset and use new image*/
             DFU_PRINT_TRACE0("DFU_OPCODE_ACTIVE_IMAGE_RESET:");
+            dfu_server_program_flush();
             os_delay(20);
             le_disconnect(0);
             if (pfnDfuExtendedCB)
@@ -598,6 +758,13 @@ void  dfu_server_handle_cp(uint16_t length, uint8_t *p_value)
         break;
     case DFU_OPCODE_SYSTEM_RESET:
         DFU_PRINT_ERROR0("DFU_OPCODE_SYSTEM_RESET");
+        if (pfnDfuExtendedCB)
+        {
+            /* let the app write its pending data before the reset */
+            dfu_cb_msg_t cb_msg;
+            cb_msg.type = DFU_CB_RESET;
+            pfnDfuExtendedCB(dfu_server_id, &cb_msg);
+        }
         DBG_DIRECT("dfu reboot!");
         WDG_SystemReset(RESET_ALL, DFU_SYSTEM_RESET);
         break;
@@ -608,6 +775,7 @@ void  dfu_server_handle_cp(uint16_t length, uint8_t *p_value)
             //dfu_report_target_fw_info(dfu_ctx.signature, &dfu_ctx.origin_image_version,
             //                          (uint32_t *)&dfu_ctx.curr_offset);
             dfu_ctx.origin_image_version = dfu_ctx.signature == AppPatch ? DFU_APP_VERSION : DFU_PATCH_VERSION;
+            dfu_server_program_abort();
             dfu_ctx.curr_offset = 0; //< mesh don't support ota resuming
             ota_tmp_buf_used_size = 0;
             notif_data[0] = DFU_OPCODE_NOTIFICATION;
@@ -781,21 +949,9 @@ void dfu_server_handle_data(uint16_t length, uint8_t *p_value)
             if (left_length == 0 || ota_tmp_buf_used_size == DFU_TEMP_BUFFER_SIZE ||
                 ota_tmp_buf_used_size + MIN(left_length, length) > DFU_TEMP_BUFFER_SIZE)
             {
-                unlock_flash_all();
-                if (sil_dfu_update(dfu_ctx.signature, dfu_ctx.curr_offset, ota_tmp_buf_used_size,
-                                   (uint32_t *)g_pOtaTempBufferHead) == 0)
-                {
-                    lock_flash();
-                }
-                else
-                {
-                    lock_flash();
-                    /*eflash write fail, we should restart ota procedure.*/
-                    dfu_reset(dfu_ctx.signature);
-                    dfu_fw_active_reset();
-                }
-                dfu_ctx.curr_offset += ota_tmp_buf_used_size;
-                ota_tmp_buf_used_size = 0;
+                /* only one buffer is programmed at a time */
+                dfu_server_program_flush();
+                dfu_server_program_start();
             }
         } //if(gBufCheckEN == true)
         data_uart_debug("\b\b\b\b%3d%%",
@@ -860,6 +1016,15 @@ void dfu_cccd_update_cb(uint8_t conn_id, T_SERVER_ID service_id, uint16_t index,
                 {
                     g_pOtaTempBufferHead = plt_malloc(DFU_TEMP_BUFFER_SIZE, RAM_TYPE_DATA_ON);
                 }
+                if (NULL == dfu_program_buffer)
+                {
+                    /* receive the next buffer while this one is programmed */
+                    dfu_program_buffer = plt_malloc(DFU_TEMP_BUFFER_SIZE, RAM_TYPE_DATA_ON);
+                    if (NULL == dfu_program_buffer)
+                    {
+                        printw("dfu_cccd_update_cb: no spare buffer, program in place");
+                    }
+                }
             }
             else
             {
@@ -884,11 +1049,17 @@ void dfu_server_disconnect_cb(uint8_t conn_id)
         dfu_server_conn_id = DFU_SERVER_INVALID_CONN_ID;
     }
 
+    dfu_server_program_abort();
     if (NULL != g_pOtaTempBufferHead)
     {
         plt_free(g_pOtaTempBufferHead, RAM_TYPE_DATA_ON);
         g_pOtaTempBufferHead = NULL;
     }
+    if (NULL != dfu_program_buffer)
+    {
+        plt_free(dfu_program_buffer, RAM_TYPE_DATA_ON);
+        dfu_program_buffer = NULL;
+    }
 #if DFU_WO_SCAN
     if (dfu_ctx.bg_scan)
     {
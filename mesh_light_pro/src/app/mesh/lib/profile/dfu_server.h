@@ -37,6 +37,8 @@ BEGIN_DECLS
 #define DFU_TEMP_BUFFER_SIZE            2048
 #define DFU_SERVER_ADV_PERIOD           5000//!< ms
 #define DFU_SERVER_TIMEOUT_MSG          110
+#define DFU_SERVER_PROGRAM_MSG          111 //!< io message to program the next chunk of the received buffer
+#define DFU_PROGRAM_CHUNK_SIZE          512 //!< bytes programmed per io message, multiple of 4
 #define DFU_WO_SCAN                     1
 
 //00006287-3c17-d293-8e48-14fe2e4da212
@@ -223,7 +225,8 @@ typedef enum
     DFU_CB_NONE,
     DFU_CB_START,
     DFU_CB_END,
-    DFU_CB_FAIL
+    DFU_CB_FAIL,
+    DFU_CB_RESET //!< system reset requested, the node reboots right after the callback
 } dfu_cb_type_t;
 
 typedef union
@@ -304,6 +307,14 @@ void dfu_server_adv_send(void);
   */
 void dfu_server_disconnect_cb(uint8_t conn_id);
 
+/**
+  * @brief program the next chunk of the received image buffer
+  * @note call it when DFU_SERVER_PROGRAM_MSG is received, the flash is programmed in chunks
+  *       while the next buffer is received
+  * @return none
+  */
+void dfu_server_program(void);
+
 /** @} */
 /** @} */
 
@@ -0,0 +1,47 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     crc32.h
+  * @brief    Head file for crc32.
+  * @details  Ieee 802.3 crc32, reflected polynomial 0xEDB88320, as zlib and the object transfer
+  *           block checksum use.
+  * @author   bill
+  * @date     2018-12-20
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion */
+#ifndef _CRC32_H_
+#define _CRC32_H_
+
+#include "platform_types.h"
+
+BEGIN_DECLS
+
+/**
+ * @addtogroup CRC32
+ * @{
+ */
+
+/**
+ * @defgroup Crc32_Exported_Functions Crc32 Exported Functions
+ * @brief
+ * @{
+ */
+/**
+ * @brief update crc32 with data
+ * @param[in] crc: 0 to start, or the value returned by the previous call to continue
+ * @param[in] pdata: data
+ * @param[in] len: data length
+ * @return crc32 of all the data so far
+ * @note table driven, four bytes per step, the tables take 4K bytes of flash
+ */
+uint32_t crc32_update(uint32_t crc, const uint8_t *pdata, uint32_t len);
+/** @} */
+/** @} */
+
+END_DECLS
+
+#endif /* _CRC32_H_ */
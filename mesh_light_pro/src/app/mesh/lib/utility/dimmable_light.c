@@ -16,24 +16,105 @@
 #include "rtl876x_rcc.h"
 #include "rtl876x_pinmux.h"
 #include "rtl876x_tim.h"
+#include "rtl876x_nvic.h"
 #include "ftl.h"
+#include "otp_config.h"
+#include "flash_device.h"
+#include "flash_map.h"
 #include "light_config.h"
+#include "dimming_curve.h"
 #if MESH_ALI_CERTIFICATION
 #include "light_effect_app.h"
 #endif
 
+#if (FTL_APP_CALLBACK_ENABLE == 1)
+#include "ftl_app_cb.h"
+/* light state and scene are rewritten as a whole, keep each under one record key */
+#define light_ftl_save(pdata, offset, size)     ftl_record_save(pdata, offset, size)
+#define light_ftl_load(pdata, offset, size)     ftl_record_load(pdata, offset, size)
+#else
+#define light_ftl_save(pdata, offset, size)     ftl_save(pdata, offset, size)
+#define light_ftl_load(pdata, offset, size)     ftl_load(pdata, offset, size)
+#endif
+
 #define LED_PWM_FREQ        200 //!< Hz
 #define LED_PWM_COUNT       (40000000/LED_PWM_FREQ)
 
+#if (LIGHT_DIMMING_CURVE == DIMMING_CURVE_LINEAR)
+#define LIGHT_CURVE_Q16(x)          DIMMING_CURVE_LINEAR_Q16(x)
+#elif (LIGHT_DIMMING_CURVE == DIMMING_CURVE_SQUARE_LAW)
+#define LIGHT_CURVE_Q16(x)          DIMMING_CURVE_SQUARE_LAW_Q16(x)
+#elif (LIGHT_DIMMING_CURVE == DIMMING_CURVE_CIE1931)
+#define LIGHT_CURVE_Q16(x)          DIMMING_CURVE_CIE1931_Q16(x)
+#elif (LIGHT_DIMMING_CURVE == DIMMING_CURVE_CUSTOM)
+#define LIGHT_CURVE_Q16(x)          DIMMING_CURVE_CLAMP_Q16(DIMMING_CURVE_CUSTOM_Q16(x))
+#else
+#error "unknown LIGHT_DIMMING_CURVE"
+#endif
+#define LIGHT_CURVE_COUNT(x)        ((uint32_t)((uint64_t)LED_PWM_COUNT * LIGHT_CURVE_Q16(x) / 65535))
+
+/* pwm high count of every DIMMING_CURVE_STEP lightness, computed by the compiler */
+static const uint32_t light_curve_count[DIMMING_CURVE_POINTS] = {DIMMING_CURVE_TABLE(LIGHT_CURVE_COUNT)};
+
+#if LIGHT_HW_FADE
+#if (ROM_WATCH_DOG_ENABLE == 1)
+#error "LIGHT_HW_FADE and ROM_WATCH_DOG_ENABLE both use TIM7"
+#endif
+#define LIGHT_RAMP_NUM              5 //!< lights fading at the same time
+#define LIGHT_RAMP_TABLE_SIZE       32 //!< duty segments of one ramp
+#define LIGHT_RAMP_TIM              TIM7
+#define LIGHT_RAMP_TIM_IRQ          TIMER7_IRQ
+#define LIGHT_RAMP_TIM_HANDLER      Timer7_Handler
+
+typedef struct
+{
+    light_t *light;
+    uint16_t lightness_begin;
+    uint16_t lightness_end;
+    uint32_t period; //!< pwm periods elapsed
+    uint32_t periods; //!< pwm periods of the whole ramp
+    uint32_t table[LIGHT_RAMP_TABLE_SIZE + 1]; //!< high count at each segment boundary
+} light_ramp_t;
+
+static light_ramp_t light_ramps[LIGHT_RAMP_NUM];
+static uint8_t light_ramp_num;
+#endif
+
+/* power on counter, a 4K flash sector written by clearing bits. word 0 holds the magic, the
+ * other words hold 16 power on cycles each, bit 2n is cleared at the power on of cycle n and
+ * bit 2n + 1 when cycle n has stayed on for LIGHT_POWER_ON_TIME. the sector is erased only
+ * when all the cycles are used. */
+#define LIGHT_POWER_ON_SECTOR_SIZE          0x1000
+#define LIGHT_POWER_ON_MAGIC                0x4e4f5750 //!< "PWON"
+#define LIGHT_POWER_ON_WORD_NUM             (LIGHT_POWER_ON_SECTOR_SIZE / 4 - 1)
+#define LIGHT_POWER_ON_WORD_CYCLE_NUM       16
+#define LIGHT_POWER_ON_CYCLE_NUM            (LIGHT_POWER_ON_WORD_NUM * LIGHT_POWER_ON_WORD_CYCLE_NUM)
+#define LIGHT_POWER_ON_WORD_ON_BITS         0x55555555
+#define LIGHT_POWER_ON_WORD_ADDR(word)      (LIGHT_POWER_ON_COUNT_ADDR + 4 + (word) * 4)
+#define LIGHT_POWER_ON_ON_BIT(cycle)        (1UL << (((cycle) % LIGHT_POWER_ON_WORD_CYCLE_NUM) * 2))
+#define LIGHT_POWER_ON_STABLE_BIT(cycle)    (LIGHT_POWER_ON_ON_BIT(cycle) << 1)
+
+#if LIGHT_POWER_ON_COUNT >= LIGHT_POWER_ON_WORD_CYCLE_NUM
+#error "LIGHT_POWER_ON_COUNT shall be less than LIGHT_POWER_ON_WORD_CYCLE_NUM"
+#endif
+
+#if (LIGHT_POWER_ON_COUNT_ADDR < OTA_TMP_ADDR + OTA_TMP_SIZE) || \
+    (LIGHT_POWER_ON_COUNT_ADDR + LIGHT_POWER_ON_SECTOR_SIZE > FLASH_ADDR + FLASH_SIZE)
+#error "LIGHT_POWER_ON_COUNT_ADDR shall be a sector between ota tmp and the end of the flash"
+#endif
 
-static light_flash_power_on_count_t light_power_on_count;
+static bool light_power_on_scanned;
+static uint16_t light_power_on_cycle; //!< cycle of this power on
+static uint8_t light_power_on_count; //!< power on cycles shorter than LIGHT_POWER_ON_TIME before this one
 static plt_timer_t power_on_timer;
 
 void light_driver_init(void)
 {
     /* turn on timer clock */
     RCC_PeriphClockCmd(APBPeriph_TIMER, APBPeriph_TIMER_CLOCK, ENABLE);
+#if !PLATFORM_HOST_SIM
     *((volatile uint32_t *)0x40000360UL) &= ~(1 << 10);
+#endif
 }
 
 void light_pin_config(const light_t *light)
@@ -69,23 +150,37 @@ void light_pin_dlps_config(const light_t *light)
                PAD_OUT_LOW);
 }
 
-void light_lighten(light_t *light, uint16_t lightness)
+static uint32_t light_lightness_to_count(uint16_t lightness)
 {
-    uint32_t high_count;
     if (0xffff == lightness)
     {
-        high_count = LED_PWM_COUNT;
-    }
-    else
-    {
-        high_count = (LED_PWM_COUNT / 65535.0) * lightness;
+        return LIGHT_CURVE_COUNT(65535);
     }
 
+    uint32_t index = lightness >> DIMMING_CURVE_STEP_BITS;
+    uint32_t frac = lightness & (DIMMING_CURVE_STEP - 1);
+    return light_curve_count[index] + (((light_curve_count[index + 1] - light_curve_count[index]) *
+                                        frac) >> DIMMING_CURVE_STEP_BITS);
+}
+
+static void light_pwm_apply(const light_t *light, uint32_t high_count)
+{
 #if PIN_REVERSE
     TIM_PWMChangeFreqAndDuty(light->tim_id, high_count, LED_PWM_COUNT - high_count);
 #else
     TIM_PWMChangeFreqAndDuty(light->tim_id, LED_PWM_COUNT - high_count, high_count);
 #endif
+}
+
+void light_lighten(light_t *light, uint16_t lightness)
+{
+#if LIGHT_HW_FADE
+    if (light_ramp_num > 0)
+    {
+        light_ramp_stop(light);
+    }
+#endif
+    light_pwm_apply(light, light_lightness_to_count(lightness));
     light->lightness = lightness;
 }
 
@@ -103,6 +198,9 @@ void light_blink_infinite(light_t *light, uint32_t hz_numerator, uint32_t hz_den
         return;
     }
 
+#if LIGHT_HW_FADE
+    light_ramp_stop(light);
+#endif
     uint32_t high_count = (40000000 / 100) * hz_denominator / hz_numerator * duty;
     uint32_t low_count = (40000000 / 100) * hz_denominator / hz_numerator * (100 - duty);
 #if PIN_REVERSE
@@ -112,6 +210,167 @@ void light_blink_infinite(light_t *light, uint32_t hz_numerator, uint32_t hz_den
 #endif
 }
 
+#if LIGHT_HW_FADE
+static void light_ramp_timer_enable(bool enable)
+{
+    if (enable)
+    {
+        /* one interrupt every pwm period */
+        TIM_TimeBaseInitTypeDef TIM_InitStruct;
+        TIM_StructInit(&TIM_InitStruct);
+        TIM_InitStruct.TIM_PWM_En = PWM_DISABLE;
+        TIM_InitStruct.TIM_Period = LED_PWM_COUNT - 1;
+        TIM_InitStruct.TIM_Mode = TIM_Mode_UserDefine;
+        TIM_InitStruct.TIM_SOURCE_DIV = TIM_CLOCK_DIVIDER_1;
+        TIM_TimeBaseInit(LIGHT_RAMP_TIM, &TIM_InitStruct);
+
+        NVIC_InitTypeDef NVIC_InitStruct;
+        NVIC_InitStruct.NVIC_IRQChannel = LIGHT_RAMP_TIM_IRQ;
+        NVIC_InitStruct.NVIC_IRQChannelPriority = 3;
+        NVIC_InitStruct.NVIC_IRQChannelCmd = ENABLE;
+        NVIC_Init(&NVIC_InitStruct);
+
+#if !PLATFORM_HOST_SIM
+        TIM_ClearINT(LIGHT_RAMP_TIM);
+#endif
+        TIM_INTConfig(LIGHT_RAMP_TIM, ENABLE);
+        TIM_Cmd(LIGHT_RAMP_TIM, ENABLE);
+    }
+    else
+    {
+        TIM_Cmd(LIGHT_RAMP_TIM, DISABLE);
+        TIM_INTConfig(LIGHT_RAMP_TIM, DISABLE);
+    }
+}
+
+static light_ramp_t *light_ramp_find(const light_t *light)
+{
+    for (uint8_t i = 0; i < LIGHT_RAMP_NUM; ++i)
+    {
+        if (light == light_ramps[i].light)
+        {
+            return &light_ramps[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief release ramp, must be called with interrupt locked
+ */
+static void light_ramp_release(light_ramp_t *ramp)
+{
+    ramp->light = NULL;
+    light_ramp_num --;
+    if (0 == light_ramp_num)
+    {
+        light_ramp_timer_enable(FALSE);
+    }
+}
+
+void LIGHT_RAMP_TIM_HANDLER(void)
+{
+#if !PLATFORM_HOST_SIM
+    TIM_ClearINT(LIGHT_RAMP_TIM);
+#endif
+    for (uint8_t i = 0; i < LIGHT_RAMP_NUM; ++i)
+    {
+        light_ramp_t *ramp = &light_ramps[i];
+        if (NULL == ramp->light)
+        {
+            continue;
+        }
+
+        ramp->period ++;
+        if (ramp->period >= ramp->periods)
+        {
+            light_pwm_apply(ramp->light, ramp->table[LIGHT_RAMP_TABLE_SIZE]);
+            ramp->light->lightness = ramp->lightness_end;
+            light_ramp_release(ramp);
+            continue;
+        }
+
+        /* interpolate between the two table entries around current period */
+        uint32_t pos = ramp->period * LIGHT_RAMP_TABLE_SIZE;
+        uint32_t index = pos / ramp->periods;
+        uint32_t frac = pos % ramp->periods;
+        int32_t delta = (int32_t)(ramp->table[index + 1] - ramp->table[index]);
+        uint32_t high_count = ramp->table[index] + (int32_t)((int64_t)delta * frac / ramp->periods);
+        light_pwm_apply(ramp->light, high_count);
+        ramp->light->lightness = ramp->lightness_begin + (int32_t)((int64_t)(ramp->lightness_end -
+                                                                           ramp->lightness_begin) * ramp->period / ramp->periods);
+    }
+}
+#endif
+
+bool light_ramp_start(light_t *light, uint16_t lightness, uint32_t time)
+{
+#if LIGHT_HW_FADE
+    uint32_t periods = time * LED_PWM_FREQ / 1000;
+    if (0 == periods)
+    {
+        return FALSE;
+    }
+
+    uint32_t s = plt_critical_enter();
+    light_ramp_t *ramp = light_ramp_find(light);
+    if (NULL == ramp)
+    {
+        ramp = light_ramp_find(NULL);
+        if (NULL == ramp)
+        {
+            plt_critical_exit(s);
+            return FALSE;
+        }
+        light_ramp_num ++;
+    }
+    /* keep the slot while building the table, the isr skips it */
+    ramp->light = NULL;
+    plt_critical_exit(s);
+
+    ramp->lightness_begin = light->lightness;
+    ramp->lightness_end = lightness;
+    ramp->period = 0;
+    ramp->periods = periods;
+    int32_t lightness_delta = (int32_t)lightness - (int32_t)light->lightness;
+    for (uint32_t i = 0; i <= LIGHT_RAMP_TABLE_SIZE; ++i)
+    {
+        ramp->table[i] = light_lightness_to_count(light->lightness + lightness_delta *
+                                                  (int32_t)i / LIGHT_RAMP_TABLE_SIZE);
+    }
+
+    s = plt_critical_enter();
+    ramp->light = light;
+    if (1 == light_ramp_num)
+    {
+        light_ramp_timer_enable(TRUE);
+    }
+    plt_critical_exit(s);
+    return TRUE;
+#else
+    UNUSED(light);
+    UNUSED(lightness);
+    UNUSED(time);
+    return FALSE;
+#endif
+}
+
+void light_ramp_stop(light_t *light)
+{
+#if LIGHT_HW_FADE
+    uint32_t s = plt_critical_enter();
+    light_ramp_t *ramp = light_ramp_find(light);
+    if (NULL != ramp)
+    {
+        light_ramp_release(ramp);
+    }
+    plt_critical_exit(s);
+#else
+    UNUSED(light);
+#endif
+}
+
 bool light_flash_write(light_flash_param_type_t type, uint16_t len, void *pdata)
 {
     uint32_t ret = 0;
@@ -126,9 +385,8 @@ bool light_flash_write(light_flash_param_type_t type, uint16_t len, void *pdata)
         break;
     case LIGHT_FLASH_PARAM_TYPE_LIGHT_STATE:
         {
-            ret = ftl_save(pdata, LIGHT_FLASH_PARAMS_APP_OFFSET + MEMBER_OFFSET(light_flash_param_t,
-                                                                                light_state),
-                           len);
+            ret = light_ftl_save(pdata, LIGHT_FLASH_PARAMS_APP_OFFSET + MEMBER_OFFSET(light_flash_param_t,
+                                 light_state), len);
         }
         break;
     case LIGHT_FLASH_PARAM_TYPE_USER_DATA:
@@ -137,6 +395,12 @@ bool light_flash_write(light_flash_param_type_t type, uint16_t len, void *pdata)
                            len);
         }
         break;
+    case LIGHT_FLASH_PARAM_TYPE_SCENE:
+        {
+            ret = ftl_save(pdata, LIGHT_FLASH_PARAMS_APP_OFFSET + MEMBER_OFFSET(light_flash_param_t, scenes),
+                           len);
+        }
+        break;
     default:
         break;
     }
@@ -160,15 +424,20 @@ bool light_flash_read(light_flash_param_type_t type, uint16_t len, void *pdata)
                        len);
         break;
     case LIGHT_FLASH_PARAM_TYPE_LIGHT_STATE:
-        ret = ftl_load((void *)pdata,
-                       LIGHT_FLASH_PARAMS_APP_OFFSET + MEMBER_OFFSET(light_flash_param_t, light_state),
-                       len);
+        ret = light_ftl_load((void *)pdata,
+                             LIGHT_FLASH_PARAMS_APP_OFFSET + MEMBER_OFFSET(light_flash_param_t, light_state),
+                             len);
         break;
     case LIGHT_FLASH_PARAM_TYPE_USER_DATA:
         ret = ftl_load((void *)pdata,
                        LIGHT_FLASH_PARAMS_APP_OFFSET + MEMBER_OFFSET(light_flash_param_t, user_data),
                        len);
         break;
+    case LIGHT_FLASH_PARAM_TYPE_SCENE:
+        ret = ftl_load((void *)pdata,
+                       LIGHT_FLASH_PARAMS_APP_OFFSET + MEMBER_OFFSET(light_flash_param_t, scenes),
+                       len);
+        break;
     default:
         break;
     }
@@ -180,23 +449,162 @@ bool light_flash_read(light_flash_param_type_t type, uint16_t len, void *pdata)
     return (0 == ret);
 }
 
+bool light_flash_scene_write(uint8_t index, light_flash_scene_t *pscene)
+{
+    uint32_t ret = light_ftl_save(pscene, LIGHT_FLASH_PARAMS_APP_OFFSET +
+                                  MEMBER_OFFSET(light_flash_param_t, scenes) + index * sizeof(light_flash_scene_t),
+                                  sizeof(light_flash_scene_t));
+    if (0 != ret)
+    {
+        printe("light_flash_scene_write: failed, index = %d, cause = %d", index, ret);
+    }
+
+    return (0 == ret);
+}
+
+static bool light_power_on_word_read(uint16_t word, uint32_t *pdata)
+{
+    return flash_read_locked(LIGHT_POWER_ON_WORD_ADDR(word), 4, (uint8_t *)pdata);
+}
+
+/**
+ * @brief find the first unused cycle and count the short cycles before it
+ */
+static void light_power_on_scan(void)
+{
+    uint32_t magic = 0;
+    light_power_on_scanned = TRUE;
+    light_power_on_cycle = LIGHT_POWER_ON_CYCLE_NUM;
+    light_power_on_count = 0;
+    if (!flash_read_locked(LIGHT_POWER_ON_COUNT_ADDR, 4, (uint8_t *)&magic) ||
+        (LIGHT_POWER_ON_MAGIC != magic))
+    {
+        /* not formatted yet, formatted at the next append */
+        return;
+    }
+
+    /* cycles are used in order, binary search the first word which has an unused cycle */
+    uint32_t data = 0;
+    uint16_t low = 0;
+    uint16_t high = LIGHT_POWER_ON_WORD_NUM;
+    while (low < high)
+    {
+        uint16_t mid = (low + high) / 2;
+        if (!light_power_on_word_read(mid, &data))
+        {
+            return;
+        }
+        if (0 == (data & LIGHT_POWER_ON_WORD_ON_BITS))
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    uint16_t cycle = LIGHT_POWER_ON_CYCLE_NUM;
+    if ((low < LIGHT_POWER_ON_WORD_NUM) && light_power_on_word_read(low, &data))
+    {
+        cycle = low * LIGHT_POWER_ON_WORD_CYCLE_NUM;
+        while (0 == (data & LIGHT_POWER_ON_ON_BIT(cycle)))
+        {
+            cycle ++;
+        }
+    }
+
+    /* count the cycles not marked stable backwards */
+    uint8_t count = 0;
+    uint16_t word = 0xffff;
+    for (uint16_t prev = cycle; (prev > 0) && (count < LIGHT_POWER_ON_COUNT); --prev)
+    {
+        if (word != (prev - 1) / LIGHT_POWER_ON_WORD_CYCLE_NUM)
+        {
+            word = (prev - 1) / LIGHT_POWER_ON_WORD_CYCLE_NUM;
+            if (!light_power_on_word_read(word, &data))
+            {
+                return;
+            }
+        }
+        if (0 == (data & LIGHT_POWER_ON_STABLE_BIT(prev - 1)))
+        {
+            break;
+        }
+        count ++;
+    }
+
+    light_power_on_cycle = cycle;
+    light_power_on_count = count;
+}
+
+/**
+ * @brief use the next cycle for this power on
+ * @param[in] stable: mark the cycle stable at once
+ */
+static bool light_power_on_append(bool stable)
+{
+    uint32_t mask = LIGHT_POWER_ON_ON_BIT(light_power_on_cycle);
+    if (stable)
+    {
+        mask |= LIGHT_POWER_ON_STABLE_BIT(light_power_on_cycle);
+    }
+
+    if (light_power_on_cycle < LIGHT_POWER_ON_CYCLE_NUM)
+    {
+        uint16_t word = light_power_on_cycle / LIGHT_POWER_ON_WORD_CYCLE_NUM;
+        return flash_auto_write_locked(LIGHT_POWER_ON_WORD_ADDR(word), ~mask);
+    }
+
+    /* sector used up or not formatted, erase it and carry the short cycles over */
+    uint8_t carry = stable ? 0 : light_power_on_count;
+    mask = 0;
+    for (uint8_t cycle = 0; cycle <= carry; ++cycle)
+    {
+        mask |= LIGHT_POWER_ON_ON_BIT(cycle);
+    }
+    if (stable)
+    {
+        mask |= LIGHT_POWER_ON_STABLE_BIT(0);
+    }
+    light_power_on_cycle = carry;
+    printi("light_power_on_append: erase counter sector, carry %d cycles", carry);
+    if (!flash_erase_locked(FLASH_ERASE_SECTOR, LIGHT_POWER_ON_COUNT_ADDR))
+    {
+        return FALSE;
+    }
+
+    return flash_auto_write_locked(LIGHT_POWER_ON_WORD_ADDR(0), ~mask) &&
+           flash_auto_write_locked(LIGHT_POWER_ON_COUNT_ADDR, LIGHT_POWER_ON_MAGIC);
+}
+
 static void light_power_on_timeout_cb(void *timer)
 {
+    UNUSED(timer);
     plt_timer_delete(power_on_timer, 0);
     power_on_timer = NULL;
-    light_power_on_count.count = 0;
-    light_flash_write(LIGHT_FLASH_PARAM_TYPE_POWER_ON_COUNT, sizeof(light_flash_power_on_count_t),
-                      &light_power_on_count);
+    uint16_t word = light_power_on_cycle / LIGHT_POWER_ON_WORD_CYCLE_NUM;
+    flash_auto_write_locked(LIGHT_POWER_ON_WORD_ADDR(word),
+                            ~LIGHT_POWER_ON_STABLE_BIT(light_power_on_cycle));
+}
+
+uint8_t light_power_on_count_get(void)
+{
+    if (!light_power_on_scanned)
+    {
+        light_power_on_scan();
+    }
+
+    return light_power_on_count;
 }
 
-bool light_power_on_count_check(uint8_t count)
+bool light_power_on_count_check(void)
 {
-    if (count >= LIGHT_POWER_ON_COUNT)
+    if (light_power_on_count_get() >= LIGHT_POWER_ON_COUNT)
     {
         mesh_node_clear();
-        light_power_on_count.count = 0;
-        light_flash_write(LIGHT_FLASH_PARAM_TYPE_POWER_ON_COUNT, sizeof(light_flash_power_on_count_t),
-                          &light_power_on_count);
+        /* marked stable together, the next power on counts from 0 */
+        light_power_on_append(TRUE);
 #if MESH_ALI_CERTIFICATION
         light_set_unprov_effect(TRUE);
 #endif
@@ -204,11 +612,9 @@ bool light_power_on_count_check(uint8_t count)
     }
     else
     {
-        light_power_on_count.count = count + 1;
+        light_power_on_append(FALSE);
         power_on_timer = plt_timer_create("PO", LIGHT_POWER_ON_TIME, 0, 0, light_power_on_timeout_cb);
         plt_timer_start(power_on_timer, 0);
-        light_flash_write(LIGHT_FLASH_PARAM_TYPE_POWER_ON_COUNT, sizeof(light_flash_power_on_count_t),
-                          &light_power_on_count);
         return FALSE;
     }
 }
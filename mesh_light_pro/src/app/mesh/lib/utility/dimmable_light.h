@@ -36,6 +36,7 @@ typedef enum
     LIGHT_FLASH_PARAM_TYPE_POWER_ON_COUNT,
     LIGHT_FLASH_PARAM_TYPE_LIGHT_STATE,
     LIGHT_FLASH_PARAM_TYPE_USER_DATA,
+    LIGHT_FLASH_PARAM_TYPE_SCENE,
 } light_flash_param_type_t;
 
 typedef struct
@@ -44,16 +45,30 @@ typedef struct
     uint8_t padding[3];
 } light_flash_power_on_count_t;
 
+#define LIGHT_FLASH_LIGHT_STATE_FLAG_BOOT  0x01 //!< written by a provisioned node, light it at boot
+
 typedef struct
 {
     uint16_t state[5];
-    uint8_t padding[2];
+    uint8_t flags;
+    uint8_t padding;
 } light_flash_light_state_t;
 
+#define LIGHT_FLASH_SCENE_NUM              16 //!< scene register size kept in flash
+
+/** scene number 0 means unused record, the state layout is defined by the light type */
+typedef struct
+{
+    uint16_t scene_number;
+    uint16_t state[7];
+} light_flash_scene_t;
+
 typedef struct
 {
+    /** not used, the power on count is kept in the sector at LIGHT_POWER_ON_COUNT_ADDR */
     light_flash_power_on_count_t power_on_count;
     light_flash_light_state_t light_state;
+    light_flash_scene_t scenes[LIGHT_FLASH_SCENE_NUM];
     /**
      * user can add some fixed size structure here,
      * size must be 4-byte alignment
@@ -111,6 +126,24 @@ void light_lighten(light_t *light, uint16_t lightness);
  */
 void light_set_lightness(light_t *light, uint16_t lightness);
 
+/**
+ * @brief fade light lightness by hardware timer
+ * @param[in] light: light handle
+ * @param[in] lightness: target lightness
+ * @param[in] time: fade time, the unit is ms
+ * @retval TRUE: fade started, pwm duty changes every pwm period
+ * @retval FALSE: hardware fade disabled, no free ramp or time too short
+ * @note the fade starts from current lightness, the lightness field follows the fade,
+ *       the lightness_last field is not updated. light_lighten stops the fade.
+ */
+bool light_ramp_start(light_t *light, uint16_t lightness, uint32_t time);
+
+/**
+ * @brief stop light fade, keep current lightness
+ * @param[in] light: light handle
+ */
+void light_ramp_stop(light_t *light);
+
 /**
  * @brief blink light
  * @param[in] light: light handle
@@ -143,10 +176,31 @@ bool light_flash_write(light_flash_param_type_t type, uint16_t len, void *pdata)
 bool light_flash_read(light_flash_param_type_t type, uint16_t len, void *pdata);
 
 /**
- * @brief check light power on count
- * @param[in] count: power on count
+ * @brief write one scene record to flash
+ * @param[in] index: record index, range: 0 ~ LIGHT_FLASH_SCENE_NUM - 1
+ * @param[in] pscene: scene record
+ * @retval TRUE: store success
+ * @retval FALSE: store failed
+ * @note read all the records by light_flash_read with LIGHT_FLASH_PARAM_TYPE_SCENE
+ */
+bool light_flash_scene_write(uint8_t index, light_flash_scene_t *pscene);
+
+/**
+ * @brief get light power on count
+ * @return power on cycles shorter than LIGHT_POWER_ON_TIME right before this power on
+ * @note it reads the counter sector once, it does not count this power on
+ */
+uint8_t light_power_on_count_get(void);
+
+/**
+ * @brief count this power on, reset the node if the light has been closed
+ *        LIGHT_POWER_ON_COUNT times in a row within LIGHT_POWER_ON_TIME
+ * @retval TRUE: node reset
+ * @retval FALSE: power on counted, it is marked stable after LIGHT_POWER_ON_TIME
+ * @note a power on clears one bit of the counter sector, and one more when marked stable,
+ *       the sector is erased once every 16368 power ons
  */
-bool light_power_on_count_check(uint8_t count);
+bool light_power_on_count_check(void);
 /** @} */
 /** @} */
 
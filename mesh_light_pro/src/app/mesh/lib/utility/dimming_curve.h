@@ -0,0 +1,86 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     dimming_curve.h
+  * @brief    Head file for light dimming curves.
+  * @details  Dimming curves map the light lightness actual to the light output, in Q16.
+  *           The curves are integer constant expressions, so the tables built by
+  *           DIMMING_CURVE_TABLE are computed by the compiler and placed in flash.
+  * @author   bill
+  * @date     2018-12-17
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion */
+#ifndef _DIMMING_CURVE_H_
+#define _DIMMING_CURVE_H_
+
+#include "platform_types.h"
+
+BEGIN_DECLS
+
+/**
+ * @addtogroup DIMMING_CURVE
+ * @{
+ */
+
+/**
+ * @defgroup Dimming_Curve_Exported_Macros Dimming Curve Exported Macros
+ * @brief
+ * @{
+ */
+/** dimming curve types */
+#define DIMMING_CURVE_LINEAR                0 //!< output follows lightness actual
+#define DIMMING_CURVE_SQUARE_LAW            1 //!< output follows lightness linear, actual^2
+#define DIMMING_CURVE_CIE1931               2 //!< lightness actual is CIE 1931 L*, output is Y
+#define DIMMING_CURVE_CUSTOM                3 //!< DIMMING_CURVE_CUSTOM_Q16(x) supplied by the sku
+
+/** table has a point every DIMMING_CURVE_STEP lightness, the points in between are interpolated */
+#define DIMMING_CURVE_STEP_BITS             8
+#define DIMMING_CURVE_STEP                  (1 << DIMMING_CURVE_STEP_BITS)
+#define DIMMING_CURVE_POINTS                ((65536 >> DIMMING_CURVE_STEP_BITS) + 1)
+
+#define DIMMING_CURVE_CLAMP_Q16(y)          ((y) > 65535 ? 65535 : (y))
+
+/** curve functions, x is lightness actual in 0 ~ 65536, return output in Q16 */
+#define DIMMING_CURVE_LINEAR_Q16(x)         DIMMING_CURVE_CLAMP_Q16((uint64_t)(x))
+#define DIMMING_CURVE_SQUARE_LAW_Q16(x)     DIMMING_CURVE_CLAMP_Q16((uint64_t)(x) * (x) / 65535)
+/* L* = 100 * x / 65535, Y = ((L* + 16) / 116)^3 above L* = 8, L* / 903.3 below */
+#define DIMMING_CURVE_CIE1931_Q16(x)        DIMMING_CURVE_CLAMP_Q16(((uint64_t)(x) * 100 <= 8ULL * 65535) ? \
+                                                                    ((uint64_t)(x) * 100 * 10 / 9033) : \
+                                                                    (((uint64_t)(x) * 100 + 16ULL * 65535) * \
+                                                                     ((uint64_t)(x) * 100 + 16ULL * 65535) / 65535 * \
+                                                                     ((uint64_t)(x) * 100 + 16ULL * 65535) / \
+                                                                     (116ULL * 116 * 116 * 65535)))
+
+/**
+ * @brief expand the table points of a curve
+ * @param[in] f: entry macro, f(x) gives the table entry at lightness x
+ * @note usage: const uint32_t table[DIMMING_CURVE_POINTS] = {DIMMING_CURVE_TABLE(f)};
+ */
+#define DIMMING_CURVE_TABLE(f)              DIMMING_CURVE_POINTS_64(f, 0), \
+    DIMMING_CURVE_POINTS_64(f, 64), \
+    DIMMING_CURVE_POINTS_64(f, 128), \
+    DIMMING_CURVE_POINTS_64(f, 192), \
+    f(256UL * DIMMING_CURVE_STEP)
+
+#define DIMMING_CURVE_POINTS_4(f, i)        f((i) * DIMMING_CURVE_STEP), \
+    f(((i) + 1) * DIMMING_CURVE_STEP), \
+    f(((i) + 2) * DIMMING_CURVE_STEP), \
+    f(((i) + 3) * DIMMING_CURVE_STEP)
+#define DIMMING_CURVE_POINTS_16(f, i)       DIMMING_CURVE_POINTS_4(f, i), \
+    DIMMING_CURVE_POINTS_4(f, (i) + 4), \
+    DIMMING_CURVE_POINTS_4(f, (i) + 8), \
+    DIMMING_CURVE_POINTS_4(f, (i) + 12)
+#define DIMMING_CURVE_POINTS_64(f, i)       DIMMING_CURVE_POINTS_16(f, i), \
+    DIMMING_CURVE_POINTS_16(f, (i) + 16), \
+    DIMMING_CURVE_POINTS_16(f, (i) + 32), \
+    DIMMING_CURVE_POINTS_16(f, (i) + 48)
+/** @} */
+/** @} */
+
+END_DECLS
+
+#endif /* _DIMMING_CURVE_H_ */
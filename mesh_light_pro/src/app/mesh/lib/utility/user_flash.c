@@ -360,6 +360,46 @@ L_Return:
     return result;
 }
 
+/**
+*  @brief: mark the image in the temp bank ready, sil_dfu_update programs its header not ready.
+*/
+DATA_RAM_FUNCTION uint32_t sil_dfu_set_ready(uint16_t signature)
+{
+    uint32_t result = 0;
+    uint32_t dfu_base_addr;
+    T_IMG_CTRL_HEADER_FORMAT header;
+    uint32_t *p_word = (uint32_t *)&header;
+
+    dfu_base_addr = get_temp_ota_bank_addr_by_img_id((T_IMG_ID)signature);
+    if (dfu_base_addr == 0)
+    {
+        result = __LINE__;
+        goto L_Return;
+    }
+
+    for (uint32_t i = 0; i < sizeof(header) / 4; ++i)
+    {
+        p_word[i] = flash_auto_read((dfu_base_addr + i * 4) | FLASH_OFFSET_TO_NO_CACHE);
+    }
+    if (header.image_id != signature)
+    {
+        result = __LINE__;
+        goto L_Return;
+    }
+
+    /* clearing a bit needs no erase */
+    header.ctrl_flag.flag_value.not_ready = 0;
+    flash_auto_write(dfu_base_addr, p_word[0]);
+    if (flash_auto_read(dfu_base_addr | FLASH_OFFSET_TO_NO_CACHE) != p_word[0])
+    {
+        result = __LINE__;
+    }
+
+L_Return:
+    DFU_PRINT_INFO1("<==sil_dfu_set_ready result:%d \r\n", result);
+    return result;
+}
+
 DATA_RAM_FUNCTION uint32_t sil_dfu_flash_erase(uint16_t signature, uint32_t offset)
 {
     uint32_t result = 0;
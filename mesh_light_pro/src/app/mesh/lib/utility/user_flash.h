@@ -39,6 +39,7 @@ void lock_flash(void);
 uint32_t flash_erase_sector(uint32_t addr);
 uint32_t sil_dfu_update(uint16_t signature, uint32_t offset, uint32_t length, uint32_t *p_void);
 uint32_t sil_dfu_flash_erase(uint16_t signature, uint32_t offset);
+uint32_t sil_dfu_set_ready(uint16_t signature);
 /** @} */
 /** @} */
 
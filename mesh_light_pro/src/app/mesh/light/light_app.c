@@ -71,6 +71,9 @@ void app_handle_io_msg(T_IO_MSG io_msg)
     case DFU_SERVER_TIMEOUT_MSG:
         dfu_server_adv_send();
         break;
+    case DFU_SERVER_PROGRAM_MSG:
+        dfu_server_program();
+        break;
 #if (ROM_WATCH_DOG_ENABLE == 1)
     case IO_MSG_TYPE_RESET_WDG_TIMER:
         {
@@ -651,6 +654,9 @@ T_APP_RESULT app_profile_callback(T_SERVER_ID service_id, void *p_data)
         case DFU_CB_END:
             light_dfu_server_end();
             break;
+        case DFU_CB_RESET:
+            light_dfu_server_reset();
+            break;
         default:
             break;
         }
@@ -40,10 +40,32 @@
 #define LIGHT_FLASH_PARAMS_APP_OFFSET      1900 //!< Shall be bigger than or equal to the size of mesh stack flash usage
 #define LIGHT_POWER_ON_COUNT               5    //!< close the light LIGHT_POWER_ON_COUNT times to reset
 #define LIGHT_POWER_ON_TIME                8000 //!< millisecond
+#define LIGHT_POWER_ON_COUNT_ADDR          APP_POWER_ON_COUNT_ADDR //!< 4K flash sector of the power on counter, reserved in flash_map.h
+#define LIGHT_STATE_STORE_QUIET_TIME       500  //!< millisecond, store light state after no change for this time
+#define LIGHT_STATE_STORE_DELAY_MAX        2000 //!< millisecond, store light state at most this time after change
 
 /** set this value to 1 if pin value low means light on */
 #define PIN_REVERSE                        0
 
+/** set this value to 1 to pace linear fades by TIM7 on every pwm period */
+#ifndef LIGHT_HW_FADE
+#define LIGHT_HW_FADE                      1
+#endif
+
+/** set dimming curve from lightness actual to pwm duty, see dimming_curve.h */
+#ifndef LIGHT_DIMMING_CURVE
+#define LIGHT_DIMMING_CURVE                DIMMING_CURVE_LINEAR
+#endif
+/* output of DIMMING_CURVE_CUSTOM in Q16, x is lightness actual in 0 ~ 65536, e.g. cubic */
+#define DIMMING_CURVE_CUSTOM_Q16(x)        ((uint64_t)(x) * (x) / 65535 * (x) / 65535)
+
+/** chromaticity of the cold and warm leds in cie 1960 uv scaled by 1e6, calibrate the ctl mixing by
+ * the measured values, the defaults are the planckian locus at 6500K and 2700K */
+#define LIGHT_CTL_COLD_U                   200495
+#define LIGHT_CTL_COLD_V                   310324
+#define LIGHT_CTL_WARM_U                   262422
+#define LIGHT_CTL_WARM_V                   351674
+
 #endif /** _LIGHT_CONFIG_H_ */
 
 
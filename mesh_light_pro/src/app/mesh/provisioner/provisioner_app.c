@@ -37,6 +37,7 @@
 #include "dfu_server.h"
 #include "dfu_client.h"
 #include "datatrans_client.h"
+#include "dfu_distributor_app.h"
 #include "mem_config.h"
 
 bool prov_manual;
@@ -89,6 +90,9 @@ void app_handle_io_msg(T_IO_MSG io_msg)
     case PING_APP_TIMEOUT_MSG:
         ping_app_handle_timeout();
         break;
+    case DFU_DIST_TIMEOUT_MSG:
+        dfu_dist_handle_timeout();
+        break;
     case LIGHT_CWRGB_TIMEOUT_MSG:
         light_cwrgb_process();
         break;
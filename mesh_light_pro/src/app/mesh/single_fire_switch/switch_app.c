@@ -89,6 +89,9 @@ void app_handle_io_msg(T_IO_MSG io_msg)
     case DFU_SERVER_TIMEOUT_MSG:
         dfu_server_adv_send();
         break;
+    case DFU_SERVER_PROGRAM_MSG:
+        dfu_server_program();
+        break;
 #if (ROM_WATCH_DOG_ENABLE == 1)
     case IO_MSG_TYPE_RESET_WDG_TIMER:
         {
@@ -25,6 +25,7 @@
 #include "ftl.h"
 #include "ftl_app_cb.h"
 //#include "otp_cfg.h" //need open on b-cut IC
+#include "platform_utils.h"
 #include "trace.h"
 
 /*============================================================================*
@@ -45,9 +46,41 @@
 
 #define MAPPING_table_size   (MAX_logical_address_size / 4 * LOGIC_ADDR_MAP_BIT_NUM / 8)
 
+/* the mapping table keeps LOGIC_ADDR_MAP_BIT_NUM bits per logical addr, the key cell of the newest
+   entry holding it as page * FTL_MAP_PAGE_ENTRY_NUM + key index / 2, 0 if the addr is not written */
+#define FTL_MAP_PAGE_ENTRY_NUM      (PAGE_element / 2)
+#define FTL_MAP_TABLE_SIZE          (MAPPING_table_size + 1)    //an odd entry number takes half a byte more
+#define FTL_MAP_PAGE(value)         ((value) / FTL_MAP_PAGE_ENTRY_NUM)
+#define FTL_MAP_KEY_INDEX(value)    ((((value) % FTL_MAP_PAGE_ENTRY_NUM) << 1) | 1)
+
+#define FTL_CACHE_SIZE              16  //power of 2
+#define FTL_CACHE_INDEX(addr)       (((addr) >> 2) & (FTL_CACHE_SIZE - 1))
+
 #define FTL_MAX_INDEX 14
 
+/* the key of a word keeps the 4 bytes aligned logical addr in bit 0 ~ 15, a record key is
+   crc16 | word num - 1 (bit 12 ~ 15) | logical addr (bit 2 ~ 11) | pad flag | record flag,
+   its words are padded to an odd number and stored below the key, so entries stay in pairs */
+#define FTL_RECORD_FLAG             0x0001
+#define FTL_RECORD_PAD_FLAG         0x0002
+#define FTL_RECORD_ADDR_MASK        0x0ffc
+#define FTL_RECORD_WORD_NUM_SHIFT   12
+#define FTL_RECORD_WORD_MAX         (FTL_RECORD_SIZE_MAX / 4)
+#define FTL_RECORD_PAD_KEY          (FTL_RECORD_FLAG | FTL_RECORD_PAD_FLAG) //fill the page tail a record does not fit in
+#define FTL_RECORD_WORD_NUM(key)    ((((key) >> FTL_RECORD_WORD_NUM_SHIFT) & 0x0f) + 1)
+#define FTL_RECORD_CELL_NUM(word_num)   (((word_num) | 1) + 1)
+#define FTL_RECORD_WORD_MASK(word_num)  ((1UL << (word_num)) - 1)
+
+#define FTL_TICK_MASK               0x3FFFFFF
+#define FTL_TICK_TO_US(tick)        ((tick) / 40) //vendor timer runs at 40MHz
+
+#if PLATFORM_HOST_SIM
+//host flash model, see ftl_rom_sim.c
+#define __get_IPSR()                0
+extern void vAssertHandler(const char *pFuncName, uint32_t funcLine);
+#else
 extern __asm void vAssertHandler(const char *pFuncName, uint32_t funcLine);
+#endif
 #define configASSERT( x ) if( ( x ) == 0 ) { vAssertHandler(__FUNCTION__, __LINE__); }
 
 #define DEBUG_FTL
@@ -70,11 +103,6 @@ extern uint8_t g_doingGarbageCollection;
 extern uint8_t g_PAGE_num;
 extern uint8_t g_free_page_count;
 extern void *ftl_sem;
-extern uint8_t *ftl_mapping_table;
-
-extern uint16_t read_mapping_table(uint16_t logical_addr);
-extern void write_mapping_table(uint16_t logical_addr, uint8_t pageID, uint16_t cell_index);
-extern void ftl_mapping_table_init(void);
 
 extern uint8_t ftl_get_prev_page(uint8_t CurPageID, uint8_t *pPrePageID);
 extern uint16_t ftl_get_page_end_position(struct Page_T *p, uint16_t *pEndPos);
@@ -117,6 +145,40 @@ typedef struct
     uint8_t  state;
 } T_FTL_BUFFER_SM;
 
+enum ftl_gc_state
+{
+    FTL_GC_SM_IDLE = 0,
+    FTL_GC_SM_COPY = 1,
+    FTL_GC_SM_ERASE = 2,
+};
+typedef struct
+{
+    uint8_t  state;
+    uint8_t  page_id;         //page being collected
+    uint8_t  sequence;        //tells whether the page is collected by inline gc meanwhile
+    uint8_t  running;         //in a slice, writes are copies of gc
+    uint8_t  free_page_count; //free pages when the collection started
+    uint8_t  hold;            //last collection freed nothing, wait for the page switch
+    uint8_t  hold_page;
+    uint16_t key_index;       //next entry to check
+} T_FTL_GC_SM;
+
+typedef struct
+{
+    uint8_t  page_id;
+    int32_t  next_index;  //key index of the next entry to visit
+    uint16_t key_index;   //key index of the current entry
+    uint32_t key;
+    uint8_t  record;      //current entry is a record with valid crc
+    uint8_t  valid;       //current entry is a record or a word with valid crc
+} T_FTL_CURSOR;
+
+typedef struct
+{
+    uint16_t tag;   //logical addr | 1, 0 if empty
+    uint32_t data;
+} T_FTL_CACHE_ENTRY;
+
 /*============================================================================*
  *                              Variables
  *============================================================================*/
@@ -124,6 +186,15 @@ uint32_t ftl_buffer[14];
 
 T_FTL_BUFFER_SM ftl_buffer_sm;
 
+T_FTL_GC_SM ftl_gc_sm;
+
+T_FTL_LATENCY_STAT ftl_latency_stat;
+
+uint8_t *ftl_map_table = NULL;  //NULL if the pages do not fit in the map, reads scan the pages then
+
+T_FTL_CACHE_ENTRY ftl_cache[FTL_CACHE_SIZE];
+uint32_t ftl_cache_gen;         //bumped by every cache update, a read fills the cache only if unchanged
+
 /*============================================================================*
  *                              Functions
  *============================================================================*/
@@ -189,64 +260,372 @@ uint32_t ftl_crc_key_init(uint16_t logical_addr, uint32_t data)
     return key;
 }
 
+static uint16_t ftl_map_get(uint16_t logical_addr)
+{
+    uint32_t index = logical_addr >> 2;
+    uint8_t *p = ftl_map_table + index * LOGIC_ADDR_MAP_BIT_NUM / 8;
+
+    if (logical_addr >= MAX_logical_address_size)
+    {
+        return 0;
+    }
+
+    if (index & 1)
+    {
+        return (p[0] >> 4) | ((uint16_t)p[1] << 4);
+    }
+    return p[0] | ((uint16_t)(p[1] & 0x0f) << 8);
+}
+
+static void ftl_map_set(uint16_t logical_addr, uint8_t pageID, uint16_t key_index)
+{
+    uint32_t index = logical_addr >> 2;
+    uint8_t *p = ftl_map_table + index * LOGIC_ADDR_MAP_BIT_NUM / 8;
+    uint16_t value = pageID * FTL_MAP_PAGE_ENTRY_NUM + (key_index >> 1);
+
+    if (logical_addr >= MAX_logical_address_size)
+    {
+        return;
+    }
+
+    if (index & 1)
+    {
+        p[0] = (p[0] & 0x0f) | (uint8_t)(value << 4);
+        p[1] = (uint8_t)(value >> 4);
+    }
+    else
+    {
+        p[0] = (uint8_t)value;
+        p[1] = (p[1] & 0xf0) | (uint8_t)(value >> 8);
+    }
+}
+
+//return 1 and the data if logical_addr is cached
+static uint8_t ftl_cache_get(uint16_t logical_addr, uint32_t *value)
+{
+    uint8_t hit = 0;
+    T_FTL_CACHE_ENTRY *p_entry = &ftl_cache[FTL_CACHE_INDEX(logical_addr)];
+    uint32_t s = os_lock();
+
+    if (p_entry->tag == (logical_addr | 1))
+    {
+        *value = p_entry->data;
+        hit = 1;
+    }
+    os_unlock(s);
+
+    return hit;
+}
+
+//writes always update the cache, a read only if no write came since it started at gen
+static void ftl_cache_put(uint16_t logical_addr, uint32_t data, uint32_t *p_gen)
+{
+    T_FTL_CACHE_ENTRY *p_entry = &ftl_cache[FTL_CACHE_INDEX(logical_addr)];
+    uint32_t s = os_lock();
+
+    if ((NULL == p_gen) || (*p_gen == ftl_cache_gen))
+    {
+        ftl_cache_gen++;
+        p_entry->tag = logical_addr | 1;
+        p_entry->data = data;
+    }
+    os_unlock(s);
+}
+
+static void ftl_map_reset(void)
+{
+    uint32_t s = os_lock();
+    ftl_cache_gen++;
+    memset(ftl_cache, 0, sizeof(ftl_cache));
+    os_unlock(s);
+
+    if (NULL != ftl_map_table)
+    {
+        memset(ftl_map_table, 0, FTL_MAP_TABLE_SIZE);
+    }
+}
+
+//cells of current page from g_free_cell_index are still in ftl buffer
+static uint32_t ftl_cell_read(uint8_t pageID, uint16_t cell_index)
+{
+    if ((pageID == g_cur_pageID) && (cell_index >= g_free_cell_index))
+    {
+        return ftl_buffer_sm.pFtl_buf[cell_index - g_free_cell_index];
+    }
+
+    return ftl_page_read(g_pPage + pageID, cell_index);
+}
+
+static uint16_t ftl_record_crc_word(uint16_t crc16, uint32_t data)
+{
+    uint8_t payload[4];
+
+    payload[0] = (uint8_t)(data & 0x000000ff);
+    payload[1] = (uint8_t)((data & 0x0000ff00) >> 8);
+    payload[2] = (uint8_t)((data & 0x00ff0000) >> 16);
+    payload[3] = (uint8_t)((data & 0xff000000) >> 24);
+
+    return btxfcs(crc16, payload, 4);
+}
+
+static uint16_t ftl_record_crc_key(uint16_t crc16, uint32_t key)
+{
+    uint8_t payload[2];
+
+    payload[0] = (uint8_t)(key & 0x000000ff);
+    payload[1] = (uint8_t)((key & 0x0000ff00) >> 8);
+
+    return btxfcs(crc16, payload, 2);
+}
+
+//return 1 if key is a record and its crc over all words and the low half key is right
+static uint8_t ftl_record_check(uint8_t pageID, uint16_t key_index, uint32_t key)
+{
+    if ((WRITABLE_32BIT == key) ||
+        ((key & (FTL_RECORD_FLAG | FTL_RECORD_PAD_FLAG)) != FTL_RECORD_FLAG))
+    {
+        return 0;
+    }
+
+    uint16_t cell_num = FTL_RECORD_CELL_NUM(FTL_RECORD_WORD_NUM(key));
+    if (key_index + 1 < INFO_size + cell_num)
+    {
+        return 0;
+    }
+
+    uint16_t crc16 = BTXFCS_INIT;
+    for (uint16_t index = key_index + 1 - cell_num; index < key_index; ++index)
+    {
+        crc16 = ftl_record_crc_word(crc16, ftl_cell_read(pageID, index));
+    }
+    crc16 = ftl_record_crc_key(crc16, key);
+
+    return (crc16 == ftl_get_crc_key(key)) ? 1 : 0;
+}
+
+static void ftl_cursor_at(T_FTL_CURSOR *p_cursor, uint8_t pageID, uint16_t key_index)
+{
+    p_cursor->page_id = pageID;
+    p_cursor->key_index = key_index;
+    p_cursor->key = ftl_cell_read(pageID, key_index);
+    p_cursor->record = ftl_record_check(pageID, key_index, p_cursor->key);
+    //a record torn by power lost leaves its words at key cells, crc tells them from keys
+    p_cursor->valid = p_cursor->record || (!(p_cursor->key & FTL_RECORD_FLAG) &&
+                                           !ftl_crc_key_check(p_cursor->key, ftl_cell_read(pageID, key_index - 1)));
+    p_cursor->next_index = key_index - (p_cursor->record ?
+                                        FTL_RECORD_CELL_NUM(FTL_RECORD_WORD_NUM(p_cursor->key)) : 2);
+}
+
+//start from the newest entry, the ones in ftl buffer included
+static void ftl_cursor_init(T_FTL_CURSOR *p_cursor)
+{
+    p_cursor->page_id = g_cur_pageID;
+    p_cursor->next_index = g_free_cell_index + ftl_buffer_sm.write_index - 1;
+}
+
+//go to the next older entry, pages are visited until EndPageID (not included)
+//return 0 when no more entry
+static uint8_t ftl_cursor_next(T_FTL_CURSOR *p_cursor, uint8_t EndPageID)
+{
+    while (p_cursor->page_id != EndPageID)
+    {
+        if (p_cursor->next_index >= 3)
+        {
+            ftl_cursor_at(p_cursor, p_cursor->page_id, p_cursor->next_index);
+            return 1;
+        }
+
+        uint8_t prePageID;
+        uint16_t EndPos;
+        if (0 != ftl_get_prev_page(p_cursor->page_id, &prePageID))
+        {
+            break;
+        }
+        p_cursor->page_id = prePageID;
+        if (0 == ftl_get_page_end_position(g_pPage + prePageID, &EndPos))
+        {
+            p_cursor->next_index = EndPos;
+        }
+        else
+        {
+            // todo, error recovery
+            p_cursor->next_index = PAGE_element - 1;
+        }
+    }
+
+    return 0;
+}
+
+//check whether the entry holds any word of [logical_addr, logical_addr + size)
+static uint8_t ftl_cursor_overlap(T_FTL_CURSOR *p_cursor, uint16_t logical_addr, uint16_t size)
+{
+    if (p_cursor->record)
+    {
+        uint32_t base = p_cursor->key & FTL_RECORD_ADDR_MASK;
+        uint32_t len = FTL_RECORD_WORD_NUM(p_cursor->key) * 4;
+        return ((base < (uint32_t)logical_addr + size) && (logical_addr < base + len)) ? 1 : 0;
+    }
+
+    if (p_cursor->key & FTL_RECORD_FLAG)
+    {
+        //pad or broken record
+        return 0;
+    }
+
+    uint16_t addr = p_cursor->key & 0xffff;
+    return ((addr >= logical_addr) && (addr < (uint32_t)logical_addr + size)) ? 1 : 0;
+}
+
+//read the word of logical_addr from the entry which overlaps it
+static uint32_t ftl_cursor_read(T_FTL_CURSOR *p_cursor, uint16_t logical_addr, uint32_t *value)
+{
+    if (p_cursor->record)
+    {
+        uint16_t base = p_cursor->key & FTL_RECORD_ADDR_MASK;
+        uint16_t cell_num = FTL_RECORD_CELL_NUM(FTL_RECORD_WORD_NUM(p_cursor->key));
+        *value = ftl_cell_read(p_cursor->page_id,
+                               p_cursor->key_index + 1 - cell_num + ((logical_addr - base) >> 2));
+        return FTL_READ_SUCCESS;
+    }
+
+    *value = ftl_cell_read(p_cursor->page_id, p_cursor->key_index - 1);
+    return ftl_crc_key_check(p_cursor->key, *value) ? FTL_READ_ERROR_CRC_FAIL : FTL_READ_SUCCESS;
+}
+
 uint8_t ftl_page_can_addr_drop_app(uint16_t logical_addr, uint8_t EndPageID)
 {
     uint8_t found = 0;
 
-    if (*(uint8_t *)0x00200357 & BIT2)  //test in FPGA
-        //if (OTP->ftl_use_mapping_table == 1)
+    if (NULL != ftl_map_table)
     {
-        uint16_t phy_addr = read_mapping_table(logical_addr);
-        if ((phy_addr != 0) && (phy_addr / PAGE_element != EndPageID))
+        uint16_t map_value = ftl_map_get(logical_addr);
+        if ((map_value != 0) && (FTL_MAP_PAGE(map_value) != EndPageID))
         {
             found = 1;
         }
         return found;
     }
 
-    uint8_t  pageID = g_cur_pageID;
-    uint16_t key_index = g_free_cell_index - 1;
+    //a newer word or record holding logical_addr, the ones in ftl buffer included
+    T_FTL_CURSOR cursor;
+    ftl_cursor_init(&cursor);
+    while (ftl_cursor_next(&cursor, EndPageID))
+    {
+        if (cursor.valid && ftl_cursor_overlap(&cursor, logical_addr, 4))
+        {
+            found = 1;
+            break;
+        }
+    }
 
-L_retry:
+    return found;
+}
 
-    if (EndPageID != pageID)
+//return bit mask of the record words not held by newer entries
+static uint32_t ftl_record_live_mask(uint8_t pageID, uint32_t key)
+{
+    uint32_t live_mask = 0;
+    uint16_t logical_addr = key & FTL_RECORD_ADDR_MASK;
+    uint8_t word_num = FTL_RECORD_WORD_NUM(key);
+
+    for (uint8_t i = 0; i < word_num; ++i)
     {
-        for (; key_index >= 3; key_index -= 2)
+        if (!ftl_page_can_addr_drop_app(logical_addr + (i << 2), pageID))
         {
-            uint32_t key = ftl_page_read(g_pPage + pageID, key_index);
-            uint16_t addr = key & 0xffff;
-            if (addr == logical_addr)
-            {
-                found = 1;
-                break;
-            }
+            live_mask |= (1UL << i);
         }
+    }
 
-        uint8_t prePageID;
-        if (found == 0 && 0 == ftl_get_prev_page(pageID, &prePageID))
+    return live_mask;
+}
+
+void ftl_buffer_push(uint32_t data);
+static uint32_t ftl_record_write(uint16_t logical_addr, uint32_t *p_data, uint8_t word_num);
+
+//copy the live words of a record out of the page to be recycled
+static void ftl_record_copy(uint8_t pageID, uint16_t key_index, uint32_t key, uint32_t live_mask)
+{
+    uint32_t data[FTL_RECORD_WORD_MAX];
+    uint16_t logical_addr = key & FTL_RECORD_ADDR_MASK;
+    uint8_t word_num = FTL_RECORD_WORD_NUM(key);
+    uint16_t data_index = key_index + 1 - FTL_RECORD_CELL_NUM(word_num);
+
+    for (uint8_t i = 0; i < word_num; ++i)
+    {
+        data[i] = ftl_page_read(g_pPage + pageID, data_index + i);
+    }
+
+    if (live_mask == FTL_RECORD_WORD_MASK(word_num))
+    {
+        ftl_record_write(logical_addr, data, word_num);
+    }
+    else
+    {
+        //words overridden by newer entries must not come back, copy the others one by one
+        for (uint8_t i = 0; i < word_num; ++i)
         {
-            uint16_t EndPos;
-            if (0 == ftl_get_page_end_position(g_pPage + prePageID, &EndPos))
+            if (live_mask & (1UL << i))
             {
-                pageID = prePageID;
-                key_index = EndPos;
-
-                goto L_retry;
+                ftl_write_app_cb(logical_addr + (i << 2), data[i]);
             }
-            else
-            {
-                // todo, error recovery
-                //TODO;
+        }
+    }
+}
 
-                pageID = prePageID;
-                key_index = PAGE_element - 1;
+//drop or copy the entry at *p_key_index of Recycle_page, then step to the next entry
+//return 1 if the entry or part of it is recycled
+static uint8_t ftl_gc_entry(uint8_t Recycle_page, uint16_t *p_key_index)
+{
+    uint8_t recycled = 0;
+    uint16_t key_index = *p_key_index;
+    uint32_t key = ftl_page_read(g_pPage + Recycle_page, key_index);
+    uint32_t rdata = ftl_page_read(g_pPage + Recycle_page, key_index - 1);
 
-                goto L_retry;
-            }
+    if (key == FTL_RECORD_PAD_KEY)
+    {
+        recycled = 1;
+    }
+    else if (ftl_record_check(Recycle_page, key_index, key))
+    {
+        uint32_t live_mask = ftl_record_live_mask(Recycle_page, key);
+        if (live_mask != FTL_RECORD_WORD_MASK(FTL_RECORD_WORD_NUM(key)))
+        {
+            recycled = 1;
+        }
+        if (live_mask)
+        {
+            ftl_record_copy(Recycle_page, key_index, key, live_mask);
         }
+        //skip the record words, the last pair is skipped below
+        key_index -= FTL_RECORD_CELL_NUM(FTL_RECORD_WORD_NUM(key)) - 2;
     }
+    else if (!(key & FTL_RECORD_FLAG) && !ftl_crc_key_check(key, rdata)) //need or not,? slown down gc speed
+    {
+        uint16_t addr = key & 0xffff;
 
-    return found;
+        if (ftl_page_can_addr_drop_app(addr, Recycle_page))
+        {
+            // drop / recycle
+            //DPRINTF("drop [%d] addr: 0x%08x \n", candidate_key_index, candidate_addr);
+
+            recycled = 1;
+        }
+        else
+        {
+            // copy it
+            // write to another place
+            ftl_write_app_cb(addr, rdata);    //todo:check if need assert rdata is all FF?
+        }
+    }
+    else
+    {
+        FLASH_PRINT_ERROR3("ftl_page_garbage_collect_Imp:check crc fail!recycle page:%x, index:%x, read value:%x",
+                           Recycle_page, key_index, key);
+        recycled = 1;
+    }
+
+    *p_key_index = key_index - 2;
+    return recycled;
 }
 
 uint16_t ftl_gc_imp_app_cb(void)
@@ -274,36 +653,9 @@ L_retry:
     }
 
     // drop or copy it
-    for (; key_index >= 3; key_index -= 2)
+    while (key_index >= 3)
     {
-        uint32_t key = ftl_page_read(g_pPage + Recycle_page, key_index);
-        uint32_t rdata = ftl_page_read(g_pPage + Recycle_page, key_index - 1);
-        if (!ftl_crc_key_check(key, rdata)) //need or not,? slown down gc speed
-        {
-            uint16_t addr = key & 0xffff;
-
-            if (ftl_page_can_addr_drop_app(addr, Recycle_page))
-            {
-                // drop / recycle
-                //DPRINTF("drop [%d] addr: 0x%08x \n", candidate_key_index, candidate_addr);
-
-                ++RecycleNum;
-            }
-            else
-            {
-                // copy it
-                uint32_t rdata = ftl_page_read(g_pPage + Recycle_page, key_index - 1);
-
-                // write to another place
-                ftl_write_app_cb(addr, rdata);    //todo:check if need assert rdata is all FF?
-            }
-        }
-        else
-        {
-            FLASH_PRINT_ERROR4("ftl_page_garbage_collect_Imp:check crc fail!recycle page:%x, retry_count:%x, index:%x, read value:%x",
-                               Recycle_page, retry_count, key_index, key);
-            ++RecycleNum;
-        }
+        RecycleNum += ftl_gc_entry(Recycle_page, &key_index);
     }
     ftl_buffer_write_back();
 
@@ -332,6 +684,182 @@ L_retry:
     return RecycleNum;
 }
 
+static uint8_t ftl_gc_page_changed(void)
+{
+    return (ftl_page_is_valid(g_pPage + ftl_gc_sm.page_id) ||
+            (ftl_get_page_seq(g_pPage + ftl_gc_sm.page_id) != ftl_gc_sm.sequence)) ? 1 : 0;
+}
+
+static uint32_t ftl_latency_us(uint32_t start_tick)
+{
+    return FTL_TICK_TO_US((platform_vendor_tick() - start_tick) & FTL_TICK_MASK);
+}
+
+//count a write of app, copies of gc are not counted
+static void ftl_latency_write_done(uint32_t start_tick)
+{
+    if (g_doingGarbageCollection || ftl_gc_sm.running)
+    {
+        return;
+    }
+
+    uint32_t latency = ftl_latency_us(start_tick);
+    ftl_latency_stat.write_count++;
+    if (latency > ftl_latency_stat.write_max_us)
+    {
+        ftl_latency_stat.write_max_us = latency;
+    }
+}
+
+static void ftl_latency_read_done(uint32_t start_tick, uint8_t cache_hit)
+{
+    uint32_t latency = ftl_latency_us(start_tick);
+    ftl_latency_stat.read_count++;
+    ftl_latency_stat.read_cache_hit_count += cache_hit;
+    if (latency > ftl_latency_stat.read_max_us)
+    {
+        ftl_latency_stat.read_max_us = latency;
+    }
+}
+
+//the page switch formats the next page, do it in idle instead of the write which fills the page
+static uint8_t ftl_gc_page_tail(void)
+{
+    return ((g_free_cell_index + ftl_buffer_sm.write_index + FTL_GC_PAGE_TAIL_CELLS) >= PAGE_element) &&
+           (ftl_get_free_page_count() > 0);
+}
+
+bool ftl_gc_pending_app(void)
+{
+    if ((ftl_gc_sm.state != FTL_GC_SM_IDLE) || ftl_gc_page_tail())
+    {
+        return true;
+    }
+
+    if (ftl_gc_sm.hold && (ftl_gc_sm.hold_page == g_cur_pageID))
+    {
+        return false;
+    }
+
+    return (ftl_get_free_page_count() <= FTL_GC_FREE_PAGE_LOW);
+}
+
+bool ftl_gc_idle_app(uint16_t entry_num)
+{
+    uint8_t sem_flag = false;
+    uint32_t start_tick = platform_vendor_tick();
+
+    if (!ftl_gc_pending_app())
+    {
+        return false;
+    }
+
+    if ((NULL != ftl_sem) && (taskSCHEDULER_NOT_STARTED != xTaskGetSchedulerState()))
+    {
+        //never block the idle task, try in next slice
+        if (os_mutex_take(ftl_sem, 0) != true)
+        {
+            return true;
+        }
+        sem_flag = true;
+    }
+
+    ftl_gc_sm.running = 1;
+    if (ftl_gc_page_tail())
+    {
+        //pad pairs are dropped by gc, the last one triggers the switch
+        uint16_t pad_num = (PAGE_element - (g_free_cell_index + ftl_buffer_sm.write_index)) / 2;
+        while (pad_num--)
+        {
+            ftl_buffer_push(WRITABLE_32BIT);
+            ftl_buffer_push(FTL_RECORD_PAD_KEY);
+        }
+        ftl_latency_stat.gc_switch_count++;
+    }
+    else
+    {
+        if (ftl_gc_sm.state == FTL_GC_SM_IDLE)
+        {
+            ftl_gc_sm.hold = 0;
+            ftl_gc_sm.page_id = ftl_page_get_oldest();
+            if (ftl_gc_sm.page_id == g_cur_pageID)
+            {
+                ftl_gc_sm.hold = 1;
+                ftl_gc_sm.hold_page = g_cur_pageID;
+            }
+            else
+            {
+                ftl_gc_sm.sequence = ftl_get_page_seq(g_pPage + ftl_gc_sm.page_id);
+                ftl_gc_sm.free_page_count = ftl_get_free_page_count();
+                if (ftl_get_page_end_position(g_pPage + ftl_gc_sm.page_id, &ftl_gc_sm.key_index))
+                {
+                    ftl_gc_sm.key_index = PAGE_element - 1;
+                }
+                ftl_gc_sm.state = FTL_GC_SM_COPY;
+            }
+        }
+        else if (ftl_gc_page_changed())
+        {
+            //collected by inline gc
+            ftl_gc_sm.state = FTL_GC_SM_IDLE;
+        }
+
+        if (ftl_gc_sm.state == FTL_GC_SM_COPY)
+        {
+            while (entry_num-- && (ftl_gc_sm.key_index >= 3))
+            {
+                ftl_gc_entry(ftl_gc_sm.page_id, &ftl_gc_sm.key_index);
+                if (ftl_gc_page_changed())
+                {
+                    ftl_gc_sm.state = FTL_GC_SM_IDLE;
+                    break;
+                }
+            }
+
+            if ((ftl_gc_sm.state == FTL_GC_SM_COPY) && (ftl_gc_sm.key_index < 3))
+            {
+                //copies must be in flash before the page is erased
+                ftl_buffer_write_back();
+                ftl_gc_sm.state = FTL_GC_SM_ERASE;
+            }
+        }
+        else if (ftl_gc_sm.state == FTL_GC_SM_ERASE)
+        {
+            if (ftl_page_erase(g_pPage + ftl_gc_sm.page_id))
+            {
+                ftl_latency_stat.gc_erase_count++;
+            }
+            g_free_page_count = ftl_get_free_page_count();
+            if (g_free_page_count <= ftl_gc_sm.free_page_count)
+            {
+                ftl_gc_sm.hold = 1;
+                ftl_gc_sm.hold_page = g_cur_pageID;
+            }
+            ftl_gc_sm.state = FTL_GC_SM_IDLE;
+        }
+    }
+    ftl_gc_sm.running = 0;
+
+    if (sem_flag)
+    {
+        os_mutex_give(ftl_sem);
+    }
+
+    uint32_t latency = ftl_latency_us(start_tick);
+    ftl_latency_stat.gc_slice_count++;
+    if (latency > ftl_latency_stat.gc_slice_max_us)
+    {
+        ftl_latency_stat.gc_slice_max_us = latency;
+    }
+
+    return ftl_gc_pending_app();
+}
+
+void ftl_latency_stat_get_app(T_FTL_LATENCY_STAT *p_stat)
+{
+    *p_stat = ftl_latency_stat;
+}
+
 
 void ftl_recover_from_power_lost_app(void)
 {
@@ -365,7 +893,31 @@ void ftl_recover_from_power_lost_app(void)
     {
         uint32_t key = ftl_page_read(g_pPage + Recycle_page, key_index);
         uint32_t rdata = ftl_page_read(g_pPage + Recycle_page, key_index - 1);
-        if (!ftl_crc_key_check(key, rdata))
+        if (key == FTL_RECORD_PAD_KEY)
+        {
+            ++RecycleNum;
+        }
+        else if (ftl_record_check(Recycle_page, key_index, key))
+        {
+            uint8_t word_num = FTL_RECORD_WORD_NUM(key);
+            uint32_t live_mask = ftl_record_live_mask(Recycle_page, key);
+            if (!live_mask)
+            {
+                ++RecycleNum;
+            }
+            else if ((g_free_cell_index + ftl_buffer_sm.write_index + FTL_RECORD_CELL_NUM(word_num)) <
+                     PAGE_element)
+            {
+                --RecycleNum;
+                ftl_record_copy(Recycle_page, key_index, key, live_mask);
+            }
+            else
+            {
+                ++later_to_write_item_num;
+            }
+            key_index -= FTL_RECORD_CELL_NUM(word_num) - 2;
+        }
+        else if (!(key & FTL_RECORD_FLAG) && !ftl_crc_key_check(key, rdata))
         {
             uint16_t addr = key & 0xffff;
 
@@ -410,6 +962,7 @@ void ftl_recover_from_power_lost_app(void)
     if (handle_error)
     {
         ftl_ioctl(FTL_IOCTL_CLEAR_ALL, 0, 0);
+        ftl_map_reset();
         FLASH_PRINT_WARN0("recovery FTL fail... clean all");
     }
 
@@ -425,46 +978,7 @@ read from buffer:30us
 read from buffer+flash:74.5us
 read from just flash:70us */
 
-//4:crc error, 1:not found, 0 success
-uint32_t ftl_buffer_read(uint16_t logical_addr, uint32_t *value)
-{
-    uint32_t ret = FTL_READ_SUCCESS;
-    if (ftl_buffer_sm.write_index == 0)
-    {
-        return FTL_READ_ERROR_READ_NOT_FOUND;
-    }
-
-    uint8_t write_index = ftl_buffer_sm.write_index;
-    for (; write_index >= 2; write_index -= 2)
-    {
-        uint32_t key = ftl_buffer_sm.pFtl_buf[write_index - 1];
-        uint32_t data = ftl_buffer_sm.pFtl_buf[write_index - 2];
-        uint16_t addr = key & 0xffff;
-        if (addr == logical_addr)
-        {
-            if (!ftl_crc_key_check(key, data))
-            {
-                //data valid
-                *value = data;
-                return FTL_READ_SUCCESS;
-
-            }
-            else
-            {
-                //if check addr pass but check crc fail, go to read pre data,so not return directly
-                //so may not return the newest valid data
-                ret = FTL_READ_ERROR_CRC_FAIL;
-            }
-        }
-
-    }
-    ret = FTL_READ_ERROR_READ_NOT_FOUND;
-
-    return ret;
-
-}
-
-// logical_addr is 4 bytes alignment addr
+// logical_addr is 4 bytes alignment addr, the word may be held by a record
 uint32_t ftl_read_app_cb(uint16_t logical_addr, uint32_t *value)
 {
     uint32_t ret = FTL_READ_SUCCESS;
@@ -478,134 +992,79 @@ uint32_t ftl_read_app_cb(uint16_t logical_addr, uint32_t *value)
     }
     else
     {
-        uint32_t r_data;
-        ret = ftl_buffer_read(logical_addr, &r_data);
-        if (!ret)
+        T_FTL_CURSOR cursor;
+        uint8_t  found = 0;
+        uint8_t  cache_hit = 0;
+        uint32_t cache_gen = ftl_cache_gen;
+        uint32_t start_tick = platform_vendor_tick();
+
+        if (ftl_cache_get(logical_addr, value))
         {
-            *value = r_data;
-#if (TEST_FTL_SPEED == 0)
-            FLASH_PRINT_WARN3("[ftl_cb] br 0x%08x: 0x%08x (%d)\r\n", logical_addr, *value, ret);
-#endif
-            return FTL_READ_SUCCESS;
+            found = 1;
+            cache_hit = 1;
         }
-        else
+        else if (NULL != ftl_map_table)
         {
-            if (ret == FTL_READ_ERROR_CRC_FAIL)
+            uint16_t map_value = ftl_map_get(logical_addr);
+            if (map_value == 0)//0 means invalid logical address
+            {
+                FLASH_PRINT_ERROR2("[ftl_cb] invalid logical address! func: %s, line: %d", __FUNCTION__, __LINE__);
+                ret = FTL_READ_ERROR_READ_NOT_FOUND;
+            }
+            else
             {
-                FLASH_PRINT_ERROR3("[ftl_cb]check crc key error! func: %s,logical addr 0x%x,line: %d", __FUNCTION__,
-                                   logical_addr, __LINE__);
+                //key of the newest entry, the data of a record are below it
+                ftl_cursor_at(&cursor, FTL_MAP_PAGE(map_value), FTL_MAP_KEY_INDEX(map_value));
+                if (ftl_cursor_overlap(&cursor, logical_addr, 4))
+                {
+                    found = !ftl_cursor_read(&cursor, logical_addr, value);
+                }
+                if (!found)
+                {
+                    //broken after the map was built, fall back to the older data
+                    FLASH_PRINT_ERROR3("[ftl_cb]check mapped entry error! func: %s,logical addr 0x%x,line: %d",
+                                       __FUNCTION__, logical_addr, __LINE__);
+                }
             }
         }
 
-        /*if not found in ram, go to find flash space*/
-        if (!(*(uint8_t *)0x00200357 & BIT2))//test on FPGA
-            //if (OTP->ftl_use_mapping_table == 0)
+        if (!found && (ret != FTL_READ_ERROR_READ_NOT_FOUND))
         {
-            uint8_t  found = 0;
-            uint8_t pageID = g_cur_pageID;
-            int32_t key_index = g_free_cell_index - 1;
-
-L_retry:
-
-            for (; key_index >= 3; key_index -= 2)
+            //search from ftl buffer to the oldest page
+            ftl_cursor_init(&cursor);
+            while (ftl_cursor_next(&cursor, g_PAGE_num))
             {
-                uint32_t key = ftl_page_read(g_pPage + pageID, key_index);
-
-                uint16_t addr = key & 0xffff;
-                if (addr == logical_addr)
+                if (ftl_cursor_overlap(&cursor, logical_addr, 4))
                 {
-                    found = 1;
-                    *value = ftl_page_read(g_pPage + pageID, key_index - 1);
-                    if (!ftl_crc_key_check(key, *value))
+                    ret = ftl_cursor_read(&cursor, logical_addr, value);
+                    if (!ret)
                     {
                         //data valid
-                        ret = FTL_READ_SUCCESS;
-
+                        found = 1;
                         break;
-
                     }
                     else
                     {
+                        //if check addr pass but check crc fail, go to read pre data,so not return directly
+                        //so may not return the newest valid data
                         FLASH_PRINT_ERROR3("[ftl_cb]check crc key error! func: %s,logical addr 0x%x,line: %d", __FUNCTION__,
                                            logical_addr, __LINE__);
-                        ret = FTL_READ_ERROR_CRC_FAIL;  //not return directly , or record check crc fail num?
                     }
-
-                }
-
-            }
-
-            uint8_t prePageID;
-            if (found == 0 && 0 == ftl_get_prev_page(pageID, &prePageID))
-            {
-                uint16_t EndPos;
-
-                if (0 == ftl_get_page_end_position(g_pPage + prePageID, &EndPos))
-                {
-                    key_index = EndPos;
-                    pageID = prePageID;
-
-                    goto L_retry;
-                }
-                else
-                {
-                    //TODO;
-                    // todo, error recovery
-
-                    key_index = PAGE_element - 1;
-                    pageID = prePageID;
-
-                    goto L_retry;
                 }
             }
 
-            if (!found)
+            if (!found && (ret != FTL_READ_ERROR_CRC_FAIL))
             {
                 ret = FTL_READ_ERROR_READ_NOT_FOUND;
                 //ftl_ioctl( FTL_IOCTL_DEBUG,0,0);
             }
         }
-        else
-        {
-            uint16_t phy_addr = read_mapping_table(logical_addr);//index of data element
-
-            if (phy_addr == 0)//0 means invalid logical address
-            {
-                FLASH_PRINT_ERROR2("[ftl_cb] invalid logical address! func: %s, line: %d", __FUNCTION__, __LINE__);
-                return FTL_READ_ERROR_READ_NOT_FOUND;
-            }
-
-            uint8_t pageID = phy_addr / PAGE_element;
-            uint16_t key_index = phy_addr % PAGE_element;
-
-            uint32_t key = ftl_page_read(g_pPage + pageID, key_index + 1);
-
-
-            uint16_t addr = key & 0xffff;
-            if (addr == logical_addr)
-            {
-                *value = ftl_page_read(g_pPage + pageID, key_index);
-                if (!ftl_crc_key_check(key, *value))
-                {
-                    //data valid
-                    ret = 0;
-                }
-                else
-                {
-
-                    FLASH_PRINT_ERROR3("[ftl_cb]check crc key error! func: %s,logical addr 0x%x,line: %d", __FUNCTION__,
-                                       logical_addr, __LINE__);
-                    return FTL_READ_ERROR_CRC_FAIL;  //if use mapping table return directly
-                }
-            }
-            else
-            {
-                ret = FTL_READ_ERROR_PARSE_ERROR;
-                FLASH_PRINT_ERROR2("[ftl_cb] logical address parse error! func: %s, line: %d", __FUNCTION__,
-                                   __LINE__);
-            }
 
+        if (found && !cache_hit)
+        {
+            ftl_cache_put(logical_addr, *value, &cache_gen);
         }
+        ftl_latency_read_done(start_tick, cache_hit);
     }
 
     FLASH_PRINT_INFO3("[ftl_cb] r  0x%08x: 0x%08x (%d)\r\n", logical_addr, *value, ret);
@@ -681,8 +1140,10 @@ uint32_t ftl_buffer_write_back(void)
                 {
                     ret = FTL_WRITE_ERROR_NEED_GC;
                 }
-                else
+                else if (ftl_get_free_page_count() <= FTL_GC_FREE_PAGE_MIN)
                 {
+                    //idle gc does not keep up, collect before the pages run out
+                    ftl_latency_stat.write_gc_count++;
                     ftl_page_garbage_collect(0, PAGE_element / 2);
                     ret = FTL_BUFFER_DATA_WRITE_BACK_DO_GC;
                 }
@@ -709,11 +1170,9 @@ void ftl_buffer_push_key(uint32_t key)
 {
     uint16_t logical_addr = key & 0xffff;
 
-    if (*(uint8_t *)0x00200357 & BIT2) //test on FPGA
-        //if (OTP->ftl_use_mapping_table == 1)
+    if (NULL != ftl_map_table)
     {
-        write_mapping_table(logical_addr, g_cur_pageID, g_free_cell_index + ftl_buffer_sm.write_index - 1);
-
+        ftl_map_set(logical_addr, g_cur_pageID, g_free_cell_index + ftl_buffer_sm.write_index);
     }
     ftl_buffer_push(key);  //may triger write back, and may do gc
 }
@@ -724,6 +1183,7 @@ uint32_t ftl_write_app_cb(uint16_t logical_addr, uint32_t w_data)
 {
     uint32_t ret = FTL_WRITE_SUCCESS;
     uint8_t sem_flag = false;
+    uint32_t start_tick = platform_vendor_tick();
 
     if (0 != __get_IPSR())
     {
@@ -754,72 +1214,244 @@ uint32_t ftl_write_app_cb(uint16_t logical_addr, uint32_t w_data)
         uint32_t key = ftl_crc_key_init(logical_addr, w_data);
 
         ftl_buffer_push_key(key);
-
+        ftl_cache_put(logical_addr, w_data, NULL);
     }
 
     if (sem_flag)
     {
         os_mutex_give(ftl_sem);
     }
+    ftl_latency_write_done(start_tick);
 #if (TEST_FTL_SPEED == 0)
     FLASH_PRINT_WARN3("[ftl_cb] w 0x%08x: 0x%08x (%d)\r\n", logical_addr, w_data, ret);
 #endif
     return ret;
 }
 
-void ftl_mapping_table_init_app(void)
+//push a record of word_num words based at logical_addr, its cells never cross a page
+static uint32_t ftl_record_write(uint16_t logical_addr, uint32_t *p_data, uint8_t word_num)
 {
-    if (NULL == ftl_mapping_table)
+    uint16_t cell_num = FTL_RECORD_CELL_NUM(word_num);
+
+    if ((g_free_cell_index + ftl_buffer_sm.write_index + cell_num) > PAGE_element)
     {
-        uint32_t mapping_table_size = MAPPING_table_size;
-        ftl_mapping_table = os_mem_zalloc(RAM_TYPE_BUFFER_ON,
-                                          mapping_table_size);//table is initialised as 0
+        //fill the page tail with pad pairs, the last one switches to a new page
+        uint16_t pad_num = (PAGE_element - (g_free_cell_index + ftl_buffer_sm.write_index)) / 2;
+        while (pad_num--)
+        {
+            ftl_buffer_push(WRITABLE_32BIT);
+            ftl_buffer_push(FTL_RECORD_PAD_KEY);
+        }
+
+        if ((g_free_cell_index + ftl_buffer_sm.write_index + cell_num) > PAGE_element)
+        {
+            return FTL_WRITE_ERROR_OUT_OF_SPACE;
+        }
     }
 
-    uint8_t pageID = g_cur_pageID;
-    int32_t key_index = g_free_cell_index - 1;
+    uint16_t crc16 = BTXFCS_INIT;
+    for (uint8_t i = 0; i < word_num; ++i)
+    {
+        crc16 = ftl_record_crc_word(crc16, p_data[i]);
+        ftl_buffer_push(p_data[i]);
+    }
+    if (!(word_num & 1))
+    {
+        crc16 = ftl_record_crc_word(crc16, WRITABLE_32BIT);
+        ftl_buffer_push(WRITABLE_32BIT);
+    }
 
-L_retry:
+    uint32_t key = ((uint32_t)(word_num - 1) << FTL_RECORD_WORD_NUM_SHIFT) | logical_addr |
+                   FTL_RECORD_FLAG;
+    crc16 = ftl_record_crc_key(crc16, key);
+    key |= ((uint32_t)crc16 << 16);
 
-    for (; key_index >= 3; key_index -= 2)
+    if (NULL != ftl_map_table)
     {
-        uint32_t key = ftl_page_read(g_pPage + pageID, key_index);
-        uint16_t addr = key & 0xffff;
-        if (!read_mapping_table(addr))
+        for (uint8_t i = 0; i < word_num; ++i)
         {
-            write_mapping_table(addr, pageID, key_index - 1);
+            ftl_map_set(logical_addr + (i << 2), g_cur_pageID,
+                        g_free_cell_index + ftl_buffer_sm.write_index);
         }
     }
+    ftl_buffer_push(key);  //may triger write back, and may do gc
 
-    uint8_t prePageID;
-    if (0 == ftl_get_prev_page(pageID, &prePageID))
+    for (uint8_t i = 0; i < word_num; ++i)
     {
-        uint16_t EndPos;
+        ftl_cache_put(logical_addr + (i << 2), p_data[i], NULL);
+    }
 
-        if (0 == ftl_get_page_end_position(g_pPage + prePageID, &EndPos))
+    return FTL_WRITE_SUCCESS;
+}
+
+uint32_t ftl_record_save(void *pdata, uint16_t offset, uint16_t size)
+{
+    uint32_t ret = FTL_WRITE_SUCCESS;
+    uint8_t sem_flag = false;
+    uint32_t data[FTL_RECORD_WORD_MAX];
+    uint32_t start_tick = platform_vendor_tick();
+
+    if ((NULL == pdata) || (0 == size) || (size > FTL_RECORD_SIZE_MAX) || (size & 0x3))
+    {
+        return FTL_WRITE_ERROR_INVALID_PARAMETER;
+    }
+
+    if ((offset & ~FTL_RECORD_ADDR_MASK) || (offset + size > FTL_RECORD_ADDR_MAX) ||
+        ftl_check_logical_addr(offset) || ftl_check_logical_addr(offset + size - 4))
+    {
+        FLASH_PRINT_ERROR2("[ftl_cb]check addr error! func: %s,logical addr 0x%x", __FUNCTION__,
+                           offset);
+        return FTL_WRITE_ERROR_INVALID_ADDR;
+    }
+
+    if (0 != __get_IPSR())
+    {
+        FLASH_PRINT_WARN0("[ftl_cb] FTL_write should not be called in interrupt handler!\n");
+        return FTL_WRITE_ERROR_IN_INTR;
+    }
+
+    if ((NULL != ftl_sem) && (taskSCHEDULER_NOT_STARTED != xTaskGetSchedulerState()))
+    {
+        if (os_mutex_take(ftl_sem, portMAX_DELAY) == true)
         {
-            key_index = EndPos;
-            pageID = prePageID;
+            sem_flag = true;
+        }
+    }
 
-            goto L_retry;
+    memcpy(data, pdata, size);
+    ret = ftl_record_write(offset, data, size >> 2);
+
+    if (sem_flag)
+    {
+        os_mutex_give(ftl_sem);
+    }
+    ftl_latency_write_done(start_tick);
+#if (TEST_FTL_SPEED == 0)
+    FLASH_PRINT_WARN3("[ftl_cb] rw 0x%08x: %d (%d)\r\n", offset, size, ret);
+#endif
+    return ret;
+}
+
+uint32_t ftl_record_load(void *pdata, uint16_t offset, uint16_t size)
+{
+    uint32_t ret = FTL_READ_SUCCESS;
+    T_FTL_CURSOR cursor;
+    uint8_t found = 0;
+
+    if ((NULL == pdata) || (0 == size) || (size & 0x3))
+    {
+        return FTL_READ_ERROR_INVALID_PARAMETER;
+    }
+
+    if (ftl_check_logical_addr(offset) || ftl_check_logical_addr(offset + size - 4))
+    {
+        FLASH_PRINT_ERROR2("[ftl_cb]check addr align error! func: %s,logical addr 0x%x", __FUNCTION__,
+                           offset);
+        return FTL_READ_ERROR_INVALID_LOGICAL_ADDR;
+    }
+
+    //the newest entry holding any word of the range must be a record of just the range
+    if (NULL == ftl_map_table)
+    {
+        ftl_cursor_init(&cursor);
+        while (ftl_cursor_next(&cursor, g_PAGE_num))
+        {
+            if (ftl_cursor_overlap(&cursor, offset, size))
+            {
+                found = cursor.record;
+                break;
+            }
         }
-        else
+    }
+    else
+    {
+        uint16_t map_value = ftl_map_get(offset);
+        found = (map_value != 0);
+        for (uint16_t addr = offset + 4; found && (addr < offset + size); addr += 4)
         {
-            //TODO;
-            // todo, error recovery
-
-            key_index = PAGE_element - 1;
-            pageID = prePageID;
+            found = (ftl_map_get(addr) == map_value);
+        }
+        if (found)
+        {
+            ftl_cursor_at(&cursor, FTL_MAP_PAGE(map_value), FTL_MAP_KEY_INDEX(map_value));
+            found = cursor.record;
+        }
+    }
 
-            goto L_retry;
+    if (found && ((cursor.key & FTL_RECORD_ADDR_MASK) == offset) &&
+        (FTL_RECORD_WORD_NUM(cursor.key) * 4 == size))
+    {
+        uint16_t data_index = cursor.key_index + 1 - FTL_RECORD_CELL_NUM(size >> 2);
+        for (uint16_t i = 0; i < (size >> 2); ++i)
+        {
+            uint32_t data = ftl_cell_read(cursor.page_id, data_index + i);
+            memcpy((uint8_t *)pdata + (i << 2), &data, 4);
+        }
+    }
+    else
+    {
+        //words saved alone or by other records
+        for (uint16_t i = 0; i < size; i += 4)
+        {
+            uint32_t data;
+            ret = ftl_read_app_cb(offset + i, &data);
+            if (ret)
+            {
+                break;
+            }
+            memcpy((uint8_t *)pdata + i, &data, 4);
         }
     }
 
+    return ret;
 }
 
+//build the mapping table with one pass from the newest entry, reads do not scan the pages then
+void ftl_mapping_table_init_app(void)
+{
+    if ((NULL == ftl_map_table) && (g_PAGE_num * FTL_MAP_PAGE_ENTRY_NUM <= (1 << LOGIC_ADDR_MAP_BIT_NUM)))
+    {
+        ftl_map_table = os_mem_zalloc(RAM_TYPE_BUFFER_ON, FTL_MAP_TABLE_SIZE);
+    }
+    ftl_map_reset();
+    if (NULL == ftl_map_table)
+    {
+        FLASH_PRINT_WARN0("[ftl_cb] no mapping table, reads scan the pages");
+        return;
+    }
+
+    //newest entry first, so an addr is mapped to its latest value
+    T_FTL_CURSOR cursor;
+    ftl_cursor_init(&cursor);
+    while (ftl_cursor_next(&cursor, g_PAGE_num))
+    {
+        if (cursor.record)
+        {
+            //all words of a record are mapped to its key
+            uint16_t addr = cursor.key & FTL_RECORD_ADDR_MASK;
+            for (uint8_t i = 0; i < FTL_RECORD_WORD_NUM(cursor.key); ++i, addr += 4)
+            {
+                if (!ftl_map_get(addr))
+                {
+                    ftl_map_set(addr, cursor.page_id, cursor.key_index);
+                }
+            }
+        }
+        else if (cursor.valid)
+        {
+            uint16_t addr = cursor.key & 0xffff;
+            if (!ftl_map_get(addr))
+            {
+                ftl_map_set(addr, cursor.page_id, cursor.key_index);
+            }
+        }
+    }
+}
 
 uint32_t ftl_init_app_cb(uint32_t u32PageStartAddr, uint8_t pagenum)
 {
+    uint32_t start_tick = platform_vendor_tick();
+
     if (ftl_sem == NULL)
     {
         os_mutex_create(&ftl_sem);
@@ -898,6 +1530,11 @@ uint32_t ftl_init_app_cb(uint32_t u32PageStartAddr, uint8_t pagenum)
             break;
         }
     }
+    //a data written without its key, keep the entries in pairs
+    if ((free_cell_index & 1) && (free_cell_index + 1 < PAGE_element))
+    {
+        ++free_cell_index;
+    }
 
     g_cur_pageID = cur_pageID;
     g_free_cell_index = free_cell_index;
@@ -905,15 +1542,13 @@ uint32_t ftl_init_app_cb(uint32_t u32PageStartAddr, uint8_t pagenum)
     ftl_ioctl(FTL_IOCTL_DEBUG, 0, 0);
 
     ftl_buffer_sm_init();
+    memset(&ftl_gc_sm, 0, sizeof(ftl_gc_sm));
 
-    //if (OTP->ftl_use_mapping_table == 1)
-    if (*(uint8_t *)0x00200357 & BIT2)  //test on FPGA
-    {
-        ftl_mapping_table_init_app();
-    }
+    ftl_mapping_table_init_app();
     ftl_recover_from_power_lost_app();
 
     g_free_page_count = ftl_get_free_page_count();
+    ftl_latency_stat.init_us = ftl_latency_us(start_tick);
 
     return 0;
 }
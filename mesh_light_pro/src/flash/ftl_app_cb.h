@@ -15,6 +15,7 @@
 #define _FTL_APP_CB_H_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef  __cplusplus
 extern  "C" {
@@ -30,12 +31,89 @@ extern  "C" {
 #define FTL_BUFFER_DATA_WRITE_BACK_SUCCESS      (0x01)
 #define FTL_BUFFER_DATA_WRITE_BACK_DO_GC        (0x02)
 
+#define FTL_RECORD_SIZE_MAX                     (64)    //!< bytes stored under one record key
+#define FTL_RECORD_ADDR_MAX                     (4096)  //!< records are kept below this logical addr
+
+#define FTL_GC_FREE_PAGE_LOW                    (2)     //!< idle gc starts at this free page count
+#define FTL_GC_FREE_PAGE_MIN                    (1)     //!< writes collect garbage inline at this free page count
+#define FTL_GC_SLICE_ENTRY_NUM                  (8)     //!< entries checked by an idle gc slice
+#define FTL_GC_PAGE_TAIL_CELLS                  (32)    //!< idle gc switches page at this free cell count
+
+typedef struct
+{
+    uint32_t write_count;       //!< ftl_write_app_cb and ftl_record_save calls of the app
+    uint32_t write_max_us;      //!< worst latency of these calls
+    uint32_t write_gc_count;    //!< calls which had to collect garbage inline
+    uint32_t gc_slice_count;    //!< idle gc slices
+    uint32_t gc_slice_max_us;   //!< worst latency of a slice, page erase included
+    uint32_t gc_erase_count;    //!< pages erased by idle gc
+    uint32_t gc_switch_count;   //!< pages switched by idle gc ahead of a write
+    uint32_t read_count;        //!< ftl_read_app_cb calls
+    uint32_t read_cache_hit_count;  //!< reads served by the read cache
+    uint32_t read_max_us;       //!< worst latency of a read
+    uint32_t init_us;           //!< latency of ftl_init_app_cb, mapping table build included
+} T_FTL_LATENCY_STAT;
+
 uint32_t ftl_init_app_cb(uint32_t u32PageStartAddr, uint8_t pagenum);
 uint32_t ftl_read_app_cb(uint16_t logical_addr, uint32_t *value);
 uint32_t ftl_write_app_cb(uint16_t logical_addr, uint32_t w_data);
 uint16_t ftl_gc_imp_app_cb(void);
 uint32_t ftl_buffer_write_back(void);
 
+/**
+    * @brief    Save data to ftl as one record
+    * @param    pdata  specify data buffer
+    * @param    offset specify FTL offset to store, 4 bytes aligned and below FTL_RECORD_ADDR_MAX
+    * @param    size   size to store, 4 bytes aligned
+    *     @arg  Min: 4
+    *     @arg  Max: FTL_RECORD_SIZE_MAX
+    * @return   status
+    * @retval   0  status successful
+    * @retval   otherwise fail
+    * @note     the words share one key and one crc instead of a key per word, the record
+    *           can be read back by ftl_record_load or ftl_load, ftl_save to part of it
+    *           overrides that part only
+    */
+uint32_t ftl_record_save(void *pdata, uint16_t offset, uint16_t size);
+
+/**
+    * @brief    Load data saved by ftl_record_save
+    * @param    pdata  specify data buffer
+    * @param    offset specify FTL offset to load
+    * @param    size   size to load, 4 bytes aligned
+    * @return   status
+    * @retval   0  status successful
+    * @retval   otherwise fail
+    * @note     the range is loaded word by word as ftl_load does when its newest data is
+    *           not a single record of the same offset and size
+    */
+uint32_t ftl_record_load(void *pdata, uint16_t offset, uint16_t size);
+
+/**
+    * @brief    Check whether idle gc has work to do
+    * @return   true if free pages are at or below FTL_GC_FREE_PAGE_LOW, a page is being collected
+    *           or the current page is nearly full
+    */
+bool ftl_gc_pending_app(void);
+
+/**
+    * @brief    Run a slice of idle gc
+    * @param    entry_num  entries of the oldest page to drop or copy in this slice
+    * @return   true if more slices are needed
+    * @note     call it from the idle or dlps check hook, a slice copies up to entry_num entries,
+    *           erases the collected page or switches to a new page when the current one has at
+    *           most FTL_GC_PAGE_TAIL_CELLS free cells, so writes of the app never wait on an erase
+    *           unless the free pages fall to FTL_GC_FREE_PAGE_MIN. The slice is skipped if ftl is
+    *           busy in another task.
+    */
+bool ftl_gc_idle_app(uint16_t entry_num);
+
+/**
+    * @brief    Get write, read and gc latency statistics
+    * @param    p_stat  statistics
+    */
+void ftl_latency_stat_get_app(T_FTL_LATENCY_STAT *p_stat);
+
 #ifdef  __cplusplus
 }
 #endif // __cplusplus
@@ -0,0 +1,142 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     ftl_gc_sim.c
+  * @brief    Host benchmark of the idle ftl garbage collection.
+  * @details  The 12 bytes light state is saved again and again on top of 200 stack words, with
+  *           a reboot every 1000 saves. Between two saves the idle task runs no gc slice at all,
+  *           or slices of FTL_GC_SLICE_ENTRY_NUM entries until no more work is pending, up to a
+  *           limit. The worst save latency, the saves which collected garbage inline and the
+  *           slice latency of ftl_latency_stat_get_app are reported with the flash timing of
+  *           ftl_rom_sim.c, for words and records, with and without the mapping table. Build it
+  *           on a linux host with the keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 <keil include path> ftl_gc_sim.c ftl_rom_sim.c
+  *           ftl_app_cb.c -o ftl_gc_sim
+  *           and run it with the number of saves and the slice limit between two saves,
+  *           e.g. ./ftl_gc_sim 10000 20
+  * @author   bill
+  * @date     2018-12-24
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ftl.h"
+#include "ftl_app_cb.h"
+#include "ftl_rom_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define FTL_GC_SIM_STACK_WORDS              200
+#define FTL_GC_SIM_LIGHT_ADDR               1904 //!< 12 bytes light state
+
+extern T_FTL_LATENCY_STAT ftl_latency_stat;
+
+static uint8_t ftl_gc_sim_shadow[FTL_GC_SIM_LIGHT_ADDR + 12];
+static uint64_t ftl_gc_sim_rng = 1;
+
+static uint32_t ftl_gc_sim_rand(void)
+{
+    /* xorshift64* */
+    ftl_gc_sim_rng ^= ftl_gc_sim_rng >> 12;
+    ftl_gc_sim_rng ^= ftl_gc_sim_rng << 25;
+    ftl_gc_sim_rng ^= ftl_gc_sim_rng >> 27;
+    return (uint32_t)((ftl_gc_sim_rng * 2685821657736338717ULL) >> 32);
+}
+
+static void ftl_gc_sim_fill(uint8_t *pdata, uint16_t size)
+{
+    for (uint16_t i = 0; i < size; ++i)
+    {
+        pdata[i] = ftl_gc_sim_rand();
+    }
+}
+
+/* return the read back failures */
+static uint32_t ftl_gc_sim_run(bool record, bool mapping, uint32_t saves, uint32_t slices)
+{
+    ftl_sim_map_alloc_fail(!mapping);
+    ftl_sim_flash_init(FTL_SIM_PAGE_NUM);
+    ftl_sim_reboot();
+    ftl_gc_sim_rng = 3;
+    ftl_gc_sim_fill(ftl_gc_sim_shadow, FTL_GC_SIM_STACK_WORDS * 4);
+    ftl_save(ftl_gc_sim_shadow, 0, FTL_GC_SIM_STACK_WORDS * 4);
+    memset(&ftl_latency_stat, 0, sizeof(ftl_latency_stat));
+    ftl_sim_stat_t begin;
+    ftl_sim_stat_get(&begin);
+
+    uint8_t *plight = ftl_gc_sim_shadow + FTL_GC_SIM_LIGHT_ADDR;
+    for (uint32_t n = 0; n < saves; ++n)
+    {
+        ftl_gc_sim_fill(plight, 12);
+        if (record)
+        {
+            ftl_record_save(plight, FTL_GC_SIM_LIGHT_ADDR, 12);
+        }
+        else
+        {
+            ftl_save(plight, FTL_GC_SIM_LIGHT_ADDR, 12);
+        }
+        for (uint32_t k = 0; (k < slices) && ftl_gc_idle_app(FTL_GC_SLICE_ENTRY_NUM); ++k)
+        {
+        }
+        if (999 == n % 1000)
+        {
+            ftl_buffer_write_back();
+            ftl_sim_reboot();
+        }
+    }
+
+    uint32_t fails = 0;
+    uint8_t buf[FTL_GC_SIM_STACK_WORDS * 4];
+    if (ftl_load(buf, 0, sizeof(buf)) || memcmp(buf, ftl_gc_sim_shadow, sizeof(buf)))
+    {
+        fails ++;
+    }
+    if (ftl_load(buf, FTL_GC_SIM_LIGHT_ADDR, 12) || memcmp(buf, plight, 12))
+    {
+        fails ++;
+    }
+
+    T_FTL_LATENCY_STAT stat;
+    ftl_latency_stat_get_app(&stat);
+    ftl_sim_stat_t end;
+    ftl_sim_stat_get(&end);
+    printf("%-6s %-10s idle %-2u: save max %6u us, inline gc %3u (rom gc %3u), slices %5u max %5u us, "
+           "idle erases %3u, idle switches %3u, erases %3u, fails %u\n", record ? "record" : "word",
+           mapping ? "mapping" : "no mapping", slices, stat.write_max_us, stat.write_gc_count,
+           end.gc_count - begin.gc_count, stat.gc_slice_count, stat.gc_slice_max_us,
+           stat.gc_erase_count, stat.gc_switch_count, end.erase_count - begin.erase_count, fails);
+    return fails;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t saves = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+    uint32_t slices = (argc > 2) ? strtoul(argv[2], NULL, 0) : 20;
+    uint32_t fails = 0;
+    bool inline_gc = false;
+
+    for (uint8_t mapping = 0; mapping < 2; ++mapping)
+    {
+        for (uint8_t record = 0; record < 2; ++record)
+        {
+            fails += ftl_gc_sim_run(record, mapping, saves, 0);
+            fails += ftl_gc_sim_run(record, mapping, saves, slices);
+            T_FTL_LATENCY_STAT stat;
+            ftl_latency_stat_get_app(&stat);
+            inline_gc = inline_gc || (stat.write_gc_count > 0);
+        }
+    }
+
+    /* with idle slices the saves must never wait on a page erase */
+    bool fail = fails || (slices && inline_gc);
+    printf("%s\n", fail ? "FAIL" : "PASS");
+    return fail ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
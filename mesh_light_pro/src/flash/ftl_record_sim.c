@@ -0,0 +1,241 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     ftl_record_sim.c
+  * @brief    Host benchmark of the ftl records.
+  * @details  The stack words, the power on count and 16 scenes are saved, then the 12 bytes
+  *           light state is saved again and again, word by word with ftl_save or as one record
+  *           with ftl_record_save, with and without the mapping table. The programmed cells,
+  *           the pages consumed and the pages collected by the rom gc loop are reported, and all
+  *           data is read back after a reboot. A fuzz of records, words, idle gc and reboots is
+  *           checked against a shadow copy at last. Build it on a linux host with the keil
+  *           include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 <keil include path> ftl_record_sim.c ftl_rom_sim.c
+  *           ftl_app_cb.c -o ftl_record_sim
+  *           and run it with the number of light state saves and fuzz operations,
+  *           e.g. ./ftl_record_sim 10000 100000
+  * @author   bill
+  * @date     2018-12-24
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ftl.h"
+#include "ftl_app_cb.h"
+#include "ftl_rom_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define FTL_RECORD_SIM_SPACE                4096 //!< logical space used by the fuzz
+#define FTL_RECORD_SIM_STACK_WORDS          200
+#define FTL_RECORD_SIM_POWER_ADDR           1900
+#define FTL_RECORD_SIM_LIGHT_ADDR           1904 //!< 12 bytes light state
+#define FTL_RECORD_SIM_SCENE_ADDR           1916 //!< 16 scenes x 16 bytes
+
+static uint8_t ftl_record_sim_shadow[FTL_RECORD_SIM_SPACE];
+static uint8_t ftl_record_sim_written[FTL_RECORD_SIM_SPACE / 4];
+static uint32_t ftl_record_sim_fails;
+static uint64_t ftl_record_sim_rng = 1;
+
+static uint32_t ftl_record_sim_rand(void)
+{
+    /* xorshift64* */
+    ftl_record_sim_rng ^= ftl_record_sim_rng >> 12;
+    ftl_record_sim_rng ^= ftl_record_sim_rng << 25;
+    ftl_record_sim_rng ^= ftl_record_sim_rng >> 27;
+    return (uint32_t)((ftl_record_sim_rng * 2685821657736338717ULL) >> 32);
+}
+
+static void ftl_record_sim_fill(uint8_t *pdata, uint16_t size)
+{
+    for (uint16_t i = 0; i < size; ++i)
+    {
+        pdata[i] = ftl_record_sim_rand();
+    }
+}
+
+static uint32_t ftl_record_sim_save(bool record, uint16_t offset, uint16_t size)
+{
+    uint8_t *pdata = ftl_record_sim_shadow + offset;
+    return record ? ftl_record_save(pdata, offset, size) : ftl_save(pdata, offset, size);
+}
+
+static void ftl_record_sim_check(uint16_t offset, uint16_t size, bool record)
+{
+    uint8_t buf[256];
+    uint32_t ret = record ? ftl_record_load(buf, offset, size) : ftl_load(buf, offset, size);
+    if (ret || memcmp(buf, ftl_record_sim_shadow + offset, size))
+    {
+        if (ftl_record_sim_fails < 10)
+        {
+            printf("  offset %u size %u read back wrong, ret %u\n", offset, size, ret);
+        }
+        ftl_record_sim_fails ++;
+    }
+}
+
+static void ftl_record_sim_bench(bool record, bool mapping, uint32_t saves)
+{
+    ftl_sim_map_alloc_fail(!mapping);
+    ftl_sim_flash_init(FTL_SIM_PAGE_NUM);
+    ftl_sim_reboot();
+    memset(ftl_record_sim_shadow, 0, sizeof(ftl_record_sim_shadow));
+    ftl_record_sim_fails = 0;
+    ftl_record_sim_rng = 1;
+
+    /* live data of the stack and the light */
+    ftl_record_sim_fill(ftl_record_sim_shadow, FTL_RECORD_SIM_STACK_WORDS * 4);
+    ftl_record_sim_save(false, 0, FTL_RECORD_SIM_STACK_WORDS * 4);
+    ftl_record_sim_fill(ftl_record_sim_shadow + FTL_RECORD_SIM_POWER_ADDR, 4 + 12 + 16 * 16);
+    ftl_record_sim_save(false, FTL_RECORD_SIM_POWER_ADDR, 4);
+    for (uint16_t i = 0; i < 16; ++i)
+    {
+        ftl_record_sim_save(record, FTL_RECORD_SIM_SCENE_ADDR + i * 16, 16);
+    }
+
+    ftl_sim_stat_t begin;
+    ftl_sim_stat_get(&begin);
+    for (uint32_t n = 0; n < saves; ++n)
+    {
+        ftl_record_sim_fill(ftl_record_sim_shadow + FTL_RECORD_SIM_LIGHT_ADDR, 12);
+        uint32_t ret = ftl_record_sim_save(record, FTL_RECORD_SIM_LIGHT_ADDR, 12);
+        if (ret)
+        {
+            printf("  save failed %u\n", ret);
+            ftl_record_sim_fails ++;
+        }
+        if (0 == n % 97)
+        {
+            ftl_record_sim_check(FTL_RECORD_SIM_LIGHT_ADDR, 12, record);
+        }
+    }
+    ftl_buffer_write_back();
+    ftl_sim_stat_t end;
+    ftl_sim_stat_get(&end);
+
+    ftl_sim_reboot();
+    for (uint16_t i = 0; i < FTL_RECORD_SIM_STACK_WORDS * 4; i += 32)
+    {
+        ftl_record_sim_check(i, 32, false);
+    }
+    ftl_record_sim_check(FTL_RECORD_SIM_POWER_ADDR, 4, false);
+    ftl_record_sim_check(FTL_RECORD_SIM_LIGHT_ADDR, 12, record);
+    for (uint16_t i = 0; i < 16; ++i)
+    {
+        ftl_record_sim_check(FTL_RECORD_SIM_SCENE_ADDR + i * 16, 16, record);
+    }
+    ftl_record_sim_check(FTL_RECORD_SIM_SCENE_ADDR, 256, false);
+
+    printf("%-6s %-10s: cells %u, pages consumed %u, rom gc %u, erases %u, clear all %u, "
+           "fails %u\n", record ? "record" : "word", mapping ? "mapping" : "no mapping",
+           end.program_count - begin.program_count, end.format_count - begin.format_count,
+           end.gc_count - begin.gc_count, end.erase_count - begin.erase_count,
+           end.clear_all_count, ftl_record_sim_fails);
+}
+
+static void ftl_record_sim_fuzz(bool mapping, uint32_t ops)
+{
+    ftl_sim_map_alloc_fail(!mapping);
+    ftl_sim_flash_init(FTL_SIM_PAGE_NUM);
+    ftl_sim_reboot();
+    memset(ftl_record_sim_shadow, 0, sizeof(ftl_record_sim_shadow));
+    memset(ftl_record_sim_written, 0, sizeof(ftl_record_sim_written));
+    ftl_record_sim_fails = 0;
+    ftl_record_sim_rng = 7 + mapping;
+
+    uint32_t reboots = 0;
+    for (uint32_t n = 0; n < ops; ++n)
+    {
+        uint32_t op = ftl_record_sim_rand() % 10;
+        uint16_t words = 1 + ftl_record_sim_rand() % (FTL_RECORD_SIZE_MAX / 4);
+        if ((op >= 4) && (op < 7))
+        {
+            words = 1 + ftl_record_sim_rand() % 3;
+        }
+        uint16_t offset = (ftl_record_sim_rand() % (FTL_RECORD_SIM_SPACE / 4 - words)) * 4;
+        if (op < 7)
+        {
+            /* a failed save may leave a part of the words, they are not checked any more */
+            uint8_t buf[FTL_RECORD_SIZE_MAX];
+            ftl_record_sim_fill(buf, words * 4);
+            uint32_t ret = (op < 4) ? ftl_record_save(buf, offset, words * 4) :
+                           ftl_save(buf, offset, words * 4);
+            memcpy(ftl_record_sim_shadow + offset, buf, words * 4);
+            memset(ftl_record_sim_written + offset / 4, ret ? 0 : 1, words);
+            if (ret)
+            {
+                printf("  save offset %u size %u failed %u\n", offset, words * 4, ret);
+                ftl_record_sim_fails ++;
+            }
+            continue;
+        }
+
+        bool written = true;
+        for (uint16_t i = 0; i < words; ++i)
+        {
+            written = written && ftl_record_sim_written[offset / 4 + i];
+        }
+        if (written)
+        {
+            ftl_record_sim_check(offset, words * 4, ftl_record_sim_rand() & 1);
+        }
+        if (8 == op)
+        {
+            for (uint32_t k = ftl_record_sim_rand() % 8; k > 0; --k)
+            {
+                ftl_gc_idle_app(1 + ftl_record_sim_rand() % 16);
+            }
+        }
+        else if ((9 == op) && (0 == ftl_record_sim_rand() % 200))
+        {
+            ftl_buffer_write_back();
+            ftl_sim_reboot();
+            reboots ++;
+        }
+    }
+    ftl_buffer_write_back();
+    ftl_sim_reboot();
+    for (uint16_t i = 0; i < FTL_RECORD_SIM_SPACE; i += 4)
+    {
+        if (ftl_record_sim_written[i / 4])
+        {
+            ftl_record_sim_check(i, 4, false);
+        }
+    }
+
+    ftl_sim_stat_t stat;
+    ftl_sim_stat_get(&stat);
+    printf("fuzz %-10s: %u ops, %u reboots, pages consumed %u, rom gc %u, clear all %u, "
+           "fails %u\n", mapping ? "mapping" : "no mapping", ops, reboots, stat.format_count,
+           stat.gc_count, stat.clear_all_count, ftl_record_sim_fails);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t saves = (argc > 1) ? strtoul(argv[1], NULL, 0) : 10000;
+    uint32_t ops = (argc > 2) ? strtoul(argv[2], NULL, 0) : 100000;
+    uint32_t fails = 0;
+
+    for (uint8_t mapping = 0; mapping < 2; ++mapping)
+    {
+        ftl_record_sim_bench(false, mapping, saves);
+        fails += ftl_record_sim_fails;
+        ftl_record_sim_bench(true, mapping, saves);
+        fails += ftl_record_sim_fails;
+    }
+    /* reads scan the pages without the mapping table, keep it short */
+    ftl_record_sim_fuzz(false, ops / 4);
+    fails += ftl_record_sim_fails;
+    ftl_record_sim_fuzz(true, ops);
+    fails += ftl_record_sim_fails;
+
+    printf("%s\n", fails ? "FAIL" : "PASS");
+    return fails ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
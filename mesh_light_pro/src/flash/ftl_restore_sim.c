@@ -0,0 +1,168 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     ftl_restore_sim.c
+  * @brief    Host benchmark of the ftl restore at boot.
+  * @details  The node data is saved once, then the light state, the sequence number, the
+  *           scenes and a node word now and then are saved over and over. After a reboot all of
+  *           it is loaded as the stack and the light do at boot, then the sequence number and the
+  *           light state are loaded again and again as at runtime. The words read from flash and
+  *           the time of the flash timing of ftl_rom_sim.c are reported for the init, the
+  *           restore and the runtime loads, without the mapping table, where every read scans
+  *           the pages from the newest entry, and with it. Build it on a linux host with the
+  *           keil include path, e.g.
+  *           gcc -O2 -DPLATFORM_HOST_SIM=1 <keil include path> ftl_restore_sim.c ftl_rom_sim.c
+  *           ftl_app_cb.c -o ftl_restore_sim
+  *           and run it with the number of light state saves before the reboot,
+  *           e.g. ./ftl_restore_sim 3000
+  * @author   bill
+  * @date     2018-12-24
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ftl.h"
+#include "ftl_app_cb.h"
+#include "ftl_rom_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define FTL_RESTORE_SIM_NODE_WORDS          400 //!< keys, models, subscriptions and groups
+#define FTL_RESTORE_SIM_SEQ_ADDR            1600
+#define FTL_RESTORE_SIM_LIGHT_ADDR          1904 //!< 12 bytes light state
+#define FTL_RESTORE_SIM_SCENE_ADDR          1920 //!< 4 scenes x 12 bytes
+#define FTL_RESTORE_SIM_RESTORE_WORDS       (FTL_RESTORE_SIM_NODE_WORDS + 1 + 3 + 12)
+#define FTL_RESTORE_SIM_HOT_LOOPS           1000
+
+typedef struct
+{
+    uint32_t init_reads;
+    uint64_t init_tick;
+    uint32_t restore_reads;
+    uint64_t restore_tick;
+    uint32_t hot_reads;
+    uint32_t fails;
+} ftl_restore_sim_result_t;
+
+static uint32_t ftl_restore_sim_shadow[4096 / 4];
+static uint64_t ftl_restore_sim_rng = 1;
+
+static uint32_t ftl_restore_sim_rand(void)
+{
+    /* xorshift64* */
+    ftl_restore_sim_rng ^= ftl_restore_sim_rng >> 12;
+    ftl_restore_sim_rng ^= ftl_restore_sim_rng << 25;
+    ftl_restore_sim_rng ^= ftl_restore_sim_rng >> 27;
+    return (uint32_t)((ftl_restore_sim_rng * 2685821657736338717ULL) >> 32);
+}
+
+static void ftl_restore_sim_save(uint16_t offset, uint16_t size)
+{
+    for (uint16_t i = 0; i < size; i += 4)
+    {
+        ftl_restore_sim_shadow[(offset + i) / 4] = ftl_restore_sim_rand();
+    }
+    ftl_save(&ftl_restore_sim_shadow[offset / 4], offset, size);
+}
+
+static uint32_t ftl_restore_sim_load(uint16_t offset, uint16_t size)
+{
+    uint32_t buf[FTL_RESTORE_SIM_NODE_WORDS];
+    return (ftl_load(buf, offset, size) ||
+            memcmp(buf, &ftl_restore_sim_shadow[offset / 4], size)) ? 1 : 0;
+}
+
+static void ftl_restore_sim_run(bool mapping, uint32_t saves, ftl_restore_sim_result_t *presult)
+{
+    ftl_sim_map_alloc_fail(!mapping);
+    ftl_sim_flash_init(FTL_SIM_PAGE_NUM);
+    ftl_sim_reboot();
+    ftl_restore_sim_rng = 11;
+    memset(presult, 0, sizeof(*presult));
+
+    ftl_restore_sim_save(0, FTL_RESTORE_SIM_NODE_WORDS * 4);
+    for (uint32_t n = 0; n < saves; ++n)
+    {
+        ftl_restore_sim_save(FTL_RESTORE_SIM_LIGHT_ADDR, 12);
+        if (0 == n % 10)
+        {
+            ftl_restore_sim_save(FTL_RESTORE_SIM_SEQ_ADDR, 4);
+        }
+        if (0 == n % 100)
+        {
+            ftl_restore_sim_save(FTL_RESTORE_SIM_SCENE_ADDR + (ftl_restore_sim_rand() % 4) * 12, 12);
+        }
+        if (0 == n % 40)
+        {
+            ftl_restore_sim_save((ftl_restore_sim_rand() % FTL_RESTORE_SIM_NODE_WORDS) * 4, 4);
+        }
+    }
+    ftl_buffer_write_back();
+
+    ftl_sim_stat_t begin;
+    ftl_sim_stat_t end;
+    ftl_sim_stat_get(&begin);
+    ftl_sim_reboot();
+    ftl_sim_stat_get(&end);
+    presult->init_reads = end.read_count - begin.read_count;
+    presult->init_tick = end.tick - begin.tick;
+
+    /* boot: the node data word by word, then the light */
+    begin = end;
+    for (uint16_t i = 0; i < FTL_RESTORE_SIM_NODE_WORDS; ++i)
+    {
+        presult->fails += ftl_restore_sim_load(i * 4, 4);
+    }
+    presult->fails += ftl_restore_sim_load(FTL_RESTORE_SIM_SEQ_ADDR, 4);
+    presult->fails += ftl_restore_sim_load(FTL_RESTORE_SIM_LIGHT_ADDR, 12);
+    presult->fails += ftl_restore_sim_load(FTL_RESTORE_SIM_SCENE_ADDR, 48);
+    ftl_sim_stat_get(&end);
+    presult->restore_reads = end.read_count - begin.read_count;
+    presult->restore_tick = end.tick - begin.tick;
+
+    /* runtime: the sequence number and the light state again and again */
+    begin = end;
+    for (uint32_t n = 0; n < FTL_RESTORE_SIM_HOT_LOOPS; ++n)
+    {
+        presult->fails += ftl_restore_sim_load(FTL_RESTORE_SIM_SEQ_ADDR, 4);
+        presult->fails += ftl_restore_sim_load(FTL_RESTORE_SIM_LIGHT_ADDR, 12);
+    }
+    ftl_sim_stat_get(&end);
+    presult->hot_reads = end.read_count - begin.read_count;
+
+    T_FTL_LATENCY_STAT stat;
+    ftl_latency_stat_get_app(&stat);
+    printf("%-10s: init %6u reads %6.1f ms, restore %u words %7u reads %6.1f ms (%.1f per word), "
+           "runtime %u words %7u reads, read max %u us, fails %u\n",
+           mapping ? "mapping" : "no mapping", presult->init_reads,
+           FTL_SIM_TICK_TO_MS(presult->init_tick), FTL_RESTORE_SIM_RESTORE_WORDS,
+           presult->restore_reads, FTL_SIM_TICK_TO_MS(presult->restore_tick),
+           (double)presult->restore_reads / FTL_RESTORE_SIM_RESTORE_WORDS,
+           FTL_RESTORE_SIM_HOT_LOOPS * 4, presult->hot_reads, stat.read_max_us, presult->fails);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t saves = (argc > 1) ? strtoul(argv[1], NULL, 0) : 3000;
+    ftl_restore_sim_result_t before;
+    ftl_restore_sim_result_t after;
+
+    ftl_restore_sim_run(false, saves, &before);
+    ftl_restore_sim_run(true, saves, &after);
+    printf("boot %.1f ms -> %.1f ms\n",
+           FTL_SIM_TICK_TO_MS(before.init_tick + before.restore_tick),
+           FTL_SIM_TICK_TO_MS(after.init_tick + after.restore_tick));
+
+    /* the mapping table must make the boot cheaper */
+    bool fail = before.fails || after.fails ||
+                (after.init_tick + after.restore_tick >= before.init_tick + before.restore_tick);
+    printf("%s\n", fail ? "FAIL" : "PASS");
+    return fail ? 1 : 0;
+}
+
+#endif /* PLATFORM_HOST_SIM */
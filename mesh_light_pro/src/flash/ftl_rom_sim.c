@@ -0,0 +1,351 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     ftl_rom_sim.c
+  * @brief    Host model of the rom ftl page layer.
+  * @details  A page starts with the magic and the sequence of the page, then the end position
+  *           of the previous page, the cells follow. Programming only clears bits, programming a
+  *           word which is not erased aborts the run. The otp and the vendor timer registers
+  *           read by ftl_app_cb.c are mapped at their addresses, the timer counts the flash
+  *           ticks only.
+  * @author   bill
+  * @date     2018-12-24
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Add Includes here */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "os_mem.h"
+#include "os_sync.h"
+#include "trace.h"
+#include "flash_device.h"
+#include "ftl.h"
+#include "ftl_app_cb.h"
+#include "ftl_rom_sim.h"
+
+#if PLATFORM_HOST_SIM
+
+#define FTL_SIM_PAGE_ELEM                   (FMC_PAGE_SIZE / 4)
+#define FTL_SIM_PAGE_MAGIC                  0x5A5A0000
+#define FTL_SIM_PAGE_DATA_NUM               ((FMC_PAGE_SIZE / 8) - 1)
+#define FTL_SIM_OTP_ADDR                    0x00200000 //!< otp config bytes, all zero
+#define FTL_SIM_VENDOR_ADDR                 0x40058000
+#define FTL_SIM_VENDOR_TICK_ADDR            0x4005817C
+
+struct Page_T
+{
+    uint32_t Data[FTL_SIM_PAGE_ELEM];
+};
+
+/* rom globals used by ftl_app_cb.c */
+struct Page_T *g_pPage;
+uint16_t g_free_cell_index;
+uint8_t g_cur_pageID;
+uint8_t g_doingGarbageCollection;
+uint8_t g_PAGE_num;
+uint8_t g_free_page_count;
+void *ftl_sem = &ftl_sem;
+
+extern uint8_t *ftl_map_table;
+
+static ftl_sim_stat_t ftl_sim_stat;
+static bool ftl_sim_alloc_fail;
+
+static void ftl_sim_tick_add(uint32_t tick)
+{
+    ftl_sim_stat.tick += tick;
+    *(volatile uint32_t *)FTL_SIM_VENDOR_TICK_ADDR = (uint32_t)ftl_sim_stat.tick;
+}
+
+static bool ftl_sim_page_valid(struct Page_T *p)
+{
+    return (p->Data[0] & 0xffff0000) == FTL_SIM_PAGE_MAGIC;
+}
+
+uint32_t ftl_page_is_valid(struct Page_T *p)
+{
+    return ftl_sim_page_valid(p) ? 0 : 1;
+}
+
+uint8_t ftl_get_page_seq(struct Page_T *p)
+{
+    return p->Data[0] & 0xff;
+}
+
+uint16_t ftl_get_page_end_position(struct Page_T *p, uint16_t *pEndPos)
+{
+    if (0xffffffff == p->Data[1])
+    {
+        return 1;
+    }
+    *pEndPos = p->Data[1] & 0xffff;
+    return 0;
+}
+
+uint32_t ftl_set_page_end_position(struct Page_T *p, uint16_t Endpos)
+{
+    p->Data[1] &= Endpos;
+    ftl_sim_tick_add(FTL_SIM_TICK_PROGRAM);
+    return 0;
+}
+
+uint32_t ftl_page_read(struct Page_T *p, uint32_t index)
+{
+    ftl_sim_stat.read_count ++;
+    ftl_sim_tick_add(FTL_SIM_TICK_READ);
+    return p->Data[index];
+}
+
+uint32_t ftl_page_write(struct Page_T *p, uint32_t index, uint32_t data)
+{
+    p->Data[index] &= data;
+    ftl_sim_stat.program_count ++;
+    ftl_sim_tick_add(FTL_SIM_TICK_PROGRAM);
+    return 0;
+}
+
+bool ftl_page_erase(struct Page_T *p)
+{
+    memset(p, 0xff, sizeof(*p));
+    ftl_sim_stat.erase_count ++;
+    ftl_sim_tick_add(FTL_SIM_TICK_ERASE);
+    return true;
+}
+
+bool ftl_page_format(struct Page_T *p, uint8_t sequence)
+{
+    ftl_page_erase(p);
+    p->Data[0] = FTL_SIM_PAGE_MAGIC | sequence;
+    ftl_sim_stat.format_count ++;
+    return true;
+}
+
+bool flash_write(uint32_t start_addr, uint32_t data_len, uint8_t *data)
+{
+    uint32_t *dst = (uint32_t *)(uintptr_t)start_addr;
+    for (uint32_t i = 0; i < data_len / 4; ++i)
+    {
+        if (0xffffffff != dst[i])
+        {
+            printf("flash 0x%08x programmed twice\n", start_addr + i * 4);
+            abort();
+        }
+        memcpy(&dst[i], data + i * 4, 4);
+    }
+    ftl_sim_stat.program_count += data_len / 4;
+    ftl_sim_tick_add(FTL_SIM_TICK_PROGRAM * (data_len / 4));
+    return true;
+}
+
+uint8_t ftl_get_prev_page(uint8_t CurPageID, uint8_t *pPrePageID)
+{
+    uint8_t prev = (CurPageID + g_PAGE_num - 1) % g_PAGE_num;
+    if ((prev == g_cur_pageID) || !ftl_sim_page_valid(g_pPage + prev) ||
+        (ftl_get_page_seq(g_pPage + prev) != (uint8_t)(ftl_get_page_seq(g_pPage + CurPageID) - 1)))
+    {
+        return 1;
+    }
+    *pPrePageID = prev;
+    return 0;
+}
+
+uint8_t ftl_page_get_oldest(void)
+{
+    uint8_t page = g_cur_pageID;
+    uint8_t prev;
+    while (0 == ftl_get_prev_page(page, &prev))
+    {
+        page = prev;
+    }
+    return page;
+}
+
+uint8_t ftl_get_free_page_count(void)
+{
+    uint8_t num = 0;
+    for (uint8_t i = 0; i < g_PAGE_num; ++i)
+    {
+        num += ftl_sim_page_valid(g_pPage + i) ? 0 : 1;
+    }
+    return num;
+}
+
+uint32_t ftl_check_logical_addr(uint16_t logical_addr)
+{
+    return ((logical_addr & 3) ||
+            (logical_addr >= (((FTL_SIM_PAGE_DATA_NUM * (g_PAGE_num - 1)) - 1) << 2))) ? 1 : 0;
+}
+
+uint8_t ftl_page_garbage_collect(uint32_t page_thresh, uint32_t cell_thresh)
+{
+    g_doingGarbageCollection = 1;
+    while (ftl_get_free_page_count() < 2)
+    {
+        ftl_gc_imp_app_cb();
+        ftl_sim_stat.gc_count ++;
+    }
+    g_doingGarbageCollection = 0;
+    return 0;
+}
+
+uint32_t ftl_ioctl(uint32_t cmd, uint32_t p1, uint32_t p2)
+{
+    if (FTL_IOCTL_CLEAR_ALL == cmd)
+    {
+        ftl_sim_stat.clear_all_count ++;
+    }
+    return 0;
+}
+
+uint32_t ftl_save(void *pdata, uint16_t offset, uint16_t size)
+{
+    for (uint16_t i = 0; i < size; i += 4)
+    {
+        uint32_t data;
+        memcpy(&data, (uint8_t *)pdata + i, 4);
+        uint32_t ret = ftl_write_app_cb(offset + i, data);
+        if (ret)
+        {
+            return ret;
+        }
+    }
+    return 0;
+}
+
+uint32_t ftl_load(void *pdata, uint16_t offset, uint16_t size)
+{
+    for (uint16_t i = 0; i < size; i += 4)
+    {
+        uint32_t data;
+        uint32_t ret = ftl_read_app_cb(offset + i, &data);
+        if (ret)
+        {
+            return ret;
+        }
+        memcpy((uint8_t *)pdata + i, &data, 4);
+    }
+    return 0;
+}
+
+uint16_t btxfcs(uint16_t fcs, uint8_t *cp, uint32_t len)
+{
+    while (len--)
+    {
+        fcs ^= *cp++;
+        for (uint8_t i = 0; i < 8; ++i)
+        {
+            fcs = (fcs & 1) ? ((fcs >> 1) ^ 0x8408) : (fcs >> 1);
+        }
+    }
+    return fcs;
+}
+
+/* os and log of the rom */
+void vAssertHandler(const char *pFuncName, uint32_t funcLine)
+{
+    printf("assert %s:%u\n", pFuncName, funcLine);
+    abort();
+}
+
+uint32_t xTaskGetSchedulerState(void)
+{
+    return 2; //running
+}
+
+uint32_t os_lock(void)
+{
+    return 0;
+}
+
+void os_unlock(uint32_t s)
+{
+}
+
+bool os_mutex_create(void **pp_handle)
+{
+    *pp_handle = &ftl_sem;
+    return true;
+}
+
+bool os_mutex_take(void *p_handle, uint32_t wait_ms)
+{
+    return true;
+}
+
+bool os_mutex_give(void *p_handle)
+{
+    return true;
+}
+
+void *os_mem_zalloc_intern(RAM_TYPE ram_type, size_t size, const char *p_func, uint32_t file_line)
+{
+    return ftl_sim_alloc_fail ? NULL : calloc(1, size);
+}
+
+void os_mem_free(void *p_block)
+{
+    free(p_block);
+}
+
+void log_buffer(uint32_t info, uint32_t log_str_index, uint8_t param_num, ...)
+{
+}
+
+static void ftl_sim_map(uint32_t addr)
+{
+    void *p = mmap((void *)(uintptr_t)addr, 0x1000, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+    if (p != (void *)(uintptr_t)addr)
+    {
+        printf("map 0x%08x failed\n", addr);
+        abort();
+    }
+}
+
+void ftl_sim_flash_init(uint8_t page_num)
+{
+    if (NULL == g_pPage)
+    {
+        ftl_sim_map(FTL_SIM_OTP_ADDR);
+        ftl_sim_map(FTL_SIM_VENDOR_ADDR);
+        /* the ftl keeps page addresses in 32 bits */
+        g_pPage = mmap(NULL, 255 * sizeof(struct Page_T), PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_32BIT, -1, 0);
+        if (MAP_FAILED == g_pPage)
+        {
+            printf("map pages failed\n");
+            abort();
+        }
+    }
+    g_PAGE_num = page_num;
+    memset(g_pPage, 0xff, page_num * sizeof(struct Page_T));
+    memset(&ftl_sim_stat, 0, sizeof(ftl_sim_stat));
+    ftl_sim_tick_add(0);
+}
+
+void ftl_sim_reboot(void)
+{
+    free(ftl_map_table);
+    ftl_map_table = NULL;
+    g_cur_pageID = 0;
+    g_free_cell_index = 0;
+    g_doingGarbageCollection = 0;
+    ftl_init_app_cb((uint32_t)(uintptr_t)g_pPage, g_PAGE_num);
+}
+
+void ftl_sim_map_alloc_fail(bool fail)
+{
+    ftl_sim_alloc_fail = fail;
+}
+
+void ftl_sim_stat_get(ftl_sim_stat_t *pstat)
+{
+    *pstat = ftl_sim_stat;
+}
+
+#endif /* PLATFORM_HOST_SIM */
@@ -0,0 +1,91 @@
+/**
+*****************************************************************************************
+*     Copyright(c) 2015, Realtek Semiconductor Corporation. All rights reserved.
+*****************************************************************************************
+  * @file     ftl_rom_sim.h
+  * @brief    Head file for the host model of the rom ftl page layer.
+  * @details  Pages, page header, erase, program and garbage collect loop of the rom, with the
+  *           flash timing of the puya flash, so ftl_app_cb.c runs unchanged on a linux host.
+  *           ftl_save and ftl_load go word by word through the app callbacks as in the rom.
+  *           Build it with PLATFORM_HOST_SIM=1 and link it with ftl_app_cb.c and a harness,
+  *           not with platform_sim.c, which has an ftl of its own, e.g.
+  *           gcc -DPLATFORM_HOST_SIM=1 <keil include path> ftl_rom_sim.c ftl_app_cb.c <harness.c>
+  * @author   bill
+  * @date     2018-12-24
+  * @version  v1.0
+  * *************************************************************************************
+  */
+
+/* Define to prevent recursive inclusion */
+#ifndef _FTL_ROM_SIM_H
+#define _FTL_ROM_SIM_H
+
+/* Add Includes here */
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef  __cplusplus
+extern  "C" {
+#endif  // __cplusplus
+
+/** @addtogroup Ftl_Rom_Sim
+  * @{
+  */
+
+/** @defgroup Ftl_Rom_Sim_Exported_Macros Exported Macros
+  * @brief
+  * @{
+  */
+#define FTL_SIM_PAGE_NUM                    8 //!< pages of the ftl section of the light boards
+#define FTL_SIM_TICK_READ                   2 //!< 40MHz ticks to read a word
+#define FTL_SIM_TICK_PROGRAM                400 //!< 40MHz ticks to program a word, 10us
+#define FTL_SIM_TICK_ERASE                  1200000 //!< 40MHz ticks to erase a page, 30ms
+#define FTL_SIM_TICK_TO_MS(tick)            ((tick) / 40000.0)
+/** @} */
+
+/** @defgroup Ftl_Rom_Sim_Exported_Types Exported Types
+  * @brief
+  * @{
+  */
+typedef struct
+{
+    uint64_t tick; //!< 40MHz ticks spent on the flash
+    uint32_t read_count; //!< words read
+    uint32_t program_count; //!< words programmed
+    uint32_t erase_count; //!< pages erased
+    uint32_t format_count; //!< pages formatted, that is consumed by the ftl
+    uint32_t gc_count; //!< pages collected by the rom gc loop, the write waited on them
+    uint32_t clear_all_count; //!< FTL_IOCTL_CLEAR_ALL invoke times
+} ftl_sim_stat_t;
+/** @} */
+
+/** @defgroup Ftl_Rom_Sim_Exported_Functions Exported Functions
+  * @brief
+  * @{
+  */
+/**
+ * @brief erase the whole ftl section and clear the statistics
+ * @param[in] page_num: pages of the ftl section
+ */
+void ftl_sim_flash_init(uint8_t page_num);
+
+/**
+ * @brief reboot, ram state of the ftl is dropped and ftl_init_app_cb rebuilds it from the pages
+ */
+void ftl_sim_reboot(void);
+
+/**
+ * @brief make the heap refuse the mapping table, reads scan the pages then
+ * @param[in] fail: refuse the allocations from the next reboot on
+ */
+void ftl_sim_map_alloc_fail(bool fail);
+
+void ftl_sim_stat_get(ftl_sim_stat_t *pstat);
+/** @} */
+/** @} */
+
+#ifdef  __cplusplus
+}
+#endif // __cplusplus
+
+#endif /* _FTL_ROM_SIM_H */